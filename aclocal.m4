@@ -47,6 +47,7 @@ sinclude(build/ac-macros/sqlite.m4)
 sinclude(build/ac-macros/swig.m4)
 sinclude(build/ac-macros/zlib.m4)
 sinclude(build/ac-macros/lz4.m4)
+sinclude(build/ac-macros/zstd.m4)
 sinclude(build/ac-macros/kwallet.m4)
 sinclude(build/ac-macros/libsecret.m4)
 sinclude(build/ac-macros/utf8proc.m4)
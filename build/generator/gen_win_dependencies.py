@@ -126,6 +126,7 @@ class GenDependenciesBase(gen_base.GeneratorBase):
         'magic',
         'macos-plist',
         'macos-keychain',
+        'zstd',
   ]
 
   # When build.conf contains a 'when = SOMETHING' where SOMETHING is not in
@@ -33,6 +33,7 @@
             [--httpd-version=<version>] [--httpd-whitelist=<version>]
             [--config-file=<file>] [--ssl-cert=<file>]
             [--exclusive-wc-locks] [--memcached-server=<url:port>]
+            [--http-http2]
             [--fsfs-compression=<type>] [--fsfs-dir-deltification=<true|false>]
             [--allow-remote-http-connection]
             <abs_srcdir> <abs_builddir>
@@ -269,6 +270,8 @@ class TestHarness:
       cmdline.append('--http-proxy-username=%s' % self.opts.http_proxy_username)
     if self.opts.http_proxy_password is not None:
       cmdline.append('--http-proxy-password=%s' % self.opts.http_proxy_password)
+    if self.opts.http_http2 is not None:
+      cmdline.append('--http-http2')
     if self.opts.httpd_version is not None:
       cmdline.append('--httpd-version=%s' % self.opts.httpd_version)
     if self.opts.httpd_whitelist is not None:
@@ -1024,6 +1027,8 @@ def create_parser():
                     help='Username for the HTTP Proxy.')
   parser.add_option('--http-proxy-password', action='store',
                     help='Password for the HTTP Proxy.')
+  parser.add_option('--http-http2', action='store_true',
+                    help='Multiplex HTTP requests over http/2.')
   parser.add_option('--httpd-version', action='store',
                     help='Assume HTTPD is this version.')
   parser.add_option('--httpd-whitelist', action='store',
@@ -179,6 +179,16 @@ typedef struct svn_cache__info_t
    * highest array index.
    */
   apr_uint64_t histogram[32];
+
+  /** Number of blocks of data that were requested to be read ahead
+   * because they were expected to end up in this cache soon.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t read_ahead_blocks;
+
+  /** Number of those blocks that have subsequently been read.
+   */
+  apr_uint64_t read_ahead_hits;
 } svn_cache__info_t;
 
 /**
@@ -310,6 +320,32 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place the cache into the
+ * file at @a path, which will be memory-mapped and shared with all other
+ * processes that use the same file.  The file will be created and sized
+ * as necessary.  All processes sharing a file must pass the same
+ * @a total_size, @a directory_size and @a segment_count; an error is
+ * returned for files that have been created with different settings.
+ *
+ * Access will be synchronized across processes using byte-range locks on
+ * each cache segment's region of the file.
+ * @a thread_safe only controls the synchronization between threads of
+ * the current process.  @a result_pool must outlive the cache.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * memory-mapped files.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         const char *path,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t thread_safe,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -391,6 +427,30 @@ svn_cache__create_null(svn_cache__t **cache_p,
                        const char *id,
                        apr_pool_t *result_pool);
 
+/**
+ * Creates a new cache in @a *cache_p that combines the @a primary and
+ * @a secondary caches into a single one.  Both must use the same keys
+ * and value types.  Lookups are served from @a primary if possible and
+ * fall back to @a secondary otherwise.  Items found in @a secondary only
+ * will be copied to @a primary.  New items are written to both caches.
+ *
+ * This allows a small but fast cache to be backed by a larger but slower
+ * one, e.g. one that persists its contents across process restarts.
+ * The serialized forms used by @a secondary may differ from those used by
+ * @a primary, because partial getters and setters will only be applied
+ * to @a primary.  Partial lookups of items that @a primary refuses to
+ * store will therefore be misses.
+ *
+ * Errors reported by either cache will be processed by their respective
+ * error handlers before being passed on to the caller.  Allocate the
+ * new cache in @a result_pool.
+ */
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *primary,
+                         svn_cache__t *secondary,
+                         apr_pool_t *result_pool);
+
 /**
  * Sets @a handler to be @a cache's error handling routine.  If any
  * error is returned from a call to svn_cache__get or svn_cache__set, @a
@@ -561,6 +621,21 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Record in the global membuffer statistics that a read-ahead has been
+ * issued for @a blocks blocks of data, which will presumably be put into
+ * one of the membuffer caches soon.
+ */
+void
+svn_cache__membuffer_record_read_ahead(apr_uint32_t blocks);
+
+/**
+ * Record in the global membuffer statistics that a block of data that
+ * had been read ahead actually got used.
+ */
+void
+svn_cache__membuffer_record_read_ahead_hit(void);
+
 /**
  * Remove all current contents from CACHE.
  *
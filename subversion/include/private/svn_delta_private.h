@@ -108,6 +108,33 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** The largest target and source view that svndiff versions 3 and 4
+ * permit in a single window.  Older svndiff versions are limited to 100kB.
+ */
+#define SVN_DELTA__MAX_WINDOW_SIZE (8 * 1024 * 1024)
+
+/** Similar to svn_txdelta_target_push() but produce windows with target
+ * views of up to @a window_size bytes instead of the standard 100kB.
+ * @a window_size must not exceed #SVN_DELTA__MAX_WINDOW_SIZE.
+ *
+ * Source views are aligned with the target views, i.e. the N-th window
+ * will use the N-th @a window_size bytes of @a source.  Windows larger
+ * than the standard size may only be serialized using svndiff version 3
+ * or 4.
+ */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool);
+
+/** Return TRUE if this build of Subversion can read and write svndiff
+ * version 4, i.e. if it has been built with Zstandard support.
+ */
+svn_boolean_t
+svn_txdelta__svndiff4_supported(void);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
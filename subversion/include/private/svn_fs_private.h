@@ -211,6 +211,30 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** Find out whether the contents of the file @a path under @a root are
+ * stored verbatim, i.e. neither deltified nor compressed, in a single
+ * range of some repository file.  If so, set @a *file to that file,
+ * opened for reading in @a result_pool, and set @a *offset and
+ * @a *length to the location of the contents within @a *file.
+ * Otherwise, set @a *file to NULL.
+ *
+ * This allows for copying file contents to the network without
+ * processing them.  Note that they will not be verified against their
+ * checksum in that case.  Not all back-ends support this.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_fs__get_contents_location(apr_file_t **file,
+                              apr_off_t *offset,
+                              svn_filesize_t *length,
+                              svn_fs_root_t *root,
+                              const char *path,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
 
 /** @} */
 
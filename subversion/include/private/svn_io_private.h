@@ -84,6 +84,20 @@ svn_error_t *
 svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
+/**
+ * Ask the operating system to asynchronously read @a length bytes of
+ * @a file, starting at @a offset, into its file cache.  This does not
+ * change the file pointer nor any data buffered by APR.
+ *
+ * This is merely a hint.  It is a no-op on platforms that don't support
+ * it.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_read_ahead(apr_file_t *file,
+                        apr_off_t offset,
+                        apr_off_t length,
+                        apr_pool_t *scratch_pool);
+
 
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
@@ -264,6 +264,15 @@ svn_log__list(const char *path, svn_revnum_t revision,
               apr_array_header_t *patterns, svn_depth_t depth,
               apr_uint32_t dirent_fields, apr_pool_t *pool);
 
+/**
+ * Return a log string for fetching the contents of @a num_files files
+ * with a single request.
+ *
+ * @since New in 1.13.
+ */
+const char *
+svn_log__fetch_files(int num_files, apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
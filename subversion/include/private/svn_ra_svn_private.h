@@ -132,6 +132,13 @@ svn_ra_svn__set_capabilities(svn_ra_svn_conn_t *conn,
 int
 svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn);
 
+/** Return #SVN_RA_SVN_CAP_SVNDIFF4_ACCEPTED if this build of Subversion
+ * can decode svndiff4 data and @c NULL otherwise.  The result is meant to
+ * be passed as an optional word when announcing our capabilities.
+ */
+const char *
+svn_ra_svn__svndiff4_capability(void);
+
 
 /**
  * Set the shim callbacks to be used by @a conn to @a shim_callbacks.
@@ -169,6 +176,30 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_string_t *str);
 
+/** Return TRUE if svn_ra_svn__write_file_range() may be used on @a conn.
+ * That is the case for plain socket connections on platforms supporting
+ * sendfile().
+ *
+ * @since New in 1.13.
+ */
+svn_boolean_t
+svn_ra_svn__can_write_file_range(svn_ra_svn_conn_t *conn);
+
+/** Write @a len bytes from @a file, starting at @a offset, over the net
+ * as a single string.  The data will be sent directly from @a file to the
+ * network, without being copied through the write buffer.
+ *
+ * Any data buffered before gets flushed.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_ra_svn__write_file_range(svn_ra_svn_conn_t *conn,
+                             apr_pool_t *pool,
+                             apr_file_t *file,
+                             apr_off_t offset,
+                             apr_size_t len);
+
 /** Write a cstring over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -365,6 +396,19 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
                         svn_ra_svn_conn_t *conn,
                         apr_pool_t *pool);
 
+/** Like svn_ra_svn__has_command() but set @a *has_command only if the
+ * receive buffer of @a conn contains a complete command, i.e. one that
+ * can be handled without waiting for further data.  Commands too large
+ * for the receive buffer count as complete once the buffer is full.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_ra_svn__has_complete_command(svn_boolean_t *has_command,
+                                 svn_boolean_t *terminated,
+                                 svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool);
+
 /** Accept a single command from @a conn and handle them according
  * to @a cmd_hash.  Command handlers will be passed @a conn, @a pool,
  * the parameters of the command, and @a baton.  @a *terminate will be
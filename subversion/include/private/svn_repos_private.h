@@ -388,6 +388,29 @@ svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
                            const char *update_anchor_relpath,
                            apr_pool_t *pool);
 
+/**
+ * Create the history index of @a repos if it does not exist yet and add
+ * all revisions of @a repos to it that it does not contain yet.  Set
+ * @a *start_rev and @a *end_rev to the range of revisions that have been
+ * added, or to #SVN_INVALID_REVNUM if the index was up to date already.
+ *
+ * The history index speeds up walking node histories in the log,
+ * file-revs and similar functions.  Once it exists, it will be kept up
+ * to date by svn_repos_fs_commit_txn().
+ *
+ * Use @a cancel_func and @a cancel_baton to check for cancellation.  Use
+ * @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos__build_history_index(svn_revnum_t *start_rev,
+                               svn_revnum_t *end_rev,
+                               svn_repos_t *repos,
+                               svn_cancel_func_t cancel_func,
+                               void *cancel_baton,
+                               apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -591,6 +591,31 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* The zstd compression level used when none has been given explicitly. */
+#define SVN__ZSTD_DEFAULT_LEVEL 3
+
+/* Same as svn__compress_zlib(), but use Zstandard compression at the
+ * given COMPRESSION_LEVEL.  Levels below 1 select SVN__ZSTD_DEFAULT_LEVEL
+ * and levels beyond the maximum supported by the library are clipped.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if Subversion has been built without
+ * zstd support, i.e. if SVN_HAVE_ZSTD is not defined.
+ */
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int compression_level);
+
+/* Same as svn__decompress_zlib(), but use Zstandard compression.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if Subversion has been built without
+ * zstd support.
+ */
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit);
+
 /** @} */
 
 /**
@@ -746,6 +771,14 @@ const char *svn_lz4__compiled_version(void);
  */
 int svn_lz4__runtime_version(void);
 
+/* Return the zstd version we compiled against or NULL, if Subversion has
+ * been built without zstd support. */
+const char *svn_zstd__compiled_version(void);
+
+/* Return the zstd version we run against or NULL, if Subversion has been
+ * built without zstd support. */
+const char *svn_zstd__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,164 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_task_group.h
+ * @brief Tracking tasks queued on an APR thread pool
+ */
+
+#ifndef SVN_TASK_GROUP_H
+#define SVN_TASK_GROUP_H
+
+#include <apr_pools.h>
+#include <apr_time.h>
+
+#include "svn_error.h"
+
+#if APR_HAS_THREADS
+#include <apr_thread_pool.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if APR_HAS_THREADS
+
+/**
+ * A task group keeps count of the tasks that its owner queued on an
+ * @c apr_thread_pool_t, lets the owner wait for them and makes sure that
+ * none of them is left queued or running once the owner shuts down.
+ *
+ * The group also provides a mutex and a condition variable that the
+ * owner and its tasks may use to protect and signal their own state.
+ * Functions documented as "called with the group locked" must only be
+ * called while holding that mutex.
+ */
+typedef struct svn_task_group__t svn_task_group__t;
+
+/** Set @a *thread_pool to a new thread pool with up to @a max_threads
+ * worker threads.  Threads only get created when there are tasks to run
+ * and tasks only get queued when all threads are busy.
+ *
+ * The thread pool lives in a root pool of its own and gets destroyed when
+ * @a owning_pool is cleaned up.  To shut down groups using it first, create
+ * those groups after calling this function.
+ */
+svn_error_t *
+svn_task_group__create_thread_pool(apr_thread_pool_t **thread_pool,
+                                   apr_size_t max_threads,
+                                   apr_pool_t *owning_pool);
+
+/** Set @a *group to a new, empty task group allocated in @a result_pool.
+ */
+svn_error_t *
+svn_task_group__create(svn_task_group__t **group,
+                       apr_pool_t *result_pool);
+
+/** Acquire the mutex of @a group. */
+void
+svn_task_group__lock(svn_task_group__t *group);
+
+/** Release the mutex of @a group. */
+void
+svn_task_group__unlock(svn_task_group__t *group);
+
+/** Wait for svn_task_group__notify() to be called on @a group.
+ * Called with the group locked.
+ */
+void
+svn_task_group__wait(svn_task_group__t *group);
+
+/** Like svn_task_group__wait() but return after at most @a timeout
+ * microseconds in any case.
+ * Called with the group locked.
+ */
+void
+svn_task_group__timed_wait(svn_task_group__t *group,
+                           apr_interval_time_t timeout);
+
+/** Wake up all threads waiting on @a group.
+ * Called with the group locked.
+ */
+void
+svn_task_group__notify(svn_task_group__t *group);
+
+/** Queue @a func with @a data on @a thread_pool as a task of @a group.
+ * @a func must call svn_task_group__task_begin() and
+ * svn_task_group__task_end() as described there.
+ * Called with the group locked.
+ *
+ * Return @c APR_EGENERAL if @a group has been shut down.  Nothing will
+ * have been queued if this returns an error.
+ */
+apr_status_t
+svn_task_group__push(svn_task_group__t *group,
+                     apr_thread_pool_t *thread_pool,
+                     apr_thread_start_t func,
+                     void *data);
+
+/** To be called by every task of @a group before it does anything else.
+ * Return FALSE if @a group has been shut down, in which case the task
+ * must not do any work but still call svn_task_group__task_end().
+ * Called with the group locked.
+ */
+svn_boolean_t
+svn_task_group__task_begin(svn_task_group__t *group);
+
+/** To be called by every task of @a group when it is done.  The task must
+ * not access any of its owner's data after releasing the group's mutex.
+ * Called with the group locked.
+ */
+void
+svn_task_group__task_end(svn_task_group__t *group);
+
+/** Return the number of tasks of @a group that have been queued but not
+ * finished yet.
+ * Called with the group locked.
+ */
+int
+svn_task_group__pending(svn_task_group__t *group);
+
+/** Wait until all tasks of @a group have finished.
+ * Called with the group locked.
+ */
+void
+svn_task_group__wait_all(svn_task_group__t *group);
+
+/** Shut down @a group.  Tasks that have not started yet won't do any work.
+ * Wait for running tasks to finish and remove the others from
+ * @a thread_pool.  Afterwards, no task of @a group is queued or running.
+ *
+ * @a thread_pool may be @c NULL if it has been destroyed already, which
+ * drops all of its queued tasks.
+ * Called with the group unlocked.
+ */
+void
+svn_task_group__shutdown(svn_task_group__t *group,
+                         apr_thread_pool_t *thread_pool);
+
+#endif /* APR_HAS_THREADS */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TASK_GROUP_H */
@@ -398,6 +398,26 @@ svn_wc__status2_from_3(svn_wc_status2_t **status,
                        apr_pool_t *result_pool,
                        apr_pool_t *scratch_pool);
 
+/**
+ * Watch the working copy that contains @a local_abspath for changes on
+ * disk until @a cancel_func returns an error, which is then returned.
+ *
+ * While this runs, status walks of that working copy only read directories
+ * that changed since the previous walk, reusing the entries found back
+ * then for all others.
+ *
+ * Return #SVN_ERR_WC_LOCKED if the working copy is already being watched
+ * and #SVN_ERR_UNSUPPORTED_FEATURE on platforms other than Linux.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_wc__monitor_run(svn_wc_context_t *wc_ctx,
+                    const char *local_abspath,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool);
+
 /**
  * Set @a *children to a new array of the immediate children of the working
  * node at @a dir_abspath.  The elements of @a *children are (const char *)
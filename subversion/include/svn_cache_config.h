@@ -83,6 +83,29 @@ svn_cache_config_get(void);
 void
 svn_cache_config_set(const svn_cache_config_t *settings);
 
+/** Place the process-global membuffer cache into the file at @a path.
+   That file will be memory-mapped and shared with all other processes
+   that use the same file, e.g. the worker processes of a pre-forking
+   server.  All of them must use the same cache size.  If @a path is
+   @c NULL (the default), the cache will be local to this process.
+
+   If the shared cache cannot be created, a process-local cache will be
+   used instead.  @a path must remain valid for the lifetime of the
+   process.  The same restrictions as for svn_cache_config_set() apply.
+
+   @since New in 1.13.
+ */
+void
+svn_cache_config_set_shared_file(const char *path);
+
+/** Return the path set by svn_cache_config_set_shared_file() or @c NULL
+   for process-local caches.
+
+   @since New in 1.13.
+ */
+const char *
+svn_cache_config_get_shared_file(void);
+
 /** @} */
 
 /** @} */
@@ -413,6 +413,15 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF2\
             SVN_DAV_PROP_NS_DAV "svn/svndiff2"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff4 format encoding.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF4\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff4"
+
 /** Presence of this in a DAV header in an OPTIONS response indicates
  * that the transmitter (in this case, the server) sends the result
  * checksum in the response to a successful PUT request.
@@ -422,6 +431,16 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM\
             SVN_DAV_PROP_NS_DAV "svn/put-result-checksum"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * 'fetch-files' requests, which send the contents of many files in a
+ * single response.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_DAV_NS_DAV_SVN_FETCH_FILES\
+            SVN_DAV_PROP_NS_DAV "svn/fetch-files"
+
 /** @} */
 
 /** @} */
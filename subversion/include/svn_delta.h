@@ -526,7 +526,16 @@ svn_txdelta_apply(svn_stream_t *source,
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
  * svndiff2 format.  @a compression_level is currently ignored if
- * @a svndiff_version is set to 2.
+ * @a svndiff_version is set to 2.  Since 1.13, @a svndiff_version can
+ * be 3 for the svndiff3 format, which uses zlib compression like svndiff1
+ * but encodes instructions more compactly and permits larger windows.
+ * It can also be 4 for the svndiff4 format, which is svndiff3 using
+ * Zstandard compression instead of zlib.  In that case, @a compression_level
+ * is the zstd compression level, with #SVN_DELTA_COMPRESSION_LEVEL_NONE
+ * selecting zstd's default level.  svndiff4 is only available if Subversion
+ * has been built with zstd support.  Since 1.13, @a *handler fails with
+ * #SVN_ERR_SVNDIFF_CORRUPT_WINDOW for windows that are larger than
+ * @a svndiff_version permits.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -597,6 +606,10 @@ svn_txdelta_to_svndiff_stream(svn_txdelta_stream_t *txstream,
  * signal completion to the window handler, regardless of how much data
  * was written, and discard any pending incomplete data.
  *
+ * Windows must not exceed #SVN_DELTA_WINDOW_SIZE, whichever svndiff
+ * version is used.  Larger windows only occur in repository storage,
+ * which is read through svn_txdelta_read_svndiff_window().
+ *
  * Allocate the stream in @a pool.
  */
 svn_stream_t *
@@ -166,6 +166,37 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** String with a decimal representation of the size of the delta windows,
+ * in bytes, that a newly created FSFS format 9 repository shall use.
+ * Larger windows allow for effective deltification of large files with
+ * data being inserted or removed but increase the memory consumption.
+ *
+ * The value must be between 102400 and 8388608 bytes.  The default is
+ * 1048576 bytes.
+ *
+ * This option will only be used during the creation of new repositories
+ * and is otherwise ignored.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_DELTA_WINDOW_SIZE    "fsfs-delta-window-size"
+
+/** String with a decimal representation of the number of worker threads
+ * that svn_fs_verify() shall use for a FSFS repository.  The revision
+ * range will be split along shards and pack files and the checks will
+ * be run concurrently.  Progress notifications and errors are still being
+ * reported in revision order.
+ *
+ * Values below 2 (the default) disable concurrent verification.  This
+ * option is ignored if APR has been built without thread support.
+ *
+ * @note When this is enabled, the cancellation function passed to
+ * svn_fs_verify() may be called from worker threads.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_VERIFY_JOBS          "fsfs-verify-jobs"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
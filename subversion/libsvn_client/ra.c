@@ -308,10 +308,14 @@ progress_func(apr_off_t progress,
 
   if (public_ctx->progress_func)
     {
-      /* All RA implementations currently provide -1 for total. So it doesn't
-         make sense to develop some complex logic to combine total across all
-         RA sessions. */
-      public_ctx->progress_func(private_ctx->total_progress, -1,
+      /* Only ra_serf provides a total, and only while it knows how much
+         data is still to come for an update.  Just add that remainder to
+         the progress accumulated across all RA sessions. */
+      public_ctx->progress_func(private_ctx->total_progress,
+                                total >= 0
+                                  ? private_ctx->total_progress
+                                    + (total - progress)
+                                  : -1,
                                 public_ctx->progress_baton, pool);
     }
 }
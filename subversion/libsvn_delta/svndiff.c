@@ -39,13 +39,19 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
+static const char SVNDIFF_V4[] = { 'S', 'V', 'N', 4 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 4)
+    return SVNDIFF_V4;
+  else if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -70,9 +76,35 @@ struct encoder_baton {
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+   section for windows of up to WINDOW_SIZE bytes: in theory, the
+   instructions could be WINDOW_SIZE 1-byte copy-from-source instructions
+   (though this is very unlikely). */
+#define MAX_INSTRUCTION_SECTION_LEN(window_size) \
+  ((window_size) * MAX_INSTRUCTION_LEN)
+
+/* Return the maximum size of the source and target views that svndiff
+   VERSION permits.  Only versions 3 and later support windows that are
+   larger than what svn_txdelta() produces.
+
+   Large windows only ever occur in repository storage.  Svndiff streams
+   received from the network or from dump files are always limited to
+   SVN_DELTA_WINDOW_SIZE; see svn_txdelta_parse_svndiff().  Otherwise, a
+   peer could make us allocate hundreds of MB per window. */
+static apr_size_t
+max_window_size(int version)
+{
+  return version >= 3 ? SVN_DELTA__MAX_WINDOW_SIZE : SVN_DELTA_WINDOW_SIZE;
+}
+
+svn_boolean_t
+svn_txdelta__svndiff4_supported(void)
+{
+#ifdef SVN_HAVE_ZSTD
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
 
 
 /* Append an encoded integer to a string.  */
@@ -169,6 +201,8 @@ encode_window(svn_stringbuf_t **instructions_p,
   const svn_string_t *newdata;
   unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
   const svn_txdelta_op_t *op;
+  apr_size_t tpos = 0;
+  apr_size_t last_src_end = 0;
 
   /* create the necessary data buffers */
   instructions = svn_stringbuf_create_empty(pool);
@@ -189,16 +223,44 @@ encode_window(svn_stringbuf_t **instructions_p,
         *ip++ |= (unsigned char)op->length;
       else
         ip = svn__encode_uint(ip + 1, op->length);
-      if (op->action_code != svn_txdelta_new)
-        ip = svn__encode_uint(ip, op->offset);
+
+      /* Encode the offset.  Svndiff3 stores them relative to where the
+         copies are most likely to start.  With large windows, that is
+         much shorter than the absolute value. */
+      if (version >= 3 && op->action_code == svn_txdelta_source)
+        {
+          /* Source copies usually continue where the previous one ended. */
+          ip = svn__encode_int(ip, (apr_int64_t)op->offset
+                                   - (apr_int64_t)last_src_end);
+          last_src_end = op->offset + op->length;
+        }
+      else if (version >= 3 && op->action_code == svn_txdelta_target)
+        {
+          /* Target copies usually refer to data close to TPOS. */
+          ip = svn__encode_uint(ip, tpos - op->offset);
+        }
+      else if (op->action_code != svn_txdelta_new)
+        {
+          ip = svn__encode_uint(ip, op->offset);
+        }
+
       svn_stringbuf_appendbytes(instructions, (const char *)ibuf, ip - ibuf);
+      tpos += op->length;
     }
 
   /* Encode the header.  */
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *compressed_instructions;
+      compressed_instructions = svn_stringbuf_create_empty(pool);
+      SVN_ERR(svn__compress_zstd(instructions->data, instructions->len,
+                                 compressed_instructions, compression_level));
+      instructions = compressed_instructions;
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -206,7 +268,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed_instructions));
       instructions = compressed_instructions;
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +279,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__compress_zstd(window->new_data->data,
+                                 window->new_data->len,
+                                 compressed, compression_level));
+      newdata = svn_stringbuf__morph_into_string(compressed);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -225,7 +296,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed));
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -256,6 +327,13 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   svn_stringbuf_t *header;
   const svn_string_t *newdata;
 
+  /* Never write windows that readers of this svndiff version reject. */
+  if (window && (   window->sview_len > max_window_size(eb->version)
+                 || window->tview_len > max_window_size(eb->version)))
+    return svn_error_createf(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                             _("Delta window is too large for svndiff%d"),
+                             eb->version);
+
   /* use specialized code if there is no source */
   if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
     return svn_error_trace(send_simple_insertion_window(window, eb));
@@ -426,11 +504,19 @@ decode_size(apr_size_t *val,
 
 /* Decode an instruction into OP, returning a pointer to the text
    after the instruction.  Note that if the action code is
-   svn_txdelta_new, the offset field of *OP will not be set.  */
+   svn_txdelta_new, the offset field of *OP will not be set.
+
+   For svndiff VERSION 3 and later, offsets are relative.  TPOS is the
+   current position within the target view and *LAST_SRC_END the end of
+   the previous copy from source (0 for the first one); the latter will
+   be updated as we decode source copies.  */
 static const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
                    const unsigned char *p,
-                   const unsigned char *end)
+                   const unsigned char *end,
+                   int version,
+                   apr_size_t *last_src_end,
+                   apr_size_t tpos)
 {
   apr_size_t c;
   apr_size_t action;
@@ -458,12 +544,53 @@ decode_instruction(svn_txdelta_op_t *op,
       if (p == NULL)
         return NULL;
     }
-  if (action != svn_txdelta_new)
+  if (action == svn_txdelta_new)
+    return p;
+
+  if (version < 3)
     {
       p = decode_size(&op->offset, p, end);
       if (p == NULL)
         return NULL;
     }
+  else if (action == svn_txdelta_source)
+    {
+      apr_int64_t delta;
+      apr_uint64_t magnitude;
+
+      p = svn__decode_int(&delta, p, end);
+      if (p == NULL)
+        return NULL;
+
+      /* Reject offsets that don't fit into apr_size_t. */
+      if (delta < 0)
+        {
+          magnitude = 0 - (apr_uint64_t)delta;
+          if (magnitude > *last_src_end)
+            return NULL;
+          op->offset = *last_src_end - (apr_size_t)magnitude;
+        }
+      else
+        {
+          magnitude = (apr_uint64_t)delta;
+          if (magnitude > APR_SIZE_MAX - *last_src_end)
+            return NULL;
+          op->offset = *last_src_end + (apr_size_t)magnitude;
+        }
+
+      if (op->length > APR_SIZE_MAX - op->offset)
+        return NULL;
+      *last_src_end = op->offset + op->length;
+    }
+  else
+    {
+      apr_size_t distance;
+
+      p = decode_size(&distance, p, end);
+      if (p == NULL || distance == 0 || distance > tpos)
+        return NULL;
+      op->offset = tpos - distance;
+    }
 
   return p;
 }
@@ -478,15 +605,16 @@ count_and_verify_instructions(int *ninst,
                               const unsigned char *end,
                               apr_size_t sview_len,
                               apr_size_t tview_len,
-                              apr_size_t new_len)
+                              apr_size_t new_len,
+                              int version)
 {
   int n = 0;
   svn_txdelta_op_t op;
-  apr_size_t tpos = 0, npos = 0;
+  apr_size_t tpos = 0, npos = 0, last_src_end = 0;
 
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      p = decode_instruction(&op, p, end, version, &last_src_end, tpos);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
@@ -546,16 +674,18 @@ count_and_verify_instructions(int *ninst,
    the remainder of the window contents, fill in a delta window
    structure *WINDOW.  New allocations will be performed in POOL;
    the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   to by DATA.  Views have already been checked to not exceed
+   MAX_VIEW_LEN bytes and decompressed data must not exceed the limits
+   derived from it either. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
               apr_size_t newlen, const unsigned char *data, apr_pool_t *pool,
-              unsigned int version)
+              unsigned int version, apr_size_t max_view_len)
 {
   const unsigned char *insend;
   int ninst;
-  apr_size_t npos;
+  apr_size_t npos, tpos, last_src_end;
   svn_txdelta_op_t *ops, *op;
   svn_string_t *new_data;
 
@@ -565,15 +695,33 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 4)
+    {
+      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__decompress_zstd(insend, newlen, ndout,
+                                   max_view_len));
+      SVN_ERR(svn__decompress_zstd(data, insend - data, instout,
+                                   MAX_INSTRUCTION_SECTION_LEN(
+                                     max_view_len)));
+
+      newlen = ndout->len;
+      data = (unsigned char *)instout->data;
+      insend = (unsigned char *)instout->data + instout->len;
+
+      new_data = svn_stringbuf__morph_into_string(ndout);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+                                  max_view_len));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  MAX_INSTRUCTION_SECTION_LEN(
+                                    max_view_len)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -581,15 +729,16 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
       new_data = svn_stringbuf__morph_into_string(ndout);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
-                                   SVN_DELTA_WINDOW_SIZE));
+                                   max_view_len));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   MAX_INSTRUCTION_SECTION_LEN(
+                                     max_view_len)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -606,15 +755,20 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   /* Count the instructions and make sure they are all valid.  */
   SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
-                                        sview_len, tview_len, newlen));
+                                        sview_len, tview_len, newlen,
+                                        version));
 
   /* Allocate a buffer for the instructions and decode them. */
   ops = apr_palloc(pool, ninst * sizeof(*ops));
   npos = 0;
+  tpos = 0;
+  last_src_end = 0;
   window->src_ops = 0;
   for (op = ops; op < ops + ninst; op++)
     {
-      data = decode_instruction(op, data, insend);
+      data = decode_instruction(op, data, insend, version, &last_src_end,
+                                tpos);
+      tpos += op->length;
       if (op->action_code == svn_txdelta_source)
         ++window->src_ops;
       else if (op->action_code == svn_txdelta_new)
@@ -653,6 +807,10 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
+      else if (memcmp(buffer, SVNDIFF_V4 + db->header_bytes, nheader) == 0)
+        db->version = 4;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -710,11 +868,13 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
+          /* Windows from streams are never larger than the standard
+             size, independent of the svndiff version. */
           if (tview_len > SVN_DELTA_WINDOW_SIZE ||
               sview_len > SVN_DELTA_WINDOW_SIZE ||
               /* for svndiff1, newlen includes the original length */
               newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              inslen > MAX_INSTRUCTION_SECTION_LEN(SVN_DELTA_WINDOW_SIZE))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -758,7 +918,8 @@ write_handler(void *baton,
       /* Decode the window and send it off. */
       SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
                             db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
+                            db->subpool, db->version,
+                            SVN_DELTA_WINDOW_SIZE));
       SVN_ERR(db->consumer_func(&window, db->consumer_baton));
 
       p += db->inslen + db->newlen;
@@ -894,9 +1055,11 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow.
+   Views must not exceed MAX_VIEW_LEN bytes. */
 static svn_error_t *
-read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
+read_window_header(svn_stream_t *stream, apr_size_t max_view_len,
+                   svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
                    apr_size_t *header_len)
@@ -921,11 +1084,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_view_len ||
+      *sview_len > max_view_len ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_view_len + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(max_view_len))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -949,7 +1112,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   apr_size_t sview_len, tview_len, inslen, newlen, len, header_len;
   unsigned char *buf;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+  SVN_ERR(read_window_header(stream, max_window_size(svndiff_version),
+                             &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
@@ -959,7 +1123,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
                             _("Unexpected end of svndiff input"));
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
-                       newlen, buf, pool, svndiff_version);
+                       newlen, buf, pool, svndiff_version,
+                       max_window_size(svndiff_version));
 }
 
 
@@ -973,7 +1138,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
   apr_off_t offset;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+  SVN_ERR(read_window_header(stream, max_window_size(svndiff_version),
+                             &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
 
   offset = inslen + newlen;
@@ -988,7 +1154,10 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+  /* We don't know the svndiff version here.  Use the most permissive
+     limits; the window contents will be checked upon decoding anyway. */
+  SVN_ERR(read_window_header(stream, SVN_DELTA__MAX_WINDOW_SIZE,
+                             &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
 
   *window_len = inslen + newlen + header_len;
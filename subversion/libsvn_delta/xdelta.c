@@ -44,19 +44,46 @@
  */
 #define MATCH_BLOCKSIZE 64
 
-/* Size of the checksum presence FLAGS array in BLOCKS_T.  With standard
-   MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about 20x
-   the number of checksums that actually occur, i.e. we expect a >95%
+/* Minimum size of the checksum presence FLAGS array in BLOCKS_T.  With
+   standard MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about
+   20x the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
    against the FLAGS array.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
 
+/* Larger source windows (e.g. svndiff3) get larger FLAGS arrays such that
+   there are at least this many entries per source block.  Otherwise, the
+   array would saturate and stop rejecting non-matching checksums.
+ */
+#define FLAGS_PER_BLOCK 16
+
 /* "no" / "invalid" / "unused" value for positions within the delta windows
  */
 #define NO_POSITION ((apr_uint32_t)-1)
 
+/* Multiplying an adler32 value with this factor is the same as advancing
+ * it N times by a summand of 0.  Valid for N < 0x10000.
+ */
+#define ADLER32_STEP(n) (1 + (n) * 0x10000u)
+
+/* Return the summand that feeds C_IN into an adler32 checksum and removes
+ * C_OUT at the same time.  See adler32_replace().
+ *
+ * Since all arithmetics is modulo 2^32, we may combine the characters into
+ * a single summand.  That one does not depend on the checksum value itself,
+ * keeping the chain of dependent instructions short when rolling the
+ * checksum over long sequences.
+ */
+static APR_INLINE apr_uint32_t
+adler32_delta(const char c_out, const char c_in)
+{
+  return (unsigned char)c_in
+       - (unsigned char)c_out
+       - MATCH_BLOCKSIZE * 0x10000u * (unsigned char)c_out;
+}
+
 /* Feed C_IN into the adler32 checksum and remove C_OUT at the same time.
  * This function may (and will) only be called for characters that are
  * MATCH_BLOCKSIZE positions apart.
@@ -68,36 +95,33 @@
 static APR_INLINE apr_uint32_t
 adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 {
-  adler32 -= (MATCH_BLOCKSIZE * 0x10000u * ((unsigned char) c_out));
-
-  adler32 -= (unsigned char)c_out;
-  adler32 += (unsigned char)c_in;
-
-  return adler32 + adler32 * 0x10000;
+  return (adler32 + adler32_delta(c_out, c_in)) * ADLER32_STEP(1);
 }
 
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
-   at DATA.  Return the checksum value.  */
+   at DATA.  Return the checksum value.
+
+   The textbook formulation "s1 += c; s2 += s1;" forms a single dependency
+   chain over all bytes.  Instead, we use the equivalent closed form for
+   S2, i.e. the sum of all bytes weighted by their distance to the end of
+   the block.  That turns both sums into independent reductions over a
+   fixed number of elements, which compilers turn into SIMD code (SSE2,
+   AVX2, NEON etc., depending on the target) without any help from us.
+   Since no partial sum can overflow, the result is exactly the same. */
 
 static APR_INLINE apr_uint32_t
 init_adler32(const char *data)
 {
   const unsigned char *input = (const unsigned char *)data;
-  const unsigned char *last = input + MATCH_BLOCKSIZE;
 
   apr_uint32_t s1 = 0;
   apr_uint32_t s2 = 0;
+  apr_uint32_t i;
 
-  for (; input < last; input += 8)
+  for (i = 0; i < MATCH_BLOCKSIZE; ++i)
     {
-      s1 += input[0]; s2 += s1;
-      s1 += input[1]; s2 += s1;
-      s1 += input[2]; s2 += s1;
-      s1 += input[3]; s2 += s1;
-      s1 += input[4]; s2 += s1;
-      s1 += input[5]; s2 += s1;
-      s1 += input[6]; s2 += s1;
-      s1 += input[7]; s2 += s1;
+      s1 += input[i];
+      s2 += (MATCH_BLOCKSIZE - i) * input[i];
     }
 
   return s2 * 0x10000 + s1;
@@ -135,10 +159,14 @@ struct blocks
      adler32 checksum.  Since FLAGS has much more entries than SLOTS, this
      will indicate most cases of non-matching checksums with a "0" bit, i.e.
      as "known not to have a match".
-     The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
-     i.e. address the byte by the multiplicative part of adler32 and address
-     the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+     The mapping of adler32 checksum bits is [0..2][16..31][3..15] (LSB ->
+     MSB), i.e. address the byte by the multiplicative part of adler32 and
+     address the bits in that byte by the additive part of adler32.  Only
+     large arrays use the additive part for the byte address as well. */
+  char *flags;
+
+  /* Number of bytes in FLAGS minus 1.  FLAGS has a power-of-two size. */
+  apr_uint32_t flags_mask;
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -157,12 +185,21 @@ static apr_uint32_t hash_func(apr_uint32_t sum)
 }
 
 /* Return the offset in BLOCKS.FLAGS for the adler32 SUM. */
-static apr_uint32_t hash_flags(apr_uint32_t sum)
+static APR_INLINE apr_uint32_t
+hash_flags(const struct blocks *blocks, apr_uint32_t sum)
 {
   /* The upper half of SUM has a wider value range than the lower 16 bit.
      Also, we want to a different folding than HASH_FUNC to minimize
-     correlation between different hash levels. */
-  return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
+     correlation between different hash levels.  For up to 64k bytes of
+     FLAGS, this is just the upper half of SUM. */
+  return ((sum >> 16) | ((sum >> 3) << 16)) & blocks->flags_mask;
+}
+
+/* Return TRUE, if BLOCKS may contain an entry for the adler32 SUM. */
+static APR_INLINE svn_boolean_t
+may_match(const struct blocks *blocks, apr_uint32_t sum)
+{
+  return (blocks->flags[hash_flags(blocks, sum)] & (1 << (sum & 7))) != 0;
 }
 
 /* Insert a block with the checksum ADLERSUM at position POS in the source
@@ -182,7 +219,7 @@ add_block(struct blocks *blocks, apr_uint32_t adlersum, apr_uint32_t pos)
 
   blocks->slots[h].adlersum = adlersum;
   blocks->slots[h].pos = pos;
-  blocks->flags[hash_flags(adlersum)] |= 1 << (adlersum & 7);
+  blocks->flags[hash_flags(blocks, adlersum)] |= 1 << (adlersum & 7);
 }
 
 /* Find a block in BLOCKS with the checksum ADLERSUM and matching the content
@@ -216,6 +253,7 @@ init_blocks_table(const char *data,
   apr_size_t nblocks;
   apr_size_t wnslots = 1;
   apr_uint32_t nslots;
+  apr_uint32_t nflags = FLAGS_COUNT;
   apr_uint32_t i;
 
   /* Be pessimistic about the block count. */
@@ -247,8 +285,13 @@ init_blocks_table(const char *data,
       blocks->slots[i].pos = NO_POSITION;
     }
 
-  /* No checksum entries in SLOTS, yet => reset all checksum flags. */
-  memset(blocks->flags, 0, sizeof(blocks->flags));
+  /* Scale the FLAGS array with the number of blocks.  NBLOCKS is
+     proportional to the window size, so this can't overflow.
+     No checksum entries in SLOTS, yet => reset all checksum flags. */
+  while (nflags < nblocks * FLAGS_PER_BLOCK)
+    nflags *= 2;
+  blocks->flags_mask = nflags / 8 - 1;
+  blocks->flags = apr_pcalloc(pool, nflags / 8);
 
   /* If there is an odd block at the end of the buffer, we will
      not use that shorter block for deltification (only indirectly
@@ -278,7 +321,7 @@ find_match(const struct blocks *blocks,
            apr_size_t pending_insert_start)
 {
   apr_size_t apos, bpos = *bposp;
-  apr_size_t delta, max_delta;
+  apr_size_t delta, max_delta, back;
 
   apos = find_block(blocks, rolling, b + bpos);
 
@@ -296,12 +339,13 @@ find_match(const struct blocks *blocks,
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+  max_delta = apos < bpos - pending_insert_start
+            ? apos
+            : bpos - pending_insert_start;
+  back = svn_cstring__reverse_match_length(a + apos, b + bpos, max_delta);
+  apos -= back;
+  bpos -= back;
+  delta += back;
 
   *aposp = apos;
   *bposp = bpos;
@@ -413,12 +457,65 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
       apr_size_t apos;
 
       /* Quickly skip positions whose respective ROLLING checksums
-         definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
+         definitely do not match any SLOT in BLOCKS.
+
+         Rolling the checksum is inherently sequential.  To not be limited
+         by instruction latencies, calculate the checksums for the next 4
+         positions independently from each other using the ADLER32_STEP
+         factors and only then check them against BLOCKS. */
+      while (!may_match(&blocks, rolling) && lo < upper)
         {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
+          if (upper - lo >= 4)
+            {
+              const char *out = b + lo;
+              const char *in = out + MATCH_BLOCKSIZE;
+
+              apr_uint32_t r0 = rolling + adler32_delta(out[0], in[0]);
+              apr_uint32_t d1 = adler32_delta(out[1], in[1]);
+              apr_uint32_t d2 = adler32_delta(out[2], in[2]);
+              apr_uint32_t d3 = adler32_delta(out[3], in[3]);
+
+              apr_uint32_t r1 = r0 * ADLER32_STEP(1);
+              apr_uint32_t r2 = r0 * ADLER32_STEP(2)
+                              + d1 * ADLER32_STEP(1);
+              apr_uint32_t r3 = r0 * ADLER32_STEP(3)
+                              + d1 * ADLER32_STEP(2)
+                              + d2 * ADLER32_STEP(1);
+              apr_uint32_t r4 = r0 * ADLER32_STEP(4)
+                              + d1 * ADLER32_STEP(3)
+                              + d2 * ADLER32_STEP(2)
+                              + d3 * ADLER32_STEP(1);
+
+              /* Stop at the first candidate, exactly like the single-step
+                 loop would have done. */
+              if (may_match(&blocks, r1))
+                {
+                  rolling = r1;
+                  lo += 1;
+                  break;
+                }
+              if (may_match(&blocks, r2))
+                {
+                  rolling = r2;
+                  lo += 2;
+                  break;
+                }
+              if (may_match(&blocks, r3))
+                {
+                  rolling = r3;
+                  lo += 3;
+                  break;
+                }
+
+              rolling = r4;
+              lo += 4;
+            }
+          else
+            {
+              rolling = adler32_replace(rolling, b[lo],
+                                        b[lo + MATCH_BLOCKSIZE]);
+              lo++;
+            }
         }
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
@@ -1564,6 +1564,26 @@ svn_fs_try_process_file_contents(svn_boolean_t *success,
                          processor, baton, pool));
 }
 
+svn_error_t *
+svn_fs__get_contents_location(apr_file_t **file,
+                              apr_off_t *offset,
+                              svn_filesize_t *length,
+                              svn_fs_root_t *root,
+                              const char *path,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  if (root->vtable->get_contents_location == NULL)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(root->vtable->get_contents_location(
+                         file, offset, length, root, path,
+                         result_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_make_file(svn_fs_root_t *root, const char *path, apr_pool_t *pool)
 {
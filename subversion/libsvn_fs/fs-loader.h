@@ -400,6 +400,13 @@ typedef struct root_vtable_t
                                             svn_fs_process_contents_func_t processor,
                                             void* baton,
                                             apr_pool_t *pool);
+  svn_error_t *(*get_contents_location)(apr_file_t **file,
+                                        apr_off_t *offset,
+                                        svn_filesize_t *length,
+                                        svn_fs_root_t *root,
+                                        const char *path,
+                                        apr_pool_t *result_pool,
+                                        apr_pool_t *scratch_pool);
   svn_error_t *(*make_file)(svn_fs_root_t *root, const char *path,
                             apr_pool_t *pool);
   svn_error_t *(*apply_textdelta)(svn_txdelta_window_handler_t *contents_p,
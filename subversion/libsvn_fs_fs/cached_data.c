@@ -38,6 +38,7 @@
 #include "index.h"
 #include "low_level.h"
 #include "pack.h"
+#include "prefetch.h"
 #include "util.h"
 #include "temp_serializer.h"
 
@@ -744,6 +745,9 @@ typedef struct rep_state_t
   int ver;          /* If a delta, what svndiff version?
                        -1 for unknown delta version. */
   int chunk_index;  /* number of the window to read */
+
+  /* Reads windows ahead on a worker thread.  May be NULL. */
+  svn_fs_fs__window_prefetch_t *prefetch;
 } rep_state_t;
 
 /* Simple wrapper around svn_io_file_get_offset to simplify callers. */
@@ -875,7 +879,8 @@ create_rep_state_body(rep_state_t **rep_state,
      Since we don't know the depth of the delta chain, let's assume, the
      whole contents get rewritten 3 times.
    */
-  estimated_window_storage = 4 * (rep->expanded_size + SVN_DELTA_WINDOW_SIZE);
+  estimated_window_storage = 4 * (rep->expanded_size
+                                  + ffd->delta_window_size);
   estimated_window_storage = MIN(estimated_window_storage, APR_SIZE_MAX);
 
   rs->window_cache =    ffd->txdelta_window_cache
@@ -1439,6 +1444,7 @@ build_rep_list(apr_array_header_t **list,
                representation_t *first_rep,
                apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   representation_t rep;
   rep_state_t *rs = NULL;
   svn_fs_fs__rep_header_t *rep_header;
@@ -1463,7 +1469,7 @@ build_rep_list(apr_array_header_t **list,
 
       /* for txn reps, there won't be a cached combined window */
       if (   !svn_fs_fs__id_txn_used(&rep.txn_id)
-          && rep.expanded_size < SVN_DELTA_WINDOW_SIZE)
+          && rep.expanded_size < ffd->delta_window_size)
         SVN_ERR(get_cached_combined_window(window_p, rs, &is_cached, pool));
 
       if (is_cached)
@@ -1541,6 +1547,77 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   return SVN_NO_ERROR;
 }
 
+/* Set *WINDOW_LEN to the size of the svndiff window at the start of DATA,
+   which is the part of a memory-mapped rev file that contains the LEN
+   bytes left in the current representation.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+read_mapped_window_len(apr_size_t *window_len,
+                       const char *data,
+                       apr_off_t len,
+                       apr_pool_t *scratch_pool)
+{
+  svn_string_t rest;
+  rest.data = data;
+  rest.len = (apr_size_t)len;
+
+  SVN_ERR(svn_txdelta__read_raw_window_len(window_len,
+                                           svn_stream_from_string(&rest,
+                                                                  scratch_pool),
+                                           scratch_pool));
+  if (*window_len > rest.len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading one svndiff window read beyond "
+                              "the end of the representation"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement read_delta_window() for representations in a memory-mapped
+   rev file.  DATA points to the data at the current position in RS.
+   This does not use any file I/O and leaves the file pointer untouched. */
+static svn_error_t *
+read_mapped_delta_window(svn_txdelta_window_t **nwin,
+                         int this_chunk,
+                         rep_state_t *rs,
+                         const char *data,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  svn_string_t window;
+  apr_size_t window_len;
+
+  /* Skip windows to reach the current chunk if we aren't there yet. */
+  SVN_ERR(read_mapped_window_len(&window_len, data, rs->size - rs->current,
+                                 scratch_pool));
+  while (rs->chunk_index < this_chunk)
+    {
+      data += window_len;
+      rs->current += window_len;
+      rs->chunk_index++;
+
+      SVN_ERR(read_mapped_window_len(&window_len, data,
+                                     rs->size - rs->current, scratch_pool));
+    }
+
+  /* Actually read the next window.  The parser copies all data into
+     RESULT_POOL, i.e. *NWIN does not depend on the file mapping. */
+  window.data = data;
+  window.len = window_len;
+  SVN_ERR(svn_txdelta_read_svndiff_window(nwin,
+                                          svn_stream_from_string(&window,
+                                                                 scratch_pool),
+                                          rs->ver, result_pool));
+  rs->current += window_len;
+
+  /* the window has not been cached before, thus cache it now
+   * (if caching is used for them at all) */
+  if (SVN_IS_VALID_REVNUM(rs->revision))
+    SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
    window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
    than THIS_CHUNK + 1 when this function returns. */
@@ -1552,6 +1629,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   svn_boolean_t is_cached;
   apr_off_t start_offset;
   apr_off_t end_offset;
+  const char *mapped;
   apr_pool_t *iterpool;
 
   SVN_ERR_ASSERT(rs->chunk_index <= this_chunk);
@@ -1559,6 +1637,25 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   SVN_ERR(dbg_log_access(rs->sfile->fs, rs->revision, rs->item_index,
                          NULL, SVN_FS_FS__ITEM_TYPE_ANY_REP, scratch_pool));
 
+  /* If the windows are being read ahead, that will be the quickest way
+     to get the next one.  Otherwise, read it ourselves. */
+  if (rs->prefetch)
+    {
+      SVN_ERR(svn_fs_fs__window_prefetch_get(nwin, &end_offset, rs->prefetch,
+                                             this_chunk, result_pool));
+      if (*nwin)
+        {
+          fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
+          ffd->prefetched_windows++;
+
+          rs->current = end_offset - rs->start;
+          rs->chunk_index = this_chunk;
+          SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+
+          return SVN_NO_ERROR;
+        }
+    }
+
   /* Read the next window.  But first, try to find it in the cache. */
   SVN_ERR(get_cached_window(nwin, rs, this_chunk, &is_cached,
                             result_pool, scratch_pool));
@@ -1592,9 +1689,17 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   SVN_ERR(auto_set_start_offset(rs, scratch_pool));
   SVN_ERR(auto_read_diff_version(rs, scratch_pool));
 
+  /* If the file has been mapped into memory, parse the data in place. */
+  start_offset = rs->start + rs->current;
+  mapped = svn_fs_fs__rev_file_mapped(rs->sfile->rfile, start_offset,
+                                      rs->size - rs->current);
+  if (mapped)
+    return svn_error_trace(read_mapped_delta_window(nwin, this_chunk, rs,
+                                                    mapped, result_pool,
+                                                    scratch_pool));
+
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
-  start_offset = rs->start + rs->current;
   SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, scratch_pool));
 
   /* Skip windows to reach the current chunk if we aren't there yet. */
@@ -1640,6 +1745,7 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
                   apr_pool_t *scratch_pool)
 {
   apr_off_t offset;
+  const char *mapped;
 
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
@@ -1647,13 +1753,21 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
   SVN_ERR(auto_set_start_offset(rs, scratch_pool));
 
   offset = rs->start + rs->current;
-  SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
+  mapped = svn_fs_fs__rev_file_mapped(rs->sfile->rfile, offset, size);
+  if (mapped)
+    {
+      *nwin = svn_stringbuf_ncreate(mapped, size, result_pool);
+    }
+  else
+    {
+      SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
 
-  /* Read the plain data. */
-  *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
-  (*nwin)->data[size] = 0;
+      /* Read the plain data. */
+      *nwin = svn_stringbuf_create_ensure(size, result_pool);
+      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data,
+                                     size, NULL, NULL, result_pool));
+      (*nwin)->data[size] = 0;
+    }
 
   /* Update RS. */
   rs->current += (apr_off_t)size;
@@ -1687,8 +1801,9 @@ get_combined_window(svn_stringbuf_t **result,
   apr_pool_t *iterpool;
 
   /* Read all windows that we need to combine. This is fine because
-     the size of each window is relatively small (100kB) and skip-
-     delta limits the number of deltas in a chain to well under 100.
+     the size of each window is relatively small (100kB, 1MB by default
+     for format 9+) and skip-delta limits the number of deltas in a chain
+     to well under 100.
      Stop early if one of them does not depend on its predecessors. */
   window_pool = svn_pool_create(rb->pool);
   windows = apr_array_make(window_pool, 0, sizeof(svn_txdelta_window_t *));
@@ -2101,6 +2216,61 @@ skip_contents(struct rep_read_baton *baton,
   return svn_error_trace(err);
 }
 
+/* If parallel reconstruction has been enabled for RB->FS and RB's
+ * representation is large enough, start reading the windows of all delta
+ * representations in RB->RS_LIST on worker threads.  Skip those whose
+ * windows are in the cache already.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+start_prefetching(struct rep_read_baton *rb,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  int i;
+
+  if (   ffd->parallel_read_threshold == 0
+      || rb->len < ffd->parallel_read_threshold)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < rb->rs_list->nelts; ++i)
+    {
+      rep_state_t *rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+      const char *path;
+
+      /* Only committed data may be read concurrently. */
+      if (!SVN_IS_VALID_REVNUM(rs->revision))
+        continue;
+
+      if (rs->window_cache)
+        {
+          window_cache_key_t key = { 0 };
+          svn_boolean_t is_cached;
+
+          SVN_ERR(svn_cache__has_key(&is_cached, rs->window_cache,
+                                     get_window_key(&key, rs),
+                                     scratch_pool));
+          if (is_cached)
+            continue;
+        }
+
+      SVN_ERR(auto_open_shared_file(rs->sfile));
+      SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+      SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+
+      SVN_ERR(svn_io_file_name_get(&path, rs->sfile->rfile->file,
+                                   scratch_pool));
+      SVN_ERR(svn_fs_fs__window_prefetch_create(&rs->prefetch, path,
+                                                rs->start + rs->current,
+                                                rs->start + rs->size,
+                                                rs->ver, rs->chunk_index,
+                                                ffd->block_size,
+                                                rb->filehandle_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* BATON is of type `rep_read_baton'; read the next *LEN bytes of the
    representation and store them in *BUF.  Sum as we read and verify
    the MD5 sum at the end.  This is a READ_FULL_FN for svn_stream_t. */
@@ -2133,6 +2303,7 @@ rep_read_contents(void *baton,
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
                              &rb->src_state, rb->fs, &rb->rep,
                              rb->filehandle_pool));
+      SVN_ERR(start_prefetching(rb, rb->pool));
 
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
@@ -2418,6 +2589,45 @@ svn_fs_fs__try_process_file_contents(svn_boolean_t *success,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_contents_location(apr_file_t **file,
+                                 apr_off_t *offset,
+                                 svn_filesize_t *length,
+                                 svn_fs_t *fs,
+                                 node_revision_t *noderev,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  representation_t *rep = noderev->data_rep;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *rh;
+  apr_off_t rep_offset;
+
+  *file = NULL;
+
+  /* Data in transactions may still change. */
+  if (!rep || rep->size == 0 || svn_fs_fs__id_txn_used(&rep->txn_id))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rep->revision,
+                                           result_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__item_offset(&rep_offset, fs, rev_file, rep->revision,
+                                 NULL, rep->item_index, scratch_pool));
+  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, rep_offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&rh, rev_file->stream, scratch_pool,
+                                     scratch_pool));
+
+  /* PLAIN representations are neither deltified nor compressed. */
+  if (rh->type != svn_fs_fs__rep_plain)
+    return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+
+  *file = rev_file->file;
+  *offset = rep_offset + rh->header_size;
+  *length = rep->size;
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Baton used when reading delta windows. */
 struct delta_read_baton
@@ -2486,8 +2696,10 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
 
   /* Try a shortcut: if the target is stored as a delta against the source,
      then just use that delta.  However, prefer using the fulltext cache
-     whenever that is available. */
-  if (target->data_rep && (source || ! ffd->fulltext_cache))
+     whenever that is available.  Also, windows larger than the standard
+     size can't be sent to older clients, so construct a new delta then. */
+  if (   target->data_rep && (source || ! ffd->fulltext_cache)
+      && ffd->delta_window_size <= SVN_DELTA_WINDOW_SIZE)
     {
       /* Read target's base rep if any. */
       SVN_ERR(create_rep_state(&rep_state, &rep_header, NULL,
@@ -3327,20 +3539,34 @@ cache_windows(svn_fs_t *fs,
           svn_fs_fs__raw_cached_window_t window;
           apr_off_t start_offset = rs->start + rs->current;
           apr_size_t window_len;
+          const char *mapped;
           char *buf;
 
-          /* navigate to the current window */
-          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
-                                                   rs->sfile->rfile->stream,
-                                                   iterpool));
-
-          /* Read the raw window. */
-          buf = apr_palloc(iterpool, window_len + 1);
-          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
-          buf[window_len] = 0;
+          mapped = svn_fs_fs__rev_file_mapped(rs->sfile->rfile,
+                                              start_offset,
+                                              rs->size - rs->current);
+          if (mapped)
+            {
+              SVN_ERR(read_mapped_window_len(&window_len, mapped,
+                                             rs->size - rs->current,
+                                             iterpool));
+              buf = apr_pstrmemdup(iterpool, mapped, window_len);
+            }
+          else
+            {
+              /* navigate to the current window */
+              SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+              SVN_ERR(svn_txdelta__read_raw_window_len(
+                        &window_len, rs->sfile->rfile->stream, iterpool));
+
+              /* Read the raw window. */
+              buf = apr_palloc(iterpool, window_len + 1);
+              SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+              SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
+                                             window_len, NULL, NULL,
+                                             iterpool));
+              buf[window_len] = 0;
+            }
 
           /* update relative offset in representation */
           rs->current += window_len;
@@ -3404,6 +3630,7 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
     {
       svn_stringbuf_t *plaintext;
       svn_boolean_t is_cached;
+      const char *mapped;
 
       /* already in cache? */
       SVN_ERR(svn_cache__has_key(&is_cached, rs.combined_cache,
@@ -3412,16 +3639,26 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       if (is_cached)
         return SVN_NO_ERROR;
 
-      /* for larger reps, the header may have crossed a block boundary.
-       * make sure we still read blocks properly aligned, i.e. don't use
-       * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      mapped = svn_fs_fs__rev_file_mapped(rev_file, offset, rs.size);
+      if (mapped)
+        {
+          plaintext = svn_stringbuf_ncreate(mapped, (apr_size_t)rs.size,
+                                            result_pool);
+        }
+      else
+        {
+          /* for larger reps, the header may have crossed a block boundary.
+           * make sure we still read blocks properly aligned, i.e. don't use
+           * plain seek here. */
+          SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset,
+                               scratch_pool));
 
-      plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
-      plaintext->data[plaintext->len] = 0;
+          plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
+          SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
+                                         rs.size, &plaintext->len, NULL,
+                                         result_pool));
+          plaintext->data[plaintext->len] = 0;
+        }
       rs.current += rs.size;
 
       SVN_ERR(set_cached_combined_window(plaintext, &rs, scratch_pool));
@@ -3511,16 +3748,29 @@ read_item(svn_stream_t **stream,
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  /* Parse mapped items in place.  Otherwise, read them into a buffer. */
+  const char *mapped = svn_fs_fs__rev_file_mapped(rev_file, entry->offset,
+                                                  entry->size);
+  if (mapped)
+    {
+      svn_string_t *text = apr_palloc(pool, sizeof(*text));
+      text->data = mapped;
+      text->len = (apr_size_t)entry->size;
 
-  /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
-  digest = svn__fnv1a_32x4(text->data, text->len);
+      *stream = svn_stream_from_string(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
+  else
+    {
+      svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
+      text->len = entry->size;
+      text->data[text->len] = 0;
+      SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
+                                     NULL, NULL, pool));
+
+      *stream = svn_stream_from_stringbuf(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
 
   /* Checksums will match most of the time. */
   if (entry->fnv1_checksum == digest)
@@ -3658,6 +3908,138 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+/* Set *IS_CACHED to TRUE, if block_read() would not need to read the item
+ * described by ENTRY in FS because it is already in cache.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+is_item_cached(svn_boolean_t *is_cached,
+               svn_fs_t *fs,
+               svn_fs_fs__p2l_entry_t *entry,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_cache__t *cache = NULL;
+  pair_cache_key_t key = { 0 };
+
+  key.revision = entry->item.revision;
+  key.second = entry->item.number;
+
+  switch (entry->type)
+    {
+      case SVN_FS_FS__ITEM_TYPE_FILE_REP:
+      case SVN_FS_FS__ITEM_TYPE_DIR_REP:
+      case SVN_FS_FS__ITEM_TYPE_FILE_PROPS:
+      case SVN_FS_FS__ITEM_TYPE_DIR_PROPS:
+        /* Reading the contents always starts with the rep header. */
+        cache = ffd->rep_header_cache;
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_NODEREV:
+        cache = ffd->node_revision_cache;
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_CHANGES:
+        cache = ffd->changes_cache;
+        key.second = 0;
+        break;
+
+      default:
+        /* Nothing to read. */
+        *is_cached = TRUE;
+        return SVN_NO_ERROR;
+    }
+
+  if (cache)
+    SVN_ERR(svn_cache__has_key(is_cached, cache, &key, scratch_pool));
+  else
+    *is_cached = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Block BLOCK_START in REV_FILE containing REVISION in FS has just been
+ * read by block_read().  Use the P2L index to find out whether any of the
+ * items in the following FFD->READ_AHEAD_BLOCKS blocks still need to be
+ * read.  If so, ask the OS to fetch these blocks in the background.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_ahead(svn_fs_t *fs,
+           svn_fs_fs__revision_file_t *rev_file,
+           svn_revnum_t revision,
+           apr_off_t block_start,
+           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t start = block_start + ffd->block_size;
+  apr_off_t end = start + ffd->read_ahead_blocks * ffd->block_size;
+  apr_array_header_t *entries;
+  svn_error_t *err;
+  int i;
+
+  /* Did we ask for the current block to be read ahead?  This is the case
+   * for sequential access patterns. */
+  if (   ffd->read_ahead_file == rev_file->start_revision
+      && block_start >= ffd->read_ahead_start
+      && block_start < ffd->read_ahead_end)
+    {
+      svn_cache__membuffer_record_read_ahead_hit();
+
+      /* Count each hit only once and don't request the same blocks
+       * twice. */
+      ffd->read_ahead_start = start;
+      start = MAX(start, ffd->read_ahead_end);
+    }
+
+  /* Don't read ahead into the index data. */
+  SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+  end = MIN(end, rev_file->l2p_offset);
+  if (start >= end)
+    return SVN_NO_ERROR;
+
+  /* Skip all leading items that have been cached already.  There is no
+   * need to read them again. */
+  SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file, revision,
+                                      start, end - start, scratch_pool,
+                                      scratch_pool));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_boolean_t is_cached;
+      svn_fs_fs__p2l_entry_t *entry
+        = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+
+      SVN_ERR(is_item_cached(&is_cached, fs, entry, scratch_pool));
+      if (!is_cached)
+        break;
+    }
+
+  if (i == entries->nelts)
+    return SVN_NO_ERROR;
+
+  /* Read ahead from the block containing the first uncached item. */
+  start = MAX(start,
+              APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t).offset);
+  start -= start % ffd->block_size;
+
+  /* This is just a hint.  Failure to follow it does not matter. */
+  err = svn_io__file_read_ahead(rev_file->file, start, end - start,
+                                scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  ffd->read_ahead_file = rev_file->start_revision;
+  ffd->read_ahead_start = start;
+  ffd->read_ahead_end = end;
+  svn_cache__membuffer_record_read_ahead(
+    (apr_uint32_t)((end - start + ffd->block_size - 1) / ffd->block_size));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3798,6 +4180,10 @@ block_read(void **result,
   while(run_count++ == 1); /* can only be true once and only if a block
                             * boundary got crossed */
 
+  /* Sequential traversals will most likely need the following blocks. */
+  if (ffd->read_ahead_blocks > 0)
+    SVN_ERR(read_ahead(fs, revision_file, revision, block_start, iterpool));
+
   /* if the caller requested a result, we must have provided one by now */
   assert(!result || *result);
   svn_pool_destroy(iterpool);
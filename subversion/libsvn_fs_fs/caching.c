@@ -31,6 +31,8 @@
 
 #include "svn_config.h"
 #include "svn_cache_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 
 #include "svn_private_config.h"
 #include "svn_hash.h"
@@ -346,6 +348,221 @@ create_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+/* The persistent cache lives in a file that survives process restarts
+ * and that may have been damaged in between.  Hence, every value in it
+ * is followed by a checksum over its serialized form.  Values that don't
+ * match their checksum are treated as cache misses.
+ */
+#define PERSISTENT_CHECKSUM_SIZE sizeof(apr_uint32_t)
+
+/* Replace the serialized value in *BUFFER of *BUFFER_SIZE bytes by a copy
+ * allocated in RESULT_POOL that has the checksum appended.
+ */
+static void
+append_checksum(void **buffer,
+                apr_size_t *buffer_size,
+                apr_pool_t *result_pool)
+{
+  apr_uint32_t checksum = svn__fnv1a_32x4(*buffer, *buffer_size);
+  char *data = apr_palloc(result_pool,
+                          *buffer_size + PERSISTENT_CHECKSUM_SIZE);
+
+  memcpy(data, *buffer, *buffer_size);
+  memcpy(data + *buffer_size, &checksum, PERSISTENT_CHECKSUM_SIZE);
+
+  *buffer = data;
+  *buffer_size += PERSISTENT_CHECKSUM_SIZE;
+}
+
+/* Return TRUE if the BUFFER_SIZE bytes in BUFFER end with a valid
+ * checksum as added by append_checksum().
+ */
+static svn_boolean_t
+checksum_matches(const void *buffer,
+                 apr_size_t buffer_size)
+{
+  apr_uint32_t checksum;
+  if (buffer_size < PERSISTENT_CHECKSUM_SIZE)
+    return FALSE;
+
+  buffer_size -= PERSISTENT_CHECKSUM_SIZE;
+  memcpy(&checksum, (const char *)buffer + buffer_size,
+         PERSISTENT_CHECKSUM_SIZE);
+
+  return checksum == svn__fnv1a_32x4(buffer, buffer_size);
+}
+
+/* Implements svn_cache__serialize_func_t for svn_stringbuf_t values
+ * in the persistent cache.
+ */
+static svn_error_t *
+serialize_persistent_stringbuf(void **buffer,
+                               apr_size_t *buffer_size,
+                               void *item,
+                               apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *value_str = item;
+
+  *buffer = value_str->data;
+  *buffer_size = value_str->len + 1;
+  append_checksum(buffer, buffer_size, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for svn_stringbuf_t values
+ * in the persistent cache.
+ */
+static svn_error_t *
+deserialize_persistent_stringbuf(void **item,
+                                 void *buffer,
+                                 apr_size_t buffer_size,
+                                 apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *value_str;
+  char *data = buffer;
+
+  /* The data must be a NUL-terminated string. */
+  if (   !checksum_matches(buffer, buffer_size)
+      || buffer_size == PERSISTENT_CHECKSUM_SIZE
+      || data[buffer_size - PERSISTENT_CHECKSUM_SIZE - 1] != '\0')
+    {
+      *item = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  value_str = apr_palloc(result_pool, sizeof(*value_str));
+  value_str->pool = result_pool;
+  value_str->blocksize = buffer_size - PERSISTENT_CHECKSUM_SIZE;
+  value_str->data = data;
+  value_str->len = value_str->blocksize - 1;
+  *item = value_str;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__serialize_func_t for txdelta windows in the
+ * persistent cache.
+ */
+static svn_error_t *
+serialize_persistent_txdelta_window(void **buffer,
+                                    apr_size_t *buffer_size,
+                                    void *item,
+                                    apr_pool_t *result_pool)
+{
+  SVN_ERR(svn_fs_fs__serialize_txdelta_window(buffer, buffer_size, item,
+                                              result_pool));
+  append_checksum(buffer, buffer_size, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for txdelta windows in the
+ * persistent cache.
+ */
+static svn_error_t *
+deserialize_persistent_txdelta_window(void **item,
+                                      void *buffer,
+                                      apr_size_t buffer_size,
+                                      apr_pool_t *result_pool)
+{
+  if (!checksum_matches(buffer, buffer_size))
+    {
+      *item = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_fs_fs__deserialize_txdelta_window(
+                           item, buffer,
+                           buffer_size - PERSISTENT_CHECKSUM_SIZE,
+                           result_pool));
+}
+
+/* If FS has a persistent cache, back *CACHE_P with it.  The persistent
+ * tier uses the same keys as *CACHE_P, i.e. KLEN, PREFIX, PRIORITY and
+ * HAS_NAMESPACE must be the same as used for create_cache().  SERIALIZER
+ * and DESERIALIZER must be one of the checksumming *_persistent_*
+ * functions above.  If *CACHE_P is NULL, the respective cache has been
+ * disabled and we leave it that way.
+ *
+ * Unless NO_HANDLER is true, errors from the persistent cache will be
+ * reported as warnings to the FS warning callback and then be ignored.
+ *
+ * Allocate the result in RESULT_POOL, temporaries in SCRATCH_POOL.
+ */
+static svn_error_t *
+add_persistent_tier(svn_cache__t **cache_p,
+                    svn_cache__serialize_func_t serializer,
+                    svn_cache__deserialize_func_t deserializer,
+                    apr_ssize_t klen,
+                    const char *prefix,
+                    apr_uint32_t priority,
+                    svn_boolean_t has_namespace,
+                    svn_fs_t *fs,
+                    svn_boolean_t no_handler,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_cache__t *persistent;
+
+  if (   *cache_p == NULL
+      || ffd->shared == NULL
+      || ffd->shared->persistent_cache == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &persistent, ffd->shared->persistent_cache,
+            serializer, deserializer, klen, prefix, priority,
+            FALSE, has_namespace, result_pool, scratch_pool));
+  SVN_ERR(init_callbacks(persistent, fs,
+                         no_handler ? NULL
+                                    : warn_and_continue_on_cache_errors,
+                         result_pool));
+
+  SVN_ERR(svn_cache__create_tiered(cache_p, *cache_p, persistent,
+                                   result_pool));
+  SVN_ERR(init_callbacks(*cache_p, fs, NULL, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__open_persistent_cache(svn_membuffer_t **cache,
+                                 svn_fs_t *fs,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *path;
+  apr_size_t size;
+  svn_error_t *err;
+
+  *cache = NULL;
+  if (ffd->persistent_cache_size == 0)
+    return SVN_NO_ERROR;
+
+  path = svn_dirent_join(fs->path, PATH_PERSISTENT_CACHE, result_pool);
+  size = (apr_uint64_t)ffd->persistent_cache_size > APR_SIZE_MAX
+       ? APR_SIZE_MAX
+       : (apr_size_t)ffd->persistent_cache_size;
+  err = svn_cache__membuffer_cache_create_shared(cache, path, size,
+                                                 size / 5, 0, TRUE, FALSE,
+                                                 result_pool);
+
+  /* Like all caches, this one is optional.  Opening it fails routinely,
+   * e.g. for users without write access to the repository.  If the file
+   * has been created with different settings, other processes may still
+   * be using it, so we must not replace it either.  Simply go without. */
+  if (err)
+    {
+      *cache = NULL;
+      svn_error_clear(err);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
@@ -547,6 +764,20 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            no_handler,
                            fs->pool, pool));
 
+      /* memcached already provides a cache that survives restarts. */
+      if (ffd->memcache == NULL)
+        SVN_ERR(add_persistent_tier(&(ffd->fulltext_cache),
+                                    serialize_persistent_stringbuf,
+                                    deserialize_persistent_stringbuf,
+                                    sizeof(pair_cache_key_t),
+                                    apr_pstrcat(pool, prefix, "TEXT",
+                                                SVN_VA_NULL),
+                                    SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                    has_namespace,
+                                    fs,
+                                    no_handler,
+                                    fs->pool, pool));
+
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
                            membuffer,
@@ -639,6 +870,17 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_persistent_tier(&(ffd->txdelta_window_cache),
+                                  serialize_persistent_txdelta_window,
+                                  deserialize_persistent_txdelta_window,
+                                  sizeof(window_cache_key_t),
+                                  apr_pstrcat(pool, prefix, "TXDELTA_WINDOW",
+                                              SVN_VA_NULL),
+                                  SVN_CACHE__MEMBUFFER_LOW_PRIORITY,
+                                  has_namespace,
+                                  fs,
+                                  no_handler,
+                                  fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->combined_window_cache),
                            NULL,
@@ -654,6 +896,18 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_persistent_tier(&(ffd->combined_window_cache),
+                                  serialize_persistent_stringbuf,
+                                  deserialize_persistent_stringbuf,
+                                  sizeof(window_cache_key_t),
+                                  apr_pstrcat(pool, prefix,
+                                              "COMBINED_WINDOW",
+                                              SVN_VA_NULL),
+                                  SVN_CACHE__MEMBUFFER_LOW_PRIORITY,
+                                  has_namespace,
+                                  fs,
+                                  no_handler,
+                                  fs->pool, pool));
     }
   else
     {
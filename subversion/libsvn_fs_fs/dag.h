@@ -426,6 +426,21 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                          void* baton,
                                          apr_pool_t *pool);
 
+/* If the contents of FILE are stored as-is in a revision or pack file,
+   set *FILE_P to that file, opened in RESULT_POOL, and *OFFSET and
+   *LENGTH to the location of the contents within it.  Otherwise, set
+   *FILE_P to NULL.
+
+   Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__dag_get_contents_location(apr_file_t **file_p,
+                                     apr_off_t *offset,
+                                     svn_filesize_t *length,
+                                     dag_node_t *file,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
+
 
 /* Set *STREAM_P to a delta stream that will turn the contents of SOURCE into
    the contents of TARGET, allocated in POOL.  If SOURCE is null, the empty
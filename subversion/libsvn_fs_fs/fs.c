@@ -39,6 +39,7 @@
 #include "hotcopy.h"
 #include "id.h"
 #include "pack.h"
+#include "prefetch.h"
 #include "recovery.h"
 #include "rep-cache.h"
 #include "revprops.h"
@@ -124,6 +125,10 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* Fulltexts and windows may be cached persistently on disk. */
+      SVN_ERR(svn_fs_fs__open_persistent_cache(&ffsd->persistent_cache, fs,
+                                               common_pool, pool));
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
@@ -388,9 +393,9 @@ fs_create(svn_fs_t *fs,
 
   SVN_ERR(svn_fs_fs__create(fs, path, scratch_pool));
 
-  SVN_ERR(svn_fs_fs__initialize_caches(fs, scratch_pool));
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(fs, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -419,9 +424,9 @@ fs_open(svn_fs_t *fs,
 
   SVN_ERR(svn_fs_fs__open(fs, path, subpool));
 
-  SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, subpool));
+  SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
 
   svn_pool_destroy(subpool);
 
@@ -430,6 +435,42 @@ fs_open(svn_fs_t *fs,
 
 
 
+svn_error_t *
+svn_fs_fs__open_clone(svn_fs_t **clone_p,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *clone_ffd;
+  svn_fs_t *clone = apr_pmemdup(result_pool, fs, sizeof(*clone));
+
+  /* Start with a closed FS that has the same config and callbacks. */
+  clone->pool = result_pool;
+  clone->path = NULL;
+  clone->config = fs->config ? apr_hash_copy(result_pool, fs->config)
+                             : NULL;
+  clone->access_ctx = NULL;
+  clone->uuid = NULL;
+
+  SVN_ERR(initialize_fs_struct(clone));
+  SVN_ERR(svn_fs_fs__open(clone, fs->path, scratch_pool));
+
+  /* FS has already been fully initialized, i.e. we don't need to touch
+     the common pool again. */
+  clone_ffd = clone->fsap_data;
+  clone_ffd->shared = ffd->shared;
+  clone_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  SVN_ERR(svn_fs_fs__initialize_caches(clone, scratch_pool));
+
+  *clone_p = clone;
+
+  return SVN_NO_ERROR;
+}
+
+
+
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
 static svn_error_t *
 fs_open_for_recovery(svn_fs_t *fs,
@@ -689,6 +730,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_fs_fs__prefetch_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -78,6 +78,8 @@ extern "C" {
                                                     to-log index */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsfs_conf) */
 #define PATH_CONFIG           "fsfs.conf"        /* Configuration */
+#define PATH_PERSISTENT_CACHE "warm-cache"       /* Persistent cache for
+                                                    fulltexts & windows */
 
 /* Names of special files and file extensions for transactions */
 #define PATH_CHANGES       "changes"       /* Records changes made so far */
@@ -100,6 +102,7 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_PERSISTENT_CACHE_SIZE "persistent-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -115,6 +118,9 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_READ_AHEAD_BLOCKS  "read-ahead-blocks"
+#define CONFIG_OPTION_PARALLEL_READ_THRESHOLD "parallel-read-threshold"
+#define CONFIG_OPTION_ENABLE_MMAP        "enable-mmap"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +133,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +206,16 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The minimum format number that supports svndiff version 4. */
+#define SVN_FS_FS__MIN_SVNDIFF4_FORMAT 9
+
+/* The minimum format number that supports the "delta-window" filesystem
+   format option. */
+#define SVN_FS_FS__MIN_DELTA_WINDOW_OPTION_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -278,6 +294,11 @@ typedef struct fs_fs_shared_data_t
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
+
+  /* The memory-mapped cache file in the repository's db/ directory that
+     keeps fulltexts and delta windows across process restarts.  NULL if
+     persistent caching has not been enabled or the file is unusable. */
+  svn_membuffer_t *persistent_cache;
 } fs_fs_shared_data_t;
 
 /* Data structure for the 1st level DAG node cache. */
@@ -315,7 +336,8 @@ typedef enum compression_type_t
 {
   compression_type_none,
   compression_type_zlib,
-  compression_type_lz4
+  compression_type_lz4,
+  compression_type_zstd
 } compression_type_t;
 
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
@@ -333,6 +355,12 @@ typedef struct fs_fs_data_t
      physical addressing. */
   svn_boolean_t use_log_addressing;
 
+  /* Size of the target windows in bytes to use when writing deltified
+     representations.  Because reconstruction combines the N-th windows of
+     all deltas in a chain, this must not change during the lifetime of
+     the repository. */
+  apr_size_t delta_window_size;
+
   /* Rev / pack file read granularity in bytes. */
   apr_int64_t block_size;
 
@@ -347,6 +375,17 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Number of blocks following the one just read by block-read that
+   * shall be read ahead asynchronously.  0 disables read-ahead. */
+  apr_int64_t read_ahead_blocks;
+
+  /* The range of blocks in the rev / pack file starting with revision
+   * READ_AHEAD_FILE that we asked the OS to read ahead most recently.
+   * READ_AHEAD_START == READ_AHEAD_END if there is no such range. */
+  svn_revnum_t read_ahead_file;
+  apr_off_t read_ahead_start;
+  apr_off_t read_ahead_end;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +399,22 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Size of the persistent cache in the repository's db/ directory in
+     bytes.  0 disables that cache. */
+  apr_int64_t persistent_cache_size;
+
+  /* Minimum expanded size in bytes of representations whose delta windows
+     get read and parsed on worker threads.  0 disables that feature. */
+  apr_int64_t parallel_read_threshold;
+
+  /* Number of delta windows that have been read on worker threads and
+     then been used by this filesystem object. */
+  apr_uint64_t prefetched_windows;
+
+  /* If TRUE, map immutable rev / pack files into memory and read from
+     there instead of going through buffered file I/O. */
+  svn_boolean_t enable_mmap;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -496,7 +551,8 @@ typedef struct fs_fs_data_t
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
-  /* Compression level (currently, only used with compression_type_zlib). */
+  /* Compression level (only used with compression_type_zlib and
+     compression_type_zstd). */
   int delta_compression_level;
 
   /* Pack after every commit. */
@@ -514,6 +570,10 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Number of worker threads to use in svn_fs_fs__verify().
+   * Values below 2 mean "verify in the calling thread only". */
+  int verify_jobs;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
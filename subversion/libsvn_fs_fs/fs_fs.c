@@ -43,11 +43,13 @@
 #include "tree.h"
 #include "util.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_io_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
 #include "../libsvn_fs/fs-loader.h"
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
 
 /* The default maximum number of files per directory to store in the
    rev and revprops directory.  The number below is somewhat arbitrary,
@@ -58,6 +60,14 @@
 #define SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR 1000
 #endif
 
+/* The default size of the delta windows in bytes for newly created
+   repositories that support the "delta-window" format option.  1MB
+   keeps large files with insertions deltifiable without increasing
+   the memory footprint of reconstruction by too much. */
+#ifndef SVN_FS_FS_DEFAULT_DELTA_WINDOW_SIZE
+#define SVN_FS_FS_DEFAULT_DELTA_WINDOW_SIZE (1024 * 1024)
+#endif
+
 /* Begin deltification after a node history exceeded this this limit.
    Useful values are 4 to 64 with 16 being a good compromise between
    computational overhead and repository size savings.
@@ -456,20 +466,41 @@ check_format(int format)
      SVN_FS_FS__FORMAT_NUMBER, format);
 }
 
+/* Return an error if DELTA_WINDOW_SIZE is not supported by FSFS.
+   PATH is the file that the value has been read from. */
+static svn_error_t *
+check_delta_window_size(apr_int64_t delta_window_size,
+                        const char *path,
+                        apr_pool_t *pool)
+{
+  if (   delta_window_size < SVN_DELTA_WINDOW_SIZE
+      || delta_window_size > SVN_DELTA__MAX_WINDOW_SIZE)
+    return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+             _("'%s' specifies an unsupported delta window size of "
+               "%s bytes"),
+             svn_dirent_local_style(path, pool),
+             apr_psprintf(pool, "%" APR_INT64_T_FMT, delta_window_size));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the format number and maximum number of files per directory
-   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR and
-   USE_LOG_ADDRESSIONG respectively.
+   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR,
+   USE_LOG_ADDRESSIONG and *DELTA_WINDOW_SIZE respectively.
 
    *MAX_FILES_PER_DIR is obtained from the 'layout' format option, and
    will be set to zero if a linear scheme should be used.
    *USE_LOG_ADDRESSIONG is obtained from the 'addressing' format option,
    and will be set to FALSE for physical addressing.
+   *DELTA_WINDOW_SIZE is obtained from the 'delta-window' format option,
+   and will be set to the standard txdelta window size if not given.
 
    Use POOL for temporary allocation. */
 static svn_error_t *
 read_format(int *pformat,
             int *max_files_per_dir,
             svn_boolean_t *use_log_addressing,
+            apr_size_t *delta_window_size,
             const char *path,
             apr_pool_t *pool)
 {
@@ -493,6 +524,7 @@ read_format(int *pformat,
       *pformat = 1;
       *max_files_per_dir = 0;
       *use_log_addressing = FALSE;
+      *delta_window_size = SVN_DELTA_WINDOW_SIZE;
 
       return SVN_NO_ERROR;
     }
@@ -518,6 +550,7 @@ read_format(int *pformat,
   /* Set the default values for anything that can be set via an option. */
   *max_files_per_dir = 0;
   *use_log_addressing = FALSE;
+  *delta_window_size = SVN_DELTA_WINDOW_SIZE;
 
   /* Read any options. */
   while (!eos)
@@ -560,6 +593,20 @@ read_format(int *pformat,
             }
         }
 
+      if (*pformat >= SVN_FS_FS__MIN_DELTA_WINDOW_OPTION_FORMAT &&
+          strncmp(buf->data, "delta-window ", 13) == 0)
+        {
+          apr_int64_t val;
+
+          /* Check that the argument is numeric. */
+          SVN_ERR(check_format_file_buffer_numeric(buf->data, 13, path, pool));
+          SVN_ERR(svn_cstring_atoi64(&val, buf->data + 13));
+          SVN_ERR(check_delta_window_size(val, path, pool));
+
+          *delta_window_size = (apr_size_t)val;
+          continue;
+        }
+
       return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
          _("'%s' contains invalid filesystem format option '%s'"),
          svn_dirent_local_style(path, pool), buf->data);
@@ -613,6 +660,11 @@ svn_fs_fs__write_format(svn_fs_t *fs,
         svn_stringbuf_appendcstr(sb, "addressing physical\n");
     }
 
+  if (ffd->format >= SVN_FS_FS__MIN_DELTA_WINDOW_OPTION_FORMAT)
+    svn_stringbuf_appendcstr(sb, apr_psprintf(pool, "delta-window %"
+                                              APR_SIZE_T_FMT "\n",
+                                              ffd->delta_window_size));
+
   /* svn_io_write_version_file() does a load of magic to allow it to
      replace version files that already exist.  We only need to do
      that when we're allowed to overwrite an existing file. */
@@ -692,7 +744,8 @@ parse_compression_option(compression_type_t *compression_type_p,
   int level;
   svn_boolean_t is_valid = TRUE;
 
-  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 */
+  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9
+   *               | zstd | zstd-1 ... zstd-19 */
   if (strcmp(value, "none") == 0)
     {
       type = compression_type_none;
@@ -722,6 +775,25 @@ parse_compression_option(compression_type_t *compression_type_p,
       else
         is_valid = FALSE;
     }
+  else if (strncmp(value, "zstd", 4) == 0)
+    {
+      const char *p = value + 4;
+
+      type = compression_type_zstd;
+      if (*p == 0)
+        {
+          level = SVN__ZSTD_DEFAULT_LEVEL;
+        }
+      else if (*p == '-')
+        {
+          p++;
+          SVN_ERR(svn_cstring_atoi(&level, p));
+          if (level < 1 || level > 19)
+            is_valid = FALSE;
+        }
+      else
+        is_valid = FALSE;
+    }
   else
     {
       is_valid = FALSE;
@@ -824,6 +896,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->read_ahead_blocks,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_READ_AHEAD_BLOCKS,
+                                   4));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -835,6 +911,14 @@ read_config(fs_fs_data_t *ffd,
       SVN_ERR(verify_block_size(ffd->l2p_page_size, sizeof(apr_off_t),
                                 CONFIG_OPTION_L2P_PAGE_SIZE, scratch_pool));
 
+      if (ffd->read_ahead_blocks < 0 || ffd->read_ahead_blocks > 0x400)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must be between 0 and 1024; was %s"),
+                                 CONFIG_OPTION_READ_AHEAD_BLOCKS,
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              ffd->read_ahead_blocks));
+
       /* convert kBytes to bytes */
       ffd->block_size *= 0x400;
       ffd->p2l_page_size *= 0x400;
@@ -846,6 +930,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->read_ahead_blocks = 0;
     }
 
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -890,6 +975,19 @@ read_config(fs_fs_data_t *ffd,
                                       _("Compression type 'lz4' requires "
                                         "filesystem format 8 or higher"));
             }
+          if (ffd->delta_compression_type == compression_type_zstd)
+            {
+              if (ffd->format < SVN_FS_FS__MIN_SVNDIFF4_FORMAT)
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' requires "
+                                          "filesystem format 9 or higher"));
+#ifndef SVN_HAVE_ZSTD
+              return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                      _("Compression type 'zstd' is not "
+                                        "supported by this build of "
+                                        "Subversion"));
+#endif
+            }
         }
       else if (compression_level_val)
         {
@@ -945,6 +1043,38 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* The persistent cache size is given in MBytes. */
+  SVN_ERR(svn_config_get_int64(config, &ffd->persistent_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                               0));
+  if (ffd->persistent_cache_size < 0)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("'%s' must not be negative; was %s"),
+                             CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_INT64_T_FMT,
+                                          ffd->persistent_cache_size));
+  ffd->persistent_cache_size *= 0x100000;
+
+  /* The parallel read threshold is given in kBytes. */
+  SVN_ERR(svn_config_get_int64(config, &ffd->parallel_read_threshold,
+                               CONFIG_SECTION_IO,
+                               CONFIG_OPTION_PARALLEL_READ_THRESHOLD,
+                               0));
+  if (ffd->parallel_read_threshold < 0)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("'%s' must not be negative; was %s"),
+                             CONFIG_OPTION_PARALLEL_READ_THRESHOLD,
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_INT64_T_FMT,
+                                          ffd->parallel_read_threshold));
+  ffd->parallel_read_threshold *= 0x400;
+
+  SVN_ERR(svn_config_get_bool(config, &ffd->enable_mmap,
+                              CONFIG_SECTION_IO, CONFIG_OPTION_ENABLE_MMAP,
+                              FALSE));
+
   return SVN_NO_ERROR;
 }
 
@@ -977,6 +1107,18 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### Fulltexts and delta windows read from this repository may also be kept" NL
+"### in a memory-mapped file in the db/ directory.  Unlike the in-memory"    NL
+"### caches, that file survives server restarts and is shared by all"        NL
+"### server processes, i.e. the in-memory caches get warmed up from it"      NL
+"### instead of the repository data files.  After changing its size, remove" NL
+"### the db/warm-cache file while no server is running;"                     NL
+"### a file of a different size will be ignored.  It will also be ignored"   NL
+"### by users without write access to it.  The following parameter sets"     NL
+"### its size in MBytes."                                                    NL
+"### The persistent cache is disabled by default."                           NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE_SIZE " = 0"                              NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1058,19 +1200,30 @@ write_config(svn_fs_t *fs,
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
-"### select between available algorithms (zlib, lz4).  zlib is a general-"   NL
-"### purpose compression algorithm.  lz4 is a fast compression algorithm"    NL
-"### which should be preferred for repositories with large and, possibly,"   NL
-"### incompressible files.  Note that the compression ratio of lz4 is"       NL
-"### usually lower than the one provided by zlib, but using it can"          NL
-"### significantly speed up commits as well as reading the data."            NL
+"### select between available algorithms (zlib, lz4, zstd).  zlib is a"      NL
+"### general-purpose compression algorithm.  lz4 is a fast compression"      NL
+"### algorithm which should be preferred for repositories with large and,"   NL
+"### possibly, incompressible files.  Note that the compression ratio of"    NL
+"### lz4 is usually lower than the one provided by zlib, but using it can"   NL
+"### significantly speed up commits as well as reading the data.  zstd"      NL
+"### (Zstandard) decompresses much faster than zlib while achieving similar" NL
+"### or better compression ratios."                                          NL
 "### lz4 compression algorithm is supported, starting from format 8"         NL
-"### repositories, available in Subversion 1.10 and higher."                 NL
+"### repositories, available in Subversion 1.10 and higher.  zstd requires"  NL
+"### format 9 repositories and a Subversion built with zstd support."        NL
 "### The syntax of this option is:"                                          NL
 "###   " CONFIG_OPTION_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"###                 | zstd | zstd-1 ... zstd-19"                            NL
 "### Versions prior to Subversion 1.10 will ignore this option."             NL
 "### The default value is 'lz4' if supported by the repository format and"   NL
-"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
+"### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5' and"      NL
+"### 'zstd' to 'zstd-3'."                                                    NL
+"### With 'none', files without a delta base are stored verbatim, which"     NL
+"### allows svnserve to send them straight from disk to the network."        NL
+"### Format 9 repositories created with delta windows larger than 100kB"     NL
+"### store deltas in svndiff3 format, which is based on zlib, unless 'zstd'" NL
+"### has been selected.  In these repositories, 'lz4' selects the fastest"   NL
+"### zlib compression level instead."                                        NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
@@ -1147,6 +1300,33 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### If block-read has been enabled, the blocks following the one that has"  NL
+"### just been read will often be needed next, e.g. during export or dump."  NL
+"### Unless their contents has been cached already, the OS will be asked"    NL
+"### to read that many blocks ahead in the background.  This is a hint and"  NL
+"### has no effect on platforms not supporting it.  0 disables read-ahead."  NL
+"### read-ahead-blocks defaults to 4."                                       NL
+"# " CONFIG_OPTION_READ_AHEAD_BLOCKS " = 4"                                  NL
+"###"                                                                        NL
+"### Reading a large file requires all delta windows in its delta chain to"  NL
+"### be read, decompressed and combined.  Files at least as large as the"    NL
+"### following threshold get their windows read and decompressed on worker"  NL
+"### threads, which may reduce latency on multi-core servers.  This applies" NL
+"### to all repository formats and can be changed at any time."              NL
+"### parallel-read-threshold is given in kBytes.  0, the default, disables"  NL
+"### parallel reads."                                                        NL
+"# " CONFIG_OPTION_PARALLEL_READ_THRESHOLD " = 0"                            NL
+"###"                                                                        NL
+"### Rev and pack files that will not change anymore may be mapped into"     NL
+"### memory.  Their contents will then be read directly from the OS page"    NL
+"### cache, which is shared between all server processes, instead of being"  NL
+"### copied into private buffers first.  Files that may still be written"    NL
+"### to, such as those of transactions in progress, are always read the"     NL
+"### usual way.  On 32 bit systems, large pack files may fail to map and"    NL
+"### will be read the usual way as well.  This applies to all repository"    NL
+"### formats and is disabled by default."                                    NL
+"# " CONFIG_OPTION_ENABLE_MMAP " = false"                                    NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1166,6 +1346,7 @@ static svn_error_t *
 read_global_config(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const char *verify_jobs_str;
 
   ffd->use_block_read = svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_FSFS_BLOCK_READ,
@@ -1174,6 +1355,19 @@ read_global_config(svn_fs_t *fs)
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
+  ffd->verify_jobs = 1;
+  verify_jobs_str = svn_hash__get_cstring(fs->config,
+                                          SVN_FS_CONFIG_FSFS_VERIFY_JOBS,
+                                          NULL);
+  if (verify_jobs_str)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, verify_jobs_str, 0,
+                                   APR_INT32_MAX, 10));
+
+      ffd->verify_jobs = (int) val;
+    }
+
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
      older formats. */
@@ -1226,15 +1420,18 @@ svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool)
   fs_fs_data_t *ffd = fs->fsap_data;
   int format, max_files_per_dir;
   svn_boolean_t use_log_addressing;
+  apr_size_t delta_window_size;
 
   /* Read info from format file. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      path_format(fs, scratch_pool), scratch_pool));
+                      &delta_window_size, path_format(fs, scratch_pool),
+                      scratch_pool));
 
   /* Now that we've got *all* info, store / update values in FFD. */
   ffd->format = format;
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
+  ffd->delta_window_size = delta_window_size;
 
   return SVN_NO_ERROR;
 }
@@ -1300,13 +1497,14 @@ upgrade_body(void *baton, apr_pool_t *pool)
   fs_fs_data_t *ffd = fs->fsap_data;
   int format, max_files_per_dir;
   svn_boolean_t use_log_addressing;
+  apr_size_t delta_window_size;
   const char *format_path = path_format(fs, pool);
   svn_node_kind_t kind;
   svn_boolean_t needs_revprop_shard_cleanup = FALSE;
 
   /* Read the FS format number and max-files-per-dir setting. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      format_path, pool));
+                      &delta_window_size, format_path, pool));
 
   /* If the config file does not exist, create one. */
   SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1383,6 +1581,9 @@ upgrade_body(void *baton, apr_pool_t *pool)
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
 
+  /* Existing deltas use the window size of the old format.  Keep it. */
+  ffd->delta_window_size = delta_window_size;
+
   /* Always add / bump the instance ID such that no form of caching
      accidentally uses outdated information.  Keep the UUID. */
   SVN_ERR(svn_fs_fs__set_uuid(fs, fs->uuid, NULL, pool));
@@ -1815,6 +2016,7 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
                             int format,
                             int shard_size,
                             svn_boolean_t use_log_addressing,
+                            apr_size_t delta_window_size,
                             apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
@@ -1834,6 +2036,12 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
   else
     ffd->use_log_addressing = FALSE;
 
+  /* Select the delta window size depending on the format. */
+  if (format >= SVN_FS_FS__MIN_DELTA_WINDOW_OPTION_FORMAT)
+    ffd->delta_window_size = delta_window_size;
+  else
+    ffd->delta_window_size = SVN_DELTA_WINDOW_SIZE;
+
   /* Create the revision data directories. */
   if (ffd->max_files_per_dir)
     SVN_ERR(svn_io_make_dir_recursively(svn_fs_fs__path_rev_shard(fs, 0,
@@ -1915,6 +2123,7 @@ svn_fs_fs__create(svn_fs_t *fs,
 {
   int format = SVN_FS_FS__FORMAT_NUMBER;
   int shard_size = SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR;
+  apr_size_t delta_window_size = SVN_FS_FS_DEFAULT_DELTA_WINDOW_SIZE;
   svn_boolean_t log_addressing;
 
   /* Process the given filesystem config. */
@@ -1922,6 +2131,7 @@ svn_fs_fs__create(svn_fs_t *fs,
     {
       svn_version_t *compatible_version;
       const char *shard_size_str;
+      const char *delta_window_size_str;
       SVN_ERR(svn_fs__compatible_version(&compatible_version, fs->config,
                                          pool));
 
@@ -1951,6 +2161,11 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -1963,6 +2178,18 @@ svn_fs_fs__create(svn_fs_t *fs,
 
           shard_size = (int) val;
         }
+
+      delta_window_size_str
+        = svn_hash_gets(fs->config, SVN_FS_CONFIG_FSFS_DELTA_WINDOW_SIZE);
+      if (delta_window_size_str)
+        {
+          apr_int64_t val;
+          SVN_ERR(svn_cstring_strtoi64(&val, delta_window_size_str,
+                                       SVN_DELTA_WINDOW_SIZE,
+                                       SVN_DELTA__MAX_WINDOW_SIZE, 10));
+
+          delta_window_size = (apr_size_t) val;
+        }
     }
 
   log_addressing = svn_hash__get_bool(fs->config,
@@ -1971,7 +2198,8 @@ svn_fs_fs__create(svn_fs_t *fs,
 
   /* Actual FS creation. */
   SVN_ERR(svn_fs_fs__create_file_tree(fs, path, format, shard_size,
-                                      log_addressing, pool));
+                                      log_addressing, delta_window_size,
+                                      pool));
 
   /* This filesystem is ready.  Stamp it with a format number. */
   SVN_ERR(svn_fs_fs__write_format(fs, FALSE, pool));
@@ -2322,8 +2550,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 13;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -48,6 +48,19 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Set *CLONE_P to a new, independently usable filesystem object for the
+   already opened filesystem FS.  It uses the same configuration and
+   shares the process-wide data with FS, but has its own file handles
+   and instance-specific caches.  Hence, it can be used concurrently to
+   FS from a different thread.  FS must outlive *CLONE_P.
+
+   Allocate *CLONE_P in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *svn_fs_fs__open_clone(svn_fs_t **clone_p,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
@@ -134,8 +147,9 @@ svn_boolean_t svn_fs_fs__fs_supports_mergeinfo(svn_fs_t *fs);
 
 /* Under the repository db PATH, create a FSFS repository with FORMAT,
  * the given SHARD_SIZE. If USE_LOG_ADDRESSING is non-zero, repository
- * will use logical addressing. If not supported by the respective format,
- * the latter two parameters will be ignored. FS will be updated.
+ * will use logical addressing.  Deltas will be written using windows of
+ * DELTA_WINDOW_SIZE bytes.  If not supported by the respective format,
+ * the latter three parameters will be ignored. FS will be updated.
  *
  * The only file not being written is the 'format' file.  This allows
  * callers such as hotcopy to modify the contents before turning the
@@ -149,6 +163,7 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
                             int format,
                             int shard_size,
                             svn_boolean_t use_log_addressing,
+                            apr_size_t delta_window_size,
                             apr_pool_t *pool);
 
 /* Create a fs_fs fileysystem referenced by FS at path PATH.  Get any
@@ -288,6 +303,16 @@ svn_fs_fs__get_node_origin(const svn_fs_id_t **origin_id,
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs, apr_pool_t *pool);
 
+/* Set *CACHE to the persistent cache in FS' db/ directory as configured
+   in fsfs.conf.  Set it to NULL if that cache has been disabled or
+   cannot be used.  Allocate the result in RESULT_POOL, which should be
+   the process-wide common pool, and temporaries in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__open_persistent_cache(svn_membuffer_t **cache,
+                                 svn_fs_t *fs,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool);
+
 /* Initialize all transaction-local caches in FS according to the global
    cache settings and make TXN_ID part of their key space. Use POOL for
    allocations.
@@ -507,6 +507,13 @@ hotcopy_incremental_check_preconditions(svn_fs_t *src_fs,
                               "of the hotcopy source does not match "
                               "the sharding layout configuration of "
                               "the hotcopy destination"));
+
+  /* Deltas of both repositories must be combinable. */
+  if (src_ffd->delta_window_size != dst_ffd->delta_window_size)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("The delta window size of the hotcopy "
+                              "source does not match the delta window "
+                              "size of the hotcopy destination"));
   return SVN_NO_ERROR;
 }
 
@@ -1058,6 +1065,7 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
       SVN_ERR(svn_fs_fs__create_file_tree(dst_fs, dst_path, src_ffd->format,
                                           src_ffd->max_files_per_dir,
                                           src_ffd->use_log_addressing,
+                                          src_ffd->delta_window_size,
                                           pool));
 
       /* Copy the UUID.  Hotcopy destination receives a new instance ID, but
@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* If not NULL, the contents of FILE mapped into memory.  Read the
+   * packed values from here rather than from FILE. */
+  const unsigned char *mapped_data;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -251,6 +255,7 @@ static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
   unsigned char buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *source = buffer;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
@@ -261,35 +266,55 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  /* With the file being mapped into memory, simply parse the data in
+   * place.  Block boundaries don't matter in that case. */
+  if (stream->mapped_data)
+    {
+      /* A corrupt index may make us seek beyond the end of the stream. */
+      if (stream->next_offset < stream->stream_end)
+        {
+          source = stream->mapped_data + stream->next_offset;
+          bytes_read = (apr_size_t)MIN(sizeof(buffer),
+                                       stream->stream_end
+                                         - stream->next_offset);
+        }
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* Only reported if we run out of data. */
+      err = APR_EOF;
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH
+       * blocks, i.e. the last number has been incomplete (and not buffered
+       * in stream) and need to be re-read.  Therefore, always correct the
+       * file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
+
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between
+       * two blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to
+       * this index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
-  while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
+  while (bytes_read > 0 && source[bytes_read-1] >= 0x80)
     --bytes_read;
 
   /* we call read() only if get() requires more data.  So, there must be
@@ -302,11 +327,11 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   target = stream->buffer;
   for (i = 0; i < bytes_read;)
     {
-      if (buffer[i] < 0x80)
+      if (source[i] < 0x80)
         {
           /* numbers < 128 are relatively frequent and particularly easy
            * to decode.  Give them special treatment. */
-          target->value = buffer[i];
+          target->value = source[i];
           ++i;
           target->total_len = i;
           ++target;
@@ -315,14 +340,14 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
         {
           apr_uint64_t value = 0;
           apr_uint64_t shift = 0;
-          while (buffer[i] >= 0x80)
+          while (source[i] >= 0x80)
             {
-              value += ((apr_uint64_t)buffer[i] & 0x7f) << shift;
+              value += ((apr_uint64_t)source[i] & 0x7f) << shift;
               shift += 7;
               ++i;
             }
 
-          target->value = value + ((apr_uint64_t)buffer[i] << shift);
+          target->value = value + ((apr_uint64_t)source[i] << shift);
           ++i;
           target->total_len = i;
           ++target;
@@ -346,11 +371,15 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 /* Create and open a packed number stream reading from offsets START to
  * END in FILE and return it in *STREAM.  Access the file in chunks of
  * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
+ * If MAPPED_DATA is not NULL, it contains the MAPPED_SIZE bytes of FILE
+ * and will be read instead of FILE itself.
  * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
                    apr_file_t *file,
+                   const char *mapped_data,
+                   apr_off_t mapped_size,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -366,11 +395,34 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
    * changing the index header prefixes. */
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
+  /* The stream must at least hold its prefix.  With the file mapped into
+   * memory, there is no read() to fail on truncated data, so check that
+   * the whole stream lies within the mapping. */
+  if (   start < 0
+      || start + (apr_off_t)len > end
+      || (mapped_data && end > mapped_size))
+    return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                             _("Index stream at offsets 0x%s to 0x%s "
+                               "is truncated"),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_HEX_FMT,
+                                          (apr_uint64_t)start),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_HEX_FMT,
+                                          (apr_uint64_t)end));
+
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  if (mapped_data)
+    {
+      memcpy(buffer, mapped_data + start, len);
+    }
+  else
+    {
+      SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
+                                       scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
+                                     scratch_pool));
+    }
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -383,6 +435,7 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
 
   result->pool = result_pool;
   result->file = file;
+  result->mapped_data = (const unsigned char *)mapped_data;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -947,6 +1000,8 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
                                  rev_file->file,
+                                 rev_file->mapped_data,
+                                 rev_file->mapped_size,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -2139,6 +2194,8 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
                                  rev_file->file,
+                                 rev_file->mapped_data,
+                                 rev_file->mapped_size,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -0,0 +1,489 @@
+/* prefetch.c --- reading delta windows ahead on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_pool.h>
+#include <apr_strings.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_task_group.h"
+
+#include "prefetch.h"
+
+#include "svn_private_config.h"
+
+#if APR_HAS_THREADS
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated. */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Maximum number of threads in THREAD_POOL, i.e. number of windows that
+ * may be read and parsed concurrently throughout the process. */
+#define MAX_THREADS 16
+
+/* Maximum number of parsed windows per prefetcher that may wait to be
+ * picked up by the reader.  This limits the memory usage of each
+ * representation in a delta chain. */
+#define MAX_READ_AHEAD 4
+
+/* Thread pool to execute the prefetch tasks. */
+static apr_thread_pool_t *thread_pool = NULL;
+
+/* Keep track on whether we already created the THREAD_POOL. */
+static svn_atomic_t thread_pool_initialized = FALSE;
+
+#endif
+
+/* Keep track on whether we already registered the cleanup with the
+ * owning pool. */
+static svn_atomic_t prefetch_initialized = FALSE;
+
+#if APR_HAS_THREADS
+
+/* A window that has been read by a worker. */
+typedef struct prefetched_window_t
+{
+  /* The parsed window, allocated in POOL. */
+  svn_txdelta_window_t *window;
+
+  /* Index of WINDOW within the representation. */
+  int chunk_index;
+
+  /* Absolute file offset of the first byte after WINDOW. */
+  apr_off_t end_offset;
+
+  /* Thread-safe root pool owned by this entry.  It gets recycled through
+   * the prefetcher's SPARE_POOLS once the window has been consumed. */
+  apr_pool_t *pool;
+} prefetched_window_t;
+
+struct svn_fs_fs__window_prefetch_t
+{
+  /* Parameters as passed to svn_fs_fs__window_prefetch_create. */
+  const char *path;
+  apr_off_t end;
+  int version;
+  apr_int64_t block_size;
+
+  /* The following members are only being accessed by the prefetch task
+   * and there is at most one of them running at any time. */
+
+  /* The file to read from.  NULL until the first task runs. */
+  apr_file_t *file;
+
+  /* Thread-safe root pool containing FILE. */
+  apr_pool_t *file_pool;
+
+  /* Absolute offset and index of the next window to read. */
+  apr_off_t offset;
+  int next_chunk;
+
+  /* The prefetch task.  There is at most one of them queued or running
+   * at any time.  The group's mutex protects the following members. */
+  svn_task_group__t *group;
+
+  /* Parsed windows waiting for the reader, a ring buffer containing
+   * COUNT entries starting at FIRST. */
+  prefetched_window_t queue[MAX_READ_AHEAD];
+  int first;
+  int count;
+
+  /* Pools of consumed or dropped windows, available for reuse.  Since
+   * there are never more than MAX_READ_AHEAD queued windows plus the one
+   * being read, we never need more pools than that. */
+  apr_pool_t *spare_pools[MAX_READ_AHEAD + 1];
+  int spare_count;
+
+  /* Set once all windows have been read or reading them failed. */
+  svn_boolean_t done;
+
+  /* Set when the prefetcher is being shut down. */
+  svn_boolean_t shutdown;
+};
+
+/* Destructor function that implicitly cleans up any running threads
+   in the TRHEAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = thread_pool;
+  if (!thread_pool)
+    return APR_SUCCESS;
+
+  thread_pool = NULL;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+/* Core implementation of get_thread_pool. */
+static svn_error_t *
+create_thread_pool(void *baton,
+                   apr_pool_t *scratch_pool)
+{
+  /* The thread-pool must be allocated from a thread-safe pool. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status = apr_thread_pool_create(&thread_pool, 0, MAX_THREADS,
+                                               pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't create prefetch thread pool in FSFS"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more requests are
+     coming in */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *POOL_P to the process-wide prefetch thread pool, creating it upon
+ * first use.  Set it to NULL if the thread pool has already been shut
+ * down.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_thread_pool(apr_thread_pool_t **pool_p,
+                apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_atomic__init_once(&thread_pool_initialized, create_thread_pool,
+                                NULL, scratch_pool));
+  *pool_p = thread_pool;
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* Core implementation of svn_fs_fs__prefetch_init. */
+static svn_error_t *
+register_cleanup(void *baton,
+                 apr_pool_t *owning_pool)
+{
+#if APR_HAS_THREADS
+  apr_pool_pre_cleanup_register(owning_pool, NULL, thread_pool_pre_cleanup);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__prefetch_init(apr_pool_t *owning_pool)
+{
+  /* Protect against multiple calls. */
+  return svn_error_trace(svn_atomic__init_once(&prefetch_initialized,
+                                               register_cleanup,
+                                               NULL, owning_pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Read the next window for PREFETCH into *ENTRY, using ENTRY's pool.
+ * To be called from the prefetch task only.
+ */
+static svn_error_t *
+read_next_window(prefetched_window_t *entry,
+                 svn_fs_fs__window_prefetch_t *prefetch)
+{
+  svn_stream_t *stream;
+
+  if (prefetch->file == NULL)
+    {
+      SVN_ERR(svn_io_file_open(&prefetch->file, prefetch->path,
+                               APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
+                               prefetch->file_pool));
+      SVN_ERR(svn_io_file_aligned_seek(prefetch->file, prefetch->block_size,
+                                       NULL, prefetch->offset,
+                                       prefetch->file_pool));
+    }
+
+  entry->chunk_index = prefetch->next_chunk;
+
+  stream = svn_stream_from_aprfile2(prefetch->file, TRUE, entry->pool);
+  SVN_ERR(svn_txdelta_read_svndiff_window(&entry->window, stream,
+                                          prefetch->version, entry->pool));
+  SVN_ERR(svn_io_file_get_offset(&entry->end_offset, prefetch->file,
+                                 entry->pool));
+  if (entry->end_offset > prefetch->end)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading one svndiff window read beyond "
+                              "the end of the representation"));
+
+  prefetch->offset = entry->end_offset;
+  prefetch->next_chunk++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Make POOL of a consumed or dropped window available for reuse by
+ * PREFETCH.  The prefetch task will clear it before reusing it.
+ * PREFETCH->GROUP must be locked. */
+static void
+recycle_pool(svn_fs_fs__window_prefetch_t *prefetch,
+             apr_pool_t *pool)
+{
+  prefetch->spare_pools[prefetch->spare_count++] = pool;
+}
+
+/* Thread pool task reading windows for the svn_fs_fs__window_prefetch_t
+ * in DATA until its queue is full. */
+static void * APR_THREAD_FUNC
+prefetch_task(apr_thread_t *tid,
+              void *data)
+{
+  svn_fs_fs__window_prefetch_t *prefetch = data;
+
+  /* PREFETCH->SHUTDOWN gets set before the group shuts down, so checking
+   * that flag covers the result of svn_task_group__task_begin(). */
+  svn_task_group__lock(prefetch->group);
+  svn_task_group__task_begin(prefetch->group);
+  while (   !prefetch->shutdown
+         && !prefetch->done
+         && prefetch->count < MAX_READ_AHEAD)
+    {
+      prefetched_window_t entry = { 0 };
+      svn_error_t *err;
+
+      if (prefetch->spare_count)
+        entry.pool = prefetch->spare_pools[--prefetch->spare_count];
+
+      svn_task_group__unlock(prefetch->group);
+      if (entry.pool)
+        svn_pool_clear(entry.pool);
+      else
+        entry.pool = svn_pool_create(NULL);
+
+      err = read_next_window(&entry, prefetch);
+      svn_task_group__lock(prefetch->group);
+
+      if (err)
+        {
+          /* The reader will fall back to reading the window itself and
+             report the problem from there. */
+          svn_error_clear(err);
+          recycle_pool(prefetch, entry.pool);
+
+          prefetch->done = TRUE;
+        }
+      else
+        {
+          int next = (prefetch->first + prefetch->count) % MAX_READ_AHEAD;
+          prefetch->queue[next] = entry;
+          prefetch->count++;
+
+          if (prefetch->offset >= prefetch->end)
+            prefetch->done = TRUE;
+        }
+
+      svn_task_group__notify(prefetch->group);
+    }
+
+  svn_task_group__task_end(prefetch->group);
+  svn_task_group__unlock(prefetch->group);
+
+  return NULL;
+}
+
+/* Queue a prefetch task for PREFETCH, if there is more data to read and
+ * no task has been queued yet.  PREFETCH->GROUP must be locked. */
+static void
+schedule_task(svn_fs_fs__window_prefetch_t *prefetch)
+{
+  if (   !svn_task_group__pending(prefetch->group)
+      && !prefetch->done
+      && !prefetch->shutdown
+      && prefetch->count < MAX_READ_AHEAD)
+    {
+      if (   thread_pool == NULL
+          || svn_task_group__push(prefetch->group, thread_pool,
+                                  prefetch_task, prefetch))
+        prefetch->done = TRUE;
+    }
+}
+
+/* Remove the oldest entry from PREFETCH's queue and return its pool.
+ * PREFETCH->GROUP must be locked. */
+static apr_pool_t *
+pop_entry(svn_fs_fs__window_prefetch_t *prefetch)
+{
+  apr_pool_t *pool = prefetch->queue[prefetch->first].pool;
+
+  prefetch->first = (prefetch->first + 1) % MAX_READ_AHEAD;
+  prefetch->count--;
+
+  return pool;
+}
+
+/* Pool cleanup function shutting down the svn_fs_fs__window_prefetch_t
+ * given as DATA.  Makes sure that its task is neither queued nor running
+ * anymore. */
+static apr_status_t
+prefetch_cleanup(void *data)
+{
+  svn_fs_fs__window_prefetch_t *prefetch = data;
+
+  svn_task_group__lock(prefetch->group);
+  prefetch->shutdown = TRUE;
+  svn_task_group__unlock(prefetch->group);
+
+  /* Removes a task that has not started yet.  If the thread pool has
+   * been destroyed already, it dropped that task and there is nothing
+   * left to wait for. */
+  svn_task_group__shutdown(prefetch->group, thread_pool);
+
+  /* No other thread is accessing PREFETCH anymore. */
+  while (prefetch->count)
+    svn_pool_destroy(pop_entry(prefetch));
+
+  while (prefetch->spare_count)
+    svn_pool_destroy(prefetch->spare_pools[--prefetch->spare_count]);
+
+  svn_pool_destroy(prefetch->file_pool);
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+svn_error_t *
+svn_fs_fs__window_prefetch_create(svn_fs_fs__window_prefetch_t **prefetch_p,
+                                  const char *path,
+                                  apr_off_t start,
+                                  apr_off_t end,
+                                  int version,
+                                  int first_chunk,
+                                  apr_int64_t block_size,
+                                  apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_fs__window_prefetch_t *prefetch;
+  apr_thread_pool_t *pool;
+
+  if (start >= end)
+    {
+      *prefetch_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Only now that prefetching is actually being used, we need threads. */
+  SVN_ERR(get_thread_pool(&pool, result_pool));
+  if (pool == NULL)
+    {
+      *prefetch_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  prefetch = apr_pcalloc(result_pool, sizeof(*prefetch));
+  prefetch->path = apr_pstrdup(result_pool, path);
+  prefetch->end = end;
+  prefetch->version = version;
+  prefetch->block_size = block_size;
+  prefetch->offset = start;
+  prefetch->next_chunk = first_chunk;
+
+  SVN_ERR(svn_task_group__create(&prefetch->group, result_pool));
+
+  /* The file handle must not be shared with the calling thread. */
+  prefetch->file_pool = svn_pool_create(NULL);
+
+  /* Register this after creating the group, so the cleanup runs before
+     the group gets destroyed. */
+  apr_pool_cleanup_register(result_pool, prefetch, prefetch_cleanup,
+                            apr_pool_cleanup_null);
+
+  svn_task_group__lock(prefetch->group);
+  schedule_task(prefetch);
+  svn_task_group__unlock(prefetch->group);
+
+  *prefetch_p = prefetch;
+#else
+  *prefetch_p = NULL;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__window_prefetch_get(svn_txdelta_window_t **window_p,
+                               apr_off_t *end_offset,
+                               svn_fs_fs__window_prefetch_t *prefetch,
+                               int chunk_index,
+                               apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS
+  prefetched_window_t entry = { 0 };
+
+  svn_task_group__lock(prefetch->group);
+  while (TRUE)
+    {
+      /* Drop windows that the reader did not need. */
+      while (   prefetch->count
+             && prefetch->queue[prefetch->first].chunk_index < chunk_index)
+        recycle_pool(prefetch, pop_entry(prefetch));
+
+      /* Make room for more windows to be read. */
+      schedule_task(prefetch);
+
+      if (prefetch->count || !svn_task_group__pending(prefetch->group))
+        break;
+
+      svn_task_group__wait(prefetch->group);
+    }
+
+  if (   prefetch->count
+      && prefetch->queue[prefetch->first].chunk_index == chunk_index)
+    {
+      entry = prefetch->queue[prefetch->first];
+      pop_entry(prefetch);
+      schedule_task(prefetch);
+    }
+  svn_task_group__unlock(prefetch->group);
+
+  if (entry.window)
+    {
+      *window_p = svn_txdelta_window_dup(entry.window, result_pool);
+      *end_offset = entry.end_offset;
+
+      svn_task_group__lock(prefetch->group);
+      recycle_pool(prefetch, entry.pool);
+      svn_task_group__unlock(prefetch->group);
+    }
+  else
+    {
+      *window_p = NULL;
+    }
+#else
+  *window_p = NULL;
+#endif
+
+  return SVN_NO_ERROR;
+}
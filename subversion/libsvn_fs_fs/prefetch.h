@@ -0,0 +1,82 @@
+/* prefetch.h : reading delta windows ahead on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS__PREFETCH_H
+#define SVN_LIBSVN_FS__PREFETCH_H
+
+#include "svn_delta.h"
+#include "fs.h"
+
+/* Reconstructing a large file from its delta chain is dominated by reading
+ * and decompressing the svndiff windows of every representation in that
+ * chain.  A window prefetcher does that work for a single representation
+ * on a worker thread while the calling thread combines the windows.
+ *
+ * Prefetchers don't use any of the FS' data structures.  They simply open
+ * their own handle to the rev / pack file and parse the windows from there.
+ * Whenever a prefetcher cannot deliver a window, it is up to the caller to
+ * read it in the usual way.  That includes reporting any errors.
+ */
+typedef struct svn_fs_fs__window_prefetch_t svn_fs_fs__window_prefetch_t;
+
+/* Limit the lifetime of the process-wide thread pool used by all window
+ * prefetchers to OWNING_POOL.  The thread pool itself will only be created
+ * once the first prefetcher gets started, i.e. never if prefetching has
+ * been disabled in all repositories.
+ */
+svn_error_t *
+svn_fs_fs__prefetch_init(apr_pool_t *owning_pool);
+
+/* Set *PREFETCH_P to a new window prefetcher for the file at PATH and start
+ * reading svndiff windows of version VERSION.  The first window is number
+ * FIRST_CHUNK and starts at the absolute file offset START.  The windows
+ * end at offset END.  BLOCK_SIZE is the I/O granularity to use.
+ *
+ * If prefetching is not supported, set *PREFETCH_P to NULL.  Otherwise,
+ * the prefetcher gets shut down when RESULT_POOL is cleaned up.
+ */
+svn_error_t *
+svn_fs_fs__window_prefetch_create(svn_fs_fs__window_prefetch_t **prefetch_p,
+                                  const char *path,
+                                  apr_off_t start,
+                                  apr_off_t end,
+                                  int version,
+                                  int first_chunk,
+                                  apr_int64_t block_size,
+                                  apr_pool_t *result_pool);
+
+/* Wait for window number CHUNK_INDEX from PREFETCH to become available.
+ * Return it in *WINDOW_P, allocated in RESULT_POOL, and set *END_OFFSET to
+ * the absolute file offset just behind it.  Windows before CHUNK_INDEX
+ * that have not been requested will be skipped.
+ *
+ * If the window cannot be provided, e.g. because it could not be read,
+ * set *WINDOW_P to NULL.
+ */
+svn_error_t *
+svn_fs_fs__window_prefetch_get(svn_txdelta_window_t **window_p,
+                               apr_off_t *end_offset,
+                               svn_fs_fs__window_prefetch_t *prefetch,
+                               int chunk_index,
+                               apr_pool_t *result_pool);
+
+#endif
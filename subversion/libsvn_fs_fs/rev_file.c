@@ -46,6 +46,11 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+#if APR_HAS_MMAP
+  file->mmap = NULL;
+#endif
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +125,40 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* Try to map the whole of FILE->FILE into memory.  The mapping will be
+ * released when FILE gets closed or RESULT_POOL gets cleaned up.  If the
+ * file cannot be mapped, e.g. because it is empty, too large for the
+ * address space or mmap is not supported at all, silently leave FILE
+ * unmapped.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  apr_finfo_t finfo;
+  apr_mmap_t *mmap;
+  apr_status_t status;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file->file,
+                               scratch_pool));
+  if (finfo.size <= 0 || finfo.size > APR_SIZE_MAX)
+    return SVN_NO_ERROR;
+
+  status = apr_mmap_create(&mmap, file->file, 0, (apr_size_t)finfo.size,
+                           APR_MMAP_READ, result_pool);
+  if (status == APR_SUCCESS)
+    {
+      file->mmap = mmap;
+      file->mapped_data = mmap->mm;
+      file->mapped_size = finfo.size;
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +199,11 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Committed revisions are immutable.  But don't map files that
+           * we are about to modify. */
+          if (ffd->enable_mmap && !writable)
+            SVN_ERR(auto_map_file(file, result_pool, scratch_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -236,24 +280,44 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       unsigned char footer_length;
       svn_stringbuf_t *footer;
 
-      /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
-
-      /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
-
-      /* Read footer. */
-      footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1 - footer_length,
-                                       file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
-      footer->data[footer->len] = '\0';
+      if (file->mapped_data)
+        {
+          /* The footer is at the very end of the mapped data. */
+          filesize = file->mapped_size;
+          footer_length = (unsigned char)file->mapped_data[filesize - 1];
+          if (footer_length > filesize - 1)
+            return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                     _("Invalid footer length %d in "
+                                       "revision file of r%ld"),
+                                     footer_length, file->start_revision);
+
+          footer = svn_stringbuf_ncreate(file->mapped_data + filesize - 1
+                                           - footer_length,
+                                         footer_length, file->pool);
+        }
+      else
+        {
+          /* Determine file size. */
+          SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize,
+                                   file->pool));
+
+          /* Read last byte (containing the length of the footer). */
+          SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+                                           filesize - 1, file->pool));
+          SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
+                                         sizeof(footer_length), NULL, NULL,
+                                         file->pool));
+
+          /* Read footer. */
+          footer = svn_stringbuf_create_ensure(footer_length, file->pool);
+          SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+                                           filesize - 1 - footer_length,
+                                           file->pool));
+          SVN_ERR(svn_io_file_read_full2(file->file, footer->data,
+                                         footer_length, &footer->len, NULL,
+                                         file->pool));
+          footer->data[footer->len] = '\0';
+        }
 
       /* Extract index locations. */
       SVN_ERR(svn_fs_fs__parse_footer(&file->l2p_offset, &file->l2p_checksum,
@@ -290,9 +354,36 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   return SVN_NO_ERROR;
 }
 
+const char *
+svn_fs_fs__rev_file_mapped(svn_fs_fs__revision_file_t *file,
+                           apr_off_t offset,
+                           apr_off_t len)
+{
+  if (   file->mapped_data
+      && offset >= 0
+      && len >= 0
+      && offset <= file->mapped_size - len)
+    return file->mapped_data + offset;
+
+  return NULL;
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      file->mmap = NULL;
+      file->mapped_data = NULL;
+      file->mapped_size = 0;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+#endif
+
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
   if (file->file)
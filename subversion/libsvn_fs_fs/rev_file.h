@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -57,6 +59,19 @@ typedef struct svn_fs_fs__revision_file_t
   /* stream based on FILE and not NULL exactly when FILE is not NULL */
   svn_stream_t *stream;
 
+  /* If not NULL, the whole of FILE has been mapped into memory, starting
+   * at this address.  Only ever set for files that will not be modified
+   * anymore.  See svn_fs_fs__rev_file_mapped(). */
+  const char *mapped_data;
+
+  /* Number of bytes accessible at MAPPED_DATA.  0 if not mapped. */
+  apr_off_t mapped_size;
+
+#if APR_HAS_MMAP
+  /* Mapping behind MAPPED_DATA.  NULL if not mapped. */
+  apr_mmap_t *mmap;
+#endif
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -137,6 +152,16 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* If FILE has been mapped into memory and the LEN bytes starting at
+ * OFFSET lie within FILE, return a pointer to the mapped copy of these
+ * bytes.  Otherwise, return NULL and the caller has to read them from
+ * FILE->FILE.  The data remains valid until FILE gets closed.
+ */
+const char *
+svn_fs_fs__rev_file_mapped(svn_fs_fs__revision_file_t *file,
+                           apr_off_t offset,
+                           apr_off_t len);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
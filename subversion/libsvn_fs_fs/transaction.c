@@ -43,12 +43,14 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "../libsvn_fs/fs-loader.h"
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
 
 #include "svn_private_config.h"
 
@@ -2168,8 +2170,24 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
+  int compression_level = ffd->delta_compression_level;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->delta_compression_type == compression_type_zstd)
+    {
+      /* Like svndiff3, svndiff4 supports large delta windows. */
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF4_FORMAT);
+      svndiff_version = 4;
+    }
+  else if (ffd->delta_window_size > SVN_DELTA_WINDOW_SIZE)
+    {
+      /* Only svndiff3 supports large windows.  It is zlib-based, so
+         use the fastest zlib level in place of LZ4. */
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+      if (ffd->delta_compression_type == compression_type_lz4)
+        compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE + 1;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2177,7 +2195,7 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
   else if (ffd->delta_compression_type == compression_type_zlib)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT);
-      svndiff_version = 1;
+      svndiff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT ? 3 : 1;
     }
   else
     {
@@ -2185,7 +2203,7 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
     }
 
   svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+                          compression_level, pool);
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2204,6 +2222,7 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
@@ -2235,7 +2254,9 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
                                   b->scratch_pool));
 
-  /* Write out the rep header. */
+  /* Write out the rep header.  Without a delta base nor compression,
+     a self-delta would merely add overhead to the fulltext.  Store the
+     latter as-is instead, so it can be sent from disk unprocessed. */
   if (base_rep)
     {
       header.base_revision = base_rep->revision;
@@ -2243,6 +2264,10 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
       header.base_length = base_rep->size;
       header.type = svn_fs_fs__rep_delta;
     }
+  else if (ffd->delta_compression_type == compression_type_none)
+    {
+      header.type = svn_fs_fs__rep_plain;
+    }
   else
     {
       header.type = svn_fs_fs__rep_self_delta;
@@ -2258,11 +2283,16 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
+  /* Prepare to write the svndiff data.  PLAIN data goes straight to
+     REP_STREAM. */
+  if (header.type != svn_fs_fs__rep_plain)
+    {
+      txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+      b->delta_stream = svn_txdelta__target_push(wh, whb, source,
+                                                 ffd->delta_window_size,
+                                                 b->scratch_pool);
+    }
 
   *wb_p = b;
 
@@ -2915,6 +2945,7 @@ write_container_delta_rep(representation_t *rep,
   apr_off_t offset = 0;
 
   struct write_container_baton *whb;
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_boolean_t is_props = (item_type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS);
 
@@ -2950,8 +2981,9 @@ write_container_delta_rep(representation_t *rep,
   txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
-  whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
-                                        scratch_pool);
+  whb->stream = svn_txdelta__target_push(diff_wh, diff_whb, source,
+                                         ffd->delta_window_size,
+                                         scratch_pool);
   whb->size = 0;
   whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
   if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
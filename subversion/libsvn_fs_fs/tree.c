@@ -2963,6 +2963,27 @@ fs_try_process_file_contents(svn_boolean_t *success,
 /* --- End machinery for svn_fs_try_process_file_contents() ---  */
 
 
+/* --- Machinery for svn_fs__get_contents_location() ---  */
+
+static svn_error_t *
+fs_get_contents_location(apr_file_t **file,
+                         apr_off_t *offset,
+                         svn_filesize_t *length,
+                         svn_fs_root_t *root,
+                         const char *path,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  dag_node_t *node;
+  SVN_ERR(get_dag(&node, root, path, scratch_pool));
+
+  return svn_fs_fs__dag_get_contents_location(file, offset, length, node,
+                                              result_pool, scratch_pool);
+}
+
+/* --- End machinery for svn_fs__get_contents_location() ---  */
+
+
 /* --- Machinery for svn_fs_apply_textdelta() ---  */
 
 
@@ -4572,6 +4593,7 @@ static root_vtable_t root_vtable = {
   fs_file_checksum,
   fs_file_contents,
   fs_try_process_file_contents,
+  fs_get_contents_location,
   fs_make_file,
   fs_apply_textdelta,
   fs_apply_text,
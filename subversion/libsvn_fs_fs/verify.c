@@ -20,9 +20,15 @@
  * ====================================================================
  */
 
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+
 #include "svn_sorts.h"
 #include "svn_checksum.h"
 #include "svn_time.h"
+#include "svn_cache_config.h"
+#include "private/svn_atomic.h"
 #include "private/svn_subr_private.h"
 
 #include "verify.h"
@@ -883,6 +889,647 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+
+/** Concurrent verification. **/
+
+#if APR_HAS_THREADS
+
+/* In repositories with a linear layout, there are no shards along which
+ * we could split the revision range.  Use tasks of this many revisions. */
+#define LINEAR_LAYOUT_TASK_SIZE 1000
+
+/* Number of rep-cache entries to check per task. */
+#define REP_CACHE_TASK_SIZE 1024
+
+/* Maximum number of tasks per worker thread that may be queued or are
+ * waiting to be reported back.  This keeps memory usage bounded and
+ * progress notifications timely. */
+#define MAX_PENDING_TASKS_PER_WORKER 4
+
+typedef struct verify_task_t verify_task_t;
+
+/* Execute TASK against FS, which is private to the calling worker thread.
+ * Check for cancellation using CANCEL_FUNC with CANCEL_BATON.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+typedef svn_error_t *
+(*verify_task_func_t)(verify_task_t *task,
+                      svn_fs_t *fs,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
+/* A unit of verification work, i.e. a shard / pack file or a batch of
+ * rep-cache entries.  Tasks get created by the main thread and are
+ * read-only to the worker threads, except for the result fields.
+ */
+struct verify_task_t
+{
+  /* The work to do. */
+  verify_task_func_t func;
+
+  /* First and last revision to check.  For batches of rep-cache entries,
+   * START is only used for progress notification. */
+  svn_revnum_t start;
+  svn_revnum_t end;
+
+  /* Rep-cache entries (representation_t) to check.  May be NULL. */
+  apr_array_header_t *reps;
+
+  /* Main thread pool that contains this task. */
+  apr_pool_t *pool;
+
+  /* If set, report NOTIFY_REVISION as progress just before reporting
+   * the result of this task.  This is where the serial code would call
+   * the notification function before doing the same work. */
+  svn_boolean_t notify;
+  svn_revnum_t notify_revision;
+
+  /* Result of FUNC.  Only valid after DONE has been set. */
+  svn_error_t *err;
+
+  /* Set by the worker thread after FUNC returned. */
+  svn_boolean_t done;
+};
+
+typedef struct verify_scheduler_t verify_scheduler_t;
+
+/* Per worker thread data. */
+typedef struct verify_worker_t
+{
+  /* The thread executing verify_worker_thread().  NULL if not started. */
+  apr_thread_t *thread;
+
+  /* Filesystem instance to be used by this worker only. */
+  svn_fs_t *fs;
+
+  /* Thread-safe root pool owned by this worker. */
+  apr_pool_t *pool;
+
+  /* Where to get tasks from. */
+  verify_scheduler_t *scheduler;
+} verify_worker_t;
+
+/* Hands out tasks to the worker threads and reports their results in
+ * the order in which they were submitted.
+ */
+struct verify_scheduler_t
+{
+  /* All tasks submitted so far (verify_task_t *).  Entries become NULL
+   * once they have been retired. */
+  apr_array_header_t *tasks;
+
+  /* Index within TASKS of the next task to hand out to a worker. */
+  int next_task;
+
+  /* Index within TASKS of the oldest task not yet retired.
+   * Only accessed by the main thread. */
+  int next_retire;
+
+  /* If set, the workers shall terminate instead of taking new tasks. */
+  svn_boolean_t shutdown;
+
+  /* Set when the verification failed or got cancelled.  Running tasks
+   * will be interrupted through worker_cancel_func(). */
+  volatile svn_atomic_t aborted;
+
+  /* Protects TASKS, NEXT_TASK, SHUTDOWN and the DONE flags of all tasks. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a task has been submitted or completed. */
+  apr_thread_cond_t *changed;
+
+  /* The worker threads (verify_worker_t *). */
+  apr_array_header_t *workers;
+
+  /* Callbacks as passed to svn_fs_fs__verify. */
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+};
+
+/* Implements svn_cancel_func_t for the worker threads.  BATON is the
+ * verify_scheduler_t.  Interrupt the current task if the verification
+ * has been aborted and forward to the user-provided cancel function.
+ */
+static svn_error_t *
+worker_cancel_func(void *baton)
+{
+  verify_scheduler_t *scheduler = baton;
+
+  if (svn_atomic_read(&scheduler->aborted))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  if (scheduler->cancel_func)
+    return svn_error_trace(scheduler->cancel_func(scheduler->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function processing the tasks of the scheduler until it gets
+ * shut down.  DATA is the verify_worker_t. */
+static void * APR_THREAD_FUNC
+verify_worker_thread(apr_thread_t *tid,
+                     void *data)
+{
+  verify_worker_t *worker = data;
+  verify_scheduler_t *scheduler = worker->scheduler;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  apr_thread_mutex_lock(scheduler->mutex);
+  while (!scheduler->shutdown)
+    {
+      verify_task_t *task;
+      svn_error_t *err;
+
+      if (scheduler->next_task == scheduler->tasks->nelts)
+        {
+          apr_thread_cond_wait(scheduler->changed, scheduler->mutex);
+          continue;
+        }
+
+      task = APR_ARRAY_IDX(scheduler->tasks, scheduler->next_task,
+                           verify_task_t *);
+      scheduler->next_task++;
+      apr_thread_mutex_unlock(scheduler->mutex);
+
+      svn_pool_clear(iterpool);
+      err = task->func(task, worker->fs, worker_cancel_func, scheduler,
+                       iterpool);
+
+      apr_thread_mutex_lock(scheduler->mutex);
+      task->err = err;
+      task->done = TRUE;
+      apr_thread_cond_broadcast(scheduler->changed);
+    }
+  apr_thread_mutex_unlock(scheduler->mutex);
+
+  svn_pool_destroy(iterpool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Set *SCHEDULER_P to a new scheduler without any worker threads.
+ * The other parameters are the same as for svn_fs_fs__verify.
+ * Allocate the result in RESULT_POOL. */
+static svn_error_t *
+scheduler_create(verify_scheduler_t **scheduler_p,
+                 svn_fs_progress_notify_func_t notify_func,
+                 void *notify_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool)
+{
+  apr_status_t status;
+  verify_scheduler_t *scheduler = apr_pcalloc(result_pool,
+                                              sizeof(*scheduler));
+
+  scheduler->tasks = apr_array_make(result_pool, 16,
+                                    sizeof(verify_task_t *));
+  scheduler->workers = apr_array_make(result_pool, 16,
+                                      sizeof(verify_worker_t *));
+  scheduler->notify_func = notify_func;
+  scheduler->notify_baton = notify_baton;
+  scheduler->cancel_func = cancel_func;
+  scheduler->cancel_baton = cancel_baton;
+
+  status = apr_thread_mutex_create(&scheduler->mutex,
+                                   APR_THREAD_MUTEX_DEFAULT, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&scheduler->changed, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  *scheduler_p = scheduler;
+
+  return SVN_NO_ERROR;
+}
+
+/* Start JOBS worker threads in SCHEDULER, each one with its own instance
+ * of FS.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * Call scheduler_shutdown() even if this function fails.
+ */
+static svn_error_t *
+start_workers(verify_scheduler_t *scheduler,
+              svn_fs_t *fs,
+              int jobs,
+              apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; i < jobs; ++i)
+    {
+      apr_status_t status;
+      verify_worker_t *worker = apr_pcalloc(scratch_pool, sizeof(*worker));
+
+      /* Worker memory must not be shared with the main thread. */
+      worker->pool = svn_pool_create(NULL);
+      worker->scheduler = scheduler;
+      APR_ARRAY_PUSH(scheduler->workers, verify_worker_t *) = worker;
+
+      SVN_ERR(svn_fs_fs__open_clone(&worker->fs, fs, worker->pool,
+                                    scratch_pool));
+
+      status = apr_thread_create(&worker->thread, NULL, verify_worker_thread,
+                                 worker, worker->pool);
+      if (status)
+        {
+          worker->thread = NULL;
+          return svn_error_wrap_apr(status,
+                                    _("Can't create verification thread"));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Terminate all worker threads in SCHEDULER and release their resources.
+ * If ERR is not SVN_NO_ERROR, interrupt running tasks.  Return ERR
+ * combined with any errors that occurred during the shutdown. */
+static svn_error_t *
+scheduler_shutdown(verify_scheduler_t *scheduler,
+                   svn_error_t *err)
+{
+  int i;
+
+  if (err)
+    svn_atomic_set(&scheduler->aborted, TRUE);
+
+  apr_thread_mutex_lock(scheduler->mutex);
+  scheduler->shutdown = TRUE;
+  apr_thread_cond_broadcast(scheduler->changed);
+  apr_thread_mutex_unlock(scheduler->mutex);
+
+  for (i = 0; i < scheduler->workers->nelts; ++i)
+    {
+      verify_worker_t *worker = APR_ARRAY_IDX(scheduler->workers, i,
+                                              verify_worker_t *);
+      if (worker->thread)
+        {
+          apr_status_t retval;
+          apr_status_t status = apr_thread_join(&retval, worker->thread);
+          if (status)
+            err = svn_error_compose_create(err,
+                    svn_error_wrap_apr(status,
+                                       _("Can't join verification thread")));
+        }
+
+      svn_pool_destroy(worker->pool);
+    }
+
+  /* Discard the results that have not been reported. */
+  for (i = scheduler->next_retire; i < scheduler->tasks->nelts; ++i)
+    {
+      verify_task_t *task = APR_ARRAY_IDX(scheduler->tasks, i,
+                                          verify_task_t *);
+      svn_error_clear(task->err);
+      svn_pool_destroy(task->pool);
+    }
+
+  scheduler->next_retire = scheduler->tasks->nelts;
+
+  return svn_error_trace(err);
+}
+
+/* Report progress for the oldest not yet retired task in SCHEDULER, wait
+ * for it to complete and return its result.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+retire_task(verify_scheduler_t *scheduler,
+            apr_pool_t *scratch_pool)
+{
+  verify_task_t *task;
+  svn_error_t *err;
+
+  /* Only the main thread adds tasks, so no need to lock for reading. */
+  task = APR_ARRAY_IDX(scheduler->tasks, scheduler->next_retire,
+                       verify_task_t *);
+  if (task->notify && scheduler->notify_func)
+    scheduler->notify_func(task->notify_revision, scheduler->notify_baton,
+                           scratch_pool);
+
+  apr_thread_mutex_lock(scheduler->mutex);
+  while (!task->done)
+    apr_thread_cond_wait(scheduler->changed, scheduler->mutex);
+
+  APR_ARRAY_IDX(scheduler->tasks, scheduler->next_retire, verify_task_t *)
+    = NULL;
+  apr_thread_mutex_unlock(scheduler->mutex);
+
+  scheduler->next_retire++;
+  err = task->err;
+  svn_pool_destroy(task->pool);
+
+  SVN_ERR(err);
+
+  if (scheduler->cancel_func)
+    SVN_ERR(scheduler->cancel_func(scheduler->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Retire all tasks in SCHEDULER in the order of their submission.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+retire_all_tasks(verify_scheduler_t *scheduler,
+                 apr_pool_t *scratch_pool)
+{
+  while (scheduler->next_retire < scheduler->tasks->nelts)
+    SVN_ERR(retire_task(scheduler, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue TASK in SCHEDULER.  If there are too many pending tasks, retire
+ * the oldest ones first.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * Please note that TASK may have been released when this returns. */
+static svn_error_t *
+submit_task(verify_scheduler_t *scheduler,
+            verify_task_t *task,
+            apr_pool_t *scratch_pool)
+{
+  int max_pending = scheduler->workers->nelts * MAX_PENDING_TASKS_PER_WORKER;
+
+  apr_thread_mutex_lock(scheduler->mutex);
+  APR_ARRAY_PUSH(scheduler->tasks, verify_task_t *) = task;
+  apr_thread_cond_broadcast(scheduler->changed);
+  apr_thread_mutex_unlock(scheduler->mutex);
+
+  /* Only the main thread modifies the number of TASKS. */
+  while (scheduler->tasks->nelts - scheduler->next_retire > max_pending)
+    SVN_ERR(retire_task(scheduler, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements verify_task_func_t for the metadata checks of a single
+ * shard or pack file. */
+static svn_error_t *
+metadata_task_func(verify_task_t *task,
+                   svn_fs_t *fs,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(verify_f7_metadata_consistency(fs,
+                                                        task->start,
+                                                        task->end,
+                                                        NULL, NULL,
+                                                        cancel_func,
+                                                        cancel_baton,
+                                                        scratch_pool));
+}
+
+/* Implements verify_task_func_t for a batch of rep-cache entries. */
+static svn_error_t *
+rep_cache_task_func(verify_task_t *task,
+                    svn_fs_t *fs,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  int i;
+  verify_walker_baton_t baton = { 0 };
+  baton.pool = svn_pool_create(scratch_pool);
+  baton.last_notified_revision = SVN_INVALID_REVNUM;
+
+  for (i = 0; i < task->reps->nelts; ++i)
+    {
+      representation_t *rep = &APR_ARRAY_IDX(task->reps, i,
+                                             representation_t);
+      SVN_ERR(verify_walker(rep, &baton, fs, scratch_pool));
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+    }
+
+  svn_pool_destroy(baton.pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Like verify_f7_metadata_consistency but distribute the work per shard
+ * or pack file to the worker threads in SCHEDULER. */
+static svn_error_t *
+verify_f7_metadata_concurrently(verify_scheduler_t *scheduler,
+                                svn_fs_t *fs,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t task_size = ffd->max_files_per_dir
+                         ? ffd->max_files_per_dir
+                         : LINEAR_LAYOUT_TASK_SIZE;
+  svn_revnum_t revision, next_revision;
+
+  for (revision = start; revision <= end; revision = next_revision)
+    {
+      apr_pool_t *task_pool = svn_pool_create(pool);
+      verify_task_t *task = apr_pcalloc(task_pool, sizeof(*task));
+      svn_revnum_t pack_start = svn_fs_fs__packed_base_rev(fs, revision);
+
+      /* Never let a task cross shard boundaries.  This way, each task
+       * will cover exactly one pack file, if the shard has been packed. */
+      next_revision = MIN(end + 1, (revision / task_size + 1) * task_size);
+
+      task->func = metadata_task_func;
+      task->start = revision;
+      task->end = next_revision - 1;
+      task->pool = task_pool;
+
+      /* Same condition as in verify_f7_metadata_consistency(). */
+      task->notify = ffd->max_files_per_dir
+                  && pack_start % ffd->max_files_per_dir == 0;
+      task->notify_revision = pack_start;
+
+      SVN_ERR(submit_task(scheduler, task, pool));
+    }
+
+  return svn_error_trace(retire_all_tasks(scheduler, pool));
+}
+
+/* Baton type for rep_cache_batch_walker(). */
+typedef struct rep_cache_batch_baton_t
+{
+  /* Where to send full batches. */
+  verify_scheduler_t *scheduler;
+
+  /* Task collecting the next batch of rep-cache entries.  May be NULL. */
+  verify_task_t *task;
+
+  /* Parent pool for the tasks. */
+  apr_pool_t *pool;
+
+  /* Mirror the resource counters of verify_walker_baton_t, such that we
+   * notify at the same entries as verify_walker() does in serial mode.
+   * A new file is assumed whenever the rev / pack file changes. */
+  int iteration_count;
+  int file_count;
+  svn_revnum_t last_file;
+  svn_revnum_t last_notified_revision;
+} rep_cache_batch_baton_t;
+
+/* Submit the current batch in BATON, if there is one.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+submit_rep_cache_batch(rep_cache_batch_baton_t *baton,
+                       apr_pool_t *scratch_pool)
+{
+  verify_task_t *task = baton->task;
+  if (task)
+    {
+      baton->task = NULL;
+      SVN_ERR(submit_task(baton->scheduler, task, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__walk_rep_reference().walker.  Collects the
+ * entries in batches and sends them to the worker threads. */
+static svn_error_t *
+rep_cache_batch_walker(representation_t *rep,
+                       void *baton,
+                       svn_fs_t *fs,
+                       apr_pool_t *scratch_pool)
+{
+  rep_cache_batch_baton_t *batch_baton = baton;
+  verify_task_t *task;
+  svn_revnum_t file = svn_fs_fs__packed_base_rev(fs, rep->revision);
+  svn_boolean_t notify = FALSE;
+
+  /* Same logic as in verify_walker(). */
+  if (   batch_baton->iteration_count > 1000
+      || batch_baton->file_count > 16)
+    {
+      if (rep->revision != batch_baton->last_notified_revision)
+        {
+          notify = TRUE;
+          batch_baton->last_notified_revision = rep->revision;
+        }
+
+      batch_baton->iteration_count = 0;
+      batch_baton->file_count = 0;
+      batch_baton->last_file = SVN_INVALID_REVNUM;
+    }
+
+  batch_baton->iteration_count++;
+  if (file != batch_baton->last_file)
+    {
+      batch_baton->file_count++;
+      batch_baton->last_file = file;
+    }
+
+  /* A notification has to be sent just before checking REP,
+   * i.e. at the start of a batch. */
+  if (notify)
+    SVN_ERR(submit_rep_cache_batch(batch_baton, scratch_pool));
+
+  task = batch_baton->task;
+  if (task == NULL)
+    {
+      apr_pool_t *task_pool = svn_pool_create(batch_baton->pool);
+
+      task = apr_pcalloc(task_pool, sizeof(*task));
+      task->func = rep_cache_task_func;
+      task->start = rep->revision;
+      task->end = rep->revision;
+      task->reps = apr_array_make(task_pool, REP_CACHE_TASK_SIZE,
+                                  sizeof(representation_t));
+      task->pool = task_pool;
+      task->notify = notify;
+      task->notify_revision = rep->revision;
+
+      batch_baton->task = task;
+    }
+
+  APR_ARRAY_PUSH(task->reps, representation_t) = *rep;
+  if (task->reps->nelts == REP_CACHE_TASK_SIZE)
+    SVN_ERR(submit_rep_cache_batch(batch_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Like verify_rep_cache but distribute the checks to the worker threads
+ * in SCHEDULER.  Reading the rep-cache DB remains in this thread. */
+static svn_error_t *
+verify_rep_cache_concurrently(verify_scheduler_t *scheduler,
+                              svn_fs_t *fs,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              apr_pool_t *pool)
+{
+  svn_boolean_t exists;
+
+  /* rep-cache verification. */
+  SVN_ERR(svn_fs_fs__exists_rep_cache(&exists, fs, pool));
+  if (exists)
+    {
+      rep_cache_batch_baton_t baton = { 0 };
+      baton.scheduler = scheduler;
+      baton.pool = pool;
+      baton.last_file = SVN_INVALID_REVNUM;
+      baton.last_notified_revision = SVN_INVALID_REVNUM;
+
+      /* tell the user that we are now ready to do *something* */
+      if (scheduler->notify_func)
+        scheduler->notify_func(SVN_INVALID_REVNUM, scheduler->notify_baton,
+                               pool);
+
+      SVN_ERR(svn_fs_fs__walk_rep_reference(fs, start, end,
+                                            rep_cache_batch_walker, &baton,
+                                            scheduler->cancel_func,
+                                            scheduler->cancel_baton,
+                                            pool));
+      SVN_ERR(submit_rep_cache_batch(&baton, pool));
+      SVN_ERR(retire_all_tasks(scheduler, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_fs_fs__verify using FFD->VERIFY_JOBS worker threads.
+ * Progress and errors are reported in the same order as during serial
+ * verification, with the same granularity. */
+static svn_error_t *
+verify_concurrently(svn_fs_t *fs,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    svn_fs_progress_notify_func_t notify_func,
+                    void *notify_baton,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  verify_scheduler_t *scheduler;
+  svn_error_t *err;
+
+  SVN_ERR(scheduler_create(&scheduler, notify_func, notify_baton,
+                           cancel_func, cancel_baton, pool));
+  err = start_workers(scheduler, fs, ffd->verify_jobs, pool);
+
+  /* log/phys index consistency.  We need to check them first to make
+     sure we can access the rev / pack files in format7. */
+  if (!err && svn_fs_fs__use_log_addressing(fs))
+    err = verify_f7_metadata_concurrently(scheduler, fs, start, end, pool);
+
+  /* rep cache consistency */
+  if (!err && ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    err = verify_rep_cache_concurrently(scheduler, fs, start, end, pool);
+
+  return svn_error_trace(scheduler_shutdown(scheduler, err));
+}
+
+#endif
+
 svn_error_t *
 svn_fs_fs__verify(svn_fs_t *fs,
                   svn_revnum_t start,
@@ -906,6 +1553,16 @@ svn_fs_fs__verify(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__ensure_revision_exists(start, fs, pool));
   SVN_ERR(svn_fs_fs__ensure_revision_exists(end, fs, pool));
 
+#if APR_HAS_THREADS
+  /* All workers share the same membuffer cache, i.e. it must be
+     thread-safe.  Otherwise, fall back to serial verification. */
+  if (ffd->verify_jobs > 1 && !svn_cache_config_get()->single_threaded)
+    return svn_error_trace(verify_concurrently(fs, start, end,
+                                               notify_func, notify_baton,
+                                               cancel_func, cancel_baton,
+                                               pool));
+#endif
+
   /* log/phys index consistency.  We need to check them first to make
      sure we can access the rev / pack files in format7. */
   if (svn_fs_fs__use_log_addressing(fs))
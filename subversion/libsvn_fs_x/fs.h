@@ -104,6 +104,7 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION        "compression"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -121,11 +122,14 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_x__create() as well.
  */
-#define SVN_FS_X__FORMAT_NUMBER   2
+#define SVN_FS_X__FORMAT_NUMBER   3
 
 /* Latest experimental format number.  Experimental formats are only
    compatible with themselves. */
-#define SVN_FS_X__EXPERIMENTAL_FORMAT_NUMBER   2
+#define SVN_FS_X__EXPERIMENTAL_FORMAT_NUMBER   1
+
+/* The minimum format number that supports svndiff version 4. */
+#define SVN_FS_X__MIN_SVNDIFF4_FORMAT 3
 
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
@@ -394,6 +398,10 @@ typedef struct svn_fs_x__data_t
   /* Compression level to use with txdelta storage format in new revs. */
   int delta_compression_level;
 
+  /* Use Zstandard instead of zlib to compress txdelta windows in new revs.
+     DELTA_COMPRESSION_LEVEL is then used as the zstd compression level. */
+  svn_boolean_t delta_compression_zstd;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -262,6 +262,7 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  const char *compression;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -289,6 +290,34 @@ read_config(svn_fs_x__data_t *ffd,
     = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                 SVN_DELTA_COMPRESSION_LEVEL_MAX);
 
+  svn_config_get(config, &compression, CONFIG_SECTION_DELTIFICATION,
+                 CONFIG_OPTION_COMPRESSION, "zlib");
+  if (strcmp(compression, "zstd") == 0)
+    {
+#ifdef SVN_HAVE_ZSTD
+      if (ffd->format < SVN_FS_X__MIN_SVNDIFF4_FORMAT)
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("Compression type 'zstd' requires "
+                                  "filesystem format 3 or higher"));
+
+      ffd->delta_compression_zstd = TRUE;
+#else
+      return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                              _("Compression type 'zstd' is not "
+                                "supported by this build of Subversion"));
+#endif
+    }
+  else if (strcmp(compression, "zlib") == 0)
+    {
+      ffd->delta_compression_zstd = FALSE;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                           _("Invalid 'compression' value '%s' in the config"),
+                               compression);
+    }
+
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
                               CONFIG_SECTION_PACKED_REVPROPS,
@@ -457,6 +486,14 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### This setting selects the compression algorithm, either 'zlib' or"       NL
+"### 'zstd'.  zstd (Zstandard) decompresses much faster than zlib while"     NL
+"### achieving similar or better compression ratios.  It requires a"         NL
+"### Subversion built with zstd support.  The compression level above is"    NL
+"### used for either algorithm.  'zstd' requires filesystem format 3 or"     NL
+"### higher.  The default is 'zlib'."                                        NL
+"# " CONFIG_OPTION_COMPRESSION " = zlib"                                     NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -649,6 +686,7 @@ upgrade_body(void *baton,
 {
   upgrade_baton_t *upgrade_baton = baton;
   svn_fs_t *fs = upgrade_baton->fs;
+  svn_fs_x__data_t *ffd = fs->fsap_data;
   int format, max_files_per_dir;
   const char *format_path = svn_fs_x__path_format(fs, scratch_pool);
 
@@ -660,6 +698,17 @@ upgrade_body(void *baton,
   if (format == SVN_FS_X__FORMAT_NUMBER)
     return SVN_NO_ERROR;
 
+  /* Format 3 only adds svndiff4 support, so no data needs converting.
+     Bump the format file. */
+  ffd->format = SVN_FS_X__FORMAT_NUMBER;
+  ffd->max_files_per_dir = max_files_per_dir;
+  SVN_ERR(svn_fs_x__write_format(fs, TRUE, scratch_pool));
+  if (upgrade_baton->notify_func)
+    SVN_ERR(upgrade_baton->notify_func(upgrade_baton->notify_baton,
+                                       SVN_FS_X__FORMAT_NUMBER,
+                                       svn_fs_upgrade_format_bumped,
+                                       scratch_pool));
+
   /* Done */
   return SVN_NO_ERROR;
 }
@@ -1062,6 +1111,12 @@ svn_fs_x__create(svn_fs_t *fs,
           case 8: return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL,
                   _("FSX is not compatible with Subversion prior to 1.9"));
 
+          case 9:
+          case 10:
+          case 11:
+          case 12: format = 2;
+                   break;
+
           default:format = SVN_FS_X__FORMAT_NUMBER;
         }
     }
@@ -1272,8 +1327,11 @@ svn_fs_x__info_format(int *fs_format,
     case 2:
       (*supports_version)->minor = 10;
       break;
+    case 3:
+      (*supports_version)->minor = 13;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_X__FORMAT_NUMBER != 2
+# if SVN_FS_X__FORMAT_NUMBER != 3
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
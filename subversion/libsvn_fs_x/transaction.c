@@ -2233,6 +2233,23 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Return the svndiff version to use for new representations in FS. */
+static int
+get_svndiff_version(svn_fs_t *fs)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  /* With compression disabled, zlib simply stores the data. */
+  if (   ffd->delta_compression_zstd
+      && ffd->delta_compression_level != SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_X__MIN_SVNDIFF4_FORMAT);
+      return 4;
+    }
+
+  return 1;
+}
+
 /* Get a rep_write_baton_t, allocated from RESULT_POOL, and store it in
    WB_P for the representation indicated by NODEREV in filesystem FS.
    Only appropriate for file contents, not for props or directory contents.
@@ -2250,7 +2267,7 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
-  int diff_version = 1;
+  int diff_version = get_svndiff_version(fs);
   svn_fs_x__rep_header_t header = { 0 };
   svn_fs_x__txn_id_t txn_id
     = svn_fs_x__get_txn_id(noderev->noderev_id.change_set);
@@ -2886,7 +2903,7 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   apr_off_t offset = 0;
 
   write_container_baton_t *whb;
-  int diff_version = 1;
+  int diff_version = get_svndiff_version(fs);
   svn_boolean_t is_props = (item_type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_X__ITEM_TYPE_DIR_PROPS);
 
@@ -37,6 +37,7 @@
 #include "svn_props.h"
 
 #include "svn_private_config.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_skel.h"
@@ -1872,6 +1873,8 @@ negotiate_put_encoding(int *svndiff_version_p,
 {
   int svndiff_version;
   int compression_level;
+  svn_boolean_t use_svndiff4 = session->supports_svndiff4
+                            && svn_txdelta__svndiff4_supported();
 
   if (session->using_compression == svn_tristate_unknown)
     {
@@ -1886,6 +1889,8 @@ negotiate_put_encoding(int *svndiff_version_p,
       if (session->supports_svndiff2 &&
           svn_ra_serf__is_low_latency_connection(session))
         svndiff_version = 2;
+      else if (use_svndiff4)
+        svndiff_version = 4;
       else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
@@ -1898,12 +1903,15 @@ negotiate_put_encoding(int *svndiff_version_p,
       /* Otherwise, prefer svndiff1, as svndiff2 is not a reasonable
        * substitute for svndiff1 with default compression level.  (It gives
        * better speed and compression ratio comparable to svndiff1 with
-       * compression level 1, but not 5).
+       * compression level 1, but not 5).  svndiff4 is both faster than
+       * svndiff1 and compresses at least as well, so use it if we can.
        *
        * Note: For future compatibility, we also handle a theoretically
        * possible case where the server has advertised only svndiff2 support.
        */
-      if (session->supports_svndiff1)
+      if (use_svndiff4)
+        svndiff_version = 4;
+      else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
         svndiff_version = 2;
@@ -144,6 +144,11 @@ struct svn_ra_serf__session_t {
      requests may come in any order */
   svn_boolean_t http20;
 
+  /* Tristate flag that indicates whether we may talk http/2 to the server.
+     If svn_tristate_unknown, offer it during the TLS handshake.  If
+     svn_tristate_true, also use it on unencrypted connections. */
+  svn_tristate_t use_http2;
+
   /* Should we use Transfer-Encoding: chunked for HTTP/1.1 servers. */
   svn_boolean_t using_chunked_requests;
 
@@ -167,6 +172,11 @@ struct svn_ra_serf__session_t {
   svn_ra_progress_notify_func_t progress_func;
   void *progress_baton;
 
+  /* Estimated number of response bytes still to be received for requests
+     that have already been scheduled, or 0 if unknown.  It gets added to
+     the progress total. */
+  apr_off_t bytes_pending;
+
   /* Callback function to handle cancellation */
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
@@ -269,10 +279,17 @@ struct svn_ra_serf__session_t {
   /* Indicates whether the server can understand svndiff version 2. */
   svn_boolean_t supports_svndiff2;
 
+  /* Indicates whether the server can understand svndiff version 4. */
+  svn_boolean_t supports_svndiff4;
+
   /* Indicates whether the server sends the result checksum in the response
    * to a successful PUT request. */
   svn_boolean_t supports_put_result_checksum;
 
+  /* Indicates whether the server can send the contents of many files
+   * with a single fetch-files REPORT. */
+  svn_boolean_t supports_fetch_files;
+
   apr_interval_time_t conn_latency;
 };
 
@@ -251,6 +251,12 @@ load_config(svn_ra_serf__session_t *session,
                                   SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS,
                                   "auto", svn_tristate_unknown));
 
+  /* Should we multiplex our requests over http/2. */
+  SVN_ERR(svn_config_get_tristate(config, &session->use_http2,
+                                  SVN_CONFIG_SECTION_GLOBAL,
+                                  SVN_CONFIG_OPTION_HTTP_HTTP2,
+                                  "auto", svn_tristate_false));
+
 #if SERF_VERSION_AT_LEAST(1, 4, 0) && !defined(SVN_SERF_NO_LOGGING)
   SVN_ERR(svn_config_get_int64(config, &log_components,
                                SVN_CONFIG_SECTION_GLOBAL,
@@ -318,6 +324,12 @@ load_config(svn_ra_serf__session_t *session,
                                       SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS,
                                       "auto", chunked_requests));
 
+      /* Should we multiplex our requests over http/2. */
+      SVN_ERR(svn_config_get_tristate(config, &session->use_http2,
+                                      server_group,
+                                      SVN_CONFIG_OPTION_HTTP_HTTP2,
+                                      "auto", session->use_http2));
+
 #if SERF_VERSION_AT_LEAST(1, 4, 0) && !defined(SVN_SERF_NO_LOGGING)
       SVN_ERR(svn_config_get_int64(config, &log_components,
                                    server_group,
@@ -454,7 +466,12 @@ svn_ra_serf__progress(void *progress_baton, apr_off_t bytes_read,
   const svn_ra_serf__session_t *serf_sess = progress_baton;
   if (serf_sess->progress_func)
     {
-      serf_sess->progress_func(bytes_read + bytes_written, -1,
+      apr_off_t progress = bytes_read + bytes_written;
+      apr_off_t total = serf_sess->bytes_pending
+                      ? progress + serf_sess->bytes_pending
+                      : -1;
+
+      serf_sess->progress_func(progress, total,
                                serf_sess->progress_baton,
                                serf_sess->pool);
     }
@@ -643,6 +660,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* using_compression */
   /* http10 */
   /* http20 */
+  /* use_http2 */
   /* using_chunked_requests */
   /* detect_chunking */
 
@@ -661,6 +679,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
 
   /* progress_func */
   /* progress_baton */
+  new_sess->bytes_pending = 0;
 
   /* cancel_func */
   /* cancel_baton */
@@ -758,7 +777,9 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
   /* supports_svndiff2 */
+  /* supports_svndiff4 */
   /* supports_put_result_checksum */
+  /* supports_fetch_files */
   /* conn_latency */
 
   new_sess->context = serf_context_create(result_pool);
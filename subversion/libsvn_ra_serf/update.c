@@ -255,6 +255,19 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
 #define REQUEST_COUNT_TO_PAUSE 50
 #define REQUEST_COUNT_TO_RESUME 40
 
+/* Over http/2, all requests share a single connection and the server
+   processes many of them concurrently.  Keep enough of them in flight to
+   hide the network latency. */
+#define HTTP2_REQUEST_COUNT_TO_RESUME 400
+
+/* Servers that support the fetch-files REPORT send us the contents of up
+   to FETCH_BATCH_SIZE files per request.  Because every file of a batch
+   counts as an outstanding request, we need to keep more of them queued
+   to fill the batches. */
+#define FETCH_BATCH_SIZE 32
+#define FETCH_BATCH_REQUEST_COUNT_TO_RESUME \
+  (FETCH_BATCH_SIZE * SVN_RA_SERF__MAX_CONNECTIONS_LIMIT)
+
 #define SPILLBUF_BLOCKSIZE 4096
 #define SPILLBUF_MAXBUFFSIZE 131072
 
@@ -262,6 +275,7 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
 
 /* Forward-declare our report context. */
 typedef struct report_context_t report_context_t;
+typedef struct fetch_batch_t fetch_batch_t;
 typedef struct body_create_baton_t body_create_baton_t;
 /*
  * This structure represents the information for a directory.
@@ -356,6 +370,33 @@ typedef struct file_baton_t
                                            written to within txdelta*/
 } file_baton_t;
 
+/*
+ * What we know about the requests that we queued on one of the session's
+ * connections and about how fast that connection delivers the responses.
+ */
+typedef struct conn_stats_t {
+
+  /* Number of GET and PROPFIND requests that have not completed, yet. */
+  unsigned int requests;
+
+  /* Number of those requests for which the server announced the size of
+     the response body. */
+  unsigned int sized_requests;
+
+  /* Sum of the announced response body sizes that have not been received,
+     yet. */
+  apr_off_t bytes_expected;
+
+  /* Response body bytes received so far. */
+  apr_off_t bytes_received;
+
+  /* Time spent with at least one request outstanding, excluding the
+     current busy period.  That one started at BUSY_SINCE. */
+  apr_interval_time_t busy_time;
+  apr_time_t busy_since;
+
+} conn_stats_t;
+
 /*
  * This structure represents a single request to GET (fetch) a file with
  * its associated Serf session/connection.
@@ -388,6 +429,14 @@ typedef struct fetch_ctx_t {
   /* The base-rev header  */
   const char *delta_base;
 
+  /* Scheduling statistics of the connection this request has been sent on.
+   */
+  conn_stats_t *stats;
+
+  /* Part of the announced response body size that has not been received
+     yet, or -1 if the server did not tell us the size. */
+  apr_off_t bytes_expected;
+
 } fetch_ctx_t;
 
 /*
@@ -445,6 +494,23 @@ struct report_context_t {
   /* number of pending PROPFIND requests */
   unsigned int num_active_propfinds;
 
+  /* Files to be requested with the next fetch-files REPORT, or NULL.
+     Only used if the server supports that report. */
+  fetch_batch_t *pending_batch;
+
+  /* number of pending fetch-files REPORT requests */
+  unsigned int num_active_batches;
+
+  /* Where to send the fetch-files REPORTs to. */
+  const char *report_target;
+
+  /* Scheduling statistics, one per session connection. */
+  conn_stats_t conn_stats[SVN_RA_SERF__MAX_CONNECTIONS_LIMIT];
+
+  /* Number and total body size of the GET responses received so far. */
+  apr_int64_t num_fetched;
+  apr_off_t bytes_fetched;
+
   /* Are we done parsing the REPORT response? */
   svn_boolean_t done;
 
@@ -545,20 +611,252 @@ create_file_baton(file_baton_t **new_file,
 }
 
 /** Minimum nr. of outstanding requests needed before a new connection is
- *  opened. */
+ *  opened, as long as we don't know anything about the connections'
+ *  throughput. */
 #define REQS_PER_CONN 8
 
-/** This function creates a new connection for this serf session, but only
- * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN or if there currently is
- * only one main connection open.
+/** Open a new connection once the responses would have to wait for more
+ *  than this many round trips on the best existing connection.  Setting up
+ *  a connection takes about 2 round trips for TCP and TLS plus one for
+ *  the first request. */
+#define NEW_CONN_LATENCY_FACTOR 4
+
+/** Response body size to assume for requests of unknown size before we
+ *  have received any GET responses. */
+#define DEFAULT_RESPONSE_SIZE 4096
+
+/** Minimum number of bytes that a connection must have received before we
+ *  trust its own throughput figures rather than the session-wide ones. */
+#define MIN_THROUGHPUT_SAMPLE 0x10000
+
+/* Return the scheduling statistics for connection CONN in CTX. */
+static conn_stats_t *
+get_conn_stats(report_context_t *ctx,
+               svn_ra_serf__connection_t *conn)
+{
+  int i;
+  for (i = 0; i < ctx->sess->num_conns; i++)
+    if (ctx->sess->conns[i] == conn)
+      return &ctx->conn_stats[i];
+
+  SVN_ERR_MALFUNCTION_NO_RETURN();
+}
+
+/* Return the time that the connection described by STATS has been busy
+   serving our requests, up to NOW. */
+static apr_interval_time_t
+get_busy_time(const conn_stats_t *stats,
+              apr_time_t now)
+{
+  return stats->requests ? stats->busy_time + (now - stats->busy_since)
+                         : stats->busy_time;
+}
+
+/* Return the average size of the response bodies received in CTX. */
+static apr_off_t
+get_average_response_size(report_context_t *ctx)
+{
+  return ctx->num_fetched ? (apr_off_t)(ctx->bytes_fetched / ctx->num_fetched)
+                          : DEFAULT_RESPONSE_SIZE;
+}
+
+/* Return the number of response body bytes that we still expect to receive
+   for the requests in STATS, assuming AVERAGE_SIZE for the responses of
+   unknown size. */
+static apr_off_t
+get_backlog(const conn_stats_t *stats,
+            apr_off_t average_size)
+{
+  return stats->bytes_expected
+       + (stats->requests - stats->sized_requests) * average_size;
+}
+
+/* Return the throughput, in bytes per microsecond, of a single connection
+   in CTX averaged over all connections.  Return 0 if it is unknown. */
+static double
+get_session_throughput(report_context_t *ctx,
+                       apr_time_t now)
+{
+  apr_off_t bytes = 0;
+  apr_interval_time_t busy_time = 0;
+  int i;
+
+  for (i = 0; i < ctx->sess->num_conns; i++)
+    {
+      bytes += ctx->conn_stats[i].bytes_received;
+      busy_time += get_busy_time(&ctx->conn_stats[i], now);
+    }
+
+  return (bytes && busy_time > 0) ? (double)bytes / (double)busy_time : 0.0;
+}
+
+/* Update the estimate of outstanding response data that ra_serf adds to
+   the total in its progress notifications. */
+static void
+update_progress_estimate(report_context_t *ctx)
+{
+  apr_off_t average_size = get_average_response_size(ctx);
+  apr_off_t pending = 0;
+  int i;
+
+  for (i = 0; i < ctx->sess->num_conns; i++)
+    pending += get_backlog(&ctx->conn_stats[i], average_size);
+
+  ctx->sess->bytes_pending = pending;
+}
+
+/* Apr pool cleanup handler resetting the progress estimate of the
+   svn_ra_serf__session_t in DATA. */
+static apr_status_t
+reset_progress_estimate(void *data)
+{
+  svn_ra_serf__session_t *sess = data;
+  sess->bytes_pending = 0;
+
+  return APR_SUCCESS;
+}
+
+/* Note that a request has been sent on the connection described by STATS
+   in CTX. */
+static void
+request_queued(report_context_t *ctx,
+               conn_stats_t *stats)
+{
+  if (stats->requests++ == 0)
+    stats->busy_since = apr_time_now();
+
+  update_progress_estimate(ctx);
+}
+
+/* Note that a request on the connection described by STATS in CTX has
+   completed. */
+static void
+request_completed(report_context_t *ctx,
+                  conn_stats_t *stats)
+{
+  if (--stats->requests == 0)
+    stats->busy_time += apr_time_now() - stats->busy_since;
+
+  update_progress_estimate(ctx);
+}
+
+/* Return the index of the first connection in CTX that we may use to
+   fetch files and properties. */
+static int
+get_first_fetch_connection(report_context_t *ctx)
+{
+  /* Skip the first connection if the REPORT response hasn't been completely
+     received yet or if we're being told to limit our connections to
+     2 (because this could be an attempt to ensure that we do all our
+     auxiliary GETs/PROPFINDs on a single connection).
+
+     ### FIXME: This latter requirement (max_connections > 2) is
+     ### really just a hack to work around the fact that some update
+     ### editor implementations (such as svnrdump's dump editor)
+     ### simply can't handle the way ra_serf violates the editor v1
+     ### drive ordering requirements.
+     ###
+     ### See https://issues.apache.org/jira/browse/SVN-4116.
+  */
+  if (ctx->report_received && (ctx->sess->max_connections > 2))
+    return 0;
+
+  return 1;
+}
+
+/* Set *BEST_CONN to the index of the connection in CTX that will most
+   likely be the first to deliver the response to a new request.
+   Set *DRAIN_TIME to the time in microseconds that connection needs to
+   deliver the responses to the requests already queued on it.
+
+   If the throughput is not known for any connection, the estimate
+   degrades to the number of outstanding bytes and *DRAIN_TIME will be
+   -1.
+
+   Connections differ a lot in how fast they serve our requests.  Often,
+   the server has to do more work for some of them and there may be a
+   large file being delivered that the remaining requests have to wait
+   for.  Hence, we put any new request on the connection with the least
+   amount of outstanding data relative to its observed throughput.  That
+   way, small requests don't queue up behind large responses.
+ */
+static void
+find_best_connection(int *best_conn,
+                     apr_interval_time_t *drain_time,
+                     report_context_t *ctx)
+{
+  apr_time_t now = apr_time_now();
+  apr_off_t average_size = get_average_response_size(ctx);
+  double session_throughput = get_session_throughput(ctx, now);
+  double min_cost = 0.0;
+  int i;
+
+  *best_conn = get_first_fetch_connection(ctx);
+  for (i = *best_conn; i < ctx->sess->num_conns; i++)
+    {
+      const conn_stats_t *stats = &ctx->conn_stats[i];
+      double throughput = session_throughput;
+      double cost;
+
+      if (stats->bytes_received >= MIN_THROUGHPUT_SAMPLE
+          && get_busy_time(stats, now) > 0)
+        throughput = (double)stats->bytes_received
+                   / (double)get_busy_time(stats, now);
+
+      cost = (double)get_backlog(stats, average_size);
+      if (throughput > 0.0)
+        cost /= throughput;
+
+      if (i == *best_conn || cost < min_cost)
+        {
+          min_cost = cost;
+          *best_conn = i;
+        }
+    }
+
+  *drain_time = session_throughput > 0.0 ? (apr_interval_time_t)min_cost
+                                         : -1;
+}
+
+/* Return TRUE if CTX should use an additional connection to fetch files
+   and properties, with NUM_ACTIVE_REQS requests being outstanding. */
+static svn_boolean_t
+connection_needed(report_context_t *ctx,
+                  int num_active_reqs)
+{
+  svn_ra_serf__session_t *sess = ctx->sess;
+  apr_interval_time_t drain_time;
+  int best_conn;
+
+  /* We need at least 1 extra connection. */
+  if (sess->num_conns == 1)
+    return TRUE;
+
+  /* Once we know how fast the connections are, a new one pays off if new
+     requests would otherwise have to wait longer than it takes to set up
+     that connection. */
+  find_best_connection(&best_conn, &drain_time, ctx);
+  if (drain_time >= 0 && sess->conn_latency > 0)
+    return drain_time > NEW_CONN_LATENCY_FACTOR * sess->conn_latency;
+
+  /* Otherwise, open a new connection for each REQS_PER_CONN outstanding
+     requests. */
+  return (num_active_reqs / REQS_PER_CONN) > sess->num_conns;
+}
+
+/** This function creates a new connection for the serf session of CTX,
+ * but only if connection_needed() says so.
  */
 static svn_error_t *
-open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
+open_connection_if_needed(report_context_t *ctx, int num_active_reqs)
 {
-  /* For each REQS_PER_CONN outstanding requests open a new connection, with
-   * a minimum of 1 extra connection. */
-  if (sess->num_conns == 1 ||
-      ((num_active_reqs / REQS_PER_CONN) > sess->num_conns))
+  svn_ra_serf__session_t *sess = ctx->sess;
+
+  /* http/2 multiplexes all requests over the first connection. */
+  if (sess->http20)
+    return SVN_NO_ERROR;
+
+  if (connection_needed(ctx, num_active_reqs))
     {
       int cur = sess->num_conns;
       apr_status_t status;
@@ -589,69 +887,31 @@ open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
 static svn_ra_serf__connection_t *
 get_best_connection(report_context_t *ctx)
 {
-  svn_ra_serf__connection_t *conn;
-  int first_conn = 1;
+  apr_interval_time_t drain_time;
+  int best_conn;
 
-  /* Skip the first connection if the REPORT response hasn't been completely
-     received yet or if we're being told to limit our connections to
-     2 (because this could be an attempt to ensure that we do all our
-     auxiliary GETs/PROPFINDs on a single connection).
+  /* With http/2, requests don't have to wait for the REPORT response
+     and there is only the one connection anyway. */
+  if (ctx->sess->http20)
+    return ctx->sess->conns[0];
 
-     ### FIXME: This latter requirement (max_connections > 2) is
-     ### really just a hack to work around the fact that some update
-     ### editor implementations (such as svnrdump's dump editor)
-     ### simply can't handle the way ra_serf violates the editor v1
-     ### drive ordering requirements.
-     ###
-     ### See https://issues.apache.org/jira/browse/SVN-4116.
-  */
-  if (ctx->report_received && (ctx->sess->max_connections > 2))
-    first_conn = 0;
+  find_best_connection(&best_conn, &drain_time, ctx);
 
-  /* If there's only one available auxiliary connection to use, don't bother
-     doing all the cur_conn math -- just return that one connection.  */
-  if (ctx->sess->num_conns - first_conn == 1)
-    {
-      conn = ctx->sess->conns[first_conn];
-    }
-  else
-    {
-#if SERF_VERSION_AT_LEAST(1, 4, 0)
-      /* Often one connection is slower than others, e.g. because the server
-         process/thread has to do more work for the particular set of requests.
-         In the worst case, when REQUEST_COUNT_TO_RESUME requests are queued
-         on such a slow connection, ra_serf will completely stop sending
-         requests.
-
-         The method used here selects the connection with the least amount of
-         pending requests, thereby giving more work to lightly loaded server
-         processes.
-       */
-      int i, best_conn = first_conn;
-      unsigned int min = INT_MAX;
-      for (i = first_conn; i < ctx->sess->num_conns; i++)
-        {
-          serf_connection_t *sc = ctx->sess->conns[i]->conn;
-          unsigned int pending = serf_connection_pending_requests(sc);
-          if (pending < min)
-            {
-              min = pending;
-              best_conn = i;
-            }
-        }
-      conn = ctx->sess->conns[best_conn];
-#else
-    /* We don't know how many requests are pending per connection, so just
-       cycle them. */
-      conn = ctx->sess->conns[ctx->sess->cur_conn];
-      ctx->sess->cur_conn++;
-      if (ctx->sess->cur_conn >= ctx->sess->num_conns)
-        ctx->sess->cur_conn = first_conn;
-#endif
-    }
-  return conn;
+  return ctx->sess->conns[best_conn];
 }
-
+
+/* Return the number of outstanding requests below which we continue
+   parsing the REPORT response of CTX. */
+static unsigned int
+request_count_to_resume(report_context_t *ctx)
+{
+  if (ctx->sess->http20)
+    return HTTP2_REQUEST_COUNT_TO_RESUME;
+
+  return ctx->sess->supports_fetch_files ? FETCH_BATCH_REQUEST_COUNT_TO_RESUME
+                                         : REQUEST_COUNT_TO_RESUME;
+}
+
 /** Helpers to open and close directories */
 
 static svn_error_t*
@@ -1004,6 +1264,24 @@ handle_fetch(serf_request_t *request,
           fetch_ctx->result_stream = NULL;
         }
 
+      /* Tell the scheduler how much data to expect on this connection. */
+      val = serf_bucket_headers_get(hdrs, "Content-Length");
+      if (val)
+        {
+          apr_int64_t size;
+          svn_error_t *err = svn_cstring_atoi64(&size, val);
+
+          if (err)
+            svn_error_clear(err);
+          else if (size >= 0)
+            {
+              fetch_ctx->bytes_expected = (apr_off_t)size;
+              fetch_ctx->stats->bytes_expected += fetch_ctx->bytes_expected;
+              fetch_ctx->stats->sized_requests++;
+              update_progress_estimate(file->parent_dir->ctx);
+            }
+        }
+
       fetch_ctx->read_headers = TRUE;
     }
 
@@ -1021,6 +1299,19 @@ handle_fetch(serf_request_t *request,
 
       fetch_ctx->read_size += len;
 
+      if (len)
+        {
+          fetch_ctx->stats->bytes_received += len;
+          if (fetch_ctx->bytes_expected > 0)
+            {
+              apr_off_t received = fetch_ctx->bytes_expected < (apr_off_t)len
+                                 ? fetch_ctx->bytes_expected
+                                 : (apr_off_t)len;
+              fetch_ctx->bytes_expected -= received;
+              fetch_ctx->stats->bytes_expected -= received;
+            }
+        }
+
       if (fetch_ctx->aborted_read)
         {
           apr_off_t skip;
@@ -1158,6 +1449,8 @@ file_props_done(serf_request_t *request,
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
   file->parent_dir->ctx->num_active_propfinds--;
+  request_completed(file->parent_dir->ctx,
+                    get_conn_stats(file->parent_dir->ctx, handler->conn));
 
   file->fetch_props = FALSE;
 
@@ -1180,6 +1473,7 @@ file_fetch_done(serf_request_t *request,
 {
   fetch_ctx_t *fetch_ctx = baton;
   file_baton_t *file = fetch_ctx->file;
+  report_context_t *ctx = file->parent_dir->ctx;
   svn_ra_serf__handler_t *handler = fetch_ctx->handler;
 
   if (handler->server_error)
@@ -1189,7 +1483,17 @@ file_fetch_done(serf_request_t *request,
   if (handler->sline.code != 200)
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
-  file->parent_dir->ctx->num_active_fetches--;
+  ctx->num_active_fetches--;
+
+  /* Update the scheduling statistics. */
+  ctx->num_fetched++;
+  ctx->bytes_fetched += fetch_ctx->read_size;
+  if (fetch_ctx->bytes_expected >= 0)
+    {
+      fetch_ctx->stats->bytes_expected -= fetch_ctx->bytes_expected;
+      fetch_ctx->stats->sized_requests--;
+    }
+  request_completed(ctx, fetch_ctx->stats);
 
   file->fetch_file = FALSE;
 
@@ -1205,6 +1509,587 @@ file_fetch_done(serf_request_t *request,
   return svn_error_trace(close_file(file, scratch_pool));
 }
 
+/* Send a GET request for the contents of FILE on connection CONN.  If
+   DELTA_BASE is not NULL, request a delta against that version resource
+   URL.  If SKIP is not 0, the first SKIP bytes of the contents have
+   already been delivered to FILE's delta handler.  DELTA_BASE must be
+   NULL in that case, so the server sends plain text. */
+static void
+send_file_fetch(file_baton_t *file,
+                svn_ra_serf__connection_t *conn,
+                const char *delta_base,
+                apr_off_t skip)
+{
+  report_context_t *ctx = file->parent_dir->ctx;
+  fetch_ctx_t *fetch_ctx;
+  svn_ra_serf__handler_t *handler;
+
+  fetch_ctx = apr_pcalloc(file->pool, sizeof(*fetch_ctx));
+  fetch_ctx->file = file;
+  fetch_ctx->session = ctx->sess;
+  fetch_ctx->stats = get_conn_stats(ctx, conn);
+  fetch_ctx->bytes_expected = -1;
+  fetch_ctx->delta_base = delta_base;
+  fetch_ctx->aborted_read = skip > 0;
+  fetch_ctx->aborted_read_size = skip;
+
+  handler = svn_ra_serf__create_handler(ctx->sess, file->pool);
+
+  handler->method = "GET";
+  handler->path = file->url;
+
+  handler->conn = conn; /* Explicit scheduling */
+
+  handler->custom_accept_encoding = TRUE;
+  handler->no_dav_headers = TRUE;
+  handler->header_delegate = headers_fetch;
+  handler->header_delegate_baton = fetch_ctx;
+
+  handler->response_handler = handle_fetch;
+  handler->response_baton = fetch_ctx;
+
+  handler->response_error = cancel_fetch;
+  handler->response_error_baton = fetch_ctx;
+
+  handler->done_delegate = file_fetch_done;
+  handler->done_delegate_baton = fetch_ctx;
+
+  fetch_ctx->handler = handler;
+
+  svn_ra_serf__request_create(handler);
+
+  ctx->num_active_fetches++;
+  request_queued(ctx, fetch_ctx->stats);
+}
+
+/*
+ * A file whose contents are requested with a fetch-files REPORT.
+ */
+typedef struct batch_item_t {
+
+  /* The file to deliver the contents to. */
+  file_baton_t *file;
+
+  /* The file's version resource URL and that of its delta base (or NULL),
+     as sent to the server. */
+  const char *href;
+  const char *delta_base;
+
+  /* Did we receive the <S:txdelta> for this file? */
+  svn_boolean_t received;
+
+  /* Number of bytes of the file's contents that the delta windows
+     received so far produce. */
+  apr_off_t target_size;
+
+} batch_item_t;
+
+/*
+ * A fetch-files REPORT, i.e. a single request for the contents of up to
+ * FETCH_BATCH_SIZE files.
+ */
+struct fetch_batch_t {
+
+  report_context_t *ctx;
+
+  /* Pool containing this structure and the request.  It is destroyed once
+     the response has been processed. */
+  apr_pool_t *pool;
+
+  /* The files to fetch as batch_item_t, in request order.  The server
+     sends the contents in the same order. */
+  apr_array_header_t *items;
+
+  /* The handler representing the REPORT, once it has been sent. */
+  svn_ra_serf__handler_t *handler;
+
+  /* Scheduling statistics of the connection the REPORT has been sent on. */
+  conn_stats_t *stats;
+
+  /* Index of the item whose contents we are currently receiving.
+     -1 before the first one. */
+  int current;
+
+  /* Response body bytes received for the current item. */
+  apr_off_t item_size;
+
+  /* Set when the connection died while we were waiting for the response.
+     The files not received by then are being fetched with GET requests
+     and we ignore the response to the re-sent (empty) REPORT. */
+  svn_boolean_t aborted;
+
+  /* The XML parser's response handler and baton. */
+  svn_ra_serf__response_handler_t parse_response;
+  void *parse_baton;
+
+};
+
+typedef enum fetch_files_state_e {
+  FETCH_FILES_INITIAL = XML_STATE_INITIAL,
+  FETCH_FILES_REPORT,
+  FETCH_FILES_FILE,
+  FETCH_FILES_TXDELTA
+} fetch_files_state_e;
+
+static const svn_ra_serf__xml_transition_t fetch_files_ttable[] = {
+  { FETCH_FILES_INITIAL, S_, "fetch-files-report", FETCH_FILES_REPORT,
+    FALSE, { NULL }, FALSE },
+
+  { FETCH_FILES_REPORT, S_, "file", FETCH_FILES_FILE,
+    FALSE, { "href", NULL }, TRUE },
+
+  { FETCH_FILES_FILE, S_, "txdelta", FETCH_FILES_TXDELTA,
+    FALSE, { NULL }, TRUE },
+
+  { 0 }
+};
+
+/* Implements svn_txdelta_window_handler_t, counting the target bytes of
+   the windows for the batch_item_t in BATON before passing them on to its
+   file's delta handler. */
+static svn_error_t *
+batch_item_window_handler(svn_txdelta_window_t *window,
+                          void *baton)
+{
+  batch_item_t *item = baton;
+
+  if (window)
+    item->target_size += window->tview_len;
+
+  return svn_error_trace(item->file->txdelta(window,
+                                             item->file->txdelta_baton));
+}
+
+/* Conforms to svn_ra_serf__xml_opened_t  */
+static svn_error_t *
+fetch_files_opened(svn_ra_serf__xml_estate_t *xes,
+                   void *baton,
+                   int entered_state,
+                   const svn_ra_serf__dav_props_t *tag,
+                   apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+
+  if (entered_state == FETCH_FILES_FILE)
+    {
+      if (batch->current + 1 >= batch->items->nelts)
+        return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                _("Unexpected file in fetch-files "
+                                  "response"));
+
+      batch->current++;
+      batch->item_size = 0;
+    }
+  else if (entered_state == FETCH_FILES_TXDELTA)
+    {
+      batch_item_t *item = &APR_ARRAY_IDX(batch->items, batch->current,
+                                          batch_item_t);
+      file_baton_t *file = item->file;
+      apr_hash_t *attrs;
+      const char *href;
+      svn_stream_t *decoder;
+
+      attrs = svn_ra_serf__xml_gather_since(xes, FETCH_FILES_FILE);
+      href = svn_hash_gets(attrs, "href");
+
+      if (!href || strcmp(href, item->href) != 0 || item->received)
+        return svn_error_createf(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                 _("Expected the contents of '%s' in "
+                                   "fetch-files response"),
+                                 item->href);
+
+      /* ITEM stays where it is, since BATCH has been sent already. */
+      decoder = svn_txdelta_parse_svndiff(batch_item_window_handler, item,
+                                          TRUE /* error early close*/,
+                                          file->pool);
+
+      file->txdelta_stream = svn_base64_decode(decoder, file->pool);
+      item->received = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+fetch_files_closed(svn_ra_serf__xml_estate_t *xes,
+                   void *baton,
+                   int leaving_state,
+                   const svn_string_t *cdata,
+                   apr_hash_t *attrs,
+                   apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+  report_context_t *ctx = batch->ctx;
+  batch_item_t *item;
+
+  if (leaving_state == FETCH_FILES_TXDELTA)
+    {
+      file_baton_t *file;
+
+      /* Finish the file right away, so there is no point at which the
+         contents are complete but ITEM still refers to the file. */
+      item = &APR_ARRAY_IDX(batch->items, batch->current, batch_item_t);
+      file = item->file;
+
+      SVN_ERR(svn_stream_close(file->txdelta_stream));
+      file->txdelta_stream = NULL;
+
+      ctx->num_active_fetches--;
+
+      /* Update the scheduling statistics. */
+      ctx->num_fetched++;
+      ctx->bytes_fetched += batch->item_size;
+      update_progress_estimate(ctx);
+
+      file->fetch_file = FALSE;
+      item->file = NULL;
+
+      if (file->fetch_props)
+        return SVN_NO_ERROR; /* Still processing PROPFIND request */
+
+      return svn_error_trace(close_file(file, scratch_pool));
+    }
+  else if (leaving_state == FETCH_FILES_FILE)
+    {
+      item = &APR_ARRAY_IDX(batch->items, batch->current, batch_item_t);
+
+      if (!item->received)
+        return svn_error_createf(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                                 _("Missing the contents of '%s' in "
+                                   "fetch-files response"),
+                                 item->href);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Conforms to svn_ra_serf__xml_cdata_t  */
+static svn_error_t *
+fetch_files_cdata(svn_ra_serf__xml_estate_t *xes,
+                  void *baton,
+                  int current_state,
+                  const char *data,
+                  apr_size_t len,
+                  apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+
+  if (current_state == FETCH_FILES_TXDELTA)
+    {
+      batch_item_t *item = &APR_ARRAY_IDX(batch->items, batch->current,
+                                          batch_item_t);
+
+      batch->stats->bytes_received += len;
+      batch->item_size += len;
+
+      SVN_ERR(svn_stream_write(item->file->txdelta_stream, data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__request_body_delegate_t */
+static svn_error_t *
+create_fetch_files_body(serf_bucket_t **body_bkt,
+                        void *baton,
+                        serf_bucket_alloc_t *alloc,
+                        apr_pool_t *pool /* request pool */,
+                        apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+  serf_bucket_t *buckets;
+  int i;
+
+  buckets = serf_bucket_aggregate_create(alloc);
+
+  svn_ra_serf__add_open_tag_buckets(buckets, alloc,
+                                    "S:fetch-files-report",
+                                    "xmlns:S", SVN_XML_NAMESPACE,
+                                    SVN_VA_NULL);
+
+  /* After an abort, all files are being fetched by other means. */
+  for (i = 0; !batch->aborted && i < batch->items->nelts; i++)
+    {
+      const batch_item_t *item = &APR_ARRAY_IDX(batch->items, i,
+                                                batch_item_t);
+
+      svn_ra_serf__add_open_tag_buckets(buckets, alloc, "S:file",
+                                        SVN_VA_NULL);
+      svn_ra_serf__add_tag_buckets(buckets, "S:href", item->href, alloc);
+      if (item->delta_base)
+        svn_ra_serf__add_tag_buckets(buckets, "S:delta-base",
+                                     item->delta_base, alloc);
+      svn_ra_serf__add_close_tag_buckets(buckets, alloc, "S:file");
+    }
+
+  svn_ra_serf__add_close_tag_buckets(buckets, alloc,
+                                     "S:fetch-files-report");
+
+  *body_bkt = buckets;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__request_header_delegate_t */
+static svn_error_t *
+setup_fetch_files_headers(serf_bucket_t *headers,
+                          void *baton,
+                          apr_pool_t *pool /* request pool */,
+                          apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+
+  svn_ra_serf__setup_svndiff_accept_encoding(headers, batch->ctx->sess);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__response_error_t */
+static svn_error_t *
+cancel_fetch_batch(serf_request_t *request,
+                   serf_bucket_t *response,
+                   int status_code,
+                   void *baton)
+{
+  fetch_batch_t *batch = baton;
+  report_context_t *ctx = batch->ctx;
+  int i;
+
+  /* Uh-oh.  Our connection died on us.
+   *
+   * The core ra_serf layer will requeue our REPORT, but we can't continue
+   * parsing where the response got cut off.  So, fetch all files that we
+   * did not receive completely with individual GET requests instead.
+   */
+  if (!response)
+    {
+      if (batch->aborted)
+        return SVN_NO_ERROR;
+
+      for (i = batch->current < 0 ? 0 : batch->current;
+           i < batch->items->nelts;
+           i++)
+        {
+          batch_item_t *item = &APR_ARRAY_IDX(batch->items, i,
+                                              batch_item_t);
+          file_baton_t *file = item->file;
+
+          if (!file)
+            continue; /* Done already */
+
+          /* The GET takes over this file's fetch count. */
+          ctx->num_active_fetches--;
+          item->file = NULL;
+
+          /* A partially received delta can't be resumed.  But we can
+             continue with the plain text after what it produced. */
+          if (item->received)
+            {
+              file->txdelta_stream = NULL;
+              send_file_fetch(file, get_best_connection(ctx), NULL,
+                              item->target_size);
+            }
+          else
+            {
+              send_file_fetch(file, get_best_connection(ctx),
+                              apr_pstrdup(file->pool, item->delta_base), 0);
+            }
+        }
+
+      batch->aborted = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* We have no idea what went wrong. */
+  SVN_ERR_MALFUNCTION();
+}
+
+/* Implements svn_ra_serf__response_handler_t */
+static svn_error_t *
+handle_fetch_batch(serf_request_t *request,
+                   serf_bucket_t *response,
+                   void *handler_baton,
+                   apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = handler_baton;
+
+  if (batch->aborted)
+    return svn_error_trace(svn_ra_serf__handle_discard_body(request,
+                                                            response,
+                                                            NULL,
+                                                            scratch_pool));
+
+  return svn_error_trace(batch->parse_response(request, response,
+                                               batch->parse_baton,
+                                               scratch_pool));
+}
+
+/* Implements svn_ra_serf__response_done_delegate_t */
+static svn_error_t *
+fetch_batch_done(serf_request_t *request,
+                 void *baton,
+                 apr_pool_t *scratch_pool)
+{
+  fetch_batch_t *batch = baton;
+  report_context_t *ctx = batch->ctx;
+  svn_ra_serf__handler_t *handler = batch->handler;
+
+  if (handler->server_error)
+    return svn_error_trace(svn_ra_serf__server_error_create(handler,
+                                                            scratch_pool));
+
+  if (handler->sline.code != 200)
+    return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  if (!batch->aborted && batch->current + 1 != batch->items->nelts)
+    return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                            _("Incomplete fetch-files response"));
+
+  ctx->num_active_batches--;
+  request_completed(ctx, batch->stats);
+
+  svn_pool_destroy(batch->pool); /* Destroys handler and request! */
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the fetch-files REPORT for the files that CTX collected so far. */
+static svn_error_t *
+send_fetch_batch(report_context_t *ctx)
+{
+  fetch_batch_t *batch = ctx->pending_batch;
+  svn_ra_serf__session_t *sess = ctx->sess;
+  svn_ra_serf__xml_context_t *xmlctx;
+  svn_ra_serf__handler_t *handler;
+  svn_ra_serf__connection_t *conn;
+
+  ctx->pending_batch = NULL;
+
+  /* Open extra connections if we have enough requests to send. */
+  if (sess->num_conns < sess->max_connections)
+    SVN_ERR(open_connection_if_needed(ctx, ctx->num_active_batches
+                                           + ctx->num_active_propfinds));
+
+  conn = get_best_connection(ctx);
+
+  xmlctx = svn_ra_serf__xml_context_create(fetch_files_ttable,
+                                           fetch_files_opened,
+                                           fetch_files_closed,
+                                           fetch_files_cdata,
+                                           batch,
+                                           batch->pool);
+  handler = svn_ra_serf__create_expat_handler(sess, xmlctx, NULL,
+                                              batch->pool);
+
+  /* Sit between serf and the XML parser, so we can ignore the response
+     after aborting. */
+  batch->parse_response = handler->response_handler;
+  batch->parse_baton = handler->response_baton;
+  handler->response_handler = handle_fetch_batch;
+  handler->response_baton = batch;
+
+  handler->response_error = cancel_fetch_batch;
+  handler->response_error_baton = batch;
+
+  handler->method = "REPORT";
+  handler->path = ctx->report_target;
+  handler->body_delegate = create_fetch_files_body;
+  handler->body_delegate_baton = batch;
+  handler->body_type = "text/xml";
+
+  handler->conn = conn; /* Explicit scheduling */
+
+  handler->custom_accept_encoding = TRUE;
+  handler->header_delegate = setup_fetch_files_headers;
+  handler->header_delegate_baton = batch;
+
+  handler->done_delegate = fetch_batch_done;
+  handler->done_delegate_baton = batch;
+
+  batch->handler = handler;
+  batch->stats = get_conn_stats(ctx, conn);
+
+  svn_ra_serf__request_create(handler);
+
+  ctx->num_active_batches++;
+  request_queued(ctx, batch->stats);
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the pending fetch-files REPORT of CTX, if there is one and there
+   is no reason to wait for more files to be added to it. */
+static svn_error_t *
+maybe_send_fetch_batch(report_context_t *ctx)
+{
+  svn_ra_serf__session_t *sess = ctx->sess;
+  int fetch_conns;
+
+  if (!ctx->pending_batch)
+    return SVN_NO_ERROR;
+
+  /* No more files will be added once the REPORT has been parsed. */
+  if (ctx->done)
+    return svn_error_trace(send_fetch_batch(ctx));
+
+  /* Small batches are fine as long as connections would be idle
+     otherwise.  Batches grow as the connections get busy. */
+  if (sess->http20)
+    fetch_conns = sess->max_connections;
+  else
+    fetch_conns = sess->num_conns - get_first_fetch_connection(ctx);
+
+  if (fetch_conns < 1)
+    fetch_conns = 1;
+
+  if (ctx->num_active_batches < (unsigned int)fetch_conns)
+    return svn_error_trace(send_fetch_batch(ctx));
+
+  return SVN_NO_ERROR;
+}
+
+/* Add FILE with the version resource URL DELTA_BASE of its delta base
+   (may be NULL) to the next fetch-files REPORT of its report context. */
+static svn_error_t *
+queue_batch_fetch(file_baton_t *file,
+                  const char *delta_base,
+                  apr_pool_t *scratch_pool)
+{
+  report_context_t *ctx = file->parent_dir->ctx;
+  fetch_batch_t *batch = ctx->pending_batch;
+  batch_item_t *item;
+
+  if (!batch)
+    {
+      apr_pool_t *batch_pool = svn_pool_create(ctx->pool);
+
+      batch = apr_pcalloc(batch_pool, sizeof(*batch));
+      batch->ctx = ctx;
+      batch->pool = batch_pool;
+      batch->items = apr_array_make(batch_pool, FETCH_BATCH_SIZE,
+                                    sizeof(batch_item_t));
+      batch->current = -1;
+
+      ctx->pending_batch = batch;
+    }
+
+  /* The request body may have to be recreated after some of the files
+     have been closed.  So, keep our own copies of the URLs. */
+  item = apr_array_push(batch->items);
+  item->file = file;
+  item->href = apr_pstrdup(batch->pool, file->url);
+  item->delta_base = apr_pstrdup(batch->pool, delta_base);
+  item->received = FALSE;
+  item->target_size = 0;
+
+  ctx->num_active_fetches++;
+
+  if (batch->items->nelts >= FETCH_BATCH_SIZE)
+    SVN_ERR(send_fetch_batch(ctx));
+
+  return SVN_NO_ERROR;
+}
+
 /* Initiates additional requests needed for a file when not in "send-all" mode.
  */
 static svn_error_t *
@@ -1213,12 +2098,11 @@ fetch_for_file(file_baton_t *file,
 {
   report_context_t *ctx = file->parent_dir->ctx;
   svn_ra_serf__connection_t *conn;
-  svn_ra_serf__handler_t *handler;
 
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+    SVN_ERR(open_connection_if_needed(ctx, ctx->num_active_fetches +
+                                           ctx->num_active_propfinds));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -1268,17 +2152,10 @@ fetch_for_file(file_baton_t *file,
 
       if (file->fetch_file)
         {
-          fetch_ctx_t *fetch_ctx;
+          const char *delta_base = NULL;
 
-          /* Let's fetch the file with a GET request... */
           SVN_ERR_ASSERT(file->url && file->repos_relpath);
 
-          /* Otherwise, we use a GET request for the file's contents. */
-
-          fetch_ctx = apr_pcalloc(file->pool, sizeof(*fetch_ctx));
-          fetch_ctx->file = file;
-          fetch_ctx->session = ctx->sess;
-
           /* Can we somehow get away with just obtaining a DIFF? */
           if (SVN_RA_SERF__HAVE_HTTPV2_SUPPORT(ctx->sess))
             {
@@ -1287,23 +2164,23 @@ fetch_for_file(file_baton_t *file,
               */
               if (SVN_IS_VALID_REVNUM(file->base_rev))
                 {
-                  fetch_ctx->delta_base = apr_psprintf(file->pool, "%s/%ld/%s",
-                                                       ctx->sess->rev_root_stub,
-                                                       file->base_rev,
-                                                       svn_path_uri_encode(
-                                                          file->repos_relpath,
-                                                          scratch_pool));
+                  delta_base = apr_psprintf(file->pool, "%s/%ld/%s",
+                                            ctx->sess->rev_root_stub,
+                                            file->base_rev,
+                                            svn_path_uri_encode(
+                                                file->repos_relpath,
+                                                scratch_pool));
                 }
               else if (file->copyfrom_path)
                 {
                   SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(file->copyfrom_rev));
 
-                  fetch_ctx->delta_base = apr_psprintf(file->pool, "%s/%ld/%s",
-                                                       ctx->sess->rev_root_stub,
-                                                       file->copyfrom_rev,
-                                                       svn_path_uri_encode(
-                                                          file->copyfrom_path+1,
-                                                          scratch_pool));
+                  delta_base = apr_psprintf(file->pool, "%s/%ld/%s",
+                                            ctx->sess->rev_root_stub,
+                                            file->copyfrom_rev,
+                                            svn_path_uri_encode(
+                                                file->copyfrom_path+1,
+                                                scratch_pool));
                 }
             }
           else if (ctx->sess->wc_callbacks->get_wc_prop)
@@ -1319,37 +2196,21 @@ fetch_for_file(file_baton_t *file,
                                                 SVN_RA_SERF__WC_CHECKED_IN_URL,
                                                 &value, scratch_pool));
 
-              fetch_ctx->delta_base = value
-                                        ? apr_pstrdup(file->pool, value->data)
-                                        : NULL;
+              delta_base = value ? apr_pstrdup(file->pool, value->data)
+                                 : NULL;
             }
 
-          handler = svn_ra_serf__create_handler(ctx->sess, file->pool);
-
-          handler->method = "GET";
-          handler->path = file->url;
-
-          handler->conn = conn; /* Explicit scheduling */
-
-          handler->custom_accept_encoding = TRUE;
-          handler->no_dav_headers = TRUE;
-          handler->header_delegate = headers_fetch;
-          handler->header_delegate_baton = fetch_ctx;
-
-          handler->response_handler = handle_fetch;
-          handler->response_baton = fetch_ctx;
-
-          handler->response_error = cancel_fetch;
-          handler->response_error_baton = fetch_ctx;
-
-          handler->done_delegate = file_fetch_done;
-          handler->done_delegate_baton = fetch_ctx;
-
-          fetch_ctx->handler = handler;
-
-          svn_ra_serf__request_create(handler);
-
-          ctx->num_active_fetches++;
+          /* Servers that support it send the contents of many files with
+             a single fetch-files REPORT.  Otherwise, we use a GET request
+             for the file's contents. */
+          if (ctx->sess->supports_fetch_files)
+            {
+              SVN_ERR(queue_batch_fetch(file, delta_base, scratch_pool));
+            }
+          else
+            {
+              send_file_fetch(file, conn, delta_base, 0);
+            }
         }
     }
 
@@ -1371,6 +2232,7 @@ fetch_for_file(file_baton_t *file,
       svn_ra_serf__request_create(file->propfind_handler);
 
       ctx->num_active_propfinds++;
+      request_queued(ctx, get_conn_stats(ctx, conn));
     }
 
   if (file->fetch_props || file->fetch_file)
@@ -1424,6 +2286,7 @@ dir_props_done(serf_request_t *request,
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
   dir->ctx->num_active_propfinds--;
+  request_completed(dir->ctx, get_conn_stats(dir->ctx, handler->conn));
 
   /* Closing the directory will automatically deliver the propfind props.
    *
@@ -1445,8 +2308,8 @@ fetch_for_dir(dir_baton_t *dir,
 
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+    SVN_ERR(open_connection_if_needed(ctx, ctx->num_active_fetches +
+                                           ctx->num_active_propfinds));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -1469,6 +2332,7 @@ fetch_for_dir(dir_baton_t *dir,
       svn_ra_serf__request_create(dir->propfind_handler);
 
       ctx->num_active_propfinds++;
+      request_queued(ctx, get_conn_stats(ctx, conn));
     }
   else
     SVN_ERR_MALFUNCTION();
@@ -2251,7 +3115,7 @@ update_delay_handler(serf_request_t *request,
         }
 
       while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-                 < REQUEST_COUNT_TO_RESUME)
+                 < request_count_to_resume(udb->report))
         {
           const char *data;
           apr_size_t len;
@@ -2335,7 +3199,7 @@ process_pending(update_delay_baton_t *udb,
   serf_bucket_alloc_t *alloc = NULL;
 
   while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-            < REQUEST_COUNT_TO_RESUME)
+            < request_count_to_resume(udb->report))
     {
       const char *data;
       apr_size_t len;
@@ -2407,7 +3271,11 @@ process_editor_report(report_context_t *ctx,
   handler->response_baton = ud;
 
   /* Open the first extra connection. */
-  SVN_ERR(open_connection_if_needed(sess, 0));
+  SVN_ERR(open_connection_if_needed(ctx, 0));
+
+  /* Our progress estimates become meaningless after this report. */
+  apr_pool_cleanup_register(scratch_pool, sess, reset_progress_estimate,
+                            apr_pool_cleanup_null);
 
   sess->cur_conn = 1;
 
@@ -2426,6 +3294,9 @@ process_editor_report(report_context_t *ctx,
 
       svn_pool_clear(iterpool);
 
+      /* Request the contents of the files collected so far. */
+      SVN_ERR(maybe_send_fetch_batch(ctx));
+
       err = svn_ra_serf__context_run(sess, &waittime_left, iterpool);
 
       if (handler->done && handler->server_error)
@@ -2480,6 +3351,7 @@ finish_report(void *report_baton,
   SVN_ERR(svn_stream_close(report->body_template));
 
   SVN_ERR(svn_ra_serf__report_resource(&report_target, sess,  scratch_pool));
+  report->report_target = apr_pstrdup(report->pool, report_target);
 
   xmlctx = svn_ra_serf__xml_context_create(update_ttable,
                                            update_opened, update_closed,
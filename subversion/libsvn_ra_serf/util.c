@@ -42,6 +42,7 @@
 
 #include "../libsvn_ra/ra_loader.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_auth_private.h"
 #include "private/svn_cert.h"
@@ -480,7 +481,41 @@ load_authorities(svn_ra_serf__connection_t *conn, const char *authorities,
   return SVN_NO_ERROR;
 }
 
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
+/* Return TRUE if SESSION has been configured to talk http/2 to the server.
+   If the caller must not see responses out of order, i.e. when it limits
+   us to a single connection for its data, stick to HTTP/1.1.
+   Without TLS, we can't negotiate the protocol and have to rely on the
+   server accepting http/2 "with prior knowledge".  Only do that when the
+   user explicitly asked for it and there is no proxy in between. */
+static svn_boolean_t
+http2_enabled(svn_ra_serf__session_t *session)
+{
+  if (session->use_http2 == svn_tristate_false
+      || session->max_connections <= 2)
+    return FALSE;
+
+  if (session->using_ssl)
+    return TRUE;
+
+  return session->use_http2 == svn_tristate_true && !session->using_proxy;
+}
+
+/* Switch CONN to http/2 framing and adjust the session flags that depend
+   on the protocol version. */
+static void
+use_http2_framing(svn_ra_serf__connection_t *conn)
+{
+  serf_connection_set_framing_type(conn->conn,
+                                   SERF_CONNECTION_FRAMING_TYPE_HTTP2);
+
+  /* Disable generating content-length headers. */
+  conn->session->http10 = FALSE;
+  conn->session->http20 = TRUE;
+  conn->session->using_chunked_requests = TRUE;
+  conn->session->detect_chunking = FALSE;
+}
+
 /* Implements serf_ssl_protocol_result_cb_t */
 static apr_status_t
 conn_negotiate_protocol(void *data,
@@ -490,15 +525,7 @@ conn_negotiate_protocol(void *data,
 
   if (!strcmp(protocol, "h2"))
     {
-      serf_connection_set_framing_type(
-            conn->conn,
-            SERF_CONNECTION_FRAMING_TYPE_HTTP2);
-
-      /* Disable generating content-length headers. */
-      conn->session->http10 = FALSE;
-      conn->session->http20 = TRUE;
-      conn->session->using_chunked_requests = TRUE;
-      conn->session->detect_chunking = FALSE;
+      use_http2_framing(conn);
     }
   else
     {
@@ -557,8 +584,11 @@ conn_setup(apr_socket_t *sock,
               SVN_ERR(load_authorities(conn, conn->session->ssl_authorities,
                                        conn->session->pool));
             }
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
-          if (APR_SUCCESS ==
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
+          /* Offer http/2 during the TLS handshake.  The framing will be
+             decided once the server has picked a protocol. */
+          if (http2_enabled(conn->session)
+              && APR_SUCCESS ==
                 serf_ssl_negotiate_protocol(conn->ssl_context, "h2,http/1.1",
                                             conn_negotiate_protocol, conn))
             {
@@ -577,6 +607,12 @@ conn_setup(apr_socket_t *sock,
                                                       conn->bkt_alloc);
         }
     }
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
+  else if (http2_enabled(conn->session))
+    {
+      use_http2_framing(conn);
+    }
+#endif
 
   return SVN_NO_ERROR;
 }
@@ -2061,10 +2097,13 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
       /* With http-compression=auto, advertise that we prefer svndiff2
          to svndiff1 with a low latency connection (assuming the underlying
          network has high bandwidth), as it is faster and in this case, we
-         don't care about worse compression ratio. */
+         don't care about worse compression ratio.  svndiff4 is still
+         faster than svndiff1 and compresses better, so rank it second. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
+        svn_txdelta__svndiff4_supported()
+          ? "gzip,svndiff2;q=0.9,svndiff4;q=0.85,svndiff1;q=0.8,svndiff;q=0.7"
+          : "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
     }
   else
     {
@@ -2072,10 +2111,14 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
          svndiff2 is not a reasonable substitute for svndiff1 with default
          compression level, because, while it is faster, it also gives worse
          compression ratio.  While we can use svndiff2 in some cases (see
-         above), we can't do this generally. */
+         above), we can't do this generally.  svndiff4, however, is both
+         faster and at least as effective as svndiff1, so prefer it if we
+         can read it. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
+        svn_txdelta__svndiff4_supported()
+          ? "gzip,svndiff4;q=0.95,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7"
+          : "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
     }
 }
 
@@ -45,6 +45,7 @@
 
 #include "ra_svn.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_error_private.h"
@@ -273,16 +274,28 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
-  /* Prefer SVNDIFF2 over SVNDIFF1. */
+  /* Prefer SVNDIFF4 over SVNDIFF2 over SVNDIFF1.  We can only produce
+   * SVNDIFF4 if we have been built with zstd support. */
+  if (svn_txdelta__svndiff4_supported()
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF4_ACCEPTED))
+    return 4;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
     return 1;
 
-  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  /* The connection does not support SVNDIFF1/2/4; default to "version 0". */
   return 0;
 }
 
+const char *
+svn_ra_svn__svndiff4_capability(void)
+{
+  return svn_txdelta__svndiff4_supported()
+       ? SVN_RA_SVN_CAP_SVNDIFF4_ACCEPTED
+       : NULL;
+}
+
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn)
 {
@@ -762,6 +775,38 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_boolean_t
+svn_ra_svn__can_write_file_range(svn_ra_svn_conn_t *conn)
+{
+  return svn_ra_svn__stream_can_sendfile(conn->stream);
+}
+
+svn_error_t *
+svn_ra_svn__write_file_range(svn_ra_svn_conn_t *conn,
+                             apr_pool_t *pool,
+                             apr_file_t *file,
+                             apr_off_t offset,
+                             apr_size_t len)
+{
+  SVN_ERR(write_number(conn, pool, len, ':'));
+  if (conn->write_pos > 0)
+    SVN_ERR(writebuf_flush(conn, pool));
+
+  /* Account for the data as writebuf_output would do. */
+  conn->current_out += len;
+  SVN_ERR(check_io_limits(conn));
+
+  SVN_ERR(svn_ra_svn__stream_sendfile(conn->stream, file, offset, len));
+
+  conn->written_since_error_check += len;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  SVN_ERR(writebuf_writechar(conn, pool, ' '));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
@@ -1291,6 +1336,240 @@ static svn_error_t *read_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Return a pointer to the character that terminates the item starting
+ * at P, if the item and that character lie completely within the range
+ * P .. END.  Return NULL otherwise, including when we find data that is
+ * malformed in some way.  Let the regular parser report those errors.
+ *
+ * This only locates the item boundaries.  It doesn't validate the item.
+ */
+static const char *
+find_item_end(const char *p, const char *end)
+{
+  int depth = 0;
+
+  while (p < end)
+    {
+      char c = *p++;
+      if (c == '(')
+        {
+          ++depth;
+          continue;
+        }
+      else if (c == ')')
+        {
+          if (--depth < 0)
+            return NULL;
+        }
+      else if (svn_ctype_isdigit(c))
+        {
+          /* Number or string.  Skip over the string contents at once. */
+          apr_uint64_t len = c - '0';
+          while (p < end && svn_ctype_isdigit(*p))
+            {
+              if (len >= APR_UINT64_MAX / 10 - 1)
+                return NULL;
+
+              len = 10 * len + (*p++ - '0');
+            }
+
+          if (p < end && *p == ':')
+            {
+              ++p;
+              if ((apr_uint64_t)(end - p) < len)
+                return NULL;
+
+              p += len;
+            }
+        }
+      else if (svn_ctype_isalpha(c))
+        {
+          while (p < end && (svn_ctype_isalnum(*p) || *p == '-'))
+            ++p;
+        }
+      else if (svn_iswhitespace(c))
+        {
+          continue;
+        }
+      else
+        {
+          return NULL;
+        }
+
+      /* We just finished an item.  Was that the top-level one? */
+      if (depth == 0)
+        return p < end ? p : NULL;
+    }
+
+  return NULL;
+}
+
+/* Parse the item starting at *DATA into the already allocated structure
+ * ITEM, the same way read_item() would.  END is the end of the parse
+ * buffer.  String and word items will point into that buffer.  To make
+ * them NUL-terminated, replace the whitespace that follows every item
+ * with NUL.  Set *DATA to the position just behind that character.
+ *
+ * LEVEL is the nesting level, just like in read_item().  Use POOL for
+ * allocations.
+ */
+static svn_error_t *
+parse_item(svn_ra_svn__item_t *item, char **data, char *end,
+           apr_pool_t *pool, int level)
+{
+  char *p = *data;
+  char c = *p++;
+
+  if (++level >= ITEM_NESTING_LIMIT)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Items are nested too deeply"));
+
+  if (svn_ctype_isdigit(c))
+    {
+      /* It's a number or a string.  Parse the number part, either way. */
+      apr_uint64_t val = c - '0';
+      while (p < end && svn_ctype_isdigit(*p))
+        {
+          apr_uint64_t prev_val = val;
+          val = val * 10 + (*p++ - '0');
+          /* val wrapped past maximum value? */
+          if ((prev_val >= (APR_UINT64_MAX / 10))
+              && (val < APR_UINT64_MAX - 10))
+            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                    _("Number is larger than maximum"));
+        }
+
+      if (p < end && *p == ':')
+        {
+          /* It's a string.  It must be followed by whitespace. */
+          ++p;
+          if ((apr_uint64_t)(end - p) <= val)
+            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                    _("Malformed network data"));
+
+          item->kind = SVN_RA_SVN_STRING;
+          item->u.string.data = p;
+          item->u.string.len = (apr_size_t)val;
+          p += val;
+        }
+      else
+        {
+          /* It's a number. */
+          item->kind = SVN_RA_SVN_NUMBER;
+          item->u.number = val;
+        }
+    }
+  else if (svn_ctype_isalpha(c))
+    {
+      /* It's a word. */
+      char *word = p - 1;
+      while (p < end && (svn_ctype_isalnum(*p) || *p == '-'))
+        ++p;
+
+      if (p - word >= MAX_WORD_LENGTH)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Word is too long"));
+
+      item->kind = SVN_RA_SVN_WORD;
+      item->u.word.data = word;
+      item->u.word.len = p - word;
+    }
+  else if (c == '(')
+    {
+      /* Same allocation scheme as in read_item(). */
+      svn_ra_svn__item_t stack_items[12];
+      svn_ra_svn__item_t *items = stack_items;
+      int capacity = sizeof(stack_items) / sizeof(stack_items[0]);
+      int count = 0;
+
+      item->kind = SVN_RA_SVN_LIST;
+      while (1)
+        {
+          while (p < end && svn_iswhitespace(*p))
+            ++p;
+
+          if (p == end)
+            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                    _("Malformed network data"));
+          if (*p == ')')
+            {
+              ++p;
+              break;
+            }
+
+          /* Auto-expand the list. */
+          if (count == capacity)
+            {
+              svn_ra_svn__item_t *new_items
+                = apr_palloc(pool, 2 * capacity * sizeof(*new_items));
+              memcpy(new_items, items, capacity * sizeof(*new_items));
+              items = new_items;
+              capacity = 2 * capacity;
+            }
+
+          SVN_ERR(parse_item(&items[count], &p, end, pool, level));
+          ++count;
+        }
+
+      /* Store the list in ITEM - if not empty (= default). */
+      if (count)
+        {
+          item->u.list.nelts = count;
+
+          /* If we haven't allocated from POOL, yet, do it now. */
+          if (items == stack_items)
+            item->u.list.items = apr_pmemdup(pool, items,
+                                             count * sizeof(*items));
+          else
+            item->u.list.items = items;
+        }
+      else
+        {
+          item->u.list.items = NULL;
+          item->u.list.nelts = 0;
+        }
+    }
+  else
+    {
+      return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                              _("Malformed network data"));
+    }
+
+  if (p == end || !svn_iswhitespace(*p))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  *p = '\0';
+  *data = p + 1;
+
+  return SVN_NO_ERROR;
+}
+
+/* The item that started with the character just before CONN->READ_PTR
+ * ends with the whitespace at ITEM_END, which is still within the read
+ * buffer.  Parse it into the already allocated structure ITEM, the same
+ * way read_item() would.
+ *
+ * Instead of reading it byte by byte, copy the whole item into POOL at
+ * once and parse it from there.  All strings and words of the item will
+ * share that copy.  LEVEL is the current nesting level.
+ */
+static svn_error_t *
+read_buffered_item(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                   svn_ra_svn__item_t *item, const char *item_end,
+                   int level)
+{
+  const char *start = conn->read_ptr - 1;
+  apr_size_t len = item_end - start + 1;
+  char *data = apr_pmemdup(pool, start, len);
+  char *p = data;
+
+  SVN_ERR(parse_item(item, &p, data + len, pool, level));
+  conn->read_ptr = item_end + 1;
+
+  return SVN_NO_ERROR;
+}
+
 /* Given the first non-whitespace character FIRST_CHAR, read an item
  * into the already allocated structure ITEM.  LEVEL should be set
  * to 0 for the first call and is used to enforce a recursion limit
@@ -1302,6 +1581,14 @@ static svn_error_t *read_item(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   char c = first_char;
   apr_uint64_t val;
   svn_ra_svn__item_t *listitem;
+  const char *item_end;
+
+  /* Most items, e.g. log entries and directory entries, are much smaller
+   * than our read buffer.  Parse those without any per-byte overhead. */
+  item_end = find_item_end(conn->read_ptr - 1, conn->read_end);
+  if (item_end)
+    return svn_error_trace(read_buffered_item(conn, pool, item, item_end,
+                                              level));
 
   if (++level >= ITEM_NESTING_LIMIT)
     return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
@@ -1903,6 +2190,130 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
   return svn_error_trace(err);
 }
 
+/* Return TRUE if the receive buffer of CONN starts with a complete item,
+ * i.e. one that can be parsed without reading any further data.  Leading
+ * whitespace must have been skipped already.
+ */
+static svn_boolean_t
+readbuf_has_complete_item(svn_ra_svn_conn_t *conn)
+{
+  const char *p = conn->read_ptr;
+  const char *end = conn->read_end;
+  int depth = 0;
+
+  while (p < end)
+    {
+      char c = *p++;
+      if (c == '(')
+        {
+          ++depth;
+          continue;
+        }
+      else if (c == ')')
+        {
+          --depth;
+        }
+      else if (svn_ctype_isdigit(c))
+        {
+          /* Number or string.  Strings longer than the buffer will never
+           * be complete; the caller has to handle that case. */
+          apr_uint64_t len = c - '0';
+          while (p < end && svn_ctype_isdigit(*p))
+            {
+              len = 10 * len + (*p++ - '0');
+              if (len > sizeof(conn->read_buf))
+                return FALSE;
+            }
+
+          if (p == end)
+            return FALSE;
+
+          if (*p == ':')
+            {
+              ++p;
+              if ((apr_uint64_t)(end - p) < len)
+                return FALSE;
+
+              p += len;
+            }
+        }
+      else if (svn_ctype_isalpha(c))
+        {
+          while (p < end && (svn_ctype_isalnum(*p) || *p == '-'))
+            ++p;
+
+          if (p == end)
+            return FALSE;
+        }
+      else
+        {
+          /* Whitespace or garbage.  The latter will be reported by the
+           * actual parser. */
+          continue;
+        }
+
+      /* We just finished an item.  Was that the top-level one? */
+      if (depth <= 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+svn_error_t *
+svn_ra_svn__has_complete_command(svn_boolean_t *has_command,
+                                 svn_boolean_t *terminated,
+                                 svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool)
+{
+  SVN_ERR(svn_ra_svn__has_command(has_command, terminated, conn, pool));
+
+  while (*has_command && !readbuf_has_complete_item(conn))
+    {
+      svn_boolean_t available;
+      apr_size_t len;
+      svn_error_t *err;
+
+      /* Move the partial command to the start of the buffer. */
+      len = conn->read_end - conn->read_ptr;
+      if (conn->read_ptr != conn->read_buf)
+        {
+          memmove(conn->read_buf, conn->read_ptr, len);
+          conn->read_ptr = conn->read_buf;
+          conn->read_end = conn->read_buf + len;
+        }
+
+      /* Commands that don't fit into the buffer must be read while being
+       * processed. */
+      if (len == sizeof(conn->read_buf))
+        break;
+
+      /* Append whatever data has already been received. */
+      SVN_ERR(svn_ra_svn__data_available(conn, &available));
+      if (!available)
+        {
+          *has_command = FALSE;
+          break;
+        }
+
+      len = sizeof(conn->read_buf) - len;
+      err = readbuf_input(conn, conn->read_end, &len, pool);
+      if (err && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
+        {
+          /* The client went away in the middle of a command. */
+          svn_error_clear(err);
+          *has_command = FALSE;
+          *terminated = TRUE;
+          break;
+        }
+
+      SVN_ERR(err);
+      conn->read_end += len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__handle_command(svn_boolean_t *terminate,
                            apr_hash_t *cmd_hash,
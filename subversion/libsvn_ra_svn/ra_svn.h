@@ -222,6 +222,17 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Return TRUE if STREAM supports svn_ra_svn__stream_sendfile. */
+svn_boolean_t svn_ra_svn__stream_can_sendfile(svn_ra_svn__stream_t *stream);
+
+/* Send LEN bytes from FILE, starting at OFFSET, to STREAM.  Block until
+ * all of them have been sent.
+ */
+svn_error_t *svn_ra_svn__stream_sendfile(svn_ra_svn__stream_t *stream,
+                                         apr_file_t *file,
+                                         apr_off_t offset,
+                                         apr_size_t len);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
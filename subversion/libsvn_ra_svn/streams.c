@@ -42,6 +42,9 @@ struct svn_ra_svn__stream_st {
   svn_stream_t *out_stream;
   void *timeout_baton;
   ra_svn_timeout_fn_t timeout_fn;
+
+  /* The socket that OUT_STREAM writes to unmodified.  May be NULL. */
+  apr_socket_t *sock;
 };
 
 typedef struct sock_baton_t {
@@ -167,6 +170,7 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
 {
   sock_baton_t *b = apr_palloc(result_pool, sizeof(*b));
   svn_stream_t *sock_stream;
+  svn_ra_svn__stream_t *s;
 
   b->sock = sock;
   b->pool = svn_pool_create(result_pool);
@@ -177,8 +181,11 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
   svn_stream_set_write(sock_stream, sock_write_cb);
   svn_stream_set_data_available(sock_stream, sock_pending_cb);
 
-  return svn_ra_svn__stream_create(sock_stream, sock_stream,
-                                   b, sock_timeout_cb, result_pool);
+  s = svn_ra_svn__stream_create(sock_stream, sock_stream,
+                                b, sock_timeout_cb, result_pool);
+  s->sock = sock;
+
+  return s;
 }
 
 svn_ra_svn__stream_t *
@@ -193,6 +200,7 @@ svn_ra_svn__stream_create(svn_stream_t *in_stream,
   s->out_stream = out_stream;
   s->timeout_baton = timeout_baton;
   s->timeout_fn = timeout_cb;
+  s->sock = NULL;
   return s;
 }
 
@@ -203,6 +211,61 @@ svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
   return svn_error_trace(svn_stream_write(stream->out_stream, data, len));
 }
 
+svn_boolean_t
+svn_ra_svn__stream_can_sendfile(svn_ra_svn__stream_t *stream)
+{
+#if APR_HAS_SENDFILE
+  return stream->sock != NULL;
+#else
+  return FALSE;
+#endif
+}
+
+svn_error_t *
+svn_ra_svn__stream_sendfile(svn_ra_svn__stream_t *stream,
+                            apr_file_t *file,
+                            apr_off_t offset,
+                            apr_size_t len)
+{
+#if APR_HAS_SENDFILE
+  apr_status_t status;
+  apr_interval_time_t interval;
+
+  SVN_ERR_ASSERT(stream->sock);
+
+  status = apr_socket_timeout_get(stream->sock, &interval);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't get socket timeout"));
+
+  /* Always block, like sock_read_cb does.  There is no point in waiting
+   * for anything else while the file contents are being sent. */
+  apr_socket_timeout_set(stream->sock, -1);
+  while (len > 0 && !status)
+    {
+      apr_off_t file_offset = offset;
+      apr_size_t count = len;
+
+      status = apr_socket_sendfile(stream->sock, file, NULL, &file_offset,
+                                   &count, 0);
+
+      /* Don't loop forever if the file got truncated. */
+      if (!status && count == 0)
+        status = APR_EOF;
+
+      offset += count;
+      len -= count;
+    }
+  apr_socket_timeout_set(stream->sock, interval);
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL, NULL);
+#endif
+}
+
 svn_error_t *
 svn_ra_svn__stream_read(svn_ra_svn__stream_t *stream, char *data,
                         apr_size_t *len)
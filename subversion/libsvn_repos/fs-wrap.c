@@ -111,6 +111,13 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* Keep the history index up to date.  Like a failing post-commit hook,
+     a failure here does not affect the new revision. */
+  err = svn_error_compose_create(err,
+                                 svn_repos__history_index_update(repos,
+                                                                 *new_rev,
+                                                                 pool));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
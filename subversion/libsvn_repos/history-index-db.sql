@@ -0,0 +1,82 @@
+/* history-index-db.sql -- schema of the repository history index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* The revisions in which the node at PATH changed.  Like the filesystem,
+   this includes revisions in which anything below a directory changed.
+   PATH is an fspath, i.e. it starts with '/'. */
+CREATE TABLE node_changes (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  );
+
+/* The revisions in which a node got added or replaced at PATH, with
+   the copy source if there is one. */
+CREATE TABLE node_adds (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  copyfrom_path TEXT,
+  copyfrom_revision INTEGER,
+  PRIMARY KEY (path, revision)
+  );
+
+/* A single row containing the youngest revision that has been indexed. */
+CREATE TABLE indexed_revision (
+  revision INTEGER NOT NULL
+  );
+
+INSERT INTO indexed_revision (revision) VALUES (0);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_GET_INDEXED_REVISION
+SELECT revision
+FROM indexed_revision
+
+-- STMT_SET_INDEXED_REVISION
+UPDATE indexed_revision
+SET revision = ?1
+
+-- STMT_INSERT_NODE_CHANGE
+INSERT OR IGNORE INTO node_changes (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_INSERT_NODE_ADD
+INSERT OR REPLACE INTO node_adds (path, revision, copyfrom_path,
+                                  copyfrom_revision)
+VALUES (?1, ?2, ?3, ?4)
+
+-- STMT_GET_LAST_NODE_CHANGE
+SELECT revision
+FROM node_changes
+WHERE path = ?1 AND revision <= ?2
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_GET_LAST_NODE_ADD
+SELECT revision, copyfrom_path, copyfrom_revision
+FROM node_adds
+WHERE path = ?1 AND revision <= ?2
+ORDER BY revision DESC
+LIMIT 1
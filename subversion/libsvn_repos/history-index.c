@@ -0,0 +1,561 @@
+/* history-index.c --- an on-disk index of node histories
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The history index records for every path the revisions in which the
+ * node at that path changed, plus the revisions in which a node got added
+ * at that path, together with its copy source.  That is enough to
+ * reconstruct the locations that svn_fs_history_prev2() reports for any
+ * node with a few indexed lookups per location, instead of walking the
+ * node's predecessors one revision at a time.
+ *
+ * The index is optional.  It gets created by svn_repos__build_history_index
+ * and, once it exists, svn_repos_fs_commit_txn() adds new revisions to it.
+ * Commits don't catch up on revisions that were added by other means, e.g.
+ * by loading a dump file.  Once the index fell behind like that, it will
+ * only be updated again by the next rebuild.  Readers only use the index if
+ * it covers the revisions they are interested in.
+ */
+
+#include <apr_strings.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_sqlite.h"
+
+#include "repos.h"
+
+#include "svn_private_config.h"
+
+#include "history-index-db.h"
+
+HISTORY_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+/* Number of revisions to add to the index within a single SQLite
+   transaction.  This keeps the database locked for a short time only
+   while building the index for an existing repository. */
+#define REVISIONS_PER_TXN 100
+
+/* A commit adds its new revision to the index only if the index covers
+   all but this many of the revisions before it.  The tolerance allows
+   for concurrent commits whose index updates have not finished yet. */
+#define MAX_COMMIT_LAG 8
+
+
+
+/** Helper functions. **/
+
+/* Return the path of the history index database of REPOS. */
+static const char *
+path_history_index(svn_repos_t *repos,
+                   apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__HISTORY_INDEX_DB,
+                         result_pool);
+}
+
+/* Make sure that REPOS->HISTORY_INDEX_DB is open if REPOS has a history
+   index.  If CREATE is set, create the index if it does not exist yet.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+open_history_index(svn_repos_t *repos,
+                   svn_boolean_t create,
+                   apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  const char *db_path;
+  int version;
+
+  if (repos->history_index_db)
+    return SVN_NO_ERROR;
+
+  /* Don't look for a non-existent index over and over again. */
+  if (repos->history_index_checked && !create)
+    return SVN_NO_ERROR;
+
+  repos->history_index_checked = TRUE;
+  db_path = path_history_index(repos, scratch_pool);
+
+  if (! create)
+    {
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(db_path, &kind, scratch_pool));
+      if (kind == svn_node_none)
+        return SVN_NO_ERROR;
+    }
+#ifndef WIN32
+  else
+    {
+      /* We want to extend the permissions that apply to the repository
+         as a whole when creating a new index and not simply default
+         to umask. */
+      svn_error_t *err = svn_io_file_create_empty(db_path, scratch_pool);
+
+      if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+        return svn_error_trace(err);
+      else if (err)
+        svn_error_clear(err);
+      else
+        SVN_ERR(svn_io_copy_perms(svn_dirent_join(repos->db_path, "fs-type",
+                                                  scratch_pool),
+                                  db_path, scratch_pool));
+    }
+#endif
+
+  /* The database will be closed when REPOS->POOL gets destroyed. */
+  SVN_ERR(svn_sqlite__open(&sdb, db_path,
+                           create ? svn_sqlite__mode_rwcreate
+                                  : svn_sqlite__mode_readwrite,
+                           statements, 0, NULL, 0,
+                           repos->pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb,
+                                                        scratch_pool),
+                        sdb);
+  if (version <= 0)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(sdb,
+                                                      STMT_CREATE_SCHEMA),
+                          sdb);
+
+  repos->history_index_db = sdb;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REV to the youngest revision contained in the history index SDB. */
+static svn_error_t *
+get_indexed_revision(svn_revnum_t *rev,
+                     svn_sqlite__db_t *sdb)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *rev = have_row ? svn_sqlite__column_revnum(stmt, 0) : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Record in SDB that the node at PATH changed in REV. */
+static svn_error_t *
+insert_node_change(svn_sqlite__db_t *sdb,
+                   const char *path,
+                   svn_revnum_t rev)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_NODE_CHANGE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, rev));
+
+  return svn_error_trace(svn_sqlite__step_done(stmt));
+}
+
+/* Add the changes of revision REV in FS to the history index SDB.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_revision(svn_sqlite__db_t *sdb,
+               svn_fs_t *fs,
+               svn_revnum_t rev,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_hash_t *parents = apr_hash_make(scratch_pool);
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+
+  while (change)
+    {
+      const char *path = apr_pstrmemdup(scratch_pool, change->path.data,
+                                        change->path.len);
+      const char *parent;
+
+      /* Deleted nodes have no history after their deletion. */
+      if (change->change_kind != svn_fs_path_change_delete)
+        SVN_ERR(insert_node_change(sdb, path, rev));
+
+      if (   change->change_kind == svn_fs_path_change_add
+          || change->change_kind == svn_fs_path_change_replace)
+        {
+          const char *copyfrom_path = change->copyfrom_path;
+          svn_revnum_t copyfrom_rev = change->copyfrom_rev;
+
+          if (! change->copyfrom_known)
+            SVN_ERR(svn_fs_copied_from(&copyfrom_rev, &copyfrom_path,
+                                       root, path, scratch_pool));
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_INSERT_NODE_ADD));
+          SVN_ERR(svn_sqlite__bindf(stmt, "srsr", path, rev,
+                                    SVN_IS_VALID_REVNUM(copyfrom_rev)
+                                      ? copyfrom_path : NULL,
+                                    copyfrom_rev));
+          SVN_ERR(svn_sqlite__step_done(stmt));
+        }
+
+      /* Like the filesystem, treat this as a change of all parent
+         directories as well. */
+      for (parent = svn_fspath__dirname(path, scratch_pool);
+           ! svn_hash_gets(parents, parent);
+           parent = svn_fspath__dirname(parent, scratch_pool))
+        {
+          svn_hash_sets(parents, parent, parent);
+          SVN_ERR(insert_node_change(sdb, parent, rev));
+
+          if (svn_fspath__is_root(parent, strlen(parent)))
+            break;
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of FS up to LAST_REV to the history index SDB that
+   it does not contain yet.  Must be called within an SQLite transaction.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_revisions(svn_sqlite__db_t *sdb,
+                svn_fs_t *fs,
+                svn_revnum_t last_rev,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t rev;
+
+  /* Another process may have indexed some revisions in the meantime. */
+  SVN_ERR(get_indexed_revision(&rev, sdb));
+  if (rev >= last_rev)
+    return SVN_NO_ERROR;
+
+  for (++rev; rev <= last_rev; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(index_revision(sdb, fs, rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, last_rev));
+
+  return svn_error_trace(svn_sqlite__update(NULL, stmt));
+}
+
+/* Add all revisions of REPOS to its open history index that it does not
+   contain yet.  Set *START_REV and *END_REV to the range of revisions
+   added, or to SVN_INVALID_REVNUM if there were none.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+update_history_index(svn_revnum_t *start_rev,
+                     svn_revnum_t *end_rev,
+                     svn_repos_t *repos,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb = repos->history_index_db;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t youngest, indexed;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  SVN_ERR(get_indexed_revision(&indexed, sdb));
+
+  *start_rev = SVN_INVALID_REVNUM;
+  *end_rev = SVN_INVALID_REVNUM;
+  if (indexed < youngest)
+    {
+      *start_rev = indexed + 1;
+      *end_rev = youngest;
+    }
+
+  while (indexed < youngest)
+    {
+      svn_revnum_t last_rev = indexed + REVISIONS_PER_TXN;
+      if (last_rev > youngest)
+        last_rev = youngest;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_SQLITE__WITH_IMMEDIATE_TXN(index_revisions(sdb, repos->fs,
+                                                     last_rev, iterpool),
+                                     sdb);
+      SVN_ERR(get_indexed_revision(&indexed, sdb));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REV to the youngest revision up to MAX_REV in which the node at
+   PATH changed according to the history index SDB.  Set it to
+   SVN_INVALID_REVNUM if there is no such revision. */
+static svn_error_t *
+get_last_change(svn_revnum_t *rev,
+                svn_sqlite__db_t *sdb,
+                const char *path,
+                svn_revnum_t max_rev)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_LAST_NODE_CHANGE));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, max_rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *rev = have_row ? svn_sqlite__column_revnum(stmt, 0) : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Set *REV to the youngest revision up to MAX_REV in which a node got
+   added at PATH or at any of its parent directories according to the
+   history index SDB, or to SVN_INVALID_REVNUM if there is no such
+   revision.  If that addition was a copy, set *COPYFROM_PATH and
+   *COPYFROM_REV to the copy source of the node at PATH, allocated in
+   RESULT_POOL.  Otherwise, set them to NULL and SVN_INVALID_REVNUM.  */
+static svn_error_t *
+get_last_add(svn_revnum_t *rev,
+             const char **copyfrom_path,
+             svn_revnum_t *copyfrom_rev,
+             svn_sqlite__db_t *sdb,
+             const char *path,
+             svn_revnum_t max_rev,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  const char *parent = path;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  *rev = SVN_INVALID_REVNUM;
+  *copyfrom_path = NULL;
+  *copyfrom_rev = SVN_INVALID_REVNUM;
+
+  while (TRUE)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_LAST_NODE_ADD));
+      SVN_ERR(svn_sqlite__bindf(stmt, "sr", parent, max_rev));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+      /* On ties, the addition closest to PATH wins. */
+      if (have_row && (   ! SVN_IS_VALID_REVNUM(*rev)
+                       || svn_sqlite__column_revnum(stmt, 0) > *rev))
+        {
+          *rev = svn_sqlite__column_revnum(stmt, 0);
+          if (svn_sqlite__column_is_null(stmt, 1))
+            {
+              *copyfrom_path = NULL;
+              *copyfrom_rev = SVN_INVALID_REVNUM;
+            }
+          else
+            {
+              *copyfrom_path
+                = svn_fspath__join(svn_sqlite__column_text(stmt, 1, NULL),
+                                   svn_fspath__skip_ancestor(parent, path),
+                                   result_pool);
+              *copyfrom_rev = svn_sqlite__column_revnum(stmt, 2);
+            }
+        }
+      SVN_ERR(svn_sqlite__reset(stmt));
+
+      if (svn_fspath__is_root(parent, strlen(parent)))
+        break;
+
+      parent = svn_fspath__dirname(parent, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__history_index_get(apr_array_header_t **locations_p,
+                             svn_boolean_t *complete,
+                             svn_repos_t *repos,
+                             const char *path,
+                             svn_revnum_t peg_rev,
+                             svn_revnum_t start,
+                             svn_boolean_t strict,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *locations;
+  apr_pool_t *iterpool;
+  svn_sqlite__db_t *sdb;
+  svn_fs_root_t *root;
+  svn_node_kind_t kind;
+  svn_revnum_t indexed;
+  svn_revnum_t rev = peg_rev;
+
+  *locations_p = NULL;
+  *complete = FALSE;
+
+  SVN_ERR(open_history_index(repos, FALSE, scratch_pool));
+  sdb = repos->history_index_db;
+  if (! sdb)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_indexed_revision(&indexed, sdb));
+  if (! SVN_IS_VALID_REVNUM(indexed) || peg_rev > indexed)
+    return SVN_NO_ERROR;
+
+  /* Leave it to the filesystem to report missing nodes. */
+  SVN_ERR(svn_fs_revision_root(&root, repos->fs, peg_rev, scratch_pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, path, scratch_pool));
+  if (kind == svn_node_none)
+    return SVN_NO_ERROR;
+
+  locations = apr_array_make(result_pool, 16,
+                             sizeof(svn_repos__history_location_t));
+  path = svn_fspath__canonicalize(path, result_pool);
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (TRUE)
+    {
+      svn_repos__history_location_t *location;
+      svn_revnum_t changed_rev, added_rev, copyfrom_rev;
+      const char *copyfrom_path;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(get_last_change(&changed_rev, sdb, path, rev));
+      SVN_ERR(get_last_add(&added_rev, &copyfrom_path, &copyfrom_rev,
+                           sdb, path, rev, result_pool, iterpool));
+
+      /* Every node but the root directory of r0 got added at some point.
+         If the index says otherwise, don't trust it. */
+      if (   ! SVN_IS_VALID_REVNUM(changed_rev)
+          && ! SVN_IS_VALID_REVNUM(added_rev))
+        {
+          if (! svn_fspath__is_root(path, strlen(path)))
+            {
+              svn_pool_destroy(iterpool);
+              return SVN_NO_ERROR;
+            }
+
+          location = apr_array_push(locations);
+          location->path = path;
+          location->revision = 0;
+          *complete = TRUE;
+          break;
+        }
+
+      location = apr_array_push(locations);
+      location->path = path;
+
+      if (   SVN_IS_VALID_REVNUM(added_rev)
+          && (! SVN_IS_VALID_REVNUM(changed_rev) || added_rev >= changed_rev))
+        {
+          /* The node got created here, possibly by copying its parent. */
+          location->revision = added_rev;
+          if (strict || ! copyfrom_path)
+            {
+              *complete = TRUE;
+              break;
+            }
+
+          path = copyfrom_path;
+          rev = copyfrom_rev;
+        }
+      else
+        {
+          location->revision = changed_rev;
+          rev = changed_rev - 1;
+        }
+
+      if (location->revision < start)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  *locations_p = locations;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__history_index_update(svn_repos_t *repos,
+                                svn_revnum_t new_rev,
+                                apr_pool_t *scratch_pool)
+{
+  svn_revnum_t indexed;
+
+  SVN_ERR(open_history_index(repos, FALSE, scratch_pool));
+  if (! repos->history_index_db)
+    return SVN_NO_ERROR;
+
+  /* Leave larger gaps to svn_repos__build_history_index, so a commit
+     never pays for indexing revisions that were e.g. loaded from a dump
+     file. */
+  SVN_ERR(get_indexed_revision(&indexed, repos->history_index_db));
+  if (indexed >= new_rev || indexed + MAX_COMMIT_LAG < new_rev - 1)
+    return SVN_NO_ERROR;
+
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(index_revisions(repos->history_index_db,
+                                                 repos->fs, new_rev,
+                                                 scratch_pool),
+                                 repos->history_index_db);
+
+  return SVN_NO_ERROR;
+}
+
+
+/** Public-ish API's. **/
+
+svn_error_t *
+svn_repos__build_history_index(svn_revnum_t *start_rev,
+                               svn_revnum_t *end_rev,
+                               svn_repos_t *repos,
+                               svn_cancel_func_t cancel_func,
+                               void *cancel_baton,
+                               apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = open_history_index(repos, TRUE, scratch_pool);
+
+  SVN_ERR(svn_error_quick_wrapf(err,
+                                _("Couldn't open history index '%s'"),
+                                svn_dirent_local_style(
+                                  path_history_index(repos, scratch_pool),
+                                  scratch_pool)));
+
+  return svn_error_trace(update_history_index(start_rev, end_rev, repos,
+                                              cancel_func, cancel_baton,
+                                              scratch_pool));
+}
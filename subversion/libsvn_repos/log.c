@@ -38,6 +38,7 @@
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "repos.h"
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_mergeinfo_private.h"
@@ -56,6 +57,13 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* Cache of path history locations, see get_cached_history().
+     May be NULL. */
+  svn_cache__t *history_cache;
+
+  /* The repository being queried.  Used to access its history index. */
+  svn_repos_t *repos;
 } log_callbacks_t;
 
 
@@ -429,8 +437,71 @@ struct path_info
   svn_fs_history_t *hist;
   apr_pool_t *newpool;
   apr_pool_t *oldpool;
+
+  /* If not NULL, all history locations of this path that are known so
+     far, in the order in which the history walk reports them.  Some of
+     them may have been read from the history cache under CACHE_KEY.
+     NEXT_LOCATION is the index of the location to report next. */
+  apr_array_header_t *locations;
+  int next_location;
+  const char *cache_key;
+
+  /* Set if LOCATIONS covers the complete history of the path. */
+  svn_boolean_t complete;
+
+  /* Set if LOCATIONS has been extended since it was read from the cache. */
+  svn_boolean_t modified;
+
+  /* Set if the history object has not been opened because LOCATIONS came
+     from the cache.  It will be opened at the last cached location once
+     we need to walk further back.  NEWPOOL and OLDPOOL are valid. */
+  svn_boolean_t reopen;
 };
 
+/* If optional AUTHZ_READ_FUNC is non-NULL, then use it (with
+ * AUTHZ_READ_BATON and FS) to check whether INFO->PATH is readable in
+ * INFO->HISTORY_REV.  If it is not, set INFO->DONE to TRUE.
+ */
+static svn_error_t *
+check_readable(struct path_info *info,
+               svn_fs_t *fs,
+               svn_repos_authz_func_t authz_read_func,
+               void *authz_read_baton,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *history_root;
+  svn_boolean_t readable;
+
+  if (! authz_read_func)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_revision_root(&history_root, fs,
+                               info->history_rev,
+                               scratch_pool));
+  SVN_ERR(authz_read_func(&readable, history_root,
+                          info->path->data,
+                          authz_read_baton,
+                          scratch_pool));
+  if (! readable)
+    info->done = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark INFO as done and release the pools used for its history object. */
+static void
+history_done(struct path_info *info)
+{
+  if (info->newpool)
+    svn_pool_destroy(info->newpool);
+  if (info->oldpool)
+    svn_pool_destroy(info->oldpool);
+
+  info->newpool = NULL;
+  info->oldpool = NULL;
+  info->done = TRUE;
+}
+
 /* Advance to the next history for the path.
  *
  * If INFO->HIST is not NULL we do this using that existing history object,
@@ -462,6 +533,35 @@ get_history(struct path_info *info,
   apr_pool_t *subpool;
   const char *path;
 
+  /* Report cached history first. */
+  if (info->locations && info->next_location < info->locations->nelts)
+    {
+      const svn_repos__history_location_t *location
+        = &APR_ARRAY_IDX(info->locations, info->next_location,
+                         svn_repos__history_location_t);
+
+      info->next_location++;
+      info->first_time = FALSE;
+      svn_stringbuf_set(info->path, location->path);
+      info->history_rev = location->revision;
+
+      if (info->history_rev < start)
+        {
+          history_done(info);
+          return SVN_NO_ERROR;
+        }
+
+      return svn_error_trace(check_readable(info, fs, authz_read_func,
+                                            authz_read_baton,
+                                            scratch_pool));
+    }
+
+  if (info->complete)
+    {
+      history_done(info);
+      return SVN_NO_ERROR;
+    }
+
   if (info->hist)
     {
       subpool = info->newpool;
@@ -473,7 +573,8 @@ get_history(struct path_info *info,
     }
   else
     {
-      subpool = svn_pool_create(result_pool);
+      subpool = info->reopen ? info->newpool
+                             : svn_pool_create(result_pool);
 
       /* Open the history located at the last rev we were at. */
       SVN_ERR(svn_fs_revision_root(&history_root, fs, info->history_rev,
@@ -490,6 +591,19 @@ get_history(struct path_info *info,
       else
         SVN_ERR(svn_fs_history_prev2(&hist, hist, ! strict, subpool,
                                      scratch_pool));
+
+      /* Keep walking from here with the history object. */
+      if (info->reopen)
+        {
+          info->hist = hist;
+          info->reopen = FALSE;
+        }
+    }
+
+  if (! hist && info->locations)
+    {
+      info->complete = TRUE;
+      info->modified = TRUE;
     }
 
   if (! hist)
@@ -507,6 +621,17 @@ get_history(struct path_info *info,
 
   svn_stringbuf_set(info->path, path);
 
+  if (info->locations)
+    {
+      svn_repos__history_location_t *location
+        = apr_array_push(info->locations);
+
+      location->path = apr_pstrdup(info->locations->pool, path);
+      location->revision = info->history_rev;
+      info->next_location++;
+      info->modified = TRUE;
+    }
+
   /* If this history item predates our START revision then
      don't fetch any more for this path. */
   if (info->history_rev < start)
@@ -519,19 +644,8 @@ get_history(struct path_info *info,
     }
 
   /* Is the history item readable?  If not, done with path. */
-  if (authz_read_func)
-    {
-      svn_boolean_t readable;
-      SVN_ERR(svn_fs_revision_root(&history_root, fs,
-                                   info->history_rev,
-                                   scratch_pool));
-      SVN_ERR(authz_read_func(&readable, history_root,
-                              info->path->data,
-                              authz_read_baton,
-                              scratch_pool));
-      if (! readable)
-        info->done = TRUE;
-    }
+  SVN_ERR(check_readable(info, fs, authz_read_func, authz_read_baton,
+                         scratch_pool));
 
   if (! info->hist)
     {
@@ -1387,10 +1501,201 @@ send_log(svn_revnum_t rev,
    memory. */
 #define MAX_OPEN_HISTORIES 32
 
+/* The history cache maps a path, the revision in which that node last
+   changed at or before the peg revision and the STRICT flag to the
+   sequence of history locations that svn_fs_history_prev2() reports for
+   that node, as far as it has been walked.  That revision is where the
+   history walk starts, so the entry is the same for every peg revision up
+   to the next change of the node.  Committed history never changes, so
+   entries never need to be invalidated; walking further back extends
+   them.  Each value is a string: the line "complete" or "partial",
+   followed by one "<rev> <path>" line per location.  Paths cannot contain
+   newlines. */
+
+/* Set *REV to the revision of the first location that the history of PATH
+   in ROOT will report, i.e. the last revision in which the node got
+   modified or copied, including copies of its parents.  Set it to
+   SVN_INVALID_REVNUM if PATH does not exist in ROOT.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+get_history_start_rev(svn_revnum_t *rev,
+                      svn_fs_root_t *root,
+                      const char *path,
+                      apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *copy_root;
+  const char *copy_path;
+  svn_error_t *err;
+
+  err = svn_fs_node_created_rev(rev, root, path, scratch_pool);
+  if (err && (err->apr_err == SVN_ERR_FS_NOT_FOUND
+              || err->apr_err == SVN_ERR_FS_NOT_DIRECTORY))
+    {
+      svn_error_clear(err);
+      *rev = SVN_INVALID_REVNUM;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Copies of parents don't create new node revisions for the path. */
+  SVN_ERR(svn_fs_closest_copy(&copy_root, &copy_path, root, path,
+                              scratch_pool));
+  if (copy_root && svn_fs_revision_root_revision(copy_root) > *rev)
+    *rev = svn_fs_revision_root_revision(copy_root);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set INFO->LOCATIONS to the history of PATH in ROOT (following copies
+   unless STRICT is set) as far as it is found in CACHE.  Set the other
+   cache-related members of INFO accordingly.  Leave INFO->LOCATIONS NULL
+   if PATH does not exist in ROOT.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+get_cached_history(struct path_info *info,
+                   svn_cache__t *cache,
+                   svn_fs_root_t *root,
+                   const char *path,
+                   svn_boolean_t strict,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *data;
+  svn_boolean_t found;
+  apr_array_header_t *lines;
+  svn_revnum_t start_rev;
+  int i;
+
+  SVN_ERR(get_history_start_rev(&start_rev, root, path, scratch_pool));
+  if (! SVN_IS_VALID_REVNUM(start_rev))
+    return SVN_NO_ERROR;
+
+  info->cache_key = apr_psprintf(result_pool, "%ld:%d:%s", start_rev,
+                                 strict ? 1 : 0, path);
+  info->locations = apr_array_make(result_pool, 16,
+                                   sizeof(svn_repos__history_location_t));
+  info->next_location = 0;
+  info->complete = FALSE;
+  info->modified = FALSE;
+
+  SVN_ERR(svn_cache__get((void **)&data, &found, cache, info->cache_key,
+                         scratch_pool));
+  if (! found)
+    return SVN_NO_ERROR;
+
+  lines = svn_cstring_split(data->data, "\n", FALSE, scratch_pool);
+  for (i = 1; i < lines->nelts; ++i)
+    {
+      const char *line = APR_ARRAY_IDX(lines, i, const char *);
+      svn_repos__history_location_t *location;
+      const char *end;
+      svn_revnum_t rev;
+      svn_error_t *err = svn_revnum_parse(&rev, line, &end);
+
+      /* Ignore malformed entries and walk the history instead. */
+      if (err || *end != ' ')
+        {
+          svn_error_clear(err);
+          apr_array_clear(info->locations);
+          return SVN_NO_ERROR;
+        }
+
+      location = apr_array_push(info->locations);
+      location->path = apr_pstrdup(result_pool, end + 1);
+      location->revision = rev;
+    }
+
+  info->complete = lines->nelts > 0
+                && strcmp(APR_ARRAY_IDX(lines, 0, const char *),
+                          "complete") == 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set INFO->LOCATIONS to the history of PATH@PEG_REV (following copies
+   unless STRICT is set) as found in the history index of REPOS, down to
+   the first location older than START.  Leave INFO unchanged if REPOS has
+   no usable history index.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+get_indexed_history(struct path_info *info,
+                    svn_repos_t *repos,
+                    const char *path,
+                    svn_revnum_t peg_rev,
+                    svn_revnum_t start,
+                    svn_boolean_t strict,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *locations;
+  svn_boolean_t complete;
+
+  SVN_ERR(svn_repos__history_index_get(&locations, &complete, repos, path,
+                                       peg_rev, start, strict,
+                                       result_pool, scratch_pool));
+  if (locations)
+    {
+      info->locations = locations;
+      info->next_location = 0;
+      info->complete = complete;
+
+      /* Let the history cache pick it up. */
+      info->modified = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Store the history locations of all entries in HISTORIES that have
+   been extended by the history walk in CACHE.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+cache_histories(svn_cache__t *cache,
+                const apr_array_header_t *histories,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < histories->nelts; ++i)
+    {
+      struct path_info *info = APR_ARRAY_IDX(histories, i,
+                                             struct path_info *);
+      svn_stringbuf_t *data;
+
+      if (! info->locations || ! info->modified || ! info->cache_key)
+        continue;
+
+      svn_pool_clear(iterpool);
+      data = svn_stringbuf_create(info->complete ? "complete\n"
+                                                 : "partial\n",
+                                  iterpool);
+      for (k = 0; k < info->locations->nelts; ++k)
+        {
+          const svn_repos__history_location_t *location
+            = &APR_ARRAY_IDX(info->locations, k,
+                             svn_repos__history_location_t);
+
+          svn_stringbuf_appendcstr(data,
+                                   apr_psprintf(iterpool, "%ld %s\n",
+                                                location->revision,
+                                                location->path));
+        }
+
+      if (svn_cache__is_cachable(cache, data->len))
+        SVN_ERR(svn_cache__set(cache, info->cache_key, data, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Get the histories for PATHS, and store them in *HISTORIES.
 
    If IGNORE_MISSING_LOCATIONS is set, don't treat requests for bogus
-   repository locations as fatal -- just ignore them.  */
+   repository locations as fatal -- just ignore them.
+
+   If HISTORY_CACHE is not NULL, take as much of the histories from it
+   as possible.  Otherwise, try the history index of REPOS, if REPOS is
+   not NULL.  */
 static svn_error_t *
 get_path_histories(apr_array_header_t **histories,
                    svn_fs_t *fs,
@@ -1401,6 +1706,8 @@ get_path_histories(apr_array_header_t **histories,
                    svn_boolean_t ignore_missing_locations,
                    svn_repos_authz_func_t authz_read_func,
                    void *authz_read_baton,
+                   svn_cache__t *history_cache,
+                   svn_repos_t *repos,
                    apr_pool_t *pool)
 {
   svn_fs_root_t *root;
@@ -1442,8 +1749,31 @@ get_path_histories(apr_array_header_t **histories,
       info->done = FALSE;
       info->history_rev = hist_end;
       info->first_time = TRUE;
-
-      if (i < MAX_OPEN_HISTORIES)
+      info->locations = NULL;
+      info->cache_key = NULL;
+      info->complete = FALSE;
+      info->reopen = FALSE;
+
+      if (history_cache)
+        SVN_ERR(get_cached_history(info, history_cache, root, this_path,
+                                   strict_node_history, pool, iterpool));
+
+      if (repos && (! info->locations || ! info->locations->nelts))
+        SVN_ERR(get_indexed_history(info, repos, this_path, hist_end,
+                                    hist_start, strict_node_history,
+                                    pool, iterpool));
+
+      if (i < MAX_OPEN_HISTORIES && info->locations
+          && info->locations->nelts)
+        {
+          /* The history object will be opened when we run out of cached
+             locations. */
+          info->hist = NULL;
+          info->reopen = TRUE;
+          info->newpool = svn_pool_create(pool);
+          info->oldpool = svn_pool_create(pool);
+        }
+      else if (i < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history2(&info->hist, root, this_path, pool,
                                      iterpool);
@@ -2015,7 +2345,9 @@ do_logs(svn_fs_t *fs,
   SVN_ERR(get_path_histories(&histories, fs, paths, hist_start, hist_end,
                              strict_node_history, ignore_missing_locations,
                              callbacks->authz_read_func,
-                             callbacks->authz_read_baton, pool));
+                             callbacks->authz_read_baton,
+                             callbacks->history_cache, callbacks->repos,
+                             pool));
 
   /* Loop through all the revisions in the range and add any
      where a path was changed to the array, or if they wanted
@@ -2149,6 +2481,11 @@ do_logs(svn_fs_t *fs,
             }
         }
     }
+
+  /* Let the next query for the same paths skip the history walk. */
+  if (callbacks->history_cache)
+    SVN_ERR(cache_histories(callbacks->history_cache, histories, iterpool));
+
   svn_pool_destroy(iterpool2);
   svn_pool_destroy(iterpool);
 
@@ -2303,6 +2640,35 @@ get_paths_history_as_mergeinfo(svn_mergeinfo_t *paths_history_mergeinfo,
   return SVN_NO_ERROR;
 }
 
+/* Set *CACHE to a history cache for REPOS that is shared with all other
+   log queries in this process.  Set it to NULL if caching is disabled.
+   Allocate the result in RESULT_POOL. */
+static svn_error_t *
+create_history_cache(svn_cache__t **cache,
+                     svn_repos_t *repos,
+                     apr_pool_t *result_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  const char *uuid;
+  const char *prefix;
+
+  *cache = NULL;
+  if (! membuffer)
+    return SVN_NO_ERROR;
+
+  /* Keys are only unique within a repository. */
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, result_pool));
+  prefix = apr_pstrcat(result_pool, "svn:repos:history:", uuid, ":",
+                       svn_fs_path(repos->fs, result_pool), ":",
+                       SVN_VA_NULL);
+
+  return svn_error_trace(svn_cache__create_membuffer_cache(
+                           cache, membuffer, NULL, NULL,
+                           APR_HASH_KEY_STRING, prefix,
+                           SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                           FALSE, FALSE, result_pool, result_pool));
+}
+
 svn_error_t *
 svn_repos_get_logs5(svn_repos_t *repos,
                     const apr_array_header_t *paths,
@@ -2332,6 +2698,8 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.history_cache = NULL;
+  callbacks.repos = repos;
 
   if (revprops)
     {
@@ -2460,6 +2828,9 @@ svn_repos_get_logs5(svn_repos_t *repos,
       svn_pool_destroy(subpool);
     }
 
+  SVN_ERR(create_history_cache(&callbacks.history_cache, repos,
+                               scratch_pool));
+
   return do_logs(repos->fs, paths, paths_history_mergeinfo, NULL, NULL,
                  start, end, limit, strict_node_history,
                  include_merged_revisions, FALSE, FALSE, FALSE,
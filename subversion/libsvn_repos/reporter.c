@@ -21,6 +21,10 @@
  * ====================================================================
  */
 
+#include <string.h>
+
+#include <apr_md5.h>
+
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_path.h"
@@ -31,9 +35,11 @@
 #include "svn_repos.h"
 #include "svn_pools.h"
 #include "svn_props.h"
+#include "svn_delta.h"
 #include "repos.h"
 #include "svn_private_config.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
@@ -143,6 +149,11 @@ typedef struct report_baton_t
 
   /* This will not change. So, fetch it once and reuse it. */
   svn_string_t *repos_uuid;
+
+  /* Cache of text deltas, shared with all other reports through the
+     global membuffer cache.  NULL if caching is not available. */
+  svn_cache__t *delta_cache;
+
   apr_pool_t *pool;
 } report_baton_t;
 
@@ -661,6 +672,283 @@ send_zero_copy_delta(const unsigned char *contents,
   return SVN_NO_ERROR;
 }
 
+/* Text deltas depend on nothing but the contents of the source and the
+ * target file.  When many clients update across the same revisions, e.g.
+ * after a large merge has been committed, we would compute the same deltas
+ * over and over again.  Therefore, we keep them in B->DELTA_CACHE as
+ * uncompressed svndiff data.  The svndiff version and compression used on
+ * the wire are up to the editor and don't affect the cached data.
+ *
+ * The cache is specific to the repository and the keys consist of the MD5
+ * and, if available, SHA1 checksums of both contents.  Each entry starts
+ * with the MD5 digest of the delta target as produced by the delta stream,
+ * followed by the svndiff data.  Entries are only used if that digest and
+ * the windows' total target length match the target file.
+ */
+
+/* Baton type to be passed into caching_window_handler.
+ */
+typedef struct caching_window_baton_t
+{
+  /* window handler and baton to send the data to */
+  svn_txdelta_window_handler_t dhandler;
+  void *dbaton;
+
+  /* svndiff writer appending the windows to BUFFER */
+  svn_txdelta_window_handler_t svndiff_handler;
+  void *svndiff_baton;
+  svn_stringbuf_t *buffer;
+
+  /* set to FALSE once BUFFER got too large to be cached */
+  svn_boolean_t recording;
+
+  /* the delta stream being sent and the MD5 checksum of its target */
+  svn_txdelta_stream_t *dstream;
+  const svn_checksum_t *t_checksum;
+
+  /* where to put BUFFER after the last window */
+  svn_cache__t *cache;
+  const char *key;
+  apr_pool_t *pool;
+} caching_window_baton_t;
+
+/* Implement svn_txdelta_window_handler_t.  Forward WINDOW to the handler
+ * given in the caching_window_baton_t *BATON and append it to the svndiff
+ * data that we will put into the cache after the last window.
+ */
+static svn_error_t *
+caching_window_handler(svn_txdelta_window_t *window,
+                       void *baton)
+{
+  caching_window_baton_t *cwb = baton;
+
+  if (cwb->recording)
+    {
+      SVN_ERR(cwb->svndiff_handler(window, cwb->svndiff_baton));
+      if (!svn_cache__is_cachable(cwb->cache, cwb->buffer->len))
+        {
+          cwb->recording = FALSE;
+        }
+      else if (window == NULL)
+        {
+          /* Only cache deltas that actually produced the expected target.
+             The digest becomes available with the last window. */
+          const unsigned char *digest = svn_txdelta_md5_digest(cwb->dstream);
+          if (digest && memcmp(digest, cwb->t_checksum->digest,
+                               APR_MD5_DIGESTSIZE) == 0)
+            {
+              memcpy(cwb->buffer->data, digest, APR_MD5_DIGESTSIZE);
+              SVN_ERR(svn_cache__set(cwb->cache, cwb->key, cwb->buffer,
+                                     cwb->pool));
+            }
+        }
+    }
+
+  return svn_error_trace(cwb->dhandler(window, cwb->dbaton));
+}
+
+/* Baton type to be passed into collect_window.
+ */
+typedef struct window_collector_t
+{
+  /* windows collected so far, allocated in POOL */
+  apr_array_header_t *windows;
+
+  /* sum of their target view lengths */
+  svn_filesize_t target_len;
+
+  apr_pool_t *pool;
+} window_collector_t;
+
+/* Implement svn_txdelta_window_handler_t.  Append a copy of WINDOW to
+ * the window_collector_t *BATON.
+ */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window,
+               void *baton)
+{
+  window_collector_t *collector = baton;
+
+  if (window)
+    {
+      APR_ARRAY_PUSH(collector->windows, svn_txdelta_window_t *)
+        = svn_txdelta_window_dup(window, collector->pool);
+      collector->target_len += window->tview_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the cached delta SVNDIFF and check it against the MD5 checksum
+ * T_CHECKSUM and the length T_LEN of the delta target.  If it matches,
+ * set *WINDOWS to the array of svn_txdelta_window_t * contained in it.
+ * Otherwise, set it to NULL.  Allocate the result in POOL.
+ */
+static svn_error_t *
+parse_cached_delta(apr_array_header_t **windows,
+                   const svn_stringbuf_t *svndiff,
+                   const svn_checksum_t *t_checksum,
+                   svn_filesize_t t_len,
+                   apr_pool_t *pool)
+{
+  window_collector_t collector;
+  svn_stream_t *parser;
+  apr_size_t len;
+  svn_error_t *err;
+
+  *windows = NULL;
+  if (   svndiff->len < APR_MD5_DIGESTSIZE
+      || memcmp(svndiff->data, t_checksum->digest, APR_MD5_DIGESTSIZE))
+    return SVN_NO_ERROR;
+
+  collector.windows = apr_array_make(pool, 16,
+                                     sizeof(svn_txdelta_window_t *));
+  collector.target_len = 0;
+  collector.pool = pool;
+
+  /* A corrupted entry must not keep us from sending the delta. */
+  len = svndiff->len - APR_MD5_DIGESTSIZE;
+  parser = svn_txdelta_parse_svndiff(collect_window, &collector, TRUE, pool);
+  err = svn_stream_write(parser, svndiff->data + APR_MD5_DIGESTSIZE, &len);
+  if (!err)
+    err = svn_stream_close(parser);
+
+  if (err)
+    svn_error_clear(err);
+  else if (collector.target_len == t_len)
+    *windows = collector.windows;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *KEY to the B->DELTA_CACHE key for the delta from S_ROOT/S_PATH
+ * to T_ROOT/T_PATH and *T_CHECKSUM to the MD5 checksum of the latter.
+ * Set *KEY to NULL if the contents' checksums are not readily available.
+ * Allocate the results in POOL.
+ */
+static svn_error_t *
+get_delta_cache_key(const char **key,
+                    svn_checksum_t **t_checksum,
+                    svn_fs_root_t *s_root,
+                    const char *s_path,
+                    svn_fs_root_t *t_root,
+                    const char *t_path,
+                    apr_pool_t *pool)
+{
+  svn_checksum_t *s_md5, *s_sha1, *t_sha1;
+
+  *key = NULL;
+
+  /* Don't let the backend calculate missing checksums.  That would often
+     be more expensive than calculating the delta itself.  The MD5 ones
+     are always stored, the SHA1 ones only make the key stronger. */
+  SVN_ERR(svn_fs_file_checksum(&s_md5, svn_checksum_md5, s_root,
+                               s_path, FALSE, pool));
+  if (!s_md5)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_file_checksum(t_checksum, svn_checksum_md5, t_root,
+                               t_path, FALSE, pool));
+  if (!*t_checksum)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_file_checksum(&s_sha1, svn_checksum_sha1, s_root,
+                               s_path, FALSE, pool));
+  SVN_ERR(svn_fs_file_checksum(&t_sha1, svn_checksum_sha1, t_root,
+                               t_path, FALSE, pool));
+
+  *key = apr_pstrcat(pool,
+                     svn_checksum_to_cstring(s_md5, pool), "/",
+                     s_sha1 ? svn_checksum_to_cstring(s_sha1, pool) : "",
+                     ":",
+                     svn_checksum_to_cstring(*t_checksum, pool), "/",
+                     t_sha1 ? svn_checksum_to_cstring(t_sha1, pool) : "",
+                     SVN_VA_NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the text delta from S_ROOT/S_PATH to B->t_root/T_PATH to DHANDLER
+ * and DBATON.  S_PATH may be NULL, in which case the delta is against the
+ * empty file.  Use B->delta_cache if possible.  Use POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+send_file_delta(report_baton_t *b,
+                svn_fs_root_t *s_root,
+                const char *s_path,
+                const char *t_path,
+                svn_txdelta_window_handler_t dhandler,
+                void *dbaton,
+                apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *dstream;
+  const char *key = NULL;
+  svn_checksum_t *t_checksum = NULL;
+  caching_window_baton_t *cwb = NULL;
+
+  /* Deltas against the empty file are just the fulltexts, which the
+     backend caches already. */
+  if (b->delta_cache && s_path)
+    SVN_ERR(get_delta_cache_key(&key, &t_checksum, s_root, s_path,
+                                b->t_root, t_path, pool));
+
+  if (key)
+    {
+      svn_stringbuf_t *svndiff;
+      svn_boolean_t found;
+
+      SVN_ERR(svn_cache__get((void **)&svndiff, &found, b->delta_cache, key,
+                             pool));
+      if (found)
+        {
+          apr_array_header_t *windows;
+          svn_filesize_t t_len;
+
+          SVN_ERR(svn_fs_file_length(&t_len, b->t_root, t_path, pool));
+          SVN_ERR(parse_cached_delta(&windows, svndiff, t_checksum, t_len,
+                                     pool));
+          if (windows)
+            {
+              int i;
+              for (i = 0; i < windows->nelts; ++i)
+                SVN_ERR(dhandler(APR_ARRAY_IDX(windows, i,
+                                               svn_txdelta_window_t *),
+                                 dbaton));
+
+              return svn_error_trace(dhandler(NULL, dbaton));
+            }
+        }
+
+      /* Record the delta while we send it.  Reserve room for the target
+         digest in front of the svndiff data. */
+      cwb = apr_pcalloc(pool, sizeof(*cwb));
+      cwb->dhandler = dhandler;
+      cwb->dbaton = dbaton;
+      cwb->buffer = svn_stringbuf_create_ensure(APR_MD5_DIGESTSIZE, pool);
+      svn_stringbuf_appendfill(cwb->buffer, 0, APR_MD5_DIGESTSIZE);
+      cwb->recording = TRUE;
+      cwb->t_checksum = t_checksum;
+      cwb->cache = b->delta_cache;
+      cwb->key = key;
+      cwb->pool = pool;
+      svn_txdelta_to_svndiff3(&cwb->svndiff_handler, &cwb->svndiff_baton,
+                              svn_stream_from_stringbuf(cwb->buffer, pool),
+                              0, SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+
+      dhandler = caching_window_handler;
+      dbaton = cwb;
+    }
+
+  SVN_ERR(svn_fs_get_file_delta_stream(&dstream, s_root, s_path,
+                                       b->t_root, t_path, pool));
+  if (cwb)
+    cwb->dstream = dstream;
+
+  return svn_error_trace(svn_txdelta_send_txstream(dstream, dhandler, dbaton,
+                                                   pool));
+}
+
 
 /* Make the appropriate edits on FILE_BATON to change its contents and
    properties from those in S_REV/S_PATH to those in B->t_root/T_PATH,
@@ -672,7 +960,6 @@ delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
             apr_pool_t *pool)
 {
   svn_fs_root_t *s_root = NULL;
-  svn_txdelta_stream_t *dstream = NULL;
   svn_checksum_t *s_checksum;
   const char *s_hex_digest = NULL;
   svn_txdelta_window_handler_t dhandler;
@@ -732,9 +1019,8 @@ delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
                 return SVN_NO_ERROR;
             }
 
-          SVN_ERR(svn_fs_get_file_delta_stream(&dstream, s_root, s_path,
-                                               b->t_root, t_path, pool));
-          SVN_ERR(svn_txdelta_send_txstream(dstream, dhandler, dbaton, pool));
+          SVN_ERR(send_file_delta(b, s_root, s_path, t_path,
+                                  dhandler, dbaton, pool));
         }
       else
         SVN_ERR(dhandler(NULL, dbaton));
@@ -1602,6 +1888,7 @@ svn_repos_begin_report3(void **report_baton,
 {
   report_baton_t *b;
   const char *uuid;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
 
   if (depth == svn_depth_exclude)
     return svn_error_create(SVN_ERR_REPOS_BAD_ARGS, NULL,
@@ -1635,6 +1922,19 @@ svn_repos_begin_report3(void **report_baton,
                                           pool);
   b->repos_uuid = svn_string_create(uuid, pool);
 
+  /* All reports on this repository in this process, and in processes
+     sharing the membuffer, may share the cached deltas.  Like the FS
+     caches, distinguish repositories by UUID and path. */
+  if (membuffer && text_deltas)
+    SVN_ERR(svn_cache__create_membuffer_cache(
+                &b->delta_cache, membuffer, NULL, NULL, APR_HASH_KEY_STRING,
+                apr_pstrcat(pool, "svn:repos:delta:", uuid, "/",
+                            svn_fs_path(repos->fs, pool), ":", SVN_VA_NULL),
+                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                FALSE, FALSE, pool, pool));
+  else
+    b->delta_cache = NULL;
+
   /* Hand reporter back to client. */
   *report_baton = b;
   return SVN_NO_ERROR;
@@ -29,6 +29,8 @@
 #include "svn_fs.h"
 #include "svn_config.h"
 
+#include "private/svn_sqlite.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -103,6 +105,9 @@ extern "C" {
 #define SVN_REPOS__CONF_AUTHZ "authz"
 #define SVN_REPOS__CONF_GROUPS "groups"
 
+/* The history index database, in the repository db directory. */
+#define SVN_REPOS__HISTORY_INDEX_DB "history-index.db"
+
 /* The Repository object, created by svn_repos_open2() and
    svn_repos_create(). */
 struct svn_repos_t
@@ -158,6 +163,13 @@ struct svn_repos_t
      lifespan.  (As the svn_repos_t structure tends to be relatively
      long-lived, please be careful regarding this pool's usage.)  */
   apr_pool_t *pool;
+
+  /* The history index database, see history-index.c.  NULL if it has
+     not been opened (yet).  HISTORY_INDEX_CHECKED gets set once we have
+     looked for the database, so that we don't search for a non-existent
+     index over and over again. */
+  svn_sqlite__db_t *history_index_db;
+  svn_boolean_t history_index_checked;
 };
 
 
@@ -387,6 +399,48 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+
+/*** History Index ***/
+
+/* A location in the history of a node. */
+typedef struct svn_repos__history_location_t
+{
+  /* The path of the node in REVISION, starting with '/'. */
+  const char *path;
+  svn_revnum_t revision;
+} svn_repos__history_location_t;
+
+/* Set *LOCATIONS to the svn_repos__history_location_t locations that
+   svn_fs_history_prev2() would report for the node at PATH@PEG_REV in
+   REPOS, youngest first, using the history index of REPOS.  Follow copies
+   unless STRICT is set.  Stop after the first location older than START.
+   Set *COMPLETE if *LOCATIONS covers the whole history of the node.
+
+   If REPOS has no history index or the index does not cover PEG_REV yet,
+   set *LOCATIONS to NULL.
+
+   Allocate the result in RESULT_POOL.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__history_index_get(apr_array_header_t **locations,
+                             svn_boolean_t *complete,
+                             svn_repos_t *repos,
+                             const char *path,
+                             svn_revnum_t peg_rev,
+                             svn_revnum_t start,
+                             svn_boolean_t strict,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* If REPOS has a history index that is up to date up to shortly before
+   NEW_REV, add the revisions up to NEW_REV to it.  Leave indexes that
+   lag further behind alone; those need to be rebuilt.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__history_index_update(svn_repos_t *repos,
+                                svn_revnum_t new_rev,
+                                apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
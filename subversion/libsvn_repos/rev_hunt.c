@@ -1122,9 +1122,12 @@ find_interesting_revisions(apr_array_header_t *path_revisions,
                            apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool, *last_pool;
-  svn_fs_history_t *history;
+  svn_fs_history_t *history = NULL;
   svn_fs_root_t *root;
   svn_node_kind_t kind;
+  apr_array_header_t *locations;
+  svn_boolean_t complete;
+  int i = 0;
 
   /* We switch between two pools while looping, since we need information from
      the last iteration to be available. */
@@ -1139,9 +1142,14 @@ find_interesting_revisions(apr_array_header_t *path_revisions,
       (SVN_ERR_FS_NOT_FILE, NULL, _("'%s' is not a file in revision %ld"),
        path, end);
 
-  /* Open a history object. */
-  SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
-                               scratch_pool));
+  /* Use the history index if there is one.  Otherwise, open a history
+     object. */
+  SVN_ERR(svn_repos__history_index_get(&locations, &complete, repos, path,
+                                       end, start, FALSE,
+                                       scratch_pool, scratch_pool));
+  if (! locations)
+    SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
+                                 scratch_pool));
   while (1)
     {
       struct path_revision *path_rev;
@@ -1151,13 +1159,28 @@ find_interesting_revisions(apr_array_header_t *path_revisions,
 
       svn_pool_clear(iterpool);
 
-      /* Fetch the history object to walk through. */
-      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
-                                   iterpool));
-      if (!history)
-        break;
-      SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
-                                      history, iterpool));
+      if (locations)
+        {
+          const svn_repos__history_location_t *location;
+
+          if (i == locations->nelts)
+            break;
+
+          location = &APR_ARRAY_IDX(locations, i++,
+                                    svn_repos__history_location_t);
+          tmp_path = location->path;
+          tmp_revnum = location->revision;
+        }
+      else
+        {
+          /* Fetch the history object to walk through. */
+          SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
+                                       iterpool));
+          if (!history)
+            break;
+          SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
+                                          history, iterpool));
+        }
 
       /* Check to see if we already saw this path (and it's ancestors) */
       if (include_merged_revisions
@@ -1493,10 +1516,13 @@ get_file_revs_backwards(svn_repos_t *repos,
                         apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool, *last_pool;
-  svn_fs_history_t *history;
+  svn_fs_history_t *history = NULL;
   svn_fs_root_t *root;
   svn_node_kind_t kind;
   struct send_baton sb;
+  apr_array_header_t *locations;
+  svn_boolean_t complete;
+  int i = 0;
 
   /* We switch between two pools while looping and so does the path-rev
      handler for actually reported revisions. We do this as we
@@ -1523,8 +1549,14 @@ get_file_revs_backwards(svn_repos_t *repos,
                              NULL, _("'%s' is not a file in revision %ld"),
                              path, end);
 
-  /* Open a history object. */
-  SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool, iterpool));
+  /* Use the history index if there is one.  Otherwise, open a history
+     object. */
+  SVN_ERR(svn_repos__history_index_get(&locations, &complete, repos, path,
+                                       end, start, FALSE,
+                                       scratch_pool, iterpool));
+  if (! locations)
+    SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
+                                 iterpool));
   while (1)
     {
       struct path_revision *path_rev;
@@ -1533,13 +1565,28 @@ get_file_revs_backwards(svn_repos_t *repos,
 
       svn_pool_clear(iterpool);
 
-      /* Fetch the history object to walk through. */
-      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
-                                   iterpool));
-      if (!history)
-        break;
-      SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
-                                      history, iterpool));
+      if (locations)
+        {
+          const svn_repos__history_location_t *location;
+
+          if (i == locations->nelts)
+            break;
+
+          location = &APR_ARRAY_IDX(locations, i++,
+                                    svn_repos__history_location_t);
+          tmp_path = location->path;
+          tmp_revnum = location->revision;
+        }
+      else
+        {
+          /* Fetch the history object to walk through. */
+          SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
+                                       iterpool));
+          if (!history)
+            break;
+          SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
+                                          history, iterpool));
+        }
 
       /* Check authorization. */
       if (authz_read_func)
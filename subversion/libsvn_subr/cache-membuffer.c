@@ -23,10 +23,18 @@
 
 #include <assert.h>
 #include <apr_md5.h>
+#include <apr_mmap.h>
+#include <apr_portable.h>
 #include <apr_thread_rwlock.h>
 
+#if APR_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 #include "svn_private_config.h"
 #include "svn_hash.h"
 #include "svn_string.h"
@@ -63,8 +71,13 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.
+ *
+ * svn_cache__membuffer_cache_create_shared does the former by placing all
+ * segments in a memory-mapped file.  Everything that gets modified after
+ * creation (see segment_state_t) lives there as well and locks on that
+ * file synchronize the processes.  Because prefix indexes are process-
+ * specific, shared caches always store full keys.
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -129,6 +142,18 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Many threads hitting the same segment will still contend for its lock,
+ * even if they only read.  Full reads are therefore first attempted without
+ * taking any lock: Every segment carries a sequence number that writers
+ * bump when they start and when they finish modifying it (seqlock).  A
+ * reader validates all directory information it uses, copies the item and
+ * then checks that the sequence number did not change in between.  Only if
+ * it did, the reader falls back to the read lock.  Hit counts get updated
+ * atomically and all priority-based promotion is deferred to the next write
+ * that needs to make room, so hits never need exclusive access.  Because
+ * lock-free hits may race with writers, the latter must modify hit counts
+ * through atomic operations as well.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -692,39 +717,13 @@ typedef struct cache_level_t
 
 } cache_level_t;
 
-/* The cache header structure.
+/* The mutable part of a cache segment's header.  For caches shared
+ * between processes, this lives in the shared memory region next to the
+ * segment's directory and data buffer.  Therefore, it must not contain
+ * any pointers.
  */
-struct svn_membuffer_t
+typedef struct segment_state_t
 {
-  /* Number of cache segments. Must be a power of 2.
-     Please note that this structure represents only one such segment
-     and that all segments must / will report the same values here. */
-  apr_uint32_t segment_count;
-
-  /* Collection of prefixes shared among all instances accessing the
-   * same membuffer cache backend.  If a prefix is contained in this
-   * pool then all cache instances using an equal prefix must actually
-   * use the one stored in this pool. */
-  prefix_pool_t *prefix_pool;
-
-  /* The dictionary, GROUP_SIZE * (group_count + spare_group_count)
-   * entries long.  Never NULL.
-   */
-  entry_group_t *directory;
-
-  /* Flag array with group_count / GROUP_INIT_GRANULARITY _bit_ elements.
-   * Allows for efficiently marking groups as "not initialized".
-   */
-  unsigned char *group_initialized;
-
-  /* Size of dictionary in groups. Must be > 0.
-   */
-  apr_uint32_t group_count;
-
-  /* Total number of spare groups.
-   */
-  apr_uint32_t spare_group_count;
-
   /* First recycleable spare group.
    */
   apr_uint32_t first_spare_group;
@@ -735,19 +734,10 @@ struct svn_membuffer_t
    */
   apr_uint32_t max_spare_used;
 
-  /* Pointer to the data buffer, data_size bytes long. Never NULL.
-   */
-  unsigned char *data;
-
   /* Total number of data buffer bytes in use.
    */
   apr_uint64_t data_used;
 
-  /* Largest entry size that we would accept.  For total cache sizes
-   * less than 4TB (sic!), this is determined by the total cache size.
-   */
-  apr_uint64_t max_entry_size;
-
   /* The cache levels, organized as sub-buffers.  Since entries in the
    * DIRECTORY use offsets in DATA for addressing, a cache lookup does
    * not need to know the cache level of a specific item.  Cache levels
@@ -796,6 +786,61 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Modification sequence number.  Writers increment it right after
+   * acquiring the write lock and once more right before releasing it.
+   * Hence, it is odd while the segment is being modified.  A reader
+   * that sees the same even value before and after copying an item
+   * knows that its copy is consistent; see membuffer_cache_get_optimistic.
+   */
+  volatile svn_atomic_t write_sequence;
+} segment_state_t;
+
+/* The cache header structure.
+ */
+struct svn_membuffer_t
+{
+  /* Number of cache segments. Must be a power of 2.
+     Please note that this structure represents only one such segment
+     and that all segments must / will report the same values here. */
+  apr_uint32_t segment_count;
+
+  /* Collection of prefixes shared among all instances accessing the
+   * same membuffer cache backend.  If a prefix is contained in this
+   * pool then all cache instances using an equal prefix must actually
+   * use the one stored in this pool. */
+  prefix_pool_t *prefix_pool;
+
+  /* The dictionary, GROUP_SIZE * (group_count + spare_group_count)
+   * entries long.  Never NULL.
+   */
+  entry_group_t *directory;
+
+  /* Flag array with group_count / GROUP_INIT_GRANULARITY _bit_ elements.
+   * Allows for efficiently marking groups as "not initialized".
+   */
+  unsigned char *group_initialized;
+
+  /* Size of dictionary in groups. Must be > 0.
+   */
+  apr_uint32_t group_count;
+
+  /* Total number of spare groups.
+   */
+  apr_uint32_t spare_group_count;
+
+  /* Pointer to the data buffer, data_size bytes long. Never NULL.
+   */
+  unsigned char *data;
+
+  /* Largest entry size that we would accept.  For total cache sizes
+   * less than 4TB (sic!), this is determined by the total cache size.
+   */
+  apr_uint64_t max_entry_size;
+
+  /* Everything that changes when modifying this segment.  Never NULL.
+   */
+  segment_state_t *state;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -805,13 +850,35 @@ struct svn_membuffer_t
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   /* Same for read-write lock. */
   apr_thread_rwlock_t *lock;
+#endif
 
   /* If set, write access will wait until they get exclusive access.
    * Otherwise, they will become no-ops if the segment is currently
-   * read-locked.  Only used when LOCK is an r/w lock.
+   * read-locked.  Only used when LOCK is an r/w lock or for shared caches.
    */
   svn_boolean_t allow_blocking_writes;
-#endif
+
+  /* The memory-mapped file containing all segments, if this cache is
+   * shared between processes.  NULL for process-local caches.
+   * Region locks on this file synchronize access across processes.
+   */
+  apr_file_t *shared_file;
+
+  /* The region of SHARED_FILE that belongs to this segment.  Only the
+   * lock on this region is needed to access the segment.
+   */
+  apr_off_t shared_offset;
+  apr_off_t shared_length;
+
+  /* Number of threads in this process holding a read lock on this
+   * segment.  They all share the same shared lock on the region.
+   */
+  int shared_readers;
+
+  /* Serializes access to SHARED_READERS and the region lock for readers.
+   * Taken after LOCK.
+   */
+  svn_mutex__t *shared_mutex;
 
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
@@ -823,13 +890,333 @@ struct svn_membuffer_t
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Reset the segment CACHE to "empty".  The caller must hold the write
+ * lock.
+ */
+static void
+clear_segment(svn_membuffer_t *cache)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (cache->group_count + cache->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  cache->state->first_spare_group = NO_INDEX;
+  cache->state->max_spare_used = 0;
+
+  memset(cache->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  cache->state->l1.first = NO_INDEX;
+  cache->state->l1.last = NO_INDEX;
+  cache->state->l1.next = NO_INDEX;
+  cache->state->l1.current_data = cache->state->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  cache->state->l2.first = NO_INDEX;
+  cache->state->l2.last = NO_INDEX;
+  cache->state->l2.next = NO_INDEX;
+  cache->state->l2.current_data = cache->state->l2.start_offset;
+
+  /* Reset content counters. */
+  cache->state->data_used = 0;
+  cache->state->used_entries = 0;
+}
+
+/* Region locks on shared cache files.
+ *
+ * Every segment of a shared cache gets locked through a byte-range lock
+ * on its own region of the file.  Hence, different segments can be used
+ * concurrently, even across processes.  The file header has a region of
+ * its own, used to serialize the initialization of the file.
+ *
+ * Where available, we use locks that are owned by the file handle (OFD
+ * locks on Linux, LockFileEx on Windows).  Classic POSIX record locks are
+ * owned by the process instead and closing *any* handle to the file drops
+ * all of them.  We never close shared cache files early in that case.
+ *
+ * In either case, the region locks don't synchronize the threads that
+ * use the same handle.  That is what the segment's LOCK is for.
+ */
+#if defined(WIN32) || defined(F_OFD_SETLK)
+#define REGION_LOCKS_PER_HANDLE 1
+#else
+#define REGION_LOCKS_PER_HANDLE 0
+#endif
+
+/* Lock the LENGTH bytes at OFFSET in FILE.  LOCKTYPE is a combination of
+ * APR_FLOCK_* flags like for apr_file_lock.  If APR_FLOCK_NONBLOCK has
+ * been given and the region is locked by someone else, return a status
+ * for which APR_STATUS_IS_EAGAIN holds.
+ */
+static apr_status_t
+lock_file_region(apr_file_t *file,
+                 apr_off_t offset,
+                 apr_off_t length,
+                 int locktype)
+{
+  svn_boolean_t exclusive
+    = (locktype & APR_FLOCK_TYPEMASK) == APR_FLOCK_EXCLUSIVE;
+  svn_boolean_t nonblocking = (locktype & APR_FLOCK_NONBLOCK) != 0;
+
+#ifdef WIN32
+  HANDLE handle;
+  OVERLAPPED overlapped = { 0 };
+  DWORD flags = 0;
+
+  apr_os_file_get(&handle, file);
+  overlapped.Offset = (DWORD)offset;
+  overlapped.OffsetHigh = (DWORD)((apr_uint64_t)offset >> 32);
+
+  if (exclusive)
+    flags |= LOCKFILE_EXCLUSIVE_LOCK;
+  if (nonblocking)
+    flags |= LOCKFILE_FAIL_IMMEDIATELY;
+
+  if (!LockFileEx(handle, flags, 0, (DWORD)length,
+                  (DWORD)((apr_uint64_t)length >> 32), &overlapped))
+    return apr_get_os_error();
+
+  return APR_SUCCESS;
+#else
+  apr_os_file_t fd;
+  struct flock lock = { 0 };
+#ifdef F_OFD_SETLK
+  int cmd = nonblocking ? F_OFD_SETLK : F_OFD_SETLKW;
+#else
+  int cmd = nonblocking ? F_SETLK : F_SETLKW;
+#endif
+
+  apr_os_file_get(&fd, file);
+  lock.l_type = exclusive ? F_WRLCK : F_RDLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = offset;
+  lock.l_len = length;
+
+  while (fcntl(fd, cmd, &lock) < 0)
+    {
+      apr_status_t status = apr_get_os_error();
+      if (APR_STATUS_IS_EINTR(status))
+        continue;
+
+      /* Some platforms report conflicting locks as EACCES. */
+      if (APR_STATUS_IS_EACCES(status))
+        return APR_EAGAIN;
+
+      return status;
+    }
+
+  return APR_SUCCESS;
+#endif
+}
+
+/* Release the lock on the LENGTH bytes at OFFSET in FILE.
+ */
+static apr_status_t
+unlock_file_region(apr_file_t *file,
+                   apr_off_t offset,
+                   apr_off_t length)
+{
+#ifdef WIN32
+  HANDLE handle;
+  OVERLAPPED overlapped = { 0 };
+
+  apr_os_file_get(&handle, file);
+  overlapped.Offset = (DWORD)offset;
+  overlapped.OffsetHigh = (DWORD)((apr_uint64_t)offset >> 32);
+
+  if (!UnlockFileEx(handle, 0, (DWORD)length,
+                    (DWORD)((apr_uint64_t)length >> 32), &overlapped))
+    return apr_get_os_error();
+
+  return APR_SUCCESS;
+#else
+  apr_os_file_t fd;
+  struct flock lock = { 0 };
+#ifdef F_OFD_SETLK
+  int cmd = F_OFD_SETLK;
+#else
+  int cmd = F_SETLK;
+#endif
+
+  apr_os_file_get(&fd, file);
+  lock.l_type = F_UNLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = offset;
+  lock.l_len = length;
+
+  if (fcntl(fd, cmd, &lock) < 0)
+    return apr_get_os_error();
+
+  return APR_SUCCESS;
+#endif
+}
+
+/* Acquire the cross-process lock on the region of the shared segment
+ * CACHE.  Get an exclusive lock if EXCLUSIVE is set and a shared one
+ * otherwise.  If NONBLOCKING is set and some other process holds a
+ * conflicting lock, set *SUCCESS to FALSE and return without holding
+ * any lock.  Leave *SUCCESS untouched otherwise.
+ *
+ * A process may have died while modifying the segment, leaving it in an
+ * inconsistent state.  We detect that by an odd write sequence number
+ * and clear the segment before handing it out.
+ *
+ * The caller must make sure that no other thread in this process holds
+ * or acquires the region lock at the same time.
+ */
+static svn_error_t *
+lock_segment_region(svn_membuffer_t *cache,
+                    svn_boolean_t exclusive,
+                    svn_boolean_t nonblocking,
+                    svn_boolean_t *success)
+{
+  apr_status_t status;
+  int locktype = exclusive ? APR_FLOCK_EXCLUSIVE : APR_FLOCK_SHARED;
+  if (nonblocking)
+    locktype |= APR_FLOCK_NONBLOCK;
+
+  while (TRUE)
+    {
+      status = lock_file_region(cache->shared_file, cache->shared_offset,
+                                cache->shared_length, locktype);
+      if (status)
+        {
+          if (nonblocking && APR_STATUS_IS_EAGAIN(status))
+            {
+              *success = FALSE;
+              return SVN_NO_ERROR;
+            }
+
+          break;
+        }
+
+      /* Nobody left the segment in an inconsistent state?
+       * Then, we are done. */
+      if ((svn_atomic_read(&cache->state->write_sequence) & 1) == 0)
+        return SVN_NO_ERROR;
+
+      /* Recovery requires the exclusive lock. */
+      if (!exclusive)
+        {
+          status = unlock_file_region(cache->shared_file,
+                                      cache->shared_offset,
+                                      cache->shared_length);
+          if (!status)
+            status = lock_file_region(cache->shared_file,
+                                      cache->shared_offset,
+                                      cache->shared_length,
+                                      APR_FLOCK_EXCLUSIVE);
+          if (status)
+            break;
+        }
+
+      /* We own the segment now.  Hence, the last writer is gone. */
+      if (svn_atomic_read(&cache->state->write_sequence) & 1)
+        {
+          clear_segment(cache);
+          svn_atomic_inc(&cache->state->write_sequence);
+        }
+
+      if (exclusive)
+        return SVN_NO_ERROR;
+
+      /* Try again with the lock we actually want. */
+      status = unlock_file_region(cache->shared_file, cache->shared_offset,
+                                  cache->shared_length);
+      if (status)
+        break;
+    }
+
+  return svn_error_wrap_apr(status, _("Can't lock shared cache file"));
+}
+
+/* For the shared segment CACHE, acquire the cross-process lock matching
+ * the in-process lock that the caller already holds.  EXCLUSIVE,
+ * NONBLOCKING and *SUCCESS are the same as for lock_segment_region.
+ *
+ * Threads holding the in-process read lock share one region lock.
+ * The first of them acquires it, the last one releases it.
+ */
+static svn_error_t *
+lock_shared_segment(svn_membuffer_t *cache,
+                    svn_boolean_t exclusive,
+                    svn_boolean_t nonblocking,
+                    svn_boolean_t *success)
+{
+  svn_error_t *err;
+
+  /* Writers are alone in this process already. */
+  if (exclusive)
+    return svn_error_trace(lock_segment_region(cache, TRUE, nonblocking,
+                                               success));
+
+  SVN_ERR(svn_mutex__lock(cache->shared_mutex));
+  if (cache->shared_readers++ > 0)
+    return svn_mutex__unlock(cache->shared_mutex, SVN_NO_ERROR);
+
+  err = lock_segment_region(cache, FALSE, FALSE, success);
+  if (err)
+    cache->shared_readers--;
+
+  return svn_mutex__unlock(cache->shared_mutex, err);
+}
+
+/* Release the cross-process lock on the shared segment CACHE acquired by
+ * lock_shared_segment.  Return ERR upon success.
+ */
+static svn_error_t *
+unlock_shared_segment(svn_membuffer_t *cache, svn_error_t *err)
+{
+  apr_status_t status = APR_SUCCESS;
+  svn_error_t *mutex_err = svn_mutex__lock(cache->shared_mutex);
+  if (mutex_err)
+    return svn_error_compose_create(err, mutex_err);
+
+  /* Writers never share the region lock. */
+  if (cache->shared_readers == 0 || --cache->shared_readers == 0)
+    status = unlock_file_region(cache->shared_file, cache->shared_offset,
+                                cache->shared_length);
+
+  if (status && !err)
+    err = svn_error_wrap_apr(status, _("Can't unlock shared cache file"));
+
+  return svn_mutex__unlock(cache->shared_mutex, err);
+}
+
+/* Release the in-process lock on CACHE.  Return ERR upon success.
+ */
+static svn_error_t *
+unlock_segment_lock(svn_membuffer_t *cache, svn_error_t *err)
+{
+#if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
+  return svn_mutex__unlock(cache->lock, err);
+#elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
+  if (cache->lock)
+  {
+    apr_status_t status = apr_thread_rwlock_unlock(cache->lock);
+    if (err)
+      return err;
+
+    if (status)
+      return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+  }
+
+  return err;
+#else
+  return err;
+#endif
+}
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
-  return svn_mutex__lock(cache->lock);
+  SVN_ERR(svn_mutex__lock(cache->lock));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   if (cache->lock)
   {
@@ -837,11 +1224,17 @@ read_lock_cache(svn_membuffer_t *cache)
     if (status)
       return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
   }
+#endif
+
+  if (cache->shared_file)
+    {
+      svn_boolean_t success = TRUE;
+      svn_error_t *err = lock_shared_segment(cache, FALSE, FALSE, &success);
+      if (err)
+        return svn_error_trace(unlock_segment_lock(cache, err));
+    }
 
   return SVN_NO_ERROR;
-#else
-  return SVN_NO_ERROR;
-#endif
 }
 
 /* If locking is supported for CACHE, acquire a write lock for it.
@@ -852,7 +1245,7 @@ static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
-  return svn_mutex__lock(cache->lock);
+  SVN_ERR(svn_mutex__lock(cache->lock));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   if (cache->lock)
     {
@@ -875,11 +1268,18 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
         return svn_error_wrap_apr(status,
                                   _("Can't write-lock cache mutex"));
     }
+#endif
+
+  if (cache->shared_file && *success)
+    {
+      svn_error_t *err = lock_shared_segment(cache, TRUE,
+                                             !cache->allow_blocking_writes,
+                                             success);
+      if (err || !*success)
+        return svn_error_trace(unlock_segment_lock(cache, err));
+    }
 
   return SVN_NO_ERROR;
-#else
-  return SVN_NO_ERROR;
-#endif
 }
 
 /* If locking is supported for CACHE, acquire an unconditional write lock
@@ -889,17 +1289,26 @@ static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
-  return svn_mutex__lock(cache->lock);
+  SVN_ERR(svn_mutex__lock(cache->lock));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  if (cache->lock)
+    {
+      apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+    }
+#endif
+
+  if (cache->shared_file)
+    {
+      svn_boolean_t success = TRUE;
+      svn_error_t *err = lock_shared_segment(cache, TRUE, FALSE, &success);
+      if (err)
+        return svn_error_trace(unlock_segment_lock(cache, err));
+    }
 
   return SVN_NO_ERROR;
-#else
-  return SVN_NO_ERROR;
-#endif
 }
 
 /* If locking is supported for CACHE, release the current lock
@@ -908,23 +1317,29 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
-#if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
-  return svn_mutex__unlock(cache->lock, err);
-#elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  if (cache->lock)
-  {
-    apr_status_t status = apr_thread_rwlock_unlock(cache->lock);
-    if (err)
-      return err;
+  if (cache->shared_file)
+    err = unlock_shared_segment(cache, err);
 
-    if (status)
-      return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
-  }
+  return unlock_segment_lock(cache, err);
+}
 
-  return err;
-#else
-  return err;
-#endif
+/* Mark the beginning of a modification of CACHE.  The caller must hold
+ * the write lock.
+ */
+static APR_INLINE void
+begin_modification(svn_membuffer_t *cache)
+{
+  svn_atomic_inc(&cache->state->write_sequence);
+}
+
+/* Mark the end of a modification of CACHE and release its write lock.
+ * Return ERR upon success.
+ */
+static svn_error_t *
+write_unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
+{
+  svn_atomic_inc(&cache->state->write_sequence);
+  return unlock_cache(cache, err);
 }
 
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
@@ -959,7 +1374,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_modification(cache);                                    \
+  SVN_ERR(write_unlock_cache(cache, (expr)));                   \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1017,17 +1433,18 @@ allocate_spare_group(svn_membuffer_t *cache)
   entry_group_t *group = NULL;
 
   /* is there some ready-to-use group? */
-  if (cache->first_spare_group != NO_INDEX)
+  if (cache->state->first_spare_group != NO_INDEX)
     {
-      group = &cache->directory[cache->first_spare_group];
-      cache->first_spare_group = group->header.next;
+      group = &cache->directory[cache->state->first_spare_group];
+      cache->state->first_spare_group = group->header.next;
     }
 
   /* any so far untouched spares available? */
-  else if (cache->max_spare_used < cache->spare_group_count)
+  else if (cache->state->max_spare_used < cache->spare_group_count)
     {
-      apr_uint32_t group_index = cache->group_count + cache->max_spare_used;
-      ++cache->max_spare_used;
+      apr_uint32_t group_index
+        = cache->group_count + cache->state->max_spare_used;
+      ++cache->state->max_spare_used;
 
       if (!is_group_initialized(cache, group_index))
         initialize_group(cache, group_index);
@@ -1056,8 +1473,8 @@ free_spare_group(svn_membuffer_t *cache,
   group->header.previous = NO_INDEX;
 
   /* add to chain of spares */
-  group->header.next = cache->first_spare_group;
-  cache->first_spare_group = (apr_uint32_t) (group - cache->directory);
+  group->header.next = cache->state->first_spare_group;
+  cache->state->first_spare_group = (apr_uint32_t) (group - cache->directory);
 }
 
 /* Follow the group chain from GROUP in CACHE to its end and return the last
@@ -1114,8 +1531,8 @@ get_index(svn_membuffer_t *cache, entry_t *entry)
 static cache_level_t *
 get_cache_level(svn_membuffer_t *cache, entry_t *entry)
 {
-  return entry->offset < cache->l1.size ? &cache->l1
-                                        : &cache->l2;
+  return entry->offset < cache->state->l1.size ? &cache->state->l1
+                                        : &cache->state->l2;
 }
 
 /* Insert ENTRY to the chain of items that belong to LEVEL in CACHE.  IDX
@@ -1219,8 +1636,8 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
 
   /* update global cache usage counters
    */
-  cache->used_entries--;
-  cache->data_used -= entry->size;
+  cache->state->used_entries--;
+  cache->state->data_used -= entry->size;
 
   /* extend the insertion window, if the entry happens to border it
    */
@@ -1312,9 +1729,9 @@ insert_entry(svn_membuffer_t *cache, entry_t *entry)
 
   /* update usage counters
    */
-  cache->used_entries++;
-  cache->data_used += entry->size;
-  entry->hit_count = 0;
+  cache->state->used_entries++;
+  cache->state->data_used += entry->size;
+  svn_atomic_set(&entry->hit_count, 0);
   group->header.used++;
 
   /* update entry chain
@@ -1353,11 +1770,21 @@ get_group_index(svn_membuffer_t **cache,
 static APR_INLINE void
 let_entry_age(svn_membuffer_t *cache, entry_t *entry)
 {
-  apr_uint32_t hits_removed = (entry->hit_count + 1) >> 1;
+  apr_uint32_t hit_count = svn_atomic_read(&entry->hit_count);
+  apr_uint32_t hits_removed = (hit_count + 1) >> 1;
 
   if (hits_removed)
     {
-      entry->hit_count -= hits_removed;
+      /* Lock-free readers may count hits concurrently.  Retry with the
+       * new value instead of overwriting their updates. */
+      apr_uint32_t old_count;
+      while ((old_count = svn_atomic_cas(&entry->hit_count,
+                                         hit_count - hits_removed,
+                                         hit_count)) != hit_count)
+        {
+          hit_count = old_count;
+          hits_removed = (hit_count + 1) >> 1;
+        }
     }
   else
     {
@@ -1522,7 +1949,7 @@ find_entry(svn_membuffer_t *cache,
 
               cache_level_t *level
                 = get_cache_level(cache, &to_shrink->entries[i]);
-              if (   (level != entry_level && entry_level == &cache->l1)
+              if (   (level != entry_level && entry_level == &cache->state->l1)
                   || (entry->hit_count > to_shrink->entries[i].hit_count))
                 {
                   entry_level = level;
@@ -1597,24 +2024,24 @@ promote_entry(svn_membuffer_t *cache, entry_t *entry)
 {
   apr_uint32_t idx = get_index(cache, entry);
   apr_size_t size = ALIGN_VALUE(entry->size);
-  assert(get_cache_level(cache, entry) == &cache->l1);
-  assert(idx == cache->l1.next);
+  assert(get_cache_level(cache, entry) == &cache->state->l1);
+  assert(idx == cache->state->l1.next);
 
   /* copy item from the current location in L1 to the start of L2's
    * insertion window */
-  memmove(cache->data + cache->l2.current_data,
+  memmove(cache->data + cache->state->l2.current_data,
           cache->data + entry->offset,
           size);
-  entry->offset = cache->l2.current_data;
+  entry->offset = cache->state->l2.current_data;
 
   /* The insertion position is now directly behind this entry.
    */
-  cache->l2.current_data += size;
+  cache->state->l2.current_data += size;
 
   /* remove ENTRY from chain of L1 entries and put it into L2
    */
-  unchain_entry(cache, &cache->l1, entry, idx);
-  chain_entry(cache, &cache->l2, entry, idx);
+  unchain_entry(cache, &cache->state->l1, entry, idx);
+  chain_entry(cache, &cache->state->l2, entry, idx);
 }
 
 /* This function implements the cache insertion / eviction strategy for L2.
@@ -1664,13 +2091,13 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
     {
       /* first offset behind the insertion window
        */
-      apr_uint64_t end = cache->l2.next == NO_INDEX
-                       ? cache->l2.start_offset + cache->l2.size
-                       : get_entry(cache, cache->l2.next)->offset;
+      apr_uint64_t end = cache->state->l2.next == NO_INDEX
+                       ? cache->state->l2.start_offset + cache->state->l2.size
+                       : get_entry(cache, cache->state->l2.next)->offset;
 
       /* leave function as soon as the insertion window is large enough
        */
-      if (end - cache->l2.current_data >= to_fit_in->size)
+      if (end - cache->state->l2.current_data >= to_fit_in->size)
         return TRUE;
 
       /* Don't be too eager to cache data.  If a lot of data has been moved
@@ -1689,20 +2116,20 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
 
       /* try to enlarge the insertion window
        */
-      if (cache->l2.next == NO_INDEX)
+      if (cache->state->l2.next == NO_INDEX)
         {
           /* We reached the end of the data buffer; restart at the beginning.
            * Due to the randomized nature of our LFU implementation, very
            * large data items may require multiple passes. Therefore, SIZE
            * should be restricted to significantly less than data_size.
            */
-          cache->l2.current_data = cache->l2.start_offset;
-          cache->l2.next = cache->l2.first;
+          cache->state->l2.current_data = cache->state->l2.start_offset;
+          cache->state->l2.next = cache->state->l2.first;
         }
       else
         {
           svn_boolean_t keep;
-          entry = get_entry(cache, cache->l2.next);
+          entry = get_entry(cache, cache->state->l2.next);
 
           if (to_fit_in->priority < SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
             {
@@ -1777,7 +2204,7 @@ static svn_boolean_t
 ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
 {
   /* Guarantees that the while loop will terminate. */
-  if (size > cache->l1.size)
+  if (size > cache->state->l1.size)
     return FALSE;
 
   /* This loop will eventually terminate because every cache entry
@@ -1787,28 +2214,28 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
     {
       /* first offset behind the insertion window
        */
-      apr_uint32_t entry_index = cache->l1.next;
+      apr_uint32_t entry_index = cache->state->l1.next;
       entry_t *entry = get_entry(cache, entry_index);
-      apr_uint64_t end = cache->l1.next == NO_INDEX
-                       ? cache->l1.start_offset + cache->l1.size
+      apr_uint64_t end = cache->state->l1.next == NO_INDEX
+                       ? cache->state->l1.start_offset + cache->state->l1.size
                        : entry->offset;
 
       /* leave function as soon as the insertion window is large enough
        */
-      if (end - cache->l1.current_data >= size)
+      if (end - cache->state->l1.current_data >= size)
         return TRUE;
 
       /* Enlarge the insertion window
        */
-      if (cache->l1.next == NO_INDEX)
+      if (cache->state->l1.next == NO_INDEX)
         {
           /* We reached the end of the data buffer; restart at the beginning.
            * Due to the randomized nature of our LFU implementation, very
            * large data items may require multiple passes. Therefore, SIZE
            * should be restricted to significantly less than data_size.
            */
-          cache->l1.current_data = cache->l1.start_offset;
-          cache->l1.next = cache->l1.first;
+          cache->state->l1.current_data = cache->state->l1.start_offset;
+          cache->state->l1.next = cache->state->l1.first;
         }
       else
         {
@@ -1818,7 +2245,7 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
           svn_boolean_t keep = ensure_data_insertable_l2(cache, entry);
 
           /* We might have touched the group that contains ENTRY. Recheck. */
-          if (entry_index == cache->l1.next)
+          if (entry_index == cache->state->l1.next)
             {
               if (keep)
                 promote_entry(cache, entry);
@@ -1832,14 +2259,198 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Header of a memory-mapped file containing a shared membuffer cache.
+ * It describes the layout of the segments that follow it.  Processes
+ * can only share a cache file if they agree on all of these values.
+ */
+typedef struct shared_file_header_t
+{
+  /* SHARED_FILE_MAGIC once the file has been fully initialized.
+   * 0 for new files. */
+  apr_uint64_t magic;
+
+  /* Sizes of the structures stored in the file.  Different builds may
+   * disagree here. */
+  apr_uint64_t state_size;
+  apr_uint64_t group_size;
+
+  /* The segment layout as derived from the cache size parameters. */
+  apr_uint64_t segment_count;
+  apr_uint64_t group_count;
+  apr_uint64_t spare_group_count;
+  apr_uint64_t data_size;
+  apr_uint64_t max_entry_size;
+} shared_file_header_t;
+
+/* Marks a fully initialized shared cache file. ("SVNMBUF1") */
+#define SHARED_FILE_MAGIC APR_UINT64_C(0x53564e4d42554631)
+
+/* All parts of a shared cache file get aligned to this boundary such that
+ * no directory group crosses memory page boundaries.
+ */
+#define SHARED_FILE_ALIGNMENT GROUP_BLOCK_SIZE
+
+/* Size of the file region reserved for the shared_file_header_t.
+ * The segments follow immediately.
+ */
+#define SHARED_FILE_HEADER_SIZE \
+  APR_ALIGN(sizeof(shared_file_header_t), SHARED_FILE_ALIGNMENT)
+
+#if APR_HAS_MMAP
+
+/* Map all FILE_SIZE bytes of the shared cache FILE at PATH into memory
+ * and return its first byte in *REGION.  Empty files will be resized
+ * accordingly.  Set *INITIALIZE if FILE does not contain a cache, yet.
+ * Otherwise, verify that its header matches LAYOUT.  The caller must hold
+ * an exclusive lock on FILE.  Allocate everything in POOL.
+ */
+static svn_error_t *
+map_shared_file(unsigned char **region,
+                svn_boolean_t *initialize,
+                apr_file_t *file,
+                const char *path,
+                const shared_file_header_t *layout,
+                apr_size_t file_size,
+                apr_pool_t *pool)
+{
+  apr_finfo_t finfo;
+  apr_mmap_t *mmap;
+  shared_file_header_t *header;
+  apr_status_t status;
+
+  /* New files get extended with zeros, i.e. all groups are "not
+   * initialized", which is exactly what we need. */
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, pool));
+  if (finfo.size == 0)
+    SVN_ERR(svn_io_file_trunc(file, file_size, pool));
+  else if (finfo.size != (apr_off_t)file_size)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("Shared cache file '%s' has been created "
+                               "for a different cache size"),
+                             svn_dirent_local_style(path, pool));
+
+  status = apr_mmap_create(&mmap, file, 0, file_size,
+                           APR_MMAP_READ | APR_MMAP_WRITE, pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't map shared cache file '%s'"),
+                              svn_dirent_local_style(path, pool));
+
+  header = mmap->mm;
+  *region = mmap->mm;
+  *initialize = header->magic == 0;
+
+  if (   !*initialize
+      && (   header->magic != SHARED_FILE_MAGIC
+          || memcmp(&header->state_size, &layout->state_size,
+                    sizeof(*header) - sizeof(header->magic)) != 0))
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("Shared cache file '%s' has been created "
+                               "with incompatible settings"),
+                             svn_dirent_local_style(path, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open or create the shared cache file at PATH, map all of its FILE_SIZE
+ * bytes into memory and return its first byte in *REGION and the open
+ * file in *FILE.  LAYOUT is the header that the file shall have.
+ *
+ * Set *INITIALIZE if the file does not contain a cache, yet.  In that
+ * case, the caller must initialize all segment states and then call
+ * close_shared_file_init.  Either way, we return with an exclusive lock
+ * on the header region of *FILE that close_shared_file_init will release.
+ *
+ * Allocate everything in POOL, which must outlive the cache.
+ */
+static svn_error_t *
+open_shared_file(apr_file_t **file,
+                 unsigned char **region,
+                 svn_boolean_t *initialize,
+                 const char *path,
+                 const shared_file_header_t *layout,
+                 apr_size_t file_size,
+                 apr_pool_t *pool)
+{
+  svn_error_t *err;
+  apr_status_t status;
+
+  SVN_ERR(svn_io_file_open(file, path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, pool));
+
+  /* Only one process may initialize the file. */
+  status = lock_file_region(*file, 0, SHARED_FILE_HEADER_SIZE,
+                            APR_FLOCK_EXCLUSIVE);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't lock shared cache file '%s'"),
+                              svn_dirent_local_style(path, pool));
+
+  err = map_shared_file(region, initialize, *file, path, layout,
+                        file_size, pool);
+  if (err)
+    {
+      status = unlock_file_region(*file, 0, SHARED_FILE_HEADER_SIZE);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status,
+                                   _("Can't unlock shared cache file")));
+
+      /* With process-owned locks, closing the file would also drop the
+       * locks that other caches in this process hold on it.  Leave the
+       * file to POOL in that case. */
+      if (REGION_LOCKS_PER_HANDLE)
+        err = svn_error_compose_create(err, svn_io_file_close(*file, pool));
+
+      return err;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Complete the initialization started by open_shared_file for the
+ * shared cache FILE mapped to REGION.  If INITIALIZE is set, mark the
+ * file as fully initialized with the given LAYOUT.
+ */
+static svn_error_t *
+close_shared_file_init(apr_file_t *file,
+                       unsigned char *region,
+                       svn_boolean_t initialize,
+                       const shared_file_header_t *layout)
+{
+  apr_status_t status;
+
+  if (initialize)
+    {
+      shared_file_header_t *header = (shared_file_header_t *)region;
+      *header = *layout;
+      header->magic = SHARED_FILE_MAGIC;
+    }
+
+  status = unlock_file_region(file, 0, SHARED_FILE_HEADER_SIZE);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't unlock shared cache file"));
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  SHARED_PATH is NULL for
+ * process-local caches.  All other parameters are the same as for
+ * those functions.
+ */
+static svn_error_t *
+create_membuffer(svn_membuffer_t **cache,
+                 const char *shared_path,
+                 apr_size_t total_size,
+                 apr_size_t directory_size,
+                 apr_size_t segment_count,
+                 svn_boolean_t thread_safe,
+                 svn_boolean_t allow_blocking_writes,
+                 apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
@@ -1852,10 +2463,22 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
+  apr_file_t *shared_file = NULL;
+  unsigned char *shared_region = NULL;
+  svn_boolean_t initialize = TRUE;
+  shared_file_header_t layout = { 0 };
+  apr_uint64_t state_block = 0;
+  apr_uint64_t init_block = 0;
+  apr_uint64_t directory_block = 0;
+  apr_uint64_t segment_block = 0;
+
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   * Prefix indexes are only valid within the current process, though.
+   * So, shared caches must not use them.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
+  SVN_ERR(prefix_pool_create(&prefix_pool,
+                             shared_path ? 0 : total_size / 100,
+                             thread_safe, pool));
   total_size -= total_size / 100;
 
   /* Limit the total size (only relevant if we can address > 4GB)
@@ -1963,6 +2586,45 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Map the shared cache file.  It contains a header followed by the
+   * segments, each one being its state, init flags, directory and data
+   * buffer in that order.
+   */
+  if (shared_path)
+    {
+#if APR_HAS_MMAP
+      apr_uint64_t file_size;
+
+      layout.state_size = sizeof(segment_state_t);
+      layout.group_size = sizeof(entry_group_t);
+      layout.segment_count = segment_count;
+      layout.group_count = main_group_count;
+      layout.spare_group_count = spare_group_count;
+      layout.data_size = data_size;
+      layout.max_entry_size = max_entry_size;
+
+      state_block = APR_ALIGN(sizeof(segment_state_t),
+                              SHARED_FILE_ALIGNMENT);
+      init_block = APR_ALIGN(group_init_size, SHARED_FILE_ALIGNMENT);
+      directory_block = group_count * (apr_uint64_t)sizeof(entry_group_t);
+      segment_block = state_block + init_block + directory_block
+                    + APR_ALIGN(ALIGN_VALUE(data_size), SHARED_FILE_ALIGNMENT);
+      file_size = SHARED_FILE_HEADER_SIZE + segment_count * segment_block;
+
+      if (file_size > APR_SIZE_MAX)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      SVN_ERR(open_shared_file(&shared_file, &shared_region, &initialize,
+                               shared_path, &layout, (apr_size_t)file_size,
+                               pool));
+#else
+      return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                              _("Shared caches require memory-mapped "
+                                "file support"));
+#endif
+    }
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1972,57 +2634,98 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 
       c[seg].group_count = main_group_count;
       c[seg].spare_group_count = spare_group_count;
-      c[seg].first_spare_group = NO_INDEX;
-      c[seg].max_spare_used = 0;
 
-      /* Allocate but don't clear / zero the directory because it would add
-         significantly to the server start-up time if the caches are large.
-         Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      if (shared_region)
+        {
+          apr_uint64_t segment_offset = SHARED_FILE_HEADER_SIZE
+                                      + seg * segment_block;
+          unsigned char *segment = shared_region + segment_offset;
+
+          c[seg].shared_offset = (apr_off_t)segment_offset;
+          c[seg].shared_length = (apr_off_t)segment_block;
+
+          c[seg].state = (segment_state_t *)segment;
+          c[seg].group_initialized = segment + state_block;
+          c[seg].directory
+            = (entry_group_t *)(segment + state_block + init_block);
+          c[seg].data = segment + state_block + init_block + directory_block;
+
+          /* A previous initialization attempt may have died half-way. */
+          if (initialize)
+            memset(c[seg].group_initialized, 0, group_init_size);
+        }
+      else
+        {
+          c[seg].state = apr_pcalloc(pool, sizeof(*c[seg].state));
 
-      /* Allocate and initialize directory entries as "not initialized",
-         hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+          /* Allocate but don't clear / zero the directory because it
+             would add significantly to the server start-up time if the
+             caches are large.  Group initialization will take care of
+             that in stead. */
+          c[seg].directory = apr_palloc(pool,
+                                        group_count * sizeof(entry_group_t));
 
-      /* Allocate 1/4th of the data buffer to L1
-       */
-      c[seg].l1.first = NO_INDEX;
-      c[seg].l1.last = NO_INDEX;
-      c[seg].l1.next = NO_INDEX;
-      c[seg].l1.start_offset = 0;
-      c[seg].l1.size = ALIGN_VALUE(data_size / 4);
-      c[seg].l1.current_data = 0;
-
-      /* The remaining 3/4th will be used as L2
-       */
-      c[seg].l2.first = NO_INDEX;
-      c[seg].l2.last = NO_INDEX;
-      c[seg].l2.next = NO_INDEX;
-      c[seg].l2.start_offset = c[seg].l1.size;
-      c[seg].l2.size = ALIGN_VALUE(data_size) - c[seg].l1.size;
-      c[seg].l2.current_data = c[seg].l2.start_offset;
-
-      /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
-      c[seg].data_used = 0;
-      c[seg].max_entry_size = max_entry_size;
+          /* Allocate and initialize directory entries as "not initialized",
+             hence "unused" */
+          c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
 
-      c[seg].used_entries = 0;
-      c[seg].total_reads = 0;
-      c[seg].total_writes = 0;
-      c[seg].total_hits = 0;
+          /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
+          c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
 
-      /* were allocations successful?
-       * If not, initialize a minimal cache structure.
-       */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+          /* were allocations successful?
+           * If not, initialize a minimal cache structure.
+           */
+          if (   c[seg].data == NULL || c[seg].directory == NULL
+              || c[seg].state == NULL)
+            {
+              /* We are OOM. There is no need to proceed with "half a cache".
+               */
+              return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+            }
+        }
+
+      c[seg].max_entry_size = max_entry_size;
+
+      if (initialize)
         {
-          /* We are OOM. There is no need to proceed with "half a cache".
+          c[seg].state->first_spare_group = NO_INDEX;
+          c[seg].state->max_spare_used = 0;
+
+          /* Allocate 1/4th of the data buffer to L1
+           */
+          c[seg].state->l1.first = NO_INDEX;
+          c[seg].state->l1.last = NO_INDEX;
+          c[seg].state->l1.next = NO_INDEX;
+          c[seg].state->l1.start_offset = 0;
+          c[seg].state->l1.size = ALIGN_VALUE(data_size / 4);
+          c[seg].state->l1.current_data = 0;
+
+          /* The remaining 3/4th will be used as L2
            */
-          return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+          c[seg].state->l2.first = NO_INDEX;
+          c[seg].state->l2.last = NO_INDEX;
+          c[seg].state->l2.next = NO_INDEX;
+          c[seg].state->l2.start_offset = c[seg].state->l1.size;
+          c[seg].state->l2.size = ALIGN_VALUE(data_size)
+                                - c[seg].state->l1.size;
+          c[seg].state->l2.current_data = c[seg].state->l2.start_offset;
+
+          c[seg].state->data_used = 0;
+          c[seg].state->used_entries = 0;
+          c[seg].state->total_reads = 0;
+          c[seg].state->total_writes = 0;
+          c[seg].state->total_hits = 0;
+          c[seg].state->write_sequence = 0;
         }
 
+      /* Shared caches additionally synchronize through region locks on
+       * SHARED_FILE.
+       */
+      c[seg].shared_file = shared_file;
+      c[seg].shared_readers = 0;
+      SVN_ERR(svn_mutex__init(&c[seg].shared_mutex,
+                              thread_safe && shared_file != NULL, pool));
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
@@ -2039,33 +2742,65 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
           if (status)
             return svn_error_wrap_apr(status, _("Can't create cache mutex"));
         }
+#endif
 
       /* Select the behavior of write operations.
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
-#endif
+
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
     }
 
+#if APR_HAS_MMAP
+  if (shared_file)
+    SVN_ERR(close_shared_file_init(shared_file, shared_region, initialize,
+                                   &layout));
+#endif
+
   /* done here
    */
   *cache = c;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(create_membuffer(cache, NULL, total_size,
+                                          directory_size, segment_count,
+                                          thread_safe, allow_blocking_writes,
+                                          pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         const char *path,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t thread_safe,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+  return svn_error_trace(create_membuffer(cache, path, total_size,
+                                          directory_size, segment_count,
+                                          thread_safe, allow_blocking_writes,
+                                          pool));
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
-
   /* Clear segment by segment.  This implies that other thread may read
      and write to other segments after we cleared them and before the
      last segment is done.
@@ -2078,31 +2813,12 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_modification(&cache[seg]);
 
-      /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
-
-      memset(cache[seg].group_initialized, 0, group_init_size);
-
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
-
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
-
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+      clear_segment(&cache[seg]);
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(write_unlock_cache(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2156,10 +2872,10 @@ select_level(svn_membuffer_t *cache,
     {
       /* Small items go into L1. */
       return ensure_data_insertable_l1(cache, size)
-           ? &cache->l1
+           ? &cache->state->l1
            : NULL;
     }
-  else if (   cache->l2.size >= size
+  else if (   cache->state->l2.size >= size
            && MAX_ITEM_SIZE >= size
            && priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
     {
@@ -2169,7 +2885,7 @@ select_level(svn_membuffer_t *cache,
       dummy_entry.size = size;
 
       return ensure_data_insertable_l2(cache, &dummy_entry)
-           ? &cache->l2
+           ? &cache->state->l2
            : NULL;
     }
 
@@ -2227,7 +2943,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        * lest we run into trouble with 32 bit underflow *not* treated as a
        * negative value.
        */
-      cache->data_used += (apr_uint64_t)size - entry->size;
+      cache->state->data_used += (apr_uint64_t)size - entry->size;
       entry->size = size;
       entry->priority = priority;
 
@@ -2247,7 +2963,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      cache->state->total_writes++;
 
       /* Putting the decrement into an assert() to make it disappear
        * in production code. */
@@ -2291,7 +3007,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      cache->state->total_writes++;
     }
   else
     {
@@ -2367,7 +3083,7 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   svn_atomic_inc(&entry->hit_count);
 
   /* That one is for stats only. */
-  cache->total_hits++;
+  cache->state->total_hits++;
 }
 
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
@@ -2394,7 +3110,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   /* The actual cache data access needs to sync'ed
    */
   entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  cache->state->total_reads++;
   if (entry == NULL)
     {
       /* no such entry found.
@@ -2433,6 +3149,154 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER)
+
+/* Issue a full memory barrier.  APR has no explicit fences but all its
+ * atomic read-modify-write operations imply one.  Use a local variable
+ * for that such that we don't contend for any shared cache line.
+ */
+static void
+memory_barrier(void)
+{
+  volatile svn_atomic_t dummy = 0;
+  svn_atomic_cas(&dummy, 0, 0);
+}
+
+#endif
+
+/* Try to do the same as membuffer_cache_get_internal but without holding
+ * any lock on CACHE.  Return TRUE if that succeeded, i.e. *BUFFER and
+ * *ITEM_SIZE have been set.  Return FALSE, if the caller must retry
+ * under a read lock, e.g. because a writer modified CACHE concurrently.
+ *
+ * Since writers may change anything at any time, no directory information
+ * is trusted before it has been checked against the CACHE's bounds.  Data
+ * copied from inconsistent states will simply be discarded.  Allocations
+ * will be done in RESULT_POOL.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER)
+  apr_uint32_t sequence;
+  apr_uint32_t group_count = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->state->l2.start_offset
+                         + cache->state->l2.size;
+  entry_group_t *group;
+  entry_t *entry = NULL;
+  entry_t found;
+  apr_size_t size = 0;
+  char *data = NULL;
+  apr_uint32_t chain_length;
+
+  /* Without locks, there is nothing to optimize. */
+  if (cache->lock == NULL && cache->shared_file == NULL)
+    return FALSE;
+
+  /* Don't even try while a writer is active. */
+  sequence = svn_atomic_read(&cache->state->write_sequence);
+  if (sequence & 1)
+    return FALSE;
+
+  memory_barrier();
+
+  /* Same as find_entry (..., FALSE) but with bounded chains. */
+  if (is_group_initialized(cache, group_index))
+    {
+      group = &cache->directory[group_index];
+      for (chain_length = 0; chain_length < MAX_GROUP_CHAIN_LENGTH;
+           ++chain_length)
+        {
+          apr_uint32_t used = group->header.used;
+          apr_uint32_t next = group->header.next;
+          apr_size_t i;
+
+          if (used > GROUP_SIZE)
+            return FALSE;
+
+          for (i = 0; i < used; ++i)
+            if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+              {
+                entry = &group->entries[i];
+                break;
+              }
+
+          if (entry || next == NO_INDEX)
+            break;
+
+          if (next >= group_count)
+            return FALSE;
+
+          group = &cache->directory[next];
+        }
+
+      if (chain_length == MAX_GROUP_CHAIN_LENGTH)
+        return FALSE;
+    }
+
+  if (entry)
+    {
+      /* Take a snapshot such that all checks apply to the values used. */
+      found = *entry;
+      if (   !entry_keys_match(&found.key, &to_find->entry_key)
+          || found.size < found.key.key_len
+          || found.size > cache->max_entry_size
+          || found.offset > data_size
+          || ALIGN_VALUE(found.size) > data_size - found.offset)
+        return FALSE;
+
+      /* Key conflict?  Then the item is not cached. */
+      if (   found.key.key_len
+          && memcmp(to_find->full_key.data, cache->data + found.offset,
+                    found.key.key_len) != 0)
+        {
+          entry = NULL;
+        }
+      else
+        {
+          size = ALIGN_VALUE(found.size) - found.key.key_len;
+          data = apr_palloc(result_pool, size);
+          memcpy(data, cache->data + found.offset + found.key.key_len, size);
+        }
+    }
+
+  /* Was any of the above affected by a concurrent write? */
+  memory_barrier();
+  if (svn_atomic_read(&cache->state->write_sequence) != sequence)
+    return FALSE;
+
+  cache->state->total_reads++;
+  if (entry)
+    {
+      /* ENTRY may be re-used by a writer at any time.  Only count the
+       * hit while the slot still describes our item.  Writers update hit
+       * counts atomically, so the remaining race may lose a hit or credit
+       * it to a slot that just got re-used, but can't corrupt the count.
+       * The hit count is only a heuristics, after all. */
+      if (   svn_atomic_read(&cache->state->write_sequence) == sequence
+          && entry_keys_match(&entry->key, &to_find->entry_key))
+        increment_hit_counters(cache, entry);
+
+      *buffer = data;
+      *item_size = found.size - found.key.key_len;
+    }
+  else
+    {
+      *buffer = NULL;
+      *item_size = 0;
+    }
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2453,14 +3317,16 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  if (!membuffer_cache_get_optimistic(cache, group_index, key,
+                                      &buffer, &size, result_pool))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2515,7 +3381,7 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
-  cache->total_reads++;
+  cache->state->total_reads++;
 
   WITH_READ_LOCK(cache,
                  membuffer_cache_has_key_internal(cache,
@@ -2549,7 +3415,7 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
                                      apr_pool_t *result_pool)
 {
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  cache->state->total_reads++;
   if (entry == NULL)
     {
       *item = NULL;
@@ -2632,7 +3498,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
   /* cache item lookup
    */
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  cache->state->total_reads++;
 
   /* this function is a no-op if the item is not in cache
    */
@@ -2647,7 +3513,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
       apr_size_t item_size = entry->size - key_len;
 
       increment_hit_counters(cache, entry);
-      cache->total_writes++;
+      cache->state->total_writes++;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
 
@@ -2697,7 +3563,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
                    */
                   entry = find_entry(cache, group_index, to_find, TRUE);
                   entry->size = item_size + key_len;
-                  entry->offset = cache->l1.current_data;
+                  entry->offset = cache->state->l1.current_data;
 
                   if (key_len)
                     memcpy(cache->data + entry->offset,
@@ -3110,7 +3976,7 @@ svn_membuffer_cache_is_cachable(void *cache_void, apr_size_t size)
    */
   svn_membuffer_cache_t *cache = cache_void;
   return cache->priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY
-       ? cache->membuffer->l2.size >= size && MAX_ITEM_SIZE >= size
+       ? cache->membuffer->state->l2.size >= size && MAX_ITEM_SIZE >= size
        : size <= cache->membuffer->max_entry_size;
 }
 
@@ -3124,12 +3990,12 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
 {
   apr_uint32_t i;
 
-  info->data_size += segment->l1.size + segment->l2.size;
-  info->used_size += segment->data_used;
-  info->total_size += segment->l1.size + segment->l2.size +
+  info->data_size += segment->state->l1.size + segment->state->l2.size;
+  info->used_size += segment->state->data_used;
+  info->total_size += segment->state->l1.size + segment->state->l2.size +
       segment->group_count * GROUP_SIZE * sizeof(entry_t);
 
-  info->used_entries += segment->used_entries;
+  info->used_entries += segment->state->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
 
   if (include_histogram)
@@ -3448,9 +4314,9 @@ static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
 {
-  info->gets += segment->total_reads;
-  info->sets += segment->total_writes;
-  info->hits += segment->total_hits;
+  info->gets += segment->state->total_reads;
+  info->sets += segment->state->total_writes;
+  info->hits += segment->state->total_hits;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
@@ -3458,6 +4324,23 @@ svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
   return SVN_NO_ERROR;
 }
 
+/* Process-wide read-ahead statistics as reported through
+ * svn_cache__membuffer_get_global_info. */
+static volatile svn_atomic_t read_ahead_blocks = 0;
+static volatile svn_atomic_t read_ahead_hits = 0;
+
+void
+svn_cache__membuffer_record_read_ahead(apr_uint32_t blocks)
+{
+  apr_atomic_add32(&read_ahead_blocks, blocks);
+}
+
+void
+svn_cache__membuffer_record_read_ahead_hit(void)
+{
+  svn_atomic_inc(&read_ahead_hits);
+}
+
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 {
@@ -3476,5 +4359,8 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
     svn_error_clear(svn_membuffer_get_global_segment_info(membuffer + i,
                                                           info));
 
+  info->read_ahead_blocks = svn_atomic_read(&read_ahead_blocks);
+  info->read_ahead_hits = svn_atomic_read(&read_ahead_hits);
+
   return info;
 }
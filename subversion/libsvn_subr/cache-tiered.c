@@ -0,0 +1,249 @@
+/*
+ * cache-tiered.c: two-level caching object for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+
+#include "svn_private_config.h"
+#include "cache.h"
+
+/* The tiered cache does not store any data itself.  It simply forwards
+ * all requests to the two caches it combines.  Writes go to both of them
+ * while reads are served from PRIMARY whenever possible.  Items found in
+ * SECONDARY only will be copied into PRIMARY.
+ *
+ * SECONDARY may use a serialized form that differs from PRIMARY's, e.g.
+ * one that carries a checksum.  Partial getters and setters only know
+ * PRIMARY's form, so they never get to see SECONDARY's data.
+ */
+typedef struct tiered_cache_t
+{
+  /* The fast cache that gets consulted first. */
+  svn_cache__t *primary;
+
+  /* The slow cache that gets consulted on PRIMARY misses. */
+  svn_cache__t *secondary;
+} tiered_cache_t;
+
+/* Copy VALUE stored under KEY in CACHE's secondary tier to its primary
+ * tier.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+promote(tiered_cache_t *cache,
+        const void *key,
+        void *value,
+        apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_cache__set(cache->primary, key, value,
+                                        scratch_pool));
+}
+
+static svn_error_t *
+tiered_cache_get(void **value_p,
+                 svn_boolean_t *found,
+                 void *cache_void,
+                 const void *key,
+                 apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  apr_pool_t *scratch_pool;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->primary, key, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->secondary, key,
+                         result_pool));
+  if (*found)
+    {
+      scratch_pool = svn_pool_create(result_pool);
+      SVN_ERR(promote(cache, key, *value_p, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_has_key(svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__has_key(found, cache->primary, key, scratch_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__has_key(found, cache->secondary, key, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set(void *cache_void,
+                 const void *key,
+                 void *value,
+                 apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set(cache->primary, key, value, scratch_pool));
+  SVN_ERR(svn_cache__set(cache->secondary, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_iter(svn_boolean_t *completed,
+                  void *cache_void,
+                  svn_iter_apr_hash_cb_t user_cb,
+                  void *user_baton,
+                  apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* The secondary tier usually contains a superset of the primary's
+   * contents but there is no guarantee for it.  Don't try to merge
+   * both and simply iterate over the fast one. */
+  return svn_error_trace(svn_cache__iter(completed, cache->primary,
+                                         user_cb, user_baton,
+                                         scratch_pool));
+}
+
+static svn_boolean_t
+tiered_cache_is_cachable(void *cache_void,
+                         apr_size_t size)
+{
+  tiered_cache_t *cache = cache_void;
+
+  return svn_cache__is_cachable(cache->primary, size)
+      || svn_cache__is_cachable(cache->secondary, size);
+}
+
+static svn_error_t *
+tiered_cache_get_partial(void **value_p,
+                         svn_boolean_t *found,
+                         void *cache_void,
+                         const void *key,
+                         svn_cache__partial_getter_func_t func,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  apr_pool_t *scratch_pool;
+  void *value;
+
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->primary, key,
+                                 func, baton, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  /* Partial getters operate on the serialized representation, i.e. we
+   * can't use their result for promotion.  Fetch the whole item instead,
+   * promote it and then retry on the primary tier.  Should the latter
+   * still not accept the item, report a miss.  The secondary's serialized
+   * form may not be what FUNC expects. */
+  scratch_pool = svn_pool_create(result_pool);
+  SVN_ERR(svn_cache__get(&value, found, cache->secondary, key,
+                         scratch_pool));
+  if (*found)
+    {
+      SVN_ERR(promote(cache, key, value, scratch_pool));
+      SVN_ERR(svn_cache__get_partial(value_p, found, cache->primary, key,
+                                     func, baton, result_pool));
+    }
+
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set_partial(void *cache_void,
+                         const void *key,
+                         svn_cache__partial_setter_func_t func,
+                         void *baton,
+                         apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  svn_boolean_t found;
+  void *value;
+
+  /* FUNC only knows the primary's serialized form.  Modify the item
+   * there and write the result through to the secondary tier. */
+  SVN_ERR(svn_cache__set_partial(cache->primary, key, func, baton,
+                                 scratch_pool));
+  SVN_ERR(svn_cache__get(&value, &found, cache->primary, key,
+                         scratch_pool));
+  if (found)
+    SVN_ERR(svn_cache__set(cache->secondary, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_get_info(void *cache_void,
+                      svn_cache__info_t *info,
+                      svn_boolean_t reset,
+                      apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  svn_cache__t *primary = cache->primary;
+
+  /* Report the fast tier only.  This is where the interesting data is. */
+  return svn_error_trace(primary->vtable->get_info(primary->cache_internal,
+                                                   info, reset,
+                                                   result_pool));
+}
+
+static svn_cache__vtable_t tiered_cache_vtable = {
+  tiered_cache_get,
+  tiered_cache_has_key,
+  tiered_cache_set,
+  tiered_cache_iter,
+  tiered_cache_is_cachable,
+  tiered_cache_get_partial,
+  tiered_cache_set_partial,
+  tiered_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *primary,
+                         svn_cache__t *secondary,
+                         apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  tiered_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->primary = primary;
+  cache->secondary = secondary;
+
+  wrapper->vtable = &tiered_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
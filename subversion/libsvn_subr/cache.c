@@ -258,6 +258,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                  / (double)(info->total_entries ? info->total_entries : 1);
 
   const char *histogram = "";
+  const char *read_ahead = "";
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -275,6 +276,21 @@ svn_cache__format_info(const svn_cache__info_t *info,
                                        text->data, info->histogram[i], i);
 
       histogram = text->data;
+
+      if (info->read_ahead_blocks)
+        {
+          double read_ahead_rate
+            = (100.0 * (double)info->read_ahead_hits)
+            / (double)info->read_ahead_blocks;
+
+          read_ahead = svn_string_createf(result_pool,
+                                          "prefetch: %" APR_UINT64_T_FMT
+                                          " blocks, %" APR_UINT64_T_FMT
+                                          " hits (%5.2f%%)\n",
+                                          info->read_ahead_blocks,
+                                          info->read_ahead_hits,
+                                          read_ahead_rate)->data;
+        }
     }
 
   return access_only
@@ -300,7 +316,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
                             "          %" APR_UINT64_T_FMT " entries (%5.2f%%)"
-                            " of %" APR_UINT64_T_FMT " total\n%s",
+                            " of %" APR_UINT64_T_FMT " total\n%s%s",
 
                             info->id,
 
@@ -315,5 +331,6 @@ svn_cache__format_info(const svn_cache__info_t *info,
 
                             info->used_entries, data_entry_rate,
                             info->total_entries,
+                            read_ahead,
                             histogram);
 }
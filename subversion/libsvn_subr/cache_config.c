@@ -64,6 +64,10 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* The file containing the shared membuffer cache or NULL.
+ */
+static const char *shared_cache_file = NULL;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +124,38 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      /* Try to share the cache with other processes, if so configured.
+       * Otherwise, or if that fails, use a process-local cache. */
+      if (shared_cache_file)
+        {
+          err = svn_cache__membuffer_cache_create_shared(
+              &cache,
+              shared_cache_file,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              ! svn_cache_config_get()->single_threaded,
+              FALSE,
+              pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              svn_pool_clear(pool);
+              cache = NULL;
+            }
+        }
+
+      if (cache)
+        err = SVN_NO_ERROR;
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -179,3 +207,14 @@ svn_cache_config_set(const svn_cache_config_t *settings)
   cache_settings = *settings;
 }
 
+void
+svn_cache_config_set_shared_file(const char *path)
+{
+  shared_cache_file = path;
+}
+
+const char *
+svn_cache_config_get_shared_file(void)
+{
+  return shared_cache_file;
+}
@@ -1155,6 +1155,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###                              HTTP operation."                   NL
         "###   http-chunked-requests      Whether to use chunked transfer"   NL
         "###                              encoding for HTTP requests body."  NL
+        "###   http-http2                 Whether to multiplex requests over"NL
+        "###                              one http/2 connection (yes/no/"    NL
+        "###                              auto).  'auto' only offers http/2" NL
+        "###                              to https servers."                 NL
         "###   http-auth-types            List of HTTP authentication types."NL
         "###   ssl-authority-files        List of files, each of a trusted CA"
                                                                              NL
@@ -1552,6 +1556,11 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set to true to store new pristine copies of files in newly"     NL
+        "### created or updated working copies LZ4-compressed.  This saves"  NL
+        "### disk space at some CPU cost.  Working copies containing"        NL
+        "### compressed pristines can't be used by clients older than 1.13." NL
+        "# compress-pristines = false"                                       NL
         ;
 
       err = svn_io_file_open(&f, path,
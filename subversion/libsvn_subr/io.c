@@ -4005,6 +4005,36 @@ svn_io_file_aligned_seek(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_io__file_read_ahead(apr_file_t *file,
+                        apr_off_t offset,
+                        apr_off_t length,
+                        apr_pool_t *scratch_pool)
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+  apr_os_file_t fd;
+  apr_status_t status;
+  int result;
+
+  status = apr_os_file_get(&fd, file);
+  if (status)
+    return do_io_file_wrapper_cleanup(file, status,
+                                      N_("Can't get file handle of '%s'"),
+                                      N_("Can't get file handle of stream"),
+                                      scratch_pool);
+
+  /* This only queues the I/O requests.  It does not block. */
+  result = posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+  if (result)
+    return do_io_file_wrapper_cleanup(file, APR_FROM_OS_ERROR(result),
+                                      N_("Can't read ahead in file '%s'"),
+                                      N_("Can't read ahead in stream"),
+                                      scratch_pool);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_io_file_write(apr_file_t *file, const void *buf,
@@ -427,3 +427,9 @@ svn_log__list(const char *path, svn_revnum_t revision,
   return apr_psprintf(pool, "list %s r%ld%s%s", log_path, revision,
                       log_depth(depth, pool), pattern_text->data);
 }
+
+const char *
+svn_log__fetch_files(int num_files, apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "fetch-files %d", num_files);
+}
@@ -0,0 +1,229 @@
+/*
+ * task_group.c: tracking tasks queued on an APR thread pool.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_errno.h>
+
+#include "svn_pools.h"
+
+#include "private/svn_task_group.h"
+
+#include "svn_private_config.h"
+
+#if APR_HAS_THREADS
+
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+
+struct svn_task_group__t
+{
+  /* Number of tasks that have been queued and not finished yet. */
+  int pending;
+
+  /* Number of tasks that called svn_task_group__task_begin() but not
+     svn_task_group__task_end() yet. */
+  int busy;
+
+  /* Set by svn_task_group__shutdown(). */
+  svn_boolean_t shutdown;
+
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled by svn_task_group__notify() and whenever a task ends. */
+  apr_thread_cond_t *changed;
+};
+
+/* A thread pool and the root pool that it has been allocated in. */
+typedef struct thread_pool_baton_t
+{
+  apr_thread_pool_t *thread_pool;
+  apr_pool_t *pool;
+} thread_pool_baton_t;
+
+/* Pool cleanup function destroying the thread_pool_baton_t in DATA. */
+static apr_status_t
+destroy_thread_pool(void *data)
+{
+  thread_pool_baton_t *baton = data;
+
+  /* Joins all worker threads.  Tasks still queued will never run. */
+  apr_status_t status = apr_thread_pool_destroy(baton->thread_pool);
+  svn_pool_destroy(baton->pool);
+
+  return status;
+}
+
+svn_error_t *
+svn_task_group__create_thread_pool(apr_thread_pool_t **thread_pool,
+                                   apr_size_t max_threads,
+                                   apr_pool_t *owning_pool)
+{
+  thread_pool_baton_t *baton = apr_pcalloc(owning_pool, sizeof(*baton));
+  apr_status_t status;
+
+  /* The thread pool must be allocated from a thread-safe pool.  Since it
+     is not a sub-pool of OWNING_POOL, the thread objects are still valid
+     when OWNING_POOL's cleanups run. */
+  baton->pool = svn_pool_create(NULL);
+  status = apr_thread_pool_create(&baton->thread_pool, 0, max_threads,
+                                  baton->pool);
+  if (status)
+    {
+      svn_pool_destroy(baton->pool);
+      return svn_error_wrap_apr(status, _("Can't create thread pool"));
+    }
+
+  /* Don't queue tasks unless we reached the worker thread limit. */
+  apr_thread_pool_threshold_set(baton->thread_pool, 0);
+
+  apr_pool_cleanup_register(owning_pool, baton, destroy_thread_pool,
+                            apr_pool_cleanup_null);
+
+  *thread_pool = baton->thread_pool;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_task_group__create(svn_task_group__t **group,
+                       apr_pool_t *result_pool)
+{
+  svn_task_group__t *new_group = apr_pcalloc(result_pool, sizeof(*new_group));
+  apr_status_t status;
+
+  status = apr_thread_mutex_create(&new_group->mutex,
+                                   APR_THREAD_MUTEX_DEFAULT, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&new_group->changed, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  *group = new_group;
+  return SVN_NO_ERROR;
+}
+
+void
+svn_task_group__lock(svn_task_group__t *group)
+{
+  apr_thread_mutex_lock(group->mutex);
+}
+
+void
+svn_task_group__unlock(svn_task_group__t *group)
+{
+  apr_thread_mutex_unlock(group->mutex);
+}
+
+void
+svn_task_group__wait(svn_task_group__t *group)
+{
+  apr_thread_cond_wait(group->changed, group->mutex);
+}
+
+void
+svn_task_group__timed_wait(svn_task_group__t *group,
+                           apr_interval_time_t timeout)
+{
+  apr_thread_cond_timedwait(group->changed, group->mutex, timeout);
+}
+
+void
+svn_task_group__notify(svn_task_group__t *group)
+{
+  apr_thread_cond_broadcast(group->changed);
+}
+
+apr_status_t
+svn_task_group__push(svn_task_group__t *group,
+                     apr_thread_pool_t *thread_pool,
+                     apr_thread_start_t func,
+                     void *data)
+{
+  apr_status_t status;
+
+  if (group->shutdown)
+    return APR_EGENERAL;
+
+  /* Our tasks are owned by GROUP, so shutting down can remove them. */
+  status = apr_thread_pool_push(thread_pool, func, data, 0, group);
+  if (!status)
+    group->pending++;
+
+  return status;
+}
+
+svn_boolean_t
+svn_task_group__task_begin(svn_task_group__t *group)
+{
+  group->busy++;
+  return !group->shutdown;
+}
+
+void
+svn_task_group__task_end(svn_task_group__t *group)
+{
+  group->busy--;
+  group->pending--;
+  apr_thread_cond_broadcast(group->changed);
+}
+
+int
+svn_task_group__pending(svn_task_group__t *group)
+{
+  return group->pending;
+}
+
+void
+svn_task_group__wait_all(svn_task_group__t *group)
+{
+  while (group->pending)
+    apr_thread_cond_wait(group->changed, group->mutex);
+}
+
+void
+svn_task_group__shutdown(svn_task_group__t *group,
+                         apr_thread_pool_t *thread_pool)
+{
+  /* Tasks starting from now on won't do any work.  Wait for those that
+     already do.  We can't wait for PENDING to drop to 0 because tasks
+     dropped by a destroyed thread pool will never end. */
+  apr_thread_mutex_lock(group->mutex);
+  group->shutdown = TRUE;
+  while (group->busy)
+    apr_thread_cond_wait(group->changed, group->mutex);
+  apr_thread_mutex_unlock(group->mutex);
+
+  /* Remove the tasks that are still queued.  This also waits for tasks
+     that have been picked up by a worker in the meantime.  It polls, so
+     only do this once nothing should be running anymore. */
+  if (thread_pool)
+    apr_thread_pool_tasks_cancel(thread_pool, group);
+
+  /* None of our tasks is queued or running anymore. */
+  apr_thread_mutex_lock(group->mutex);
+  group->pending = 0;
+  group->busy = 0;
+  apr_thread_mutex_unlock(group->mutex);
+}
+
+#endif /* APR_HAS_THREADS */
@@ -0,0 +1,97 @@
+/* monitor-queries.sql -- schema of the working copy monitor cache
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* The working copy directories whose entries are stored in DIRENTS and
+   have not changed on disk since.  RELPATH is relative to the wcroot. */
+CREATE TABLE dirs (
+  relpath TEXT NOT NULL PRIMARY KEY
+  );
+
+/* The entries of the directories in DIRS, as svn_io_get_dirents3() returned
+   them.  Rows of directories that are not in DIRS are stale. */
+CREATE TABLE dirents (
+  parent_relpath TEXT NOT NULL,
+  name TEXT NOT NULL,
+  kind INTEGER NOT NULL,
+  special INTEGER NOT NULL,
+  filesize INTEGER NOT NULL,
+  mtime INTEGER NOT NULL,
+  PRIMARY KEY (parent_relpath, name)
+  );
+
+/* A single row identifying the monitor session and the offset within its
+   journal up to which the changes have been applied to DIRS. */
+CREATE TABLE journal (
+  session TEXT,
+  journal_offset INTEGER NOT NULL
+  );
+
+INSERT INTO journal (session, journal_offset) VALUES (NULL, 0);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_SELECT_JOURNAL
+SELECT session, journal_offset
+FROM journal
+
+-- STMT_UPDATE_JOURNAL
+UPDATE journal
+SET session = ?1, journal_offset = ?2
+
+-- STMT_DELETE_ALL_DIRS
+DELETE FROM dirs
+
+-- STMT_DELETE_ALL_DIRENTS
+DELETE FROM dirents
+
+-- STMT_DELETE_DIR
+DELETE FROM dirs
+WHERE relpath = ?1
+
+-- STMT_DELETE_DIR_DESCENDANTS
+DELETE FROM dirs
+WHERE IS_STRICT_DESCENDANT_OF(relpath, ?1)
+
+-- STMT_SELECT_DIR
+SELECT 1
+FROM dirs
+WHERE relpath = ?1
+
+-- STMT_INSERT_DIR
+INSERT OR IGNORE INTO dirs (relpath)
+VALUES (?1)
+
+-- STMT_SELECT_DIRENTS
+SELECT name, kind, special, filesize, mtime
+FROM dirents
+WHERE parent_relpath = ?1
+
+-- STMT_DELETE_DIRENTS
+DELETE FROM dirents
+WHERE parent_relpath = ?1
+
+-- STMT_INSERT_DIRENT
+INSERT OR REPLACE INTO dirents (parent_relpath, name, kind, special,
+                                filesize, mtime)
+VALUES (?1, ?2, ?3, ?4, ?5, ?6)
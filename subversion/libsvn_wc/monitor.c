@@ -0,0 +1,1266 @@
+/*
+ * monitor.c :  watching a working copy for changes and caching the
+ *              directory entries that did not change
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The monitor (svn_wc__monitor_run) and its readers (status walks) talk
+ * through a journal file in the administrative area of the wcroot.  The
+ * monitor holds an exclusive lock on the journal while it runs.  The
+ * journal starts with a header line that identifies the monitor session,
+ * followed by one record per line:
+ *
+ *   "C <relpath>"   The node at RELPATH changed.  Any directory below it
+ *                   may have changed as well.  RELPATH is URI-encoded.
+ *   "K <name>"      A reader created the cookie file NAME.
+ *   "O"             Events got lost.  Anything may have changed.
+ *
+ * Readers keep a cache of directory entries in an SQLite database next to
+ * the journal, together with the session and the journal offset up to
+ * which its content has been checked against the journal.  Before using
+ * the cache, a reader creates a cookie file and waits for the monitor to
+ * report it.  Any change made before that is in the journal by then.
+ *
+ * Once the readers applied all records, the monitor starts over with an
+ * empty journal and a new session, moving the cache on to the new session
+ * in the same transaction.  That keeps the journal short without costing
+ * the readers their cache.
+ */
+
+#include <string.h>
+
+#include <apr_strings.h>
+#include <apr_time.h>
+#include <apr_uuid.h>
+
+#if __linux__
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_path.h"
+#include "svn_sorts.h"
+#include "svn_utf.h"
+#include "svn_uuid.h"
+#include "svn_wc.h"
+
+#include "private/svn_sqlite.h"
+#include "private/svn_wc_private.h"
+
+#include "wc.h"
+#include "wc_db.h"
+#include "adm_files.h"
+#include "monitor.h"
+
+#include "svn_private_config.h"
+
+#include "monitor-queries.h"
+
+MONITOR_QUERIES_SQL_DECLARE_STATEMENTS(statements);
+
+/* The first line of the journal is this, followed by the session id. */
+#define JOURNAL_HEADER "svn-wc-monitor-journal 1 "
+
+/* Journal record types. */
+#define RECORD_CHANGE   'C'
+#define RECORD_COOKIE   'K'
+#define RECORD_OVERFLOW 'O'
+
+/* Basename prefix of the cookie files that readers create in the
+   administrative tmp directory. */
+#define COOKIE_PREFIX "monitor-cookie"
+
+/* How long to wait for the monitor to report a cookie. */
+#define COOKIE_TIMEOUT apr_time_from_sec(2)
+
+/* Number of directories whose entries are written to the cache within a
+   single transaction. */
+#define DIRS_PER_TXN 1000
+
+/* The monitor starts a new journal once the current one got this large
+   and the readers applied all of it to the cache. */
+#define ROTATE_JOURNAL_SIZE 0x100000
+
+/* The monitor starts a new journal once the current one got this large,
+   even if that means that the readers have to drop their cache. */
+#define FORCE_ROTATE_JOURNAL_SIZE (16 * ROTATE_JOURNAL_SIZE)
+
+struct svn_wc__monitor_t
+{
+  /* The working copy root that the paths are relative to. */
+  const char *wcroot_abspath;
+
+  /* The directory entry cache. */
+  svn_sqlite__db_t *sdb;
+
+  /* The session and journal offset that the cache has been brought up to
+     date with while opening.  If another reader moves the cache on to a
+     later offset, the entries read by us may be older than changes that
+     it already applied, so we must not write them anymore. */
+  const char *session;
+  apr_int64_t offset;
+
+  /* Set once the cache has moved on without us. */
+  svn_boolean_t stale;
+
+  /* Set once accessing the cache failed, e.g. because it was locked by
+     someone else for too long.  We then neither read from nor write to
+     the cache anymore. */
+  svn_boolean_t failed;
+
+  /* Entries to write to the cache, mapping directory relpaths to hashes
+     as returned by svn_io_get_dirents3(), allocated in PENDING_POOL. */
+  apr_hash_t *pending;
+  apr_pool_t *pending_pool;
+};
+
+/* The records read from a journal. */
+typedef struct journal_t
+{
+  /* The session id from the journal header. */
+  const char *session;
+
+  /* Offset of the first record in the journal. */
+  apr_off_t start;
+
+  /* Offset just behind the last complete record read. */
+  apr_off_t end;
+
+  /* The relpaths of all changed nodes read, as const char *. */
+  apr_array_header_t *changes;
+
+  /* Whether an overflow record has been read. */
+  svn_boolean_t overflow;
+
+  /* Whether the cookie we are waiting for has been read. */
+  svn_boolean_t cookie_seen;
+} journal_t;
+
+
+
+/*** Reading the journal. ***/
+
+/* Read the records of the journal at JOURNAL_PATH into *JOURNAL, starting
+   at OFFSET or at the first record if OFFSET is 0 or the journal belongs
+   to a session other than SESSION.  Set JOURNAL->COOKIE_SEEN if the cookie
+   named COOKIE is among those records; COOKIE may be NULL.  Set
+   JOURNAL->SESSION to NULL if the journal has no valid header yet.
+   Allocate *JOURNAL in RESULT_POOL. */
+static svn_error_t *
+read_journal(journal_t **journal_p,
+             const char *journal_path,
+             const char *session,
+             apr_off_t offset,
+             const char *cookie,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  journal_t *journal = apr_pcalloc(result_pool, sizeof(*journal));
+  apr_file_t *file;
+  svn_stringbuf_t *header;
+  svn_stringbuf_t *contents;
+  const char *eol;
+  svn_boolean_t eof;
+  const char *p, *end;
+
+  journal->changes = apr_array_make(result_pool, 16, sizeof(const char *));
+  *journal_p = journal;
+
+  SVN_ERR(svn_io_file_open(&file, journal_path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_readline(file, &header, &eol, &eof, 256,
+                               scratch_pool, scratch_pool));
+  if (eof || strncmp(header->data, JOURNAL_HEADER,
+                     sizeof(JOURNAL_HEADER) - 1) != 0)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  journal->session = apr_pstrdup(result_pool,
+                                 header->data + sizeof(JOURNAL_HEADER) - 1);
+  SVN_ERR(svn_io_file_get_offset(&journal->start, file, scratch_pool));
+
+  if (offset < journal->start || !session
+      || strcmp(session, journal->session) != 0)
+    offset = journal->start;
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_stringbuf_from_aprfile(&contents, file, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  /* Only complete records count.  The monitor may still be writing the
+     last one. */
+  journal->end = offset;
+  p = contents->data;
+  end = contents->data + contents->len;
+  while (p < end)
+    {
+      const char *line_end = memchr(p, '\n', end - p);
+      const char *value;
+
+      if (!line_end)
+        break;
+
+      value = apr_pstrndup(scratch_pool, p, line_end - p);
+      if (*value)
+        value += (value[1] == ' ') ? 2 : 1;
+
+      switch (*p)
+        {
+          case RECORD_CHANGE:
+            APR_ARRAY_PUSH(journal->changes, const char *)
+              = svn_path_uri_decode(value, result_pool);
+            break;
+
+          case RECORD_COOKIE:
+            if (cookie && strcmp(value, cookie) == 0)
+              journal->cookie_seen = TRUE;
+            break;
+
+          default:
+            /* Overflow or something we don't know. */
+            journal->overflow = TRUE;
+            break;
+        }
+
+      journal->end += line_end + 1 - p;
+      p = line_end + 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a cookie file in the administrative area of WCROOT_ABSPATH and
+   wait for the monitor to report it in the journal at JOURNAL_PATH,
+   reading the journal from SESSION and OFFSET on.  Set *SYNCED to whether
+   that happened in time. */
+static svn_error_t *
+sync_with_monitor(svn_boolean_t *synced,
+                  const char *wcroot_abspath,
+                  const char *journal_path,
+                  const char *session,
+                  apr_int64_t offset,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_time_t deadline = apr_time_now() + COOKIE_TIMEOUT;
+  apr_interval_time_t delay = 1000;
+  apr_file_t *file;
+  const char *cookie_path;
+  const char *cookie;
+
+  SVN_ERR(svn_io_open_uniquely_named(&file, &cookie_path,
+                                     svn_wc__adm_child(wcroot_abspath,
+                                                       SVN_WC__ADM_TMP,
+                                                       scratch_pool),
+                                     COOKIE_PREFIX, ".tmp",
+                                     svn_io_file_del_none,
+                                     scratch_pool, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+  SVN_ERR(svn_io_remove_file2(cookie_path, FALSE, scratch_pool));
+  cookie = svn_dirent_basename(cookie_path, NULL);
+
+  *synced = FALSE;
+  while (!*synced && apr_time_now() < deadline)
+    {
+      journal_t *journal;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_journal(&journal, journal_path, session, offset, cookie,
+                           iterpool, iterpool));
+      if (journal->cookie_seen)
+        *synced = TRUE;
+      else
+        {
+          apr_sleep(delay);
+          delay = MIN(delay * 2, 100000);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** The directory entry cache. ***/
+
+/* Set *SESSION and *OFFSET to the journal position of the cache SDB. */
+static svn_error_t *
+get_journal_position(const char **session,
+                     apr_int64_t *offset,
+                     svn_sqlite__db_t *sdb,
+                     apr_pool_t *result_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_JOURNAL));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    {
+      *session = svn_sqlite__column_text(stmt, 0, result_pool);
+      *offset = svn_sqlite__column_int64(stmt, 1);
+    }
+  else
+    {
+      *session = NULL;
+      *offset = 0;
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Remove the entries of all directories from the cache SDB. */
+static svn_error_t *
+clear_cache(svn_sqlite__db_t *sdb)
+{
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_DELETE_ALL_DIRS));
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_DELETE_ALL_DIRENTS));
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove from the cache SDB the entries of all directories that may have
+   changed with the node at RELPATH:  its parent, itself and everything
+   below it. */
+static svn_error_t *
+invalidate_path(svn_sqlite__db_t *sdb,
+                const char *relpath,
+                apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  if (*relpath)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_DELETE_DIR));
+      SVN_ERR(svn_sqlite__bindf(stmt, "s",
+                                svn_relpath_dirname(relpath, scratch_pool)));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+    }
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_DELETE_DIR));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DELETE_DIR_DESCENDANTS));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  return SVN_NO_ERROR;
+}
+
+/* Apply all changes in the journal at JOURNAL_PATH that have not been
+   applied to MONITOR->SDB yet, and set MONITOR->SESSION and
+   MONITOR->OFFSET to the resulting journal position.  To be called
+   within a transaction. */
+static svn_error_t *
+update_cache(svn_wc__monitor_t *monitor,
+             const char *journal_path,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  const char *session;
+  apr_int64_t offset;
+  journal_t *journal;
+
+  SVN_ERR(get_journal_position(&session, &offset, monitor->sdb,
+                               scratch_pool));
+  SVN_ERR(read_journal(&journal, journal_path, session, offset, NULL,
+                       scratch_pool, scratch_pool));
+  if (!journal->session)
+    return svn_error_create(SVN_ERR_WC_CORRUPT, NULL,
+                            _("Working copy monitor journal is invalid"));
+
+  if (   !session
+      || strcmp(session, journal->session) != 0
+      || offset > journal->end
+      || journal->overflow)
+    {
+      SVN_ERR(clear_cache(monitor->sdb));
+    }
+  else
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      int i;
+
+      for (i = 0; i < journal->changes->nelts; i++)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(invalidate_path(monitor->sdb,
+                                  APR_ARRAY_IDX(journal->changes, i,
+                                                const char *),
+                                  iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb,
+                                    STMT_UPDATE_JOURNAL));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sL", journal->session,
+                            (apr_int64_t)journal->end));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  monitor->session = apr_pstrdup(result_pool, journal->session);
+  monitor->offset = journal->end;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the entries of MONITOR->PENDING to the cache, unless the cache
+   has moved on since we opened it.  To be called within a transaction. */
+static svn_error_t *
+write_pending(svn_wc__monitor_t *monitor,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  apr_hash_index_t *hi;
+  const char *session;
+  apr_int64_t offset;
+
+  SVN_ERR(get_journal_position(&session, &offset, monitor->sdb,
+                               scratch_pool));
+  if (   !session
+      || strcmp(session, monitor->session) != 0
+      || offset != monitor->offset)
+    {
+      monitor->stale = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, monitor->pending);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const char *relpath = apr_hash_this_key(hi);
+      apr_hash_t *dirents = apr_hash_this_val(hi);
+      svn_sqlite__stmt_t *stmt;
+      apr_hash_index_t *hi2;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb,
+                                        STMT_DELETE_DIRENTS));
+      SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+      for (hi2 = apr_hash_first(iterpool, dirents);
+           hi2;
+           hi2 = apr_hash_next(hi2))
+        {
+          const svn_io_dirent2_t *dirent = apr_hash_this_val(hi2);
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb,
+                                            STMT_INSERT_DIRENT));
+          SVN_ERR(svn_sqlite__bindf(stmt, "ssddLL", relpath,
+                                    (const char *)apr_hash_this_key(hi2),
+                                    (int)dirent->kind,
+                                    (int)dirent->special,
+                                    (apr_int64_t)dirent->filesize,
+                                    (apr_int64_t)dirent->mtime));
+          SVN_ERR(svn_sqlite__update(NULL, stmt));
+        }
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb,
+                                        STMT_INSERT_DIR));
+      SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write MONITOR->PENDING to the cache and clear it. */
+static svn_error_t *
+flush_pending(svn_wc__monitor_t *monitor,
+              apr_pool_t *scratch_pool)
+{
+  if (!monitor->stale && apr_hash_count(monitor->pending))
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(write_pending(monitor, scratch_pool),
+                                   monitor->sdb);
+
+  svn_pool_clear(monitor->pending_pool);
+  monitor->pending = apr_hash_make(monitor->pending_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the cache of WCROOT_ABSPATH, creating it if necessary, apply the
+   records of the journal at JOURNAL_PATH to it and return it in
+   *MONITOR_P.  If SYNC is set, first wait for the monitor to write all
+   changes made before now to the journal and set *MONITOR_P to NULL if
+   it doesn't do so in time.  Allocate *MONITOR_P in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+open_cache(svn_wc__monitor_t **monitor_p,
+           const char *wcroot_abspath,
+           const char *journal_path,
+           svn_boolean_t sync,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  svn_wc__monitor_t *monitor;
+  const char *session;
+  apr_int64_t offset;
+  svn_boolean_t synced = TRUE;
+  int version;
+
+  *monitor_p = NULL;
+
+  monitor = apr_pcalloc(result_pool, sizeof(*monitor));
+  monitor->wcroot_abspath = apr_pstrdup(result_pool, wcroot_abspath);
+  monitor->pending_pool = svn_pool_create(result_pool);
+  monitor->pending = apr_hash_make(monitor->pending_pool);
+
+  SVN_ERR(svn_sqlite__open(&monitor->sdb,
+                           svn_wc__adm_child(wcroot_abspath,
+                                             SVN_WC__ADM_MONITOR_CACHE,
+                                             scratch_pool),
+                           svn_sqlite__mode_rwcreate, statements,
+                           0, NULL, 0, result_pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version,
+                                                        monitor->sdb,
+                                                        scratch_pool),
+                        monitor->sdb);
+  if (version <= 0)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(monitor->sdb,
+                                                      STMT_CREATE_SCHEMA),
+                          monitor->sdb);
+
+  /* Make sure that every change made before now is in the journal. */
+  if (sync)
+    {
+      SVN_SQLITE__ERR_CLOSE(get_journal_position(&session, &offset,
+                                                 monitor->sdb, scratch_pool),
+                            monitor->sdb);
+      SVN_SQLITE__ERR_CLOSE(sync_with_monitor(&synced, wcroot_abspath,
+                                              journal_path, session, offset,
+                                              scratch_pool),
+                            monitor->sdb);
+    }
+  if (!synced)
+    return svn_error_trace(svn_sqlite__close(monitor->sdb));
+
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(update_cache(monitor, journal_path,
+                                              result_pool, scratch_pool),
+                                 monitor->sdb);
+
+  *monitor_p = monitor;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_wc__monitor_open() but may return errors. */
+static svn_error_t *
+open_monitor(svn_wc__monitor_t **monitor_p,
+             const char *wcroot_abspath,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  const char *journal_path;
+  apr_pool_t *lock_pool;
+  svn_node_kind_t kind;
+  svn_error_t *err;
+
+  *monitor_p = NULL;
+
+  journal_path = svn_wc__adm_child(wcroot_abspath,
+                                   SVN_WC__ADM_MONITOR_JOURNAL,
+                                   scratch_pool);
+  SVN_ERR(svn_io_check_path(journal_path, &kind, scratch_pool));
+  if (kind != svn_node_file)
+    return SVN_NO_ERROR;
+
+  /* A journal that nobody holds a lock on has been left behind by a
+     monitor that is gone.  Don't wait for that one to see our cookie. */
+  lock_pool = svn_pool_create(scratch_pool);
+  err = svn_io_file_lock2(journal_path, FALSE, TRUE, lock_pool);
+  svn_pool_destroy(lock_pool);
+  if (!err)
+    return SVN_NO_ERROR;
+  svn_error_clear(err);
+
+  return svn_error_trace(open_cache(monitor_p, wcroot_abspath, journal_path,
+                                    TRUE, result_pool, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__monitor_open(svn_wc__monitor_t **monitor,
+                     const char *wcroot_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = open_monitor(monitor, wcroot_abspath,
+                                  result_pool, scratch_pool);
+
+  /* Without a usable cache, we simply read all directories. */
+  if (err)
+    {
+      svn_error_clear(err);
+      *monitor = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__monitor_open_unsynced(svn_wc__monitor_t **monitor,
+                              const char *wcroot_abspath,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(open_cache(monitor, wcroot_abspath,
+                                    svn_wc__adm_child(
+                                      wcroot_abspath,
+                                      SVN_WC__ADM_MONITOR_JOURNAL,
+                                      scratch_pool),
+                                    FALSE, result_pool, scratch_pool));
+}
+
+/* Implements svn_wc__monitor_get_dirents() but may return errors. */
+static svn_error_t *
+get_dirents(apr_hash_t **dirents,
+            svn_wc__monitor_t *monitor,
+            const char *relpath,
+            apr_pool_t *result_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb, STMT_SELECT_DIR));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  SVN_ERR(svn_sqlite__reset(stmt));
+  if (!have_row)
+    return SVN_NO_ERROR;
+
+  *dirents = apr_hash_make(result_pool);
+  SVN_ERR(svn_sqlite__get_statement(&stmt, monitor->sdb,
+                                    STMT_SELECT_DIRENTS));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", relpath));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      svn_io_dirent2_t *dirent = svn_io_dirent2_create(result_pool);
+
+      dirent->kind = svn_sqlite__column_int(stmt, 1);
+      dirent->special = svn_sqlite__column_boolean(stmt, 2);
+      dirent->filesize = svn_sqlite__column_int64(stmt, 3);
+      dirent->mtime = svn_sqlite__column_int64(stmt, 4);
+
+      svn_hash_sets(*dirents, svn_sqlite__column_text(stmt, 0, result_pool),
+                    dirent);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_wc__monitor_get_dirents(apr_hash_t **dirents,
+                            svn_wc__monitor_t *monitor,
+                            const char *local_abspath,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  const char *relpath = svn_dirent_skip_ancestor(monitor->wcroot_abspath,
+                                                 local_abspath);
+  svn_error_t *err;
+
+  *dirents = NULL;
+  if (!relpath || monitor->failed)
+    return SVN_NO_ERROR;
+
+  /* Without a usable cache, the caller simply reads the directory. */
+  err = get_dirents(dirents, monitor, relpath, result_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      monitor->failed = TRUE;
+      *dirents = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__monitor_set_dirents(svn_wc__monitor_t *monitor,
+                            const char *local_abspath,
+                            apr_hash_t *dirents,
+                            apr_pool_t *scratch_pool)
+{
+  const char *relpath = svn_dirent_skip_ancestor(monitor->wcroot_abspath,
+                                                 local_abspath);
+  apr_pool_t *pool = monitor->pending_pool;
+  apr_hash_t *copy;
+  apr_hash_index_t *hi;
+
+  if (!relpath || monitor->stale || monitor->failed)
+    return SVN_NO_ERROR;
+
+  copy = apr_hash_make(pool);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    svn_hash_sets(copy, apr_pstrdup(pool, apr_hash_this_key(hi)),
+                  svn_io_dirent2_dup(apr_hash_this_val(hi), pool));
+
+  svn_hash_sets(monitor->pending, apr_pstrdup(pool, relpath), copy);
+
+  /* Failing to update the cache only means that the next walk will have
+     to read more directories. */
+  if (apr_hash_count(monitor->pending) >= DIRS_PER_TXN)
+    {
+      svn_error_t *err = flush_pending(monitor, scratch_pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          monitor->failed = TRUE;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__monitor_close(svn_wc__monitor_t *monitor,
+                      apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  if (!monitor->failed)
+    err = flush_pending(monitor, scratch_pool);
+
+  svn_error_clear(svn_error_compose_create(err,
+                                           svn_sqlite__close(monitor->sdb)));
+
+  return SVN_NO_ERROR;
+}
+
+
+
+/*** The monitor. ***/
+
+#if __linux__
+
+/* Events to watch working copy directories for. */
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB \
+                    | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF \
+                    | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK)
+
+/* Size of the buffer to read events into. */
+#define EVENT_BUFFER_SIZE 0x10000
+
+/* Milliseconds to wait for events before checking for cancellation. */
+#define POLL_TIMEOUT 200
+
+/* State of a running monitor. */
+typedef struct watcher_t
+{
+  /* The working copy being watched. */
+  const char *wcroot_abspath;
+
+  /* The inotify instance. */
+  int fd;
+
+  /* Maps the watch descriptors (int) of all watched directories to their
+     relpaths (const char *). */
+  apr_hash_t *watches;
+
+  /* Watch descriptor of the administrative tmp directory. */
+  int tmp_wd;
+
+  /* The journal, locked, its current size and the current session. */
+  apr_file_t *journal;
+  apr_off_t journal_size;
+  char session[APR_UUID_FORMATTED_LENGTH + 1];
+
+  /* Records not yet written to JOURNAL. */
+  svn_stringbuf_t *records;
+
+  /* Buffer to read events into. */
+  char *buffer;
+
+  /* Pool for the watches. */
+  apr_pool_t *pool;
+} watcher_t;
+
+/* Append a record of TYPE with VALUE to W->RECORDS.  VALUE may be NULL. */
+static void
+add_record(watcher_t *w,
+           char type,
+           const char *value)
+{
+  svn_stringbuf_appendbyte(w->records, type);
+  if (value)
+    {
+      svn_stringbuf_appendbyte(w->records, ' ');
+      svn_stringbuf_appendcstr(w->records, value);
+    }
+  svn_stringbuf_appendbyte(w->records, '\n');
+}
+
+/* Return an error for the failed inotify operation on ABSPATH. */
+static svn_error_t *
+watch_error(const char *abspath,
+            apr_pool_t *scratch_pool)
+{
+  return svn_error_wrap_apr(apr_get_os_error(), _("Can't watch '%s'"),
+                            svn_dirent_local_style(abspath, scratch_pool));
+}
+
+/* Watch the directory RELPATH in W and all directories below it. */
+static svn_error_t *
+add_watches(watcher_t *w,
+            const char *relpath,
+            apr_pool_t *scratch_pool)
+{
+  const char *abspath = svn_dirent_join(w->wcroot_abspath, relpath,
+                                        scratch_pool);
+  const char *native_path;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+  int wd;
+
+  SVN_ERR(svn_path_cstring_from_utf8(&native_path, abspath, scratch_pool));
+  wd = inotify_add_watch(w->fd, native_path, WATCH_MASK);
+  if (wd < 0)
+    {
+      /* Gone already or replaced by a file.  We'll see that event. */
+      if (errno == ENOENT || errno == ENOTDIR)
+        return SVN_NO_ERROR;
+
+      return svn_error_trace(watch_error(abspath, scratch_pool));
+    }
+
+  apr_hash_set(w->watches, apr_pmemdup(w->pool, &wd, sizeof(wd)),
+               sizeof(wd), apr_pstrdup(w->pool, relpath));
+
+  err = svn_io_get_dirents3(&dirents, abspath, TRUE, scratch_pool,
+                            scratch_pool);
+  if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      svn_pool_clear(iterpool);
+
+      if (dirent->kind != svn_node_dir || dirent->special
+          || svn_wc_is_adm_dir(name, iterpool))
+        continue;
+
+      SVN_ERR(add_watches(w, svn_relpath_join(relpath, name, iterpool),
+                          iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Stop watching RELPATH and all directories below it in W. */
+static void
+remove_watches(watcher_t *w,
+               const char *relpath,
+               apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(scratch_pool, w->watches);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const int *wd = apr_hash_this_key(hi);
+      const char *watched_relpath = apr_hash_this_val(hi);
+
+      if (svn_relpath_skip_ancestor(relpath, watched_relpath))
+        {
+          inotify_rm_watch(w->fd, *wd);
+          apr_hash_set(w->watches, wd, sizeof(*wd), NULL);
+        }
+    }
+}
+
+/* Add the records for EVENT to W->RECORDS. */
+static svn_error_t *
+handle_event(watcher_t *w,
+             const struct inotify_event *event,
+             apr_pool_t *scratch_pool)
+{
+  const char *dir_relpath;
+  const char *relpath;
+
+  if (event->mask & IN_Q_OVERFLOW)
+    {
+      add_record(w, RECORD_OVERFLOW, NULL);
+      return SVN_NO_ERROR;
+    }
+
+  if (event->wd == w->tmp_wd)
+    {
+      if ((event->mask & IN_CREATE) && event->len
+          && strncmp(event->name, COOKIE_PREFIX,
+                     sizeof(COOKIE_PREFIX) - 1) == 0)
+        add_record(w, RECORD_COOKIE, event->name);
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Events may still arrive for directories that we stopped watching. */
+  dir_relpath = apr_hash_get(w->watches, &event->wd, sizeof(event->wd));
+  if (!dir_relpath)
+    return SVN_NO_ERROR;
+
+  if (event->mask & IN_IGNORED)
+    {
+      apr_hash_set(w->watches, &event->wd, sizeof(event->wd), NULL);
+      return SVN_NO_ERROR;
+    }
+
+  if (event->len)
+    {
+      const char *name;
+      svn_error_t *err = svn_path_cstring_to_utf8(&name, event->name,
+                                                  scratch_pool);
+
+      /* We can't record that path, so we don't know what changed. */
+      if (err)
+        {
+          svn_error_clear(err);
+          add_record(w, RECORD_OVERFLOW, NULL);
+          return SVN_NO_ERROR;
+        }
+
+      if (svn_wc_is_adm_dir(name, scratch_pool))
+        return SVN_NO_ERROR;
+
+      relpath = svn_relpath_join(dir_relpath, name, scratch_pool);
+    }
+  else
+    relpath = dir_relpath;
+
+  /* A directory that moves around takes its watches along, so these would
+     report wrong paths.  Watch the new location instead.  The record must
+     be added after that, so nothing can change unnoticed after a reader
+     saw it. */
+  if ((event->mask & IN_ISDIR) && (event->mask & IN_MOVED_FROM))
+    remove_watches(w, relpath, scratch_pool);
+  if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+    SVN_ERR(add_watches(w, relpath, scratch_pool));
+
+  add_record(w, RECORD_CHANGE, svn_path_uri_encode(relpath, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Start the new session SESSION in W with an empty journal. */
+static svn_error_t *
+start_session(watcher_t *w,
+              const char *session,
+              apr_pool_t *scratch_pool)
+{
+  const char *header = apr_pstrcat(scratch_pool, JOURNAL_HEADER, session,
+                                   "\n", SVN_VA_NULL);
+
+  SVN_ERR(svn_io_file_trunc(w->journal, 0, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(w->journal, header, strlen(header), NULL,
+                                 scratch_pool));
+
+  w->journal_size = strlen(header);
+  apr_cpystrn(w->session, session, sizeof(w->session));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MOVED to whether the cache SDB was at the end of the current
+   journal of W and has been moved on to the start of the journal of the
+   new session SESSION.  Set it to TRUE as well if the cache belongs to
+   some other session anyway.  To be called within a transaction. */
+static svn_error_t *
+move_cache_session(svn_boolean_t *moved,
+                   watcher_t *w,
+                   svn_sqlite__db_t *sdb,
+                   const char *session,
+                   apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  const char *cache_session;
+  apr_int64_t offset;
+
+  SVN_ERR(get_journal_position(&cache_session, &offset, sdb, scratch_pool));
+
+  *moved = FALSE;
+  if (!cache_session || strcmp(cache_session, w->session) != 0)
+    {
+      /* Readers will drop the cache in any case. */
+      *moved = TRUE;
+    }
+  else if (offset == w->journal_size)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_UPDATE_JOURNAL));
+      SVN_ERR(svn_sqlite__bindf(stmt, "sL", session,
+                                (apr_int64_t)(sizeof(JOURNAL_HEADER) - 1
+                                              + strlen(session) + 1)));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+      *moved = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MOVED as move_cache_session() does for the cache of W, opening it
+   first.  Set *MOVED to TRUE if there is no cache. */
+static svn_error_t *
+move_cache(svn_boolean_t *moved,
+           watcher_t *w,
+           const char *session,
+           apr_pool_t *scratch_pool)
+{
+  const char *cache_path = svn_wc__adm_child(w->wcroot_abspath,
+                                             SVN_WC__ADM_MONITOR_CACHE,
+                                             scratch_pool);
+  svn_sqlite__db_t *sdb;
+  svn_node_kind_t kind;
+  int version;
+
+  *moved = FALSE;
+
+  SVN_ERR(svn_io_check_path(cache_path, &kind, scratch_pool));
+  if (kind == svn_node_none)
+    {
+      *moved = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_sqlite__open(&sdb, cache_path, svn_sqlite__mode_readwrite,
+                           statements, 0, NULL, 0, scratch_pool,
+                           scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb,
+                                                        scratch_pool),
+                        sdb);
+  if (version <= 0)
+    *moved = TRUE;
+  else
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(move_cache_session(moved, w, sdb,
+                                                      session, scratch_pool),
+                                   sdb);
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+/* Start a new session in W if its journal got large and the readers
+   applied all of it to their cache.  Do so as well if the journal got
+   excessively large, even if that means that the readers have to drop
+   their cache. */
+static svn_error_t *
+rotate_journal(watcher_t *w,
+               apr_pool_t *scratch_pool)
+{
+  const char *session;
+  svn_boolean_t moved;
+  svn_error_t *err;
+
+  if (w->journal_size < ROTATE_JOURNAL_SIZE)
+    return SVN_NO_ERROR;
+
+  /* Readers keep a transaction open while they apply the journal, so
+     we can't miss any of them catching up.  If the cache is not
+     accessible right now, simply try again later. */
+  session = svn_uuid_generate(scratch_pool);
+  err = move_cache(&moved, w, session, scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      moved = FALSE;
+    }
+
+  if (moved || w->journal_size >= FORCE_ROTATE_JOURNAL_SIZE)
+    SVN_ERR(start_session(w, session, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait for events on W and record them until CANCEL_FUNC returns an
+   error. */
+static svn_error_t *
+watch(watcher_t *w,
+      svn_cancel_func_t cancel_func,
+      void *cancel_baton,
+      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      struct pollfd pfd;
+      ssize_t len;
+      char *p;
+      int rc;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      pfd.fd = w->fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      rc = poll(&pfd, 1, POLL_TIMEOUT);
+      if (rc < 0 && errno != EINTR)
+        return svn_error_wrap_apr(apr_get_os_error(),
+                                  _("Can't wait for changes"));
+      if (rc <= 0)
+        continue;
+
+      len = read(w->fd, w->buffer, EVENT_BUFFER_SIZE);
+      if (len < 0 && errno != EINTR && errno != EAGAIN)
+        return svn_error_wrap_apr(apr_get_os_error(),
+                                  _("Can't read changes"));
+
+      for (p = w->buffer; len > 0 && p < w->buffer + len; )
+        {
+          const struct inotify_event *event = (const void *)p;
+
+          SVN_ERR(handle_event(w, event, iterpool));
+          p += sizeof(*event) + event->len;
+        }
+
+      if (w->records->len)
+        {
+          SVN_ERR(svn_io_file_write_full(w->journal, w->records->data,
+                                         w->records->len, NULL, iterpool));
+          w->journal_size += w->records->len;
+          svn_stringbuf_setempty(w->records);
+
+          SVN_ERR(rotate_journal(w, iterpool));
+        }
+    }
+}
+
+/* Pool cleanup function closing the inotify instance in DATA. */
+static apr_status_t
+close_inotify(void *data)
+{
+  watcher_t *w = data;
+
+  close(w->fd);
+
+  return APR_SUCCESS;
+}
+
+#endif /* __linux__ */
+
+svn_error_t *
+svn_wc__monitor_run(svn_wc_context_t *wc_ctx,
+                    const char *local_abspath,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+#if __linux__
+  watcher_t *w = apr_pcalloc(scratch_pool, sizeof(*w));
+  const char *journal_path;
+  const char *tmp_abspath;
+  const char *native_path;
+  svn_error_t *err;
+
+  w->pool = scratch_pool;
+  w->watches = apr_hash_make(scratch_pool);
+  w->records = svn_stringbuf_create_empty(scratch_pool);
+  w->buffer = apr_palloc(scratch_pool, EVENT_BUFFER_SIZE);
+
+  SVN_ERR(svn_wc__db_get_wcroot(&w->wcroot_abspath, wc_ctx->db,
+                                local_abspath, scratch_pool, scratch_pool));
+
+  journal_path = svn_wc__adm_child(w->wcroot_abspath,
+                                   SVN_WC__ADM_MONITOR_JOURNAL,
+                                   scratch_pool);
+  SVN_ERR(svn_io_file_open(&w->journal, journal_path,
+                           APR_WRITE | APR_CREATE | APR_APPEND,
+                           APR_OS_DEFAULT, scratch_pool));
+  err = svn_io_lock_open_file(w->journal, TRUE, TRUE, scratch_pool);
+  if (err)
+    return svn_error_createf(SVN_ERR_WC_LOCKED, err,
+                             _("Working copy '%s' is already being "
+                               "monitored"),
+                             svn_dirent_local_style(w->wcroot_abspath,
+                                                    scratch_pool));
+
+  /* Readers ignore a journal without a header, so they won't use it
+     until we watch everything. */
+  SVN_ERR(svn_io_file_trunc(w->journal, 0, scratch_pool));
+
+  w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (w->fd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't initialize inotify"));
+  apr_pool_cleanup_register(scratch_pool, w, close_inotify,
+                            apr_pool_cleanup_null);
+
+  /* Readers create their cookies here. */
+  tmp_abspath = svn_wc__adm_child(w->wcroot_abspath, SVN_WC__ADM_TMP,
+                                  scratch_pool);
+  SVN_ERR(svn_path_cstring_from_utf8(&native_path, tmp_abspath,
+                                     scratch_pool));
+  w->tmp_wd = inotify_add_watch(w->fd, native_path, IN_CREATE | IN_ONLYDIR);
+  if (w->tmp_wd < 0)
+    return svn_error_trace(watch_error(tmp_abspath, scratch_pool));
+
+  SVN_ERR(add_watches(w, "", scratch_pool));
+
+  SVN_ERR(start_session(w, svn_uuid_generate(scratch_pool), scratch_pool));
+
+  err = watch(w, cancel_func, cancel_baton, scratch_pool);
+
+  /* Remove the journal while still holding the lock, so readers won't
+     find a journal that nobody keeps up to date. */
+  err = svn_error_compose_create(err, svn_io_remove_file2(journal_path, TRUE,
+                                                          scratch_pool));
+  err = svn_error_compose_create(err, svn_io_file_close(w->journal,
+                                                        scratch_pool));
+
+  return svn_error_trace(err);
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Monitoring working copies is not supported "
+                            "on this platform"));
+#endif
+}
@@ -0,0 +1,105 @@
+/*
+ * monitor.h :  reusing directory entries recorded by a working copy monitor
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#ifndef SVN_LIBSVN_WC_MONITOR_H
+#define SVN_LIBSVN_WC_MONITOR_H
+
+#include <apr_pools.h>
+#include <apr_hash.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* While svn_wc__monitor_run() watches a working copy, it appends the paths
+   of all changed nodes to a journal in the administrative area.  Readers
+   use that journal to keep a cache of directory entries up to date, so
+   that the status walk does not have to read directories that did not
+   change on disk since the last walk.
+
+   The cache is only ever used while the monitor is running and after it
+   confirmed that it has seen all changes made before the cache got opened.
+   Otherwise, svn_wc__monitor_open() returns no cache. */
+typedef struct svn_wc__monitor_t svn_wc__monitor_t;
+
+/* Set *MONITOR to the directory entry cache of the working copy rooted at
+   WCROOT_ABSPATH, allocated in RESULT_POOL, or to NULL if that working copy
+   is not being monitored.  Use SCRATCH_POOL for temporary allocations.
+
+   Problems with the monitor or its cache are not reported as errors but
+   result in *MONITOR being NULL as well. */
+svn_error_t *
+svn_wc__monitor_open(svn_wc__monitor_t **monitor,
+                     const char *wcroot_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Like svn_wc__monitor_open() but open the cache even if no monitor is
+   running and don't wait for one to report all changes made before now.
+   Problems with the journal or the cache are reported as errors.
+
+   This trusts the journal to be complete and is meant for testing. */
+svn_error_t *
+svn_wc__monitor_open_unsynced(svn_wc__monitor_t **monitor,
+                              const char *wcroot_abspath,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+/* Set *DIRENTS to the cached entries of the directory LOCAL_ABSPATH, as
+   svn_io_get_dirents3() would return them without ONLY_CHECK_TYPE, or to
+   NULL if they are not known or the cache cannot be read.  Allocate
+   *DIRENTS in RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__monitor_get_dirents(apr_hash_t **dirents,
+                            svn_wc__monitor_t *monitor,
+                            const char *local_abspath,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Remember DIRENTS, as just read by svn_io_get_dirents3() without
+   ONLY_CHECK_TYPE, as the entries of the directory LOCAL_ABSPATH in
+   MONITOR.  Failures to write them to the cache are not reported as
+   errors.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__monitor_set_dirents(svn_wc__monitor_t *monitor,
+                            const char *local_abspath,
+                            apr_hash_t *dirents,
+                            apr_pool_t *scratch_pool);
+
+/* Write all entries passed to svn_wc__monitor_set_dirents() to the cache
+   and close MONITOR.  Failures to write the cache are not reported as
+   errors.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__monitor_close(svn_wc__monitor_t *monitor,
+                      apr_pool_t *scratch_pool);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_WC_MONITOR_H */
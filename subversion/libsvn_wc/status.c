@@ -46,11 +46,13 @@
 
 #include "wc.h"
 #include "props.h"
+#include "monitor.h"
 
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_editor.h"
+#include "private/svn_task_group.h"
 
 
 /* The file internal variant of svn_wc_status3_t, with slightly more
@@ -75,6 +77,9 @@ typedef struct svn_wc__internal_status_t
 } svn_wc__internal_status_t;
 
 
+/* Reads directories ahead of the status walk on worker threads. */
+typedef struct dirent_prefetch_t dirent_prefetch_t;
+
 /*** Baton used for walking the local status */
 struct walk_status_baton
 {
@@ -100,6 +105,15 @@ struct walk_status_baton
 
   /* Repository locks, if set. */
   apr_hash_t *repos_locks;
+
+  /*** Reading ahead ***/
+  /* Reads the entries of subdirectories before the walk gets to them.
+     NULL if the directories are being read as the walk reaches them. */
+  dirent_prefetch_t *prefetch;
+
+  /* Entries of directories that did not change since the last walk, if
+     the working copy is being monitored.  NULL otherwise. */
+  svn_wc__monitor_t *monitor;
 };
 
 /*** Editor batons ***/
@@ -1023,6 +1037,253 @@ send_unversioned_item(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/*** Reading directories ahead ***/
+
+/* Number of subdirectories of a directory whose entries may be read ahead
+   of the status walk.  Every directory between the walk root and the
+   current directory may have that many of them waiting, so this also
+   limits the memory used for entries that have not been walked yet. */
+#define PREFETCH_WINDOW 16
+
+#if APR_HAS_THREADS
+
+/* Maximum number of threads reading directories for one status walk. */
+#define PREFETCH_MAX_THREADS 16
+
+/* The entries of one directory, as read by a worker thread. */
+typedef struct prefetched_dir_t
+{
+  /* The directory and its entries, allocated in POOL. */
+  const char *local_abspath;
+  apr_hash_t *dirents;
+
+  /* Root pool owned by this entry. */
+  apr_pool_t *pool;
+
+  /* The prefetcher that queued this entry. */
+  dirent_prefetch_t *prefetch;
+
+  /* The following members are protected by PREFETCH->GROUP. */
+
+  /* Set once the worker is done with this entry. */
+  svn_boolean_t done;
+
+  /* Set if DIRENTS could not be read. */
+  svn_boolean_t failed;
+} prefetched_dir_t;
+
+struct dirent_prefetch_t
+{
+  /* Passed on to svn_io_get_dirents3(). */
+  svn_boolean_t only_check_type;
+
+  /* Contains everything below and gets destroyed by prefetch_destroy(). */
+  apr_pool_t *pool;
+
+  /* The workers.  Destroyed after GROUP has been shut down. */
+  apr_thread_pool_t *thread_pool;
+
+  /* The tasks reading directories. */
+  svn_task_group__t *group;
+
+  /* Maps the abspaths of all directories that have been queued but not
+     been taken by the walk yet to their prefetched_dir_t *.  Only the
+     walking thread accesses this. */
+  apr_hash_t *dirs;
+};
+
+/* Pool cleanup function destroying the root pool given as DATA. */
+static apr_status_t
+destroy_root_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* Thread pool task reading the entries of the prefetched_dir_t in DATA. */
+static void * APR_THREAD_FUNC
+prefetch_dir_task(apr_thread_t *tid,
+                  void *data)
+{
+  prefetched_dir_t *dir = data;
+  dirent_prefetch_t *prefetch = dir->prefetch;
+  svn_boolean_t proceed;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  svn_task_group__lock(prefetch->group);
+  proceed = svn_task_group__task_begin(prefetch->group);
+  svn_task_group__unlock(prefetch->group);
+
+  if (proceed)
+    err = svn_io_get_dirents3(&dir->dirents, dir->local_abspath,
+                              prefetch->only_check_type,
+                              dir->pool, dir->pool);
+
+  svn_task_group__lock(prefetch->group);
+  dir->failed = (!proceed || err);
+  dir->done = TRUE;
+  svn_task_group__task_end(prefetch->group);
+  svn_task_group__unlock(prefetch->group);
+
+  /* The walk will read the directory itself and handle the error. */
+  svn_error_clear(err);
+
+  return NULL;
+}
+
+/* Pool cleanup function shutting down the dirent_prefetch_t given as
+   DATA.  Makes sure that no task is queued or running anymore. */
+static apr_status_t
+prefetch_cleanup(void *data)
+{
+  dirent_prefetch_t *prefetch = data;
+  apr_hash_index_t *hi;
+
+  svn_task_group__shutdown(prefetch->group, prefetch->thread_pool);
+
+  /* No worker is accessing PREFETCH anymore. */
+  for (hi = apr_hash_first(NULL, prefetch->dirs); hi; hi = apr_hash_next(hi))
+    {
+      prefetched_dir_t *dir = apr_hash_this_val(hi);
+      svn_pool_destroy(dir->pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+/* Set *PREFETCH_P to a new prefetcher, allocated in a sub-pool of
+   RESULT_POOL, that reads directories for the status walk using
+   ONLY_CHECK_TYPE.  Set it to NULL if reading ahead is not supported. */
+static svn_error_t *
+prefetch_create(dirent_prefetch_t **prefetch_p,
+                svn_boolean_t only_check_type,
+                apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS
+  apr_pool_t *pool = svn_pool_create(result_pool);
+  dirent_prefetch_t *prefetch = apr_pcalloc(pool, sizeof(*prefetch));
+
+  prefetch->only_check_type = only_check_type;
+  prefetch->pool = pool;
+  prefetch->dirs = apr_hash_make(pool);
+
+  /* Threads only get created once there is something to read. */
+  SVN_ERR(svn_task_group__create_thread_pool(&prefetch->thread_pool,
+                                             PREFETCH_MAX_THREADS, pool));
+  SVN_ERR(svn_task_group__create(&prefetch->group, pool));
+
+  /* Register this last, so the cleanup runs before the thread pool and
+     the group get destroyed. */
+  apr_pool_cleanup_register(pool, prefetch, prefetch_cleanup,
+                            apr_pool_cleanup_null);
+
+  *prefetch_p = prefetch;
+#else
+  *prefetch_p = NULL;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Shut down PREFETCH and release its threads.  PREFETCH may be NULL. */
+static void
+prefetch_destroy(dirent_prefetch_t *prefetch)
+{
+#if APR_HAS_THREADS
+  if (prefetch)
+    svn_pool_destroy(prefetch->pool);
+#endif
+}
+
+/* Queue reading the entries of the directory LOCAL_ABSPATH in PREFETCH. */
+static void
+prefetch_dir(dirent_prefetch_t *prefetch,
+             const char *local_abspath)
+{
+#if APR_HAS_THREADS
+  apr_pool_t *pool;
+  prefetched_dir_t *dir;
+  apr_status_t status;
+
+  if (svn_hash_gets(prefetch->dirs, local_abspath))
+    return;
+
+  pool = svn_pool_create(NULL);
+  dir = apr_pcalloc(pool, sizeof(*dir));
+  dir->local_abspath = apr_pstrdup(pool, local_abspath);
+  dir->pool = pool;
+  dir->prefetch = prefetch;
+
+  svn_task_group__lock(prefetch->group);
+  status = svn_task_group__push(prefetch->group, prefetch->thread_pool,
+                                prefetch_dir_task, dir);
+  svn_task_group__unlock(prefetch->group);
+
+  /* Not reading ahead is no error.  The walk will read it itself. */
+  if (status)
+    svn_pool_destroy(pool);
+  else
+    svn_hash_sets(prefetch->dirs, dir->local_abspath, dir);
+#endif
+}
+
+/* If the entries of LOCAL_ABSPATH have been queued in PREFETCH, wait for
+   them and set *DIRENTS to them, kept alive as long as RESULT_POOL.  Set
+   *DIRENTS to NULL if they have not been queued or could not be read. */
+static void
+take_prefetched_dir(apr_hash_t **dirents,
+                    dirent_prefetch_t *prefetch,
+                    const char *local_abspath,
+                    apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS
+  prefetched_dir_t *dir = svn_hash_gets(prefetch->dirs, local_abspath);
+
+  *dirents = NULL;
+  if (!dir)
+    return;
+
+  svn_hash_sets(prefetch->dirs, local_abspath, NULL);
+
+  svn_task_group__lock(prefetch->group);
+  while (!dir->done)
+    svn_task_group__wait(prefetch->group);
+  svn_task_group__unlock(prefetch->group);
+
+  if (dir->failed)
+    {
+      svn_pool_destroy(dir->pool);
+      return;
+    }
+
+  *dirents = dir->dirents;
+  apr_pool_cleanup_register(result_pool, dir->pool, destroy_root_pool,
+                            apr_pool_cleanup_null);
+#else
+  *dirents = NULL;
+#endif
+}
+
+/* Return TRUE if the status walk will descend into the child described by
+   INFO and DIRENT and needs to read its entries from disk. */
+static svn_boolean_t
+walks_into_dir(const struct svn_wc__db_info_t *info,
+               const svn_io_dirent2_t *dirent)
+{
+  return (info
+          && dirent
+          && dirent->kind == svn_node_dir
+          && info->has_descendants
+          && info->status != svn_wc__db_status_not_present
+          && info->status != svn_wc__db_status_excluded
+          && info->status != svn_wc__db_status_server_excluded
+          && !(info->kind == svn_node_unknown
+               && info->status == svn_wc__db_status_normal));
+}
+
+
 static svn_error_t *
 get_dir_status(const struct walk_status_baton *wb,
                const char *local_abspath,
@@ -1235,6 +1496,8 @@ get_dir_status(const struct walk_status_baton *wb,
   apr_array_header_t *collected_ignore_patterns = NULL;
   apr_pool_t *iterpool;
   svn_error_t *err;
+  int ahead = 0;
+  int next = 0;
   int i;
 
   if (cancel_func)
@@ -1245,7 +1508,16 @@ get_dir_status(const struct walk_status_baton *wb,
 
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
+  dirents = NULL;
+  if (wb->monitor)
+    SVN_ERR(svn_wc__monitor_get_dirents(&dirents, wb->monitor, local_abspath,
+                                        scratch_pool, iterpool));
+  else if (wb->prefetch)
+    take_prefetched_dir(&dirents, wb->prefetch, local_abspath, scratch_pool);
+
+  /* Read the entries ourselves unless they are unchanged since the last
+     walk or have been read ahead by a worker thread. */
+  if (!dirents && wb->check_working_copy)
     {
       err = svn_io_get_dirents3(&dirents, local_abspath,
                                 wb->ignore_text_mods /* only_check_type*/,
@@ -1259,8 +1531,14 @@ get_dir_status(const struct walk_status_baton *wb,
         }
       else
         SVN_ERR(err);
+
+      if (wb->monitor && !err)
+        SVN_ERR(svn_wc__monitor_set_dirents(wb->monitor, local_abspath,
+                                            dirents, iterpool));
     }
-  else
+
+  /* Without checking the working copy, there is nothing on disk. */
+  if (!dirents)
     dirents = apr_hash_make(scratch_pool);
 
   if (!dir_info)
@@ -1359,6 +1637,33 @@ get_dir_status(const struct walk_status_baton *wb,
       child_dirent = apr_hash_get(dirents, key, klen);
       child_info = apr_hash_get(nodes, key, klen);
 
+      /* Keep the entries of the next few subdirectories coming while we
+         walk this child.  Reading ahead ends at this directory's
+         children, so the walk order does not change. */
+      if (wb->prefetch && depth == svn_depth_infinity)
+        {
+          for (; next < sorted_children->nelts && ahead < PREFETCH_WINDOW;
+               next++)
+            {
+              svn_sort__item_t next_item
+                = APR_ARRAY_IDX(sorted_children, next, svn_sort__item_t);
+
+              if (walks_into_dir(apr_hash_get(nodes, next_item.key,
+                                              next_item.klen),
+                                 apr_hash_get(dirents, next_item.key,
+                                              next_item.klen)))
+                {
+                  prefetch_dir(wb->prefetch,
+                               svn_dirent_join(local_abspath,
+                                               next_item.key, iterpool));
+                  ahead++;
+                }
+            }
+
+          if (walks_into_dir(child_info, child_dirent))
+            ahead--;
+        }
+
       SVN_ERR(one_child_status(wb,
                                child_abspath,
                                local_abspath,
@@ -2513,6 +2818,8 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.check_working_copy = check_working_copy;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
+  eb->wb.prefetch         = NULL;
+  eb->wb.monitor          = NULL;
 
   SVN_ERR(svn_wc__db_externals_defined_below(&eb->wb.externals,
                                              wc_ctx->db, eb->target_abspath,
@@ -2644,6 +2951,8 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.check_working_copy = TRUE;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
+  wb.prefetch = NULL;
+  wb.monitor = NULL;
 
   /* Use the caller-provided ignore patterns if provided; the build-time
      configured defaults otherwise. */
@@ -2690,19 +2999,44 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
       && info->status != svn_wc__db_status_excluded
       && info->status != svn_wc__db_status_server_excluded)
     {
-      SVN_ERR(get_dir_status(&wb,
-                             local_abspath,
-                             FALSE /* skip_root */,
-                             NULL, NULL, NULL,
-                             info,
-                             dirent,
-                             ignore_patterns,
-                             depth,
-                             get_all,
-                             no_ignore,
-                             status_func, status_baton,
-                             cancel_func, cancel_baton,
-                             scratch_pool));
+      /* The monitor cache only has complete entries. */
+      if (!ignore_text_mods)
+        {
+          const char *wcroot_abspath;
+
+          SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, db, local_abspath,
+                                        scratch_pool, scratch_pool));
+          SVN_ERR(svn_wc__monitor_open(&wb.monitor, wcroot_abspath,
+                                       scratch_pool, scratch_pool));
+        }
+
+      /* Only deep walks have subdirectories to read ahead.  With a
+         monitor, most directories won't have to be read at all. */
+      if (!wb.monitor
+          && (depth == svn_depth_infinity || depth == svn_depth_unknown))
+        SVN_ERR(prefetch_create(&wb.prefetch, ignore_text_mods,
+                                scratch_pool));
+
+      err = get_dir_status(&wb,
+                           local_abspath,
+                           FALSE /* skip_root */,
+                           NULL, NULL, NULL,
+                           info,
+                           dirent,
+                           ignore_patterns,
+                           depth,
+                           get_all,
+                           no_ignore,
+                           status_func, status_baton,
+                           cancel_func, cancel_baton,
+                           scratch_pool);
+
+      prefetch_destroy(wb.prefetch);
+      if (wb.monitor)
+        err = svn_error_compose_create(err,
+                                       svn_wc__monitor_close(wb.monitor,
+                                                             scratch_pool));
+      SVN_ERR(err);
     }
   else
     {
@@ -209,6 +209,12 @@ struct edit_baton
      of conflict checks to be omitted. */
   svn_boolean_t clean_checkout;
 
+  /* If set, the changes to the working copy are collected in a bulk
+     transaction (see svn_wc__db_bulk_begin()).  BULK_NODES counts the
+     nodes changed since that transaction was last committed. */
+  svn_boolean_t bulk;
+  int bulk_nodes;
+
   /* If this is a 'switch' operation, the new relpath of target_abspath,
      else NULL. */
   const char *switch_repos_relpath;
@@ -468,18 +474,68 @@ get_empty_tmp_file(const char **tmp_filename,
   return SVN_NO_ERROR;
 }
 
+/* Number of nodes changed in a bulk transaction before it gets committed
+   and the queued work items are run. */
+#define BULK_FLUSH_NODES 5000
+
+/* If EB is in bulk mode, commit the changes made so far, so that they are
+   safe to act upon outside of this edit.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+flush_bulk(struct edit_baton *eb,
+           apr_pool_t *scratch_pool)
+{
+  if (eb->bulk)
+    {
+      SVN_ERR(svn_wc__db_bulk_flush(eb->db, eb->wcroot_abspath,
+                                    scratch_pool));
+      eb->bulk_nodes = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the work queue of the working copy of EB, like svn_wc__wq_run() does
+   for LOCAL_ABSPATH.
+
+   In bulk mode, work items may only run after the changes that queued them
+   have been committed, or an interrupted edit could leave files behind
+   that the working copy does not know about.  So commit the pending changes
+   first.  Unless FORCE is set, don't do that before BULK_FLUSH_NODES nodes
+   have been changed.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_work_queue(struct edit_baton *eb,
+               const char *local_abspath,
+               svn_boolean_t force,
+               apr_pool_t *scratch_pool)
+{
+  if (eb->bulk && !force && eb->bulk_nodes < BULK_FLUSH_NODES)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(flush_bulk(eb, scratch_pool));
+
+  return svn_error_trace(svn_wc__wq_run(eb->db, local_abspath,
+                                        eb->cancel_func, eb->cancel_baton,
+                                        scratch_pool));
+}
+
 /* An APR pool cleanup handler.  This runs the working queue for an
    editor baton. */
 static apr_status_t
 cleanup_edit_baton(void *edit_baton)
 {
   struct edit_baton *eb = edit_baton;
-  svn_error_t *err;
+  svn_error_t *err = SVN_NO_ERROR;
   apr_pool_t *pool = apr_pool_parent_get(eb->pool);
 
-  err = svn_wc__wq_run(eb->db, eb->wcroot_abspath,
-                       NULL /* cancel_func */, NULL /* cancel_baton */,
-                       pool);
+  /* Everything up to the failing change is consistent, so commit it. */
+  if (eb->bulk)
+    err = svn_wc__db_bulk_end(eb->db, eb->wcroot_abspath, pool);
+
+  if (!err)
+    err = svn_wc__wq_run(eb->db, eb->wcroot_abspath,
+                         NULL /* cancel_func */, NULL /* cancel_baton */,
+                         pool);
 
   if (err)
     {
@@ -1169,6 +1225,15 @@ open_root(void *edit_baton,
      edit run. */
   eb->root_opened = TRUE;
 
+  /* Checkouts and updates that pull in complete trees add so many nodes
+     that committing each of them on its own dominates their run time. */
+  if (eb->clean_checkout
+      || (eb->depth_is_sticky && eb->requested_depth == svn_depth_infinity))
+    {
+      SVN_ERR(svn_wc__db_bulk_begin(eb->db, eb->wcroot_abspath, pool));
+      eb->bulk = TRUE;
+    }
+
   SVN_ERR(make_dir_baton(&db, NULL, eb, NULL, FALSE, pool));
   *dir_baton = db;
 
@@ -1808,9 +1873,9 @@ delete_entry(const char *path,
         }
     }
 
-  SVN_ERR(svn_wc__wq_run(eb->db, pb->local_abspath,
-                         eb->cancel_func, eb->cancel_baton,
-                         scratch_pool));
+  /* A node added in place of this one would be obstructed until the
+     deletion is done. */
+  SVN_ERR(run_work_queue(eb, pb->local_abspath, TRUE, scratch_pool));
 
   /* Notify. */
   if (tree_conflict)
@@ -2816,23 +2881,25 @@ close_directory(void *dir_baton,
     }
 
   /* Process all of the queued work items for this directory.  */
-  SVN_ERR(svn_wc__wq_run(eb->db, db->local_abspath,
-                         eb->cancel_func, eb->cancel_baton,
-                         scratch_pool));
+  eb->bulk_nodes++;
+  SVN_ERR(run_work_queue(eb, db->local_abspath, FALSE, scratch_pool));
 
   if (db->parent_baton)
     svn_hash_sets(db->parent_baton->not_present_nodes, db->name, NULL);
 
   if (conflict_skel && eb->conflict_func)
-    SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, db->local_abspath,
-                                             svn_node_dir,
-                                             conflict_skel,
-                                             NULL /* merge_options */,
-                                             eb->conflict_func,
-                                             eb->conflict_baton,
-                                             eb->cancel_func,
-                                             eb->cancel_baton,
-                                             scratch_pool));
+    {
+      SVN_ERR(flush_bulk(eb, scratch_pool));
+      SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, db->local_abspath,
+                                               svn_node_dir,
+                                               conflict_skel,
+                                               NULL /* merge_options */,
+                                               eb->conflict_func,
+                                               eb->conflict_baton,
+                                               eb->cancel_func,
+                                               eb->cancel_baton,
+                                               scratch_pool));
+    }
 
   /* Notify of any prop changes on this directory -- but do nothing if
      it's an added or skipped directory, because notification has already
@@ -3033,15 +3100,18 @@ absent_node(const char *path,
     if (tree_conflict)
       {
         if (eb->conflict_func)
-          SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, local_abspath,
-                                                   kind,
-                                                   tree_conflict,
-                                                   NULL /* merge_options */,
-                                                   eb->conflict_func,
-                                                   eb->conflict_baton,
-                                                   eb->cancel_func,
-                                                   eb->cancel_baton,
-                                                   scratch_pool));
+          {
+            SVN_ERR(flush_bulk(eb, scratch_pool));
+            SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, local_abspath,
+                                                     kind,
+                                                     tree_conflict,
+                                                     NULL /* merge_options */,
+                                                     eb->conflict_func,
+                                                     eb->conflict_baton,
+                                                     eb->cancel_func,
+                                                     eb->cancel_baton,
+                                                     scratch_pool));
+          }
         do_notification(eb, local_abspath, kind, svn_wc_notify_tree_conflict,
                         scratch_pool);
       }
@@ -4558,6 +4628,7 @@ close_file(void *file_baton,
         svn_hash_sets(eb->wcroot_iprops, fb->local_abspath, NULL);
     }
 
+  eb->bulk_nodes++;
   SVN_ERR(svn_wc__db_base_add_file(eb->db, fb->local_abspath,
                                    eb->wcroot_abspath,
                                    fb->new_repos_relpath,
@@ -4584,15 +4655,18 @@ close_file(void *file_baton,
                                    scratch_pool));
 
   if (conflict_skel && eb->conflict_func)
-    SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, fb->local_abspath,
-                                             svn_node_file,
-                                             conflict_skel,
-                                             NULL /* merge_options */,
-                                             eb->conflict_func,
-                                             eb->conflict_baton,
-                                             eb->cancel_func,
-                                             eb->cancel_baton,
-                                             scratch_pool));
+    {
+      SVN_ERR(flush_bulk(eb, scratch_pool));
+      SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, fb->local_abspath,
+                                               svn_node_file,
+                                               conflict_skel,
+                                               NULL /* merge_options */,
+                                               eb->conflict_func,
+                                               eb->conflict_baton,
+                                               eb->cancel_func,
+                                               eb->cancel_baton,
+                                               scratch_pool));
+    }
 
   /* Deal with the WORKING tree, based on updates to the BASE tree.  */
 
@@ -4735,6 +4809,12 @@ close_edit(void *edit_baton,
   struct edit_baton *eb = edit_baton;
   apr_pool_t *scratch_pool = eb->pool;
 
+  if (eb->bulk)
+    {
+      eb->bulk = FALSE;
+      SVN_ERR(svn_wc__db_bulk_end(eb->db, eb->wcroot_abspath, scratch_pool));
+    }
+
   /* The editor didn't even open the root; we have to take care of
      some cleanup stuffs. */
   if (! eb->root_opened
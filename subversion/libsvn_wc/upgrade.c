@@ -1696,8 +1696,13 @@ svn_wc__upgrade_sdb(int *result_format,
         /* FALLTHROUGH  */
 #endif
       case SVN_WC__VERSION:
-        /* already upgraded */
-        *result_format = SVN_WC__VERSION;
+      case SVN_WC__HAS_COMPRESSED_PRISTINES:
+        /* already upgraded.  Format 32 is only entered on demand, when the
+           first compressed pristine text is stored, so keep it. */
+        if (start_format > SVN_WC__VERSION)
+          *result_format = start_format;
+        else
+          *result_format = SVN_WC__VERSION;
 
         SVN_SQLITE__WITH_LOCK(
             svn_wc__db_install_schema_statistics(sdb, scratch_pool),
@@ -1933,7 +1938,8 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
       /* Auto-upgrade worked! */
       SVN_ERR(svn_wc__db_close(db));
 
-      SVN_ERR_ASSERT(result_format == SVN_WC__VERSION);
+      SVN_ERR_ASSERT(result_format >= SVN_WC__VERSION
+                     && result_format <= SVN_WC__MAX_VERSION);
 
       if (bumped_format && notify_func)
         {
@@ -80,7 +80,8 @@ CREATE UNIQUE INDEX I_LOCAL_ABSPATH ON WCROOT (local_abspath);
    derived from the 'checksum' column.  Each pristine text is referenced by
    any number of rows in the NODES and ACTUAL_NODE tables.
 
-   In future, the pristine text file may be compressed.
+   The file may hold the pristine text compressed, as indicated by the
+   'compression' column.
  */
 CREATE TABLE PRISTINE (
   /* The SHA-1 checksum of the pristine text. This is a unique key. The
@@ -88,12 +89,16 @@ CREATE TABLE PRISTINE (
      pristine texts referenced from this database. */
   checksum  TEXT NOT NULL PRIMARY KEY,
 
-  /* Enumerated values specifying type of compression. The only value
-     supported so far is NULL, meaning that no compression has been applied
-     and the pristine text is stored verbatim in the file. */
+  /* Enumerated values specifying type of compression. NULL means that no
+     compression has been applied and the pristine text is stored verbatim
+     in the file.  1 means that the file holds the text as a sequence of
+     LZ4 compressed blocks (format 32 and later).  Compressed texts are
+     stored in files with a different extension, so that older clients
+     don't mistake them for verbatim texts. */
   compression  INTEGER,
 
-  /* The size in bytes of the file in which the pristine text is stored.
+  /* The size in bytes of the pristine text, which is also the size of the
+     file in which it is stored, unless that file is compressed.
      Used to verify the pristine file is "proper". */
   size  INTEGER NOT NULL,
 
@@ -699,9 +704,17 @@ WHERE l.op_depth = 0
 
 
 /* ------------------------------------------------------------------------- */
-/* Format 32 ....  */
-/* -- STMT_UPGRADE_TO_32
-PRAGMA user_version = 32; */
+/* Format 32 allows the compression column of the PRISTINE table to be set.
+   Older clients would not find the compressed texts, so they must not open
+   working copies that may contain them.  Working copies are not upgraded to
+   this format, but bumped when the first compressed text is stored. */
+-- STMT_UPGRADE_TO_32
+PRAGMA user_version = 32;
+
+/* ------------------------------------------------------------------------- */
+/* Format 33 ....  */
+/* -- STMT_UPGRADE_TO_33
+PRAGMA user_version = 33; */
 
 
 /* ------------------------------------------------------------------------- */
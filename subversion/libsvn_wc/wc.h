@@ -161,11 +161,20 @@ extern "C" {
  * == 1.9.x shipped with format 31
  * == 1.10.x shipped with format 31
  *
+ * The bump to 32 allows pristine texts to be stored LZ4-compressed, as
+ * marked by the compression column of the PRISTINE table.  Working copies
+ * are only bumped to 32 when the first compressed pristine text is stored
+ * in them, so format 31 remains fully supported.
+ *
  * Please document any further format changes here.
  */
 
 #define SVN_WC__VERSION 31
 
+/* The newest format this client can work with.  Formats between
+   SVN_WC__VERSION and this are entered on demand, see above. */
+#define SVN_WC__MAX_VERSION 32
+
 
 /* Formats <= this have no concept of "revert text-base/props".  */
 #define SVN_WC__NO_REVERT_FILES 4
@@ -196,6 +205,9 @@ extern "C" {
    sqlite_stat1 table on opening */
 #define SVN_WC__ENSURE_STAT1_TABLE 31
 
+/* A version < this stores all pristine texts verbatim. */
+#define SVN_WC__HAS_COMPRESSED_PRISTINES 32
+
 /* Return a string indicating the released version (or versions) of
  * Subversion that used WC format number WC_FORMAT, or some other
  * suitable string if no released version used WC_FORMAT.
@@ -290,6 +302,8 @@ struct svn_wc_traversal_info_t
 #define SVN_WC__ADM_PRISTINE            "pristine"
 #define SVN_WC__ADM_NONEXISTENT_PATH    "nonexistent-path"
 #define SVN_WC__ADM_EXPERIMENTAL        "experimental"
+#define SVN_WC__ADM_MONITOR_JOURNAL     "monitor-journal"
+#define SVN_WC__ADM_MONITOR_CACHE       "monitor-cache.db"
 
 /* The basename of the ".prej" file, if a directory ever has property
    conflicts.  This .prej file will appear *within* the conflicted
@@ -1613,6 +1613,92 @@ svn_wc__db_get_wcroot(const char **wcroot_abspath,
 }
 
 
+svn_error_t *
+svn_wc__db_bulk_begin(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_ERR_ASSERT(! wcroot->bulk_txn);
+
+  SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb,
+                                      STMT_PRAGMA_BULK_CACHE_SIZE));
+
+  /* Take the 'RESERVED' lock right away, like the pristine install and
+     remove transactions that now become part of this one would. */
+  SVN_ERR(svn_sqlite__begin_immediate_transaction(wcroot->sdb));
+  wcroot->bulk_txn = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit the bulk transaction of WCROOT, if there is one.  Start a new one
+   if RESTART is TRUE. */
+static svn_error_t *
+bulk_commit(svn_wc__db_wcroot_t *wcroot,
+            svn_boolean_t restart)
+{
+  if (! wcroot->bulk_txn)
+    return SVN_NO_ERROR;
+
+  wcroot->bulk_txn = FALSE;
+  SVN_ERR(svn_sqlite__finish_transaction(wcroot->sdb, SVN_NO_ERROR));
+
+  if (restart)
+    {
+      SVN_ERR(svn_sqlite__begin_immediate_transaction(wcroot->sdb));
+      wcroot->bulk_txn = TRUE;
+    }
+  else
+    SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb,
+                                        STMT_PRAGMA_DEFAULT_CACHE_SIZE));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_bulk_flush(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  return svn_error_trace(bulk_commit(wcroot, TRUE));
+}
+
+svn_error_t *
+svn_wc__db_bulk_end(svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  return svn_error_trace(bulk_commit(wcroot, FALSE));
+}
+
+
 svn_error_t *
 svn_wc__db_base_add_directory(svn_wc__db_t *db,
                               const char *local_abspath,
@@ -13597,6 +13683,89 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
 }
 
 
+/* The body of svn_wc__db_wq_record_and_fetch_items().
+ */
+static svn_error_t *
+wq_fetch_items(apr_array_header_t **ids,
+               apr_array_header_t **work_items,
+               svn_wc__db_wcroot_t *wcroot,
+               apr_uint64_t completed_id,
+               int max_items,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  if (completed_id != 0)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                        STMT_DELETE_WORK_ITEMS_UPTO));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1, completed_id));
+
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 1, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *)
+        = svn_skel__parse(val, len, result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_wc__db_wq_record_and_fetch_items(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     apr_uint64_t completed_id,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(ids != NULL);
+  SVN_ERR_ASSERT(work_items != NULL);
+  SVN_ERR_ASSERT(max_items > 0);
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    svn_error_compose_create(
+            wq_fetch_items(ids, work_items, wcroot, completed_id, max_items,
+                           result_pool, scratch_pool),
+            record_map ? wq_record(wcroot, record_map, scratch_pool)
+                       : SVN_NO_ERROR),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* ### temporary API. remove before release.  */
 svn_error_t *
@@ -45,6 +45,7 @@
 
 #include "private/svn_skel.h"
 #include "private/svn_sqlite.h"
+#include "private/svn_task_group.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
@@ -268,6 +269,17 @@ svn_wc__db_open(svn_wc__db_t **db,
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db);
 
+#if APR_HAS_THREADS
+/* Set *THREAD_POOL to the worker threads that operations on DB share,
+   creating them with up to MAX_THREADS threads on first use.  Threads
+   only get created when there is work for them.  They are destroyed
+   together with DB's RESULT_POOL.  */
+svn_error_t *
+svn_wc__db_get_thread_pool(apr_thread_pool_t **thread_pool,
+                           svn_wc__db_t *db,
+                           apr_size_t max_threads);
+#endif
+
 
 /* Initialize the SDB for LOCAL_ABSPATH, which should be a working copy path.
 
@@ -362,6 +374,45 @@ svn_wc__db_get_wcroot(const char **wcroot_abspath,
                       apr_pool_t *scratch_pool);
 
 
+/* Start a bulk transaction in the working copy containing WRI_ABSPATH.
+
+   Until svn_wc__db_bulk_end() gets called, all changes to that working
+   copy are collected in a single SQLite transaction, instead of one
+   transaction per operation, and the database keeps more pages in memory.
+   Operations that fail are still rolled back on their own.
+
+   Work items queued in a bulk transaction must not be run before it is
+   committed using svn_wc__db_bulk_flush() or svn_wc__db_bulk_end().
+   Otherwise, an interruption could leave files behind that the working
+   copy does not know about.
+
+   The bulk transaction holds a 'RESERVED' lock on the database, which
+   keeps other processes from changing the working copy until it ends.
+ */
+svn_error_t *
+svn_wc__db_bulk_begin(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool);
+
+/* Commit the changes collected in the bulk transaction of the working copy
+   containing WRI_ABSPATH and start a new one.  Do nothing if there is no
+   bulk transaction.
+ */
+svn_error_t *
+svn_wc__db_bulk_flush(svn_wc__db_t *db,
+                      const char *wri_abspath,
+                      apr_pool_t *scratch_pool);
+
+/* Commit the changes collected in the bulk transaction of the working copy
+   containing WRI_ABSPATH and end it.  Do nothing if there is no bulk
+   transaction.
+ */
+svn_error_t *
+svn_wc__db_bulk_end(svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    apr_pool_t *scratch_pool);
+
+
 /* @} */
 
 /* Different kinds of trees
@@ -902,6 +953,12 @@ svn_wc__db_base_get_lock_tokens_recursive(apr_hash_t **lock_tokens,
 /* Set *PRISTINE_ABSPATH to the path to the pristine text file
    identified by SHA1_CHECKSUM.  Error if it does not exist.
 
+   If the text is stored compressed, the path is that of a decompressed
+   copy, which is deleted when RESULT_POOL is cleared.  That copy is made
+   outside of the working copy, so that svn_wc__internal_merge() copies it
+   before referring to it from work items, like other files that are not
+   owned by the working copy.
+
    ### This is temporary - callers should not be looking at the file
    directly.
 
@@ -915,8 +972,8 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              apr_pool_t *scratch_pool);
 
 /* Set *PRISTINE_ABSPATH to the path under WCROOT_ABSPATH that will be
-   used by the pristine text identified by SHA1_CHECKSUM.  The file
-   need not exist.
+   used by the pristine text identified by SHA1_CHECKSUM, when stored
+   verbatim.  The file need not exist.
  */
 svn_error_t *
 svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
@@ -925,6 +982,34 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Set *PRISTINE_ABSPATH to the path of the file in which the pristine text
+   identified by SHA1_CHECKSUM is stored in the WC identified by
+   WRI_ABSPATH in DB, and *COMPRESSED to whether that file holds the text
+   compressed.  Error if the text is not in the store.
+
+   Unlike svn_wc__db_pristine_get_path(), this never creates a file.  Read
+   a compressed file through svn_wc__db_pristine_stream_decompressed().
+
+   Allocate the path in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_get_stored_path(const char **pristine_abspath,
+                                    svn_boolean_t *compressed,
+                                    svn_wc__db_t *db,
+                                    const char *wri_abspath,
+                                    const svn_checksum_t *sha1_checksum,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool);
+
+/* Return a readable stream, allocated in RESULT_POOL, that yields the
+   pristine text read in compressed form from STREAM, which is the contents
+   of a file reported as compressed by svn_wc__db_pristine_get_stored_path().
+   Closing the returned stream closes STREAM.
+
+   This does not access DB, so it may be used on any thread. */
+svn_stream_t *
+svn_wc__db_pristine_stream_decompressed(svn_stream_t *stream,
+                                        apr_pool_t *result_pool);
+
 
 /* If requested set *CONTENTS to a readable stream that will yield the pristine
    text identified by SHA1_CHECKSUM (must be a SHA-1 checksum) within the WC
@@ -3028,6 +3113,26 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Variant of svn_wc__db_wq_record_and_fetch_next(), which returns up to
+   MAX_ITEMS work items at once.  Set *IDS to an array of their apr_uint64_t
+   identifiers and *WORK_ITEMS to an array of the corresponding
+   svn_skel_t *, both empty if there are no work items to be completed.
+
+   If COMPLETED_ID is not 0, all wq items up to and including COMPLETED_ID
+   will be marked as completed before returning the next items.  If
+   RECORD_MAP is not NULL, the timestamps and sizes it holds are recorded
+   in the same transaction. */
+svn_error_t *
+svn_wc__db_wq_record_and_fetch_items(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     apr_uint64_t completed_id,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
+
 
 /* @} */
 
@@ -28,8 +28,10 @@
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -37,22 +39,35 @@
 #include "wc_db_private.h"
 
 #define PRISTINE_STORAGE_EXT ".svn-base"
+#define PRISTINE_COMPRESSED_EXT ".svn-lz4"
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Value of the PRISTINE.compression column for texts that are stored as
+   a sequence of LZ4 compressed blocks.  NULL means stored verbatim. */
+#define PRISTINE_COMPRESSION_LZ4 1
+
+/* Compressed pristine texts are split into blocks of this many bytes
+   (the last block may be shorter).  Each block is stored as its
+   svn__encode_uint() encoded length followed by the output of
+   svn__compress_lz4(). */
+#define PRISTINE_BLOCK_SIZE 0x10000
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
    to hold CHECKSUM's pristine file, relating to the pristine store
    configured for the working copy indicated by PDH. The returned path
-   does not necessarily currently exist.
+   does not necessarily currently exist.  If COMPRESSED is set, return
+   the location for the compressed form of the text.
 
    Any other allocations are made in SCRATCH_POOL. */
 static svn_error_t *
 get_pristine_fname(const char **pristine_abspath,
                    const char *wcroot_abspath,
                    const svn_checksum_t *sha1_checksum,
+                   svn_boolean_t compressed,
                    apr_pool_t *result_pool,
                    apr_pool_t *scratch_pool)
 {
@@ -80,10 +95,13 @@ get_pristine_fname(const char **pristine_abspath,
   subdir[1] = hexdigest[1];
   subdir[2] = '\0';
 
-  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
+  hexdigest = apr_pstrcat(scratch_pool, hexdigest,
+                          compressed ? PRISTINE_COMPRESSED_EXT
+                                     : PRISTINE_STORAGE_EXT,
                           SVN_VA_NULL);
 
-  /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
+  /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base
+     or, if compressed, at DIR/.svn/pristine/XX/XXYYZZ...svn-lz4 */
   *pristine_abspath = svn_dirent_join_many(result_pool,
                                            base_dir_abspath,
                                            subdir,
@@ -92,6 +110,307 @@ get_pristine_fname(const char **pristine_abspath,
   return SVN_NO_ERROR;
 }
 
+/* Return the absolute path to the temporary directory for pristine text
+   files within WCROOT. */
+static char *
+pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_dirent_join_many(result_pool, wcroot->abspath,
+                              svn_wc_get_adm_dir(scratch_pool),
+                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
+}
+
+/* Set *COMPRESSED to whether the PRISTINE.compression value in column
+   COLUMN of STMT says that the pristine text identified by SHA1_CHECKSUM
+   is stored compressed.  Return an error for compression methods that
+   we don't know. */
+static svn_error_t *
+column_compressed(svn_boolean_t *compressed,
+                  svn_sqlite__stmt_t *stmt,
+                  int column,
+                  const svn_checksum_t *sha1_checksum,
+                  apr_pool_t *scratch_pool)
+{
+  int compression;
+
+  if (svn_sqlite__column_is_null(stmt, column))
+    {
+      *compressed = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  compression = svn_sqlite__column_int(stmt, column);
+  if (compression != PRISTINE_COMPRESSION_LZ4)
+    return svn_error_createf(SVN_ERR_WC_UNSUPPORTED_FORMAT, NULL,
+                             _("Pristine text '%s' is stored with unknown "
+                               "compression method %d"),
+                             svn_checksum_to_cstring_display(sha1_checksum,
+                                                             scratch_pool),
+                             compression);
+
+  *compressed = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the streams created by compressed_stream() and
+   svn_wc__db_pristine_stream_decompressed(). */
+typedef struct lz4_baton_t
+{
+  /* The stream holding the compressed blocks. */
+  svn_stream_t *inner;
+
+  /* The uncompressed contents of the current block and, when reading,
+     the offset within it of the next byte to return. */
+  svn_stringbuf_t *block;
+  apr_size_t offset;
+
+  /* The compressed form of the current block. */
+  svn_stringbuf_t *compressed;
+
+  /* When writing, the number of uncompressed bytes gets added to this. */
+  svn_filesize_t *size;
+} lz4_baton_t;
+
+/* Return the error for a compressed pristine file that can't be read. */
+static svn_error_t *
+corrupt_block_error(void)
+{
+  return svn_error_create(SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
+                          _("Compressed pristine text is corrupt"));
+}
+
+/* Compress the contents of BATON->block, append them to BATON->inner
+   and empty BATON->block. */
+static svn_error_t *
+write_lz4_block(lz4_baton_t *baton)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t len;
+
+  SVN_ERR(svn__compress_lz4(baton->block->data, baton->block->len,
+                            baton->compressed));
+
+  len = svn__encode_uint(header, baton->compressed->len) - header;
+  SVN_ERR(svn_stream_write(baton->inner, (const char *)header, &len));
+  len = baton->compressed->len;
+  SVN_ERR(svn_stream_write(baton->inner, baton->compressed->data, &len));
+
+  svn_stringbuf_setempty(baton->block);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t for compressed_stream(). */
+static svn_error_t *
+write_handler_lz4(void *baton,
+                  const char *data,
+                  apr_size_t *len)
+{
+  lz4_baton_t *b = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t chunk = MIN(remaining,
+                             PRISTINE_BLOCK_SIZE - b->block->len);
+
+      svn_stringbuf_appendbytes(b->block, data, chunk);
+      data += chunk;
+      remaining -= chunk;
+
+      if (b->block->len == PRISTINE_BLOCK_SIZE)
+        SVN_ERR(write_lz4_block(b));
+    }
+
+  *b->size += *len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for compressed_stream(). */
+static svn_error_t *
+write_close_handler_lz4(void *baton)
+{
+  lz4_baton_t *b = baton;
+
+  if (b->block->len > 0)
+    SVN_ERR(write_lz4_block(b));
+
+  return svn_error_trace(svn_stream_close(b->inner));
+}
+
+/* Return a writable stream, allocated in RESULT_POOL, that writes all data
+   written to it to INNER in compressed form, and adds the number of bytes
+   written to it to *SIZE.  Closing the stream closes INNER. */
+static svn_stream_t *
+compressed_stream(svn_stream_t *inner,
+                  svn_filesize_t *size,
+                  apr_pool_t *result_pool)
+{
+  lz4_baton_t *baton = apr_pcalloc(result_pool, sizeof(*baton));
+  svn_stream_t *stream;
+
+  baton->inner = inner;
+  baton->block = svn_stringbuf_create_ensure(PRISTINE_BLOCK_SIZE,
+                                             result_pool);
+  baton->compressed = svn_stringbuf_create_empty(result_pool);
+  baton->size = size;
+
+  stream = svn_stream_create(baton, result_pool);
+  svn_stream_set_write(stream, write_handler_lz4);
+  svn_stream_set_close(stream, write_close_handler_lz4);
+
+  return stream;
+}
+
+/* Read the next block from BATON->inner and decompress it into
+   BATON->block.  Leave BATON->block empty at the end of the stream. */
+static svn_error_t *
+read_lz4_block(lz4_baton_t *baton)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t header_len = 0;
+  apr_uint64_t block_len;
+  apr_size_t len;
+
+  svn_stringbuf_setempty(baton->block);
+  baton->offset = 0;
+
+  /* Read the encoded block length byte by byte, up to and including the
+     first byte without the continuation bit. */
+  do
+    {
+      if (header_len == sizeof(header))
+        return corrupt_block_error();
+
+      len = 1;
+      SVN_ERR(svn_stream_read_full(baton->inner,
+                                   (char *)header + header_len, &len));
+      if (len == 0)
+        return header_len ? corrupt_block_error() : SVN_NO_ERROR;
+    }
+  while (header[header_len++] & 0x80);
+
+  svn__decode_uint(&block_len, header, header + header_len);
+  if (block_len == 0 || block_len > 2 * PRISTINE_BLOCK_SIZE)
+    return corrupt_block_error();
+
+  len = (apr_size_t)block_len;
+  svn_stringbuf_ensure(baton->compressed, len);
+  SVN_ERR(svn_stream_read_full(baton->inner, baton->compressed->data, &len));
+  if (len != block_len)
+    return corrupt_block_error();
+
+  return svn_error_trace(svn__decompress_lz4(baton->compressed->data, len,
+                                             baton->block,
+                                             PRISTINE_BLOCK_SIZE));
+}
+
+/* Implements svn_read_fn_t for svn_wc__db_pristine_stream_decompressed().
+   It always reads as much as requested, unless the stream ends. */
+static svn_error_t *
+read_handler_lz4(void *baton,
+                 char *buffer,
+                 apr_size_t *len)
+{
+  lz4_baton_t *b = baton;
+  apr_size_t total = 0;
+
+  while (total < *len)
+    {
+      apr_size_t chunk;
+
+      if (b->offset == b->block->len)
+        {
+          SVN_ERR(read_lz4_block(b));
+          if (b->block->len == 0)
+            break;
+        }
+
+      chunk = MIN(*len - total, b->block->len - b->offset);
+      memcpy(buffer + total, b->block->data + b->offset, chunk);
+      b->offset += chunk;
+      total += chunk;
+    }
+
+  *len = total;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for svn_wc__db_pristine_stream_decompressed(). */
+static svn_error_t *
+read_close_handler_lz4(void *baton)
+{
+  lz4_baton_t *b = baton;
+
+  return svn_error_trace(svn_stream_close(b->inner));
+}
+
+svn_stream_t *
+svn_wc__db_pristine_stream_decompressed(svn_stream_t *stream,
+                                        apr_pool_t *result_pool)
+{
+  lz4_baton_t *baton = apr_pcalloc(result_pool, sizeof(*baton));
+  svn_stream_t *decompressed;
+
+  baton->inner = stream;
+  baton->block = svn_stringbuf_create_ensure(PRISTINE_BLOCK_SIZE,
+                                             result_pool);
+  baton->compressed = svn_stringbuf_create_empty(result_pool);
+
+  decompressed = svn_stream_create(baton, result_pool);
+  svn_stream_set_read2(decompressed, read_handler_lz4, read_handler_lz4);
+  svn_stream_set_close(decompressed, read_close_handler_lz4);
+
+  return decompressed;
+}
+
+/* Set *PRISTINE_ABSPATH to the file in WCROOT's pristine store that holds
+   the pristine text identified by SHA1_CHECKSUM and *COMPRESSED to whether
+   that file holds the text in compressed form.  Return an error if the
+   text is not in the store or its file is missing.
+
+   Allocate *PRISTINE_ABSPATH in RESULT_POOL. */
+static svn_error_t *
+get_stored_pristine(const char **pristine_abspath,
+                    svn_boolean_t *compressed,
+                    svn_wc__db_wcroot_t *wcroot,
+                    const svn_checksum_t *sha1_checksum,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_node_kind_t kind_on_disk = svn_node_none;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_PRISTINE_SIZE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    err = column_compressed(compressed, stmt, 1, sha1_checksum, scratch_pool);
+  SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
+
+  if (have_row)
+    {
+      SVN_ERR(get_pristine_fname(pristine_abspath, wcroot->abspath,
+                                 sha1_checksum, *compressed,
+                                 result_pool, scratch_pool));
+      SVN_ERR(svn_io_check_path(*pristine_abspath, &kind_on_disk,
+                                scratch_pool));
+    }
+
+  if (kind_on_disk != svn_node_file)
+    return svn_error_createf(SVN_ERR_WC_DB_ERROR, NULL,
+                             _("The pristine text with checksum '%s' was "
+                               "not found"),
+                             svn_checksum_to_cstring_display(sha1_checksum,
+                                                             scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
@@ -103,7 +422,8 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
 {
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
-  svn_boolean_t present;
+  const char *stored_abspath;
+  svn_boolean_t compressed;
 
   SVN_ERR_ASSERT(pristine_abspath != NULL);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
@@ -121,22 +441,62 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                                              scratch_pool, scratch_pool));
   VERIFY_USABLE_WCROOT(wcroot);
 
-  SVN_ERR(svn_wc__db_pristine_check(&present, db, wri_abspath, sha1_checksum,
-                                    scratch_pool));
-  if (! present)
-    return svn_error_createf(SVN_ERR_WC_DB_ERROR, NULL,
-                             _("The pristine text with checksum '%s' was "
-                               "not found"),
-                             svn_checksum_to_cstring_display(sha1_checksum,
-                                                             scratch_pool));
+  SVN_ERR(get_stored_pristine(&stored_abspath, &compressed, wcroot,
+                              sha1_checksum, result_pool, scratch_pool));
 
-  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot->abspath,
-                             sha1_checksum,
-                             result_pool, scratch_pool));
+  if (! compressed)
+    {
+      *pristine_abspath = stored_abspath;
+      return SVN_NO_ERROR;
+    }
+
+  /* Callers expect the text verbatim, so provide a decompressed copy
+     that lives as long as RESULT_POOL.  Keep it out of the working copy,
+     where files handed to work items must outlive the pool. */
+  {
+    svn_stream_t *src_stream;
+    svn_stream_t *dst_stream;
+
+    SVN_ERR(svn_stream_open_readonly(&src_stream, stored_abspath,
+                                     scratch_pool, scratch_pool));
+    SVN_ERR(svn_stream_open_unique(&dst_stream, pristine_abspath, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   result_pool, scratch_pool));
+    SVN_ERR(svn_stream_copy3(
+              svn_wc__db_pristine_stream_decompressed(src_stream,
+                                                      scratch_pool),
+              dst_stream, NULL, NULL, scratch_pool));
+  }
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_pristine_get_stored_path(const char **pristine_abspath,
+                                    svn_boolean_t *compressed,
+                                    svn_wc__db_t *db,
+                                    const char *wri_abspath,
+                                    const svn_checksum_t *sha1_checksum,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+  SVN_ERR_ASSERT(sha1_checksum != NULL);
+  SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath,
+                                             db, wri_abspath,
+                                             scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  return svn_error_trace(get_stored_pristine(pristine_abspath, compressed,
+                                             wcroot, sha1_checksum,
+                                             result_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     const char *wcroot_abspath,
@@ -145,16 +505,16 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *scratch_pool)
 {
   SVN_ERR(get_pristine_fname(pristine_abspath, wcroot_abspath,
-                             sha1_checksum,
+                             sha1_checksum, FALSE,
                              result_pool, scratch_pool));
   return SVN_NO_ERROR;
 }
 
 /* Set *CONTENTS to a readable stream from which the pristine text
- * identified by SHA1_CHECKSUM and PRISTINE_ABSPATH can be read from the
- * pristine store of WCROOT.  If SIZE is not null, set *SIZE to the size
- * in bytes of that text. If that text is not in the pristine store,
- * return an error.
+ * identified by SHA1_CHECKSUM can be read from the pristine store of
+ * WCROOT, decompressing it if it is stored compressed.  If SIZE is not
+ * null, set *SIZE to the size in bytes of that text. If that text is not
+ * in the pristine store, return an error.
  *
  * Even if the pristine text is removed from the store while it is being
  * read, the stream will remain valid and readable until it is closed.
@@ -170,12 +530,13 @@ pristine_read_txn(svn_stream_t **contents,
                   svn_filesize_t *size,
                   svn_wc__db_wcroot_t *wcroot,
                   const svn_checksum_t *sha1_checksum,
-                  const char *pristine_abspath,
                   apr_pool_t *result_pool,
                   apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_boolean_t compressed = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -186,8 +547,11 @@ pristine_read_txn(svn_stream_t **contents,
 
   if (size)
     *size = svn_sqlite__column_int64(stmt, 0);
+  if (have_row)
+    err = column_compressed(&compressed, stmt, 1, sha1_checksum,
+                            scratch_pool);
 
-  SVN_ERR(svn_sqlite__reset(stmt));
+  SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
   if (! have_row)
     {
       return svn_error_createf(SVN_ERR_WC_PATH_NOT_FOUND, NULL,
@@ -205,10 +569,19 @@ pristine_read_txn(svn_stream_t **contents,
    * buffers. */
   if (contents)
     {
+      const char *pristine_abspath;
       apr_file_t *file;
+
+      SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
+                                 sha1_checksum, compressed,
+                                 scratch_pool, scratch_pool));
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
       *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+      if (compressed)
+        *contents = svn_wc__db_pristine_stream_decompressed(*contents,
+                                                            result_pool);
     }
 
   return SVN_NO_ERROR;
@@ -225,7 +598,6 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
 {
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
-  const char *pristine_abspath;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
 
@@ -243,12 +615,9 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
                               wri_abspath, scratch_pool, scratch_pool));
   VERIFY_USABLE_WCROOT(wcroot);
 
-  SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum,
-                             scratch_pool, scratch_pool));
   SVN_WC__DB_WITH_TXN(
     pristine_read_txn(contents, size,
-                      wcroot, sha1_checksum, pristine_abspath,
+                      wcroot, sha1_checksum,
                       result_pool, scratch_pool),
     wcroot);
 
@@ -256,21 +625,20 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
 }
 
 
-/* Return the absolute path to the temporary directory for pristine text
-   files within WCROOT. */
-static char *
-pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+struct svn_wc__db_install_data_t
 {
-  return svn_dirent_join_many(result_pool, wcroot->abspath,
-                              svn_wc_get_adm_dir(scratch_pool),
-                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
-}
+  svn_wc__db_wcroot_t *wcroot;
+  svn_stream_t *inner_stream;
+
+  /* Whether INNER_STREAM receives the text compressed, and if so, the
+     size of the uncompressed text. */
+  svn_boolean_t compressed;
+  svn_filesize_t size;
+};
 
-/* Install the pristine text described by BATON into the pristine store of
- * SDB.  If it is already stored then just delete the new file
- * BATON->tempfile_abspath.
+/* Install the pristine text described by INSTALL_DATA into the pristine
+ * store of SDB.  If it is already stored then just delete the new file
+ * INSTALL_DATA->inner_stream.
  *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
@@ -279,8 +647,8 @@ pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
  */
 static svn_error_t *
 pristine_install_txn(svn_sqlite__db_t *sdb,
-                     /* The path to the source file that is to be moved into place. */
-                     svn_stream_t *install_stream,
+                     /* The new text and the stream holding it. */
+                     const svn_wc__db_install_data_t *install_data,
                      /* The target path for the file (within the pristine store). */
                      const char *pristine_abspath,
                      /* The pristine text's SHA-1 checksum. */
@@ -289,73 +657,67 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *md5_checksum,
                      apr_pool_t *scratch_pool)
 {
+  svn_stream_t *install_stream = install_data->inner_stream;
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_filesize_t size;
+  apr_finfo_t finfo;
+
+  SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
+                                       APR_FINFO_SIZE, scratch_pool));
+  size = install_data->compressed ? install_data->size : finfo.size;
 
   /* If this pristine text is already present in the store, just keep it:
    * delete the new one and return. */
-  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE_SIZE));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
-  SVN_ERR(svn_sqlite__reset(stmt));
 
   if (have_row)
     {
 #ifdef SVN_DEBUG
-      /* Consistency checks.  Verify both files exist and match.
+      /* Consistency checks.  Verify both texts match.  The stored text
+       * need not use the same compression, so compare the text sizes.
        * ### We could check much more. */
-      {
-        apr_finfo_t finfo1, finfo2;
-
-        SVN_ERR(svn_stream__install_get_info(&finfo1, install_stream, APR_FINFO_SIZE,
-                                             scratch_pool));
-
-        SVN_ERR(svn_io_stat(&finfo2, pristine_abspath, APR_FINFO_SIZE,
-                            scratch_pool));
-        if (finfo1.size != finfo2.size)
-          {
-            return svn_error_createf(
-              SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
-              _("New pristine text '%s' has different size: %s versus %s"),
-              svn_checksum_to_cstring_display(sha1_checksum, scratch_pool),
-              apr_off_t_toa(scratch_pool, finfo1.size),
-              apr_off_t_toa(scratch_pool, finfo2.size));
-          }
-      }
+      svn_filesize_t stored_size = svn_sqlite__column_int64(stmt, 0);
+
+      if (size != stored_size)
+        {
+          return svn_error_createf(
+            SVN_ERR_WC_CORRUPT_TEXT_BASE, svn_sqlite__reset(stmt),
+            _("New pristine text '%s' has different size: %s versus %s"),
+            svn_checksum_to_cstring_display(sha1_checksum, scratch_pool),
+            apr_off_t_toa(scratch_pool, size),
+            apr_off_t_toa(scratch_pool, stored_size));
+        }
 #endif
 
+      SVN_ERR(svn_sqlite__reset(stmt));
+
       /* Remove the temp file: it's already there */
       SVN_ERR(svn_stream__install_delete(install_stream, scratch_pool));
       return SVN_NO_ERROR;
     }
+  SVN_ERR(svn_sqlite__reset(stmt));
 
   /* Move the file to its target location.  (If it is already there, it is
    * an orphan file and it doesn't matter if we overwrite it.) */
-  {
-    apr_finfo_t finfo;
-    SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
-                                         APR_FINFO_SIZE, scratch_pool));
-    SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
-                                       TRUE, scratch_pool));
-
-    SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
-    SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
-    SVN_ERR(svn_sqlite__insert(NULL, stmt));
-
-    SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
-  }
+  SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
+                                     TRUE, scratch_pool));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  if (install_data->compressed)
+    SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
+  SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+  SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
 
   return SVN_NO_ERROR;
 }
 
-struct svn_wc__db_install_data_t
-{
-  svn_wc__db_wcroot_t *wcroot;
-  svn_stream_t *inner_stream;
-};
-
 svn_error_t *
 svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
                                     svn_wc__db_install_data_t **install_data,
@@ -388,6 +750,24 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
+  /* Clients that don't know about compressed texts can't open a working
+     copy of a format that allows them, so only bump the format when the
+     first compressed text is about to be stored. */
+  if (db->compress_pristines
+      && wcroot->format < SVN_WC__HAS_COMPRESSED_PRISTINES)
+    {
+      SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb, STMT_UPGRADE_TO_32));
+      wcroot->format = SVN_WC__HAS_COMPRESSED_PRISTINES;
+    }
+
+  /* The checksums are calculated over the uncompressed text. */
+  if (db->compress_pristines)
+    {
+      (*install_data)->compressed = TRUE;
+      *stream = compressed_stream(*stream, &(*install_data)->size,
+                                  result_pool);
+    }
+
   if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
@@ -413,17 +793,26 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
   SVN_ERR_ASSERT(md5_checksum->kind == svn_checksum_md5);
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum,
+                             sha1_checksum, install_data->compressed,
                              scratch_pool, scratch_pool));
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
-   * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
-    pristine_install_txn(wcroot->sdb,
-                         install_data->inner_stream, pristine_abspath,
-                         sha1_checksum, md5_checksum,
-                         scratch_pool),
-    wcroot->sdb);
+   * at the disk, to ensure no concurrent pristine install/delete txn.
+   * A bulk transaction already holds that lock. */
+  if (wcroot->bulk_txn)
+    SVN_SQLITE__WITH_LOCK(
+      pristine_install_txn(wcroot->sdb,
+                           install_data, pristine_abspath,
+                           sha1_checksum, md5_checksum,
+                           scratch_pool),
+      wcroot->sdb);
+  else
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(
+      pristine_install_txn(wcroot->sdb,
+                           install_data, pristine_abspath,
+                           sha1_checksum, md5_checksum,
+                           scratch_pool),
+      wcroot->sdb);
 
   return SVN_NO_ERROR;
 }
@@ -514,13 +903,16 @@ svn_wc__db_pristine_get_sha1(const svn_checksum_t **sha1_checksum,
 }
 
 /* Handle the moving of a pristine from SRC_WCROOT to DST_WCROOT. The existing
-   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE */
+   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM, SIZE and
+   COMPRESSED.  The file keeps its compression, unless DST_WCROOT has a
+   format that can't hold compressed texts. */
 static svn_error_t *
 maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                             svn_wc__db_wcroot_t *dst_wcroot,
                             const svn_checksum_t *checksum,
                             const svn_checksum_t *md5_checksum,
                             apr_int64_t size,
+                            svn_boolean_t compressed,
                             svn_cancel_func_t cancel_func,
                             void *cancel_baton,
                             apr_pool_t *scratch_pool)
@@ -532,13 +924,20 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
   const char *tmp_abspath;
   const char *src_abspath;
   int affected_rows;
+  svn_boolean_t store_compressed;
   svn_error_t *err;
 
+  store_compressed = (compressed
+                      && dst_wcroot->format
+                           >= SVN_WC__HAS_COMPRESSED_PRISTINES);
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, dst_wcroot->sdb,
                                     STMT_INSERT_OR_IGNORE_PRISTINE));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  if (store_compressed)
+    SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
 
   SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
 
@@ -553,10 +952,13 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                                  scratch_pool, scratch_pool));
 
   SVN_ERR(get_pristine_fname(&src_abspath, src_wcroot->abspath, checksum,
-                             scratch_pool, scratch_pool));
+                             compressed, scratch_pool, scratch_pool));
 
   SVN_ERR(svn_stream_open_readonly(&src_stream, src_abspath,
                                    scratch_pool, scratch_pool));
+  if (compressed && !store_compressed)
+    src_stream = svn_wc__db_pristine_stream_decompressed(src_stream,
+                                                         scratch_pool);
 
   /* ### Should we verify the SHA1 or MD5 here, or is that too expensive? */
   SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
@@ -564,7 +966,7 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                            scratch_pool));
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, dst_wcroot->abspath, checksum,
-                             scratch_pool, scratch_pool));
+                             store_compressed, scratch_pool, scratch_pool));
 
   /* Move the file to its target location.  (If it is already there, it is
    * an orphan file and it doesn't matter if we overwrite it.) */
@@ -623,6 +1025,7 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       const svn_checksum_t *checksum;
       const svn_checksum_t *md5_checksum;
       apr_int64_t size;
+      svn_boolean_t compressed;
       svn_error_t *err;
 
       svn_pool_clear(iterpool);
@@ -631,10 +1034,13 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&md5_checksum, stmt, 1, iterpool));
       size = svn_sqlite__column_int64(stmt, 2);
 
-      err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
-                                        checksum, md5_checksum, size,
-                                        cancel_func, cancel_baton,
-                                        iterpool);
+      err = column_compressed(&compressed, stmt, 3, checksum, iterpool);
+      if (! err)
+        err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
+                                          checksum, md5_checksum, size,
+                                          compressed,
+                                          cancel_func, cancel_baton,
+                                          iterpool);
 
       if (err)
         return svn_error_trace(svn_error_compose_create(
@@ -687,9 +1093,9 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
 
 
 
-/* If the pristine text referenced by SHA1_CHECKSUM in WCROOT/SDB, whose path
- * within the pristine store is PRISTINE_ABSPATH, has a reference count of
- * zero, delete it (both the database row and the disk file).
+/* If the pristine text referenced by SHA1_CHECKSUM in WCROOT/SDB has a
+ * reference count of zero, delete it (both the database row and the disk
+ * file).
  *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
@@ -698,12 +1104,23 @@ static svn_error_t *
 pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
                                     svn_wc__db_wcroot_t *wcroot,
                                     const svn_checksum_t *sha1_checksum,
-                                    const char *pristine_abspath,
                                     apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_boolean_t compressed = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
   int affected_rows;
 
+  /* Find out where the file is before the row is gone. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE_SIZE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    err = column_compressed(&compressed, stmt, 1, sha1_checksum,
+                            scratch_pool);
+  SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
+
   /* Remove the DB row, if refcount is 0. */
   SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
                                     STMT_DELETE_PRISTINE_IF_UNREFERENCED));
@@ -721,7 +1138,11 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
 #else
       svn_boolean_t ignore_enoent = TRUE;
 #endif
+      const char *pristine_abspath;
 
+      SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
+                                 sha1_checksum, compressed,
+                                 scratch_pool, scratch_pool));
       SVN_ERR(svn_io_remove_file2(pristine_abspath, ignore_enoent,
                                   scratch_pool));
     }
@@ -739,17 +1160,19 @@ pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
                                 const svn_checksum_t *sha1_checksum,
                                 apr_pool_t *scratch_pool)
 {
-  const char *pristine_abspath;
-
-  SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum, scratch_pool, scratch_pool));
-
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
-   * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
-    pristine_remove_if_unreferenced_txn(
-      wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
-    wcroot->sdb);
+   * at the disk, to ensure no concurrent pristine install/delete txn.
+   * A bulk transaction already holds that lock. */
+  if (wcroot->bulk_txn)
+    SVN_SQLITE__WITH_LOCK(
+      pristine_remove_if_unreferenced_txn(
+        wcroot->sdb, wcroot, sha1_checksum, scratch_pool),
+      wcroot->sdb);
+  else
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(
+      pristine_remove_if_unreferenced_txn(
+        wcroot->sdb, wcroot, sha1_checksum, scratch_pool),
+      wcroot->sdb);
 
   return SVN_NO_ERROR;
 }
@@ -917,8 +1340,18 @@ svn_wc__db_pristine_check(svn_boolean_t *present,
     svn_error_t *err;
 
     SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                               sha1_checksum, scratch_pool, scratch_pool));
+                               sha1_checksum, FALSE,
+                               scratch_pool, scratch_pool));
     err = svn_io_check_path(pristine_abspath, &kind_on_disk, scratch_pool);
+    if (!err && kind_on_disk != svn_node_file)
+      {
+        /* The text may be stored compressed. */
+        SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
+                                   sha1_checksum, TRUE,
+                                   scratch_pool, scratch_pool));
+        err = svn_io_check_path(pristine_abspath, &kind_on_disk,
+                                scratch_pool);
+      }
 #ifdef WIN32
     if (err && err->apr_err == APR_FROM_OS_ERROR(ERROR_ACCESS_DENIED))
       {
@@ -52,6 +52,9 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Should new pristine texts be stored compressed? */
+  svn_boolean_t compress_pristines;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -66,6 +69,11 @@ struct svn_wc__db_t {
 
   /* As we grow the state of this DB, allocate that state here. */
   apr_pool_t *state_pool;
+
+#if APR_HAS_THREADS
+  /* Created by svn_wc__db_get_thread_pool().  NULL until first used. */
+  apr_thread_pool_t *thread_pool;
+#endif
 };
 
 
@@ -107,6 +115,9 @@ typedef struct svn_wc__db_wcroot_t {
      const char *local_abspath -> svn_wc_adm_access_t *adm_access */
   apr_hash_t *access_cache;
 
+  /* Whether SDB is in a transaction started by svn_wc__db_bulk_begin(). */
+  svn_boolean_t bulk_txn;
+
 } svn_wc__db_wcroot_t;
 
 
@@ -155,7 +166,8 @@ svn_wc__db_verify_no_work(svn_sqlite__db_t *sdb);
 /* Assert that the given WCROOT is usable.
    NOTE: the expression is multiply-evaluated!!  */
 #define VERIFY_USABLE_WCROOT(wcroot)  SVN_ERR_ASSERT(               \
-    (wcroot) != NULL && (wcroot)->format == SVN_WC__VERSION)
+    (wcroot) != NULL && (wcroot)->format >= SVN_WC__VERSION        \
+    && (wcroot)->format <= SVN_WC__MAX_VERSION)
 
 /* Check if the WCROOT is usable for light db operations such as path
    calculations */
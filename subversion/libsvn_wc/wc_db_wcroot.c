@@ -240,6 +240,7 @@ svn_wc__db_open(svn_wc__db_t **db,
     {
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
+      svn_boolean_t compress_pristines = FALSE;
       apr_int64_t timeout;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
@@ -261,6 +262,15 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_bool(config, &compress_pristines,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_COMPRESS_PRISTINES,
+                                FALSE);
+      if (err)
+        svn_error_clear(err);
+      else
+        (*db)->compress_pristines = compress_pristines;
     }
 
   return SVN_NO_ERROR;
@@ -293,6 +303,22 @@ svn_wc__db_close(svn_wc__db_t *db)
                                                        scratch_pool));
 }
 
+#if APR_HAS_THREADS
+svn_error_t *
+svn_wc__db_get_thread_pool(apr_thread_pool_t **thread_pool,
+                           svn_wc__db_t *db,
+                           apr_size_t max_threads)
+{
+  if (!db->thread_pool)
+    SVN_ERR(svn_task_group__create_thread_pool(&db->thread_pool,
+                                               max_threads,
+                                               db->state_pool));
+
+  *thread_pool = db->thread_pool;
+  return SVN_NO_ERROR;
+}
+#endif
+
 
 svn_error_t *
 svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
@@ -321,7 +347,7 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
     }
 
   /* If this working copy is from a future version, then bail out.  */
-  if (format > SVN_WC__VERSION)
+  if (format > SVN_WC__MAX_VERSION)
     {
       return svn_error_createf(
         SVN_ERR_WC_UNSUPPORTED_FORMAT, NULL,
@@ -377,6 +403,7 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
   (*wcroot)->owned_locks = apr_array_make(result_pool, 8,
                                           sizeof(svn_wc__db_wclock_t));
   (*wcroot)->access_cache = apr_hash_make(result_pool);
+  (*wcroot)->bulk_txn = FALSE;
 
   /* SDB will be NULL for pre-NG working copies. We only need to run a
      cleanup when the SDB is present.  */
@@ -38,8 +38,10 @@
 #include "conflicts.h"
 #include "translate.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_task_group.h"
 
 
 /* Workqueue operation names.  */
@@ -84,6 +86,11 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
                         svn_boolean_t ignore_enoent,
                         apr_pool_t *scratch_pool);
 
+static void
+record_dirent(work_item_baton_t *wqb,
+              const char *local_abspath,
+              const svn_io_dirent2_t *dirent);
+
 /* ------------------------------------------------------------------------ */
 /* OP_REMOVE_BASE  */
 
@@ -445,60 +452,81 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
-static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+/* Everything needed to install a file for an OP_FILE_INSTALL work item,
+   gathered from the database by prepare_file_install(), so that
+   install_file() does not need access to the database. */
+typedef struct file_install_t
 {
-  const svn_skel_t *arg1 = work_item->children->next;
-  const svn_skel_t *arg4 = arg1->next->next->next;
-  const char *local_relpath;
+  /* The file to install and the file to install it from, which holds
+     the text compressed if SOURCE_COMPRESSED is set. */
   const char *local_abspath;
-  svn_boolean_t use_commit_times;
-  svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
+  const char *source_abspath;
+  svn_boolean_t source_compressed;
+
+  /* How to translate SOURCE_ABSPATH into LOCAL_ABSPATH. */
   svn_subst_eol_style_t style;
   const char *eol;
   apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  /* Where to create the temporary file that is moved into place. */
   const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
+
+  /* Tweaks of the installed file. AFFECTED_TIME is 0 if the timestamp
+     should not be set. */
+  svn_boolean_t set_executable;
+  svn_boolean_t set_read_only;
+  apr_time_t affected_time;
+
+  /* Whether the timestamp and size of the installed file are recorded. */
+  svn_boolean_t record_fileinfo;
+} file_install_t;
+
+/* Set *INSTALL to the description of how to install the file of the
+ * OP_FILE_INSTALL work item WORK_ITEM, allocated in RESULT_POOL.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+prepare_file_install(file_install_t **install,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const svn_skel_t *arg1 = work_item->children->next;
+  const svn_skel_t *arg4 = arg1->next->next->next;
+  file_install_t *fi = apr_pcalloc(result_pool, sizeof(*fi));
+  const char *local_relpath;
+  svn_boolean_t use_commit_times;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&fi->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  fi->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
                                             &changed_date,
-                                            db, local_abspath, wri_abspath,
-                                            scratch_pool, scratch_pool));
+                                            db, fi->local_abspath,
+                                            wri_abspath,
+                                            result_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
+      SVN_ERR(svn_wc__db_from_relpath(&fi->source_abspath, db, wri_abspath,
                                       local_relpath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -513,27 +541,89 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(fi->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
-                                                  wcroot_abspath,
-                                                  checksum,
-                                                  scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_get_stored_path(&fi->source_abspath,
+                                                  &fi->source_compressed,
+                                                  db, wri_abspath, checksum,
+                                                  result_pool, scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&fi->style, &fi->eol,
+                                     &fi->keywords,
+                                     &fi->special, db, fi->local_abspath,
                                      props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+                                     result_pool, scratch_pool));
+  if (fi->special)
+    {
+      /* No need to set exec or read-only flags on special files.  */
+      *install = fi;
+      return SVN_NO_ERROR;
+    }
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&fi->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  fi->set_executable = (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE));
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, fi->local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      fi->set_read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    fi->affected_time = changed_date;
+
+  *install = fi;
+  return SVN_NO_ERROR;
+}
+
+/* Install the file described by INSTALL.  If INSTALL->record_fileinfo is
+ * set, set *DIRENT to the stat information of the installed file,
+ * allocated in RESULT_POOL, and else to NULL.
+ *
+ * This only accesses the file system, so it may run on any thread.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+install_file(const svn_io_dirent2_t **dirent,
+             const file_install_t *install,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  const char *local_abspath = install->local_abspath;
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  *dirent = NULL;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, install->source_abspath,
+                                   scratch_pool, scratch_pool));
+  if (install->source_compressed)
+    src_stream = svn_wc__db_pristine_stream_decompressed(src_stream,
+                                                         scratch_pool);
+
+  if (install->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
@@ -546,33 +636,28 @@ run_file_install(work_item_baton_t *wqb,
                                cancel_func, cancel_baton,
                                scratch_pool));
 
-      /* No need to set exec or read-only flags on special files.  */
-
       /* ### Shouldn't this record a timestamp and size, etc.? */
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
+  if (svn_subst_translation_required(install->style, install->eol,
+                                     install->keywords,
                                      FALSE /* special */,
                                      TRUE /* force_eol_check */))
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, install->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               install->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
   /* Translate to a temporary file. We don't want the user seeing a partial
      file, nor let them muck with it while we translate. We may also need to
      get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+  SVN_ERR(svn_stream__create_for_install(&dst_stream,
+                                         install->temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
   /* Copy from the source to the dest, translating as we go. This will also
@@ -589,44 +674,49 @@ run_file_install(work_item_baton_t *wqb,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
+  if (install->set_executable)
     SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
-    {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
-
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
-    }
+  if (install->set_read_only)
+    SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
 
-  if (use_commit_times)
-    {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
-    }
+  if (install->affected_time)
+    SVN_ERR(svn_io_set_file_affected_time(install->affected_time,
+                                          local_abspath,
+                                          scratch_pool));
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
-    {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
-                                      FALSE /* ignore_enoent */,
-                                      scratch_pool));
-    }
+  if (install->record_fileinfo)
+    SVN_ERR(svn_io_stat_dirent2(dirent, local_abspath, FALSE, FALSE,
+                                result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_install_t *install;
+  const svn_io_dirent2_t *dirent;
+
+  SVN_ERR(prepare_file_install(&install, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+
+  SVN_ERR(install_file(&dirent, install, cancel_func, cancel_baton,
+                       wqb->result_pool, scratch_pool));
+
+  if (dirent)
+    record_dirent(wqb, install->local_abspath, dirent);
 
   return SVN_NO_ERROR;
 }
@@ -1474,6 +1564,300 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Wrap ERR, the error of running the work item WORK_ITEM with identifier ID
+   from the work queue of WRI_ABSPATH, for reporting from svn_wc__wq_run().
+ */
+static svn_error_t *
+wrap_work_item_error(svn_error_t *err,
+                     const char *wri_abspath,
+                     apr_uint64_t id,
+                     const svn_skel_t *work_item,
+                     apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/*** Installing files in parallel ***/
+
+/* Maximum number of work items fetched at once while installing files.
+   Checkouts and updates queue all files of a directory before running
+   the queue, so this is also the maximum number of files installed in
+   parallel. */
+#define INSTALL_BATCH_SIZE 64
+
+#if APR_HAS_THREADS
+
+/* Maximum number of threads installing files for the work queue runs on
+   one working copy database. */
+#define INSTALL_MAX_THREADS 8
+
+/* Microseconds between checks of the cancellation callback while waiting
+   for the workers. */
+#define INSTALL_CANCEL_INTERVAL 100000
+
+typedef struct installer_t installer_t;
+
+/* One file installed by a worker thread. */
+typedef struct install_task_t
+{
+  /* The file to install. */
+  file_install_t *install;
+
+  /* Root pool owned by this task, or NULL if the task never got queued. */
+  apr_pool_t *pool;
+
+  /* The installer that queued this task. */
+  installer_t *installer;
+
+  /* The results of install_file(), allocated in POOL. */
+  const svn_io_dirent2_t *dirent;
+  svn_error_t *err;
+} install_task_t;
+
+/* The workers installing files for svn_wc__wq_run(). */
+struct installer_t
+{
+  /* The workers, shared by all runs on the same database. */
+  apr_thread_pool_t *thread_pool;
+
+  /* The tasks of this run. */
+  svn_task_group__t *group;
+
+  /* Set once the run got cancelled.  The workers check this instead of
+     the caller's cancellation callback, which may not be thread-safe. */
+  svn_atomic_t cancelled;
+};
+
+/* Implements svn_cancel_func_t for the workers of the installer_t given
+   as BATON. */
+static svn_error_t *
+installer_cancel_func(void *baton)
+{
+  installer_t *installer = baton;
+
+  if (svn_atomic_read(&installer->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread pool task installing the file of the install_task_t in DATA. */
+static void * APR_THREAD_FUNC
+install_task(apr_thread_t *tid,
+             void *data)
+{
+  install_task_t *task = data;
+  installer_t *installer = task->installer;
+  svn_boolean_t proceed;
+
+  svn_task_group__lock(installer->group);
+  proceed = svn_task_group__task_begin(installer->group);
+  svn_task_group__unlock(installer->group);
+
+  if (proceed)
+    task->err = install_file(&task->dirent, task->install,
+                             installer_cancel_func, installer,
+                             task->pool, task->pool);
+
+  svn_task_group__lock(installer->group);
+  svn_task_group__task_end(installer->group);
+  svn_task_group__unlock(installer->group);
+
+  return NULL;
+}
+
+/* Pool cleanup function shutting down the installer_t given as DATA.
+   Makes sure that no task is queued or running anymore. */
+static apr_status_t
+installer_cleanup(void *data)
+{
+  installer_t *installer = data;
+
+  svn_task_group__shutdown(installer->group, installer->thread_pool);
+
+  return APR_SUCCESS;
+}
+
+/* Set *INSTALLER_P to a new installer for DB, allocated in RESULT_POOL. */
+static svn_error_t *
+installer_create(installer_t **installer_p,
+                 svn_wc__db_t *db,
+                 apr_pool_t *result_pool)
+{
+  installer_t *installer = apr_pcalloc(result_pool, sizeof(*installer));
+
+  SVN_ERR(svn_wc__db_get_thread_pool(&installer->thread_pool, db,
+                                     INSTALL_MAX_THREADS));
+  SVN_ERR(svn_task_group__create(&installer->group, result_pool));
+
+  /* Register this after creating the group, so the cleanup runs before
+     the group gets destroyed. */
+  apr_pool_cleanup_register(result_pool, installer, installer_cleanup,
+                            apr_pool_cleanup_null);
+
+  *installer_p = installer;
+  return SVN_NO_ERROR;
+}
+
+/* Return the number of leading work items in WORK_ITEMS that are
+   OP_FILE_INSTALL items which neither install nor read a file that an
+   earlier one of them installs or reads.  These can run in any order. */
+static int
+count_independent_installs(const apr_array_header_t *work_items,
+                           apr_pool_t *scratch_pool)
+{
+  apr_hash_t *relpaths = apr_hash_make(scratch_pool);
+  int i;
+
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, i,
+                                                  const svn_skel_t *);
+      const svn_skel_t *arg1;
+      const svn_skel_t *arg4;
+
+      if (! svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        break;
+
+      arg1 = work_item->children->next;
+      arg4 = arg1->next->next->next;
+
+      if (apr_hash_get(relpaths, arg1->data, arg1->len)
+          || (arg4 && apr_hash_get(relpaths, arg4->data, arg4->len)))
+        break;
+
+      apr_hash_set(relpaths, arg1->data, arg1->len, "");
+      if (arg4)
+        apr_hash_set(relpaths, arg4->data, arg4->len, "");
+    }
+
+  return i;
+}
+
+/* Run the first COUNT work items in WORK_ITEMS, which must be independent
+   OP_FILE_INSTALL items as per count_independent_installs(), with their
+   identifiers in IDS.  Install the files on the workers of *INSTALLER_P,
+   which is created in RESULT_POOL if it is NULL, and remember their
+   fileinfo in WQB.
+
+   All database access and all calls to CANCEL_FUNC with CANCEL_BATON
+   happen on this thread.  Returns only after all workers are done with
+   these items.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_installs(installer_t **installer_p,
+             work_item_baton_t *wqb,
+             svn_wc__db_t *db,
+             const char *wri_abspath,
+             const apr_array_header_t *ids,
+             const apr_array_header_t *work_items,
+             int count,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  install_task_t *tasks = apr_pcalloc(scratch_pool, count * sizeof(*tasks));
+  installer_t *installer;
+  svn_error_t *cancel_err = SVN_NO_ERROR;
+  svn_error_t *err;
+  int queued;
+  int i;
+
+  if (! *installer_p)
+    SVN_ERR(installer_create(installer_p, db, result_pool));
+  installer = *installer_p;
+
+  /* Gather everything from the database here and leave the file system
+     work to the workers. */
+  for (queued = 0; queued < count; queued++)
+    {
+      install_task_t *task = &tasks[queued];
+      apr_status_t status;
+
+      task->err = prepare_file_install(&task->install, db,
+                                       APR_ARRAY_IDX(work_items, queued,
+                                                     svn_skel_t *),
+                                       wri_abspath,
+                                       scratch_pool, scratch_pool);
+      if (task->err)
+        {
+          queued++;
+          break;
+        }
+
+      task->installer = installer;
+      task->pool = svn_pool_create(NULL);
+
+      svn_task_group__lock(installer->group);
+      status = svn_task_group__push(installer->group, installer->thread_pool,
+                                    install_task, task);
+      svn_task_group__unlock(installer->group);
+
+      /* Not having a worker is no error.  Install the file ourselves. */
+      if (status)
+        task->err = install_file(&task->dirent, task->install,
+                                 cancel_func, cancel_baton,
+                                 task->pool, task->pool);
+    }
+
+  /* Keep checking for cancellation on behalf of the workers.  Once
+     cancelled, they will stop at their next check. */
+  svn_task_group__lock(installer->group);
+  while (svn_task_group__pending(installer->group))
+    {
+      if (!cancel_func || cancel_err)
+        {
+          svn_task_group__wait(installer->group);
+          continue;
+        }
+
+      svn_task_group__timed_wait(installer->group, INSTALL_CANCEL_INTERVAL);
+
+      svn_task_group__unlock(installer->group);
+      cancel_err = cancel_func(cancel_baton);
+      if (cancel_err)
+        svn_atomic_set(&installer->cancelled, TRUE);
+      svn_task_group__lock(installer->group);
+    }
+  svn_task_group__unlock(installer->group);
+
+  /* Report the cancellation or else the first failure in queue order,
+     like a serial run would.  Nothing gets recorded after a failure. */
+  err = cancel_err;
+  for (i = 0; i < queued; i++)
+    {
+      install_task_t *task = &tasks[i];
+
+      if (task->err && !err)
+        err = wrap_work_item_error(task->err, wri_abspath,
+                                   APR_ARRAY_IDX(ids, i, apr_uint64_t),
+                                   APR_ARRAY_IDX(work_items, i,
+                                                 const svn_skel_t *),
+                                   scratch_pool);
+      else
+        svn_error_clear(task->err);
+
+      if (!err && task->dirent)
+        record_dirent(wqb, task->install->local_abspath,
+                      svn_io_dirent2_dup(task->dirent, wqb->result_pool));
+
+      if (task->pool)
+        svn_pool_destroy(task->pool);
+    }
+
+  return svn_error_trace(err);
+}
+
+#endif
+
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1484,6 +1868,13 @@ svn_wc__wq_run(svn_wc__db_t *db,
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_uint64_t last_id = 0;
   work_item_baton_t wib = { 0 };
+  int max_items = 1;
+#if APR_HAS_THREADS
+  installer_t *installer = NULL;
+
+  /* Look for files to install in parallel right away. */
+  max_items = INSTALL_BATCH_SIZE;
+#endif
   wib.result_pool = svn_pool_create(scratch_pool);
 
 #ifdef SVN_DEBUG_WORK_QUEUE
@@ -1502,31 +1893,28 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
   while (TRUE)
     {
+      apr_array_header_t *ids;
+      apr_array_header_t *work_items;
       apr_uint64_t id;
       svn_skel_t *work_item;
       svn_error_t *err;
 
       svn_pool_clear(iterpool);
 
-      if (! wib.used)
+      /* Make sure to do this *early* in the loop iteration. There may
+         be a LAST_ID that needs to be marked as completed, *before* we
+         start worrying about anything else.  The fileinfo of all items
+         up to LAST_ID is recorded in the same transaction. */
+      SVN_ERR(svn_wc__db_wq_record_and_fetch_items(&ids, &work_items,
+                                                   db, wri_abspath,
+                                                   last_id,
+                                                   wib.used ? wib.record_map
+                                                            : NULL,
+                                                   max_items,
+                                                   iterpool,
+                                                   wib.result_pool));
+      if (wib.used)
         {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, wri_abspath,
-                                           last_id, iterpool, iterpool));
-        }
-      else
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_record_and_fetch_next(&id, &work_item,
-                                                      db, wri_abspath,
-                                                      last_id, wib.record_map,
-                                                      iterpool,
-                                                      wib.result_pool));
-
           svn_pool_clear(wib.result_pool);
           wib.record_map = NULL;
           wib.used = FALSE;
@@ -1540,28 +1928,61 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
       /* If we have a WORK_ITEM, then process the sucker. Otherwise,
          we're done.  */
-      if (work_item == NULL)
+      if (work_items->nelts == 0)
         break;
 
+#if APR_HAS_THREADS
+      /* Install independent files concurrently.  Like for any other work
+         item, none of them is marked completed before all of them have
+         been installed, so an interrupted run just installs them again. */
+      if (work_items->nelts > 1)
+        {
+          int count = count_independent_installs(work_items, iterpool);
+
+          if (count > 1)
+            {
+#ifdef SVN_DEBUG_WORK_QUEUE
+              SVN_DBG(("wq_run: installing %d files\n", count));
+#endif
+              SVN_ERR(run_installs(&installer, &wib, db, wri_abspath,
+                                   ids, work_items, count,
+                                   cancel_func, cancel_baton,
+                                   scratch_pool, iterpool));
+
+              last_id = APR_ARRAY_IDX(ids, count - 1, apr_uint64_t);
+              max_items = INSTALL_BATCH_SIZE;
+              continue;
+            }
+        }
+#endif
+
+      id = APR_ARRAY_IDX(ids, 0, apr_uint64_t);
+      work_item = APR_ARRAY_IDX(work_items, 0, svn_skel_t *);
+
       err = dispatch_work_item(&wib, db, wri_abspath, work_item,
                                cancel_func, cancel_baton, iterpool);
       if (err)
-        {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
-        }
+        return svn_error_trace(wrap_work_item_error(err, wri_abspath, id,
+                                                    work_item,
+                                                    scratch_pool));
 
       /* The work item finished without error. Mark it completed
          in the next loop.  */
       last_id = id;
+
+#if APR_HAS_THREADS
+      /* Only look ahead while files are being installed.  Fetching many
+         items for other work would just waste time. */
+      max_items = svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL)
+                    ? INSTALL_BATCH_SIZE : 1;
+#endif
     }
 
+#if APR_HAS_THREADS
+  if (installer)
+    apr_pool_cleanup_run(scratch_pool, installer, installer_cleanup);
+#endif
+
   svn_pool_destroy(iterpool);
   return SVN_NO_ERROR;
 }
@@ -1626,8 +2047,21 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
   SVN_ERR(svn_io_stat_dirent2(&dirent, local_abspath, FALSE, ignore_enoent,
                               wqb->result_pool, scratch_pool));
 
+  record_dirent(wqb, local_abspath, dirent);
+
+  return SVN_NO_ERROR;
+}
+
+/* Remember DIRENT, which must be allocated in WQB->result_pool, as the
+   fileinfo to record for LOCAL_ABSPATH, unless it does not describe a
+   file. */
+static void
+record_dirent(work_item_baton_t *wqb,
+              const char *local_abspath,
+              const svn_io_dirent2_t *dirent)
+{
   if (dirent->kind != svn_node_file)
-    return SVN_NO_ERROR;
+    return;
 
   wqb->used = TRUE;
 
@@ -1636,6 +2070,4 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
 
   svn_hash_sets(wqb->record_map, apr_pstrdup(wqb->result_pool, local_abspath),
                 dirent);
-
-  return SVN_NO_ERROR;
 }
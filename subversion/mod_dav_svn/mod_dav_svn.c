@@ -627,6 +627,15 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheFile_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  svn_cache_config_set_shared_file(svn_dirent_internal_style(arg1,
+                                                             cmd->pool));
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1392,6 +1401,12 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheFile", SVNInMemoryCacheFile_cmd, NULL,
+                RSRC_CONF,
+                "specifies a file that contains Subversion's in-memory object "
+                "cache and shares it between all processes using that file "
+                "(default is a per-process cache)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
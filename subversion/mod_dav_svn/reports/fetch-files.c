@@ -0,0 +1,340 @@
+/*
+ * fetch-files.c: mod_dav_svn REPORT handler for fetching the contents
+ *                of many files with a single request
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_xml.h>
+
+#include <mod_dav.h>
+
+#include "svn_pools.h"
+#include "svn_types.h"
+#include "svn_delta.h"
+#include "svn_fs.h"
+#include "svn_xml.h"
+#include "svn_dav.h"
+
+#include "private/svn_log.h"
+
+#include "../dav_svn.h"
+
+/* One file requested by the client. */
+typedef struct fetch_item_t
+{
+  /* Version resource URL of the file, as sent by the client. */
+  const char *href;
+
+  /* Version resource URL of the delta base.  NULL if the client has none. */
+  const char *delta_base;
+
+  /* The file that HREF points to. */
+  svn_fs_root_t *root;
+  const char *path;
+} fetch_item_t;
+
+/* State shared by all files of the report. */
+typedef struct fetch_files_baton_t
+{
+  const dav_resource *resource;
+
+  /* this buffers the output for a bit and is automatically flushed,
+     at appropriate times, by the Apache filter system. */
+  apr_bucket_brigade *bb;
+
+  /* where to deliver the output */
+  dav_svn__output *output;
+
+  /* Whether we've written the <S:fetch-files-report> header.  Allows for
+     lazy writes to support mod_dav-based error handling. */
+  svn_boolean_t needs_header;
+
+  /* Revision roots opened so far, mapping svn_revnum_t to svn_fs_root_t *.
+     Most files in a batch come from only a few revisions. */
+  apr_hash_t *roots;
+} fetch_files_baton_t;
+
+
+/* If FFB->needs_header is true, send the "<S:fetch-files-report>" start
+   element and set FFB->needs_header to zero.  Else do nothing. */
+static svn_error_t *
+maybe_send_header(fetch_files_baton_t *ffb)
+{
+  if (ffb->needs_header)
+    {
+      SVN_ERR(dav_svn__brigade_puts(ffb->bb, ffb->output,
+                                    DAV_XML_HEADER DEBUG_CR
+                                    "<S:fetch-files-report xmlns:S=\""
+                                    SVN_XML_NAMESPACE "\" "
+                                    "xmlns:D=\"DAV:\">" DEBUG_CR));
+      ffb->needs_header = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *ROOT_P to the root of revision REV in FFB's repository, reusing
+   roots that have been opened before. */
+static svn_error_t *
+get_root(svn_fs_root_t **root_p,
+         fetch_files_baton_t *ffb,
+         svn_revnum_t rev)
+{
+  apr_pool_t *pool = ffb->resource->pool;
+  svn_fs_root_t *root = apr_hash_get(ffb->roots, &rev, sizeof(rev));
+
+  if (!root)
+    {
+      svn_revnum_t *key = apr_palloc(pool, sizeof(*key));
+
+      SVN_ERR(svn_fs_revision_root(&root, ffb->resource->info->repos->fs,
+                                   rev, pool));
+      *key = rev;
+      apr_hash_set(ffb->roots, key, sizeof(*key), root);
+    }
+
+  *root_p = root;
+  return SVN_NO_ERROR;
+}
+
+/* Set *ROOT_P and *PATH_P to the file that the version resource URL HREF
+   points to.  Return SVN_ERR_APMOD_MALFORMED_URI if HREF is not a version
+   resource URL of FFB's repository and SVN_ERR_AUTHZ_UNREADABLE if the
+   user may not read the file. */
+static svn_error_t *
+resolve_href(svn_fs_root_t **root_p,
+             const char **path_p,
+             fetch_files_baton_t *ffb,
+             const char *href,
+             apr_pool_t *pool)
+{
+  const dav_resource *resource = ffb->resource;
+  dav_svn__uri_info info;
+  svn_error_t *err;
+
+  err = dav_svn__simple_parse_uri(&info, resource, href, pool);
+  if (err || !SVN_IS_VALID_REVNUM(info.rev) || !info.repos_path)
+    return svn_error_createf(SVN_ERR_APMOD_MALFORMED_URI, err,
+                             "'%s' is not a version resource URL", href);
+
+  if (!dav_svn__allow_read(resource->info->r, resource->info->repos,
+                           info.repos_path, info.rev, pool))
+    return svn_error_createf(SVN_ERR_AUTHZ_UNREADABLE, NULL,
+                             "Access to '%s' forbidden", href);
+
+  SVN_ERR(get_root(root_p, ffb, info.rev));
+  *path_p = info.repos_path;
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the contents of the file described by ITEM as a base64-encoded
+   svndiff against its delta base, if any.  ITEM's file must have been
+   resolved already. */
+static svn_error_t *
+send_file(fetch_files_baton_t *ffb,
+          const fetch_item_t *item,
+          apr_pool_t *pool)
+{
+  const dav_resource *resource = ffb->resource;
+  svn_fs_root_t *base_root = NULL;
+  const char *base_path = NULL;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *base64_stream;
+
+  /* An unusable delta base is not an error.  We simply send fulltext. */
+  if (item->delta_base)
+    {
+      svn_node_kind_t kind = svn_node_none;
+      svn_error_t *err = resolve_href(&base_root, &base_path, ffb,
+                                      item->delta_base, pool);
+
+      if (!err)
+        err = svn_fs_check_path(&kind, base_root, base_path, pool);
+
+      if (err || kind != svn_node_file)
+        {
+          svn_error_clear(err);
+          base_root = NULL;
+          base_path = NULL;
+        }
+    }
+
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, base_root, base_path,
+                                       item->root, item->path, pool));
+
+  SVN_ERR(maybe_send_header(ffb));
+  SVN_ERR(dav_svn__brigade_printf(ffb->bb, ffb->output,
+                                  "<S:file href=\"%s\"><S:txdelta>",
+                                  apr_xml_quote_string(pool, item->href,
+                                                       1)));
+
+  /* The window handler closes BASE64_STREAM after the last window. */
+  base64_stream = dav_svn__make_base64_output_stream(ffb->bb, ffb->output,
+                                                     pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton, base64_stream,
+                          resource->info->svndiff_version,
+                          dav_svn__get_compression_level(resource->info->r),
+                          pool);
+  SVN_ERR(svn_txdelta_send_txstream(delta_stream, handler, handler_baton,
+                                    pool));
+
+  SVN_ERR(dav_svn__brigade_puts(ffb->bb, ffb->output,
+                                "</S:txdelta></S:file>" DEBUG_CR));
+
+  return SVN_NO_ERROR;
+}
+
+dav_error *
+dav_svn__fetch_files_report(const dav_resource *resource,
+                            const apr_xml_doc *doc,
+                            dav_svn__output *output)
+{
+  svn_error_t *serr = NULL;
+  dav_error *derr = NULL;
+  apr_xml_elem *child;
+  fetch_files_baton_t ffb = { 0 };
+  apr_array_header_t *items;
+  apr_pool_t *iterpool;
+  int ns;
+  int i;
+
+  ns = dav_svn__find_ns(doc->namespaces, SVN_XML_NAMESPACE);
+  if (ns == -1)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    "The request does not contain the 'svn:' "
+                                    "namespace, so it is not going to have "
+                                    "certain required elements");
+    }
+
+  /* Parse the whole request before sending anything, so malformed requests
+     get a proper error response. */
+  items = apr_array_make(resource->pool, 16, sizeof(fetch_item_t));
+  for (child = doc->root->first_child; child != NULL; child = child->next)
+    {
+      fetch_item_t *item;
+      apr_xml_elem *elem;
+
+      /* if this element isn't one of ours, then skip it */
+      if (child->ns != ns || strcmp(child->name, "file") != 0)
+        continue;
+
+      item = apr_array_push(items);
+      item->href = NULL;
+      item->delta_base = NULL;
+      item->root = NULL;
+      item->path = NULL;
+
+      for (elem = child->first_child; elem != NULL; elem = elem->next)
+        {
+          if (elem->ns != ns)
+            continue;
+
+          if (strcmp(elem->name, "href") == 0)
+            item->href = dav_xml_get_cdata(elem, resource->pool, 1);
+          else if (strcmp(elem->name, "delta-base") == 0)
+            item->delta_base = dav_xml_get_cdata(elem, resource->pool, 1);
+          /* else unknown element; skip it */
+        }
+
+      if (!item->href || !*item->href)
+        return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                      "Request contains a file without "
+                                      "an href");
+    }
+
+  ffb.resource = resource;
+  ffb.bb = apr_brigade_create(resource->pool,
+                              dav_svn__output_get_bucket_alloc(output));
+  ffb.output = output;
+  ffb.needs_header = TRUE;
+  ffb.roots = apr_hash_make(resource->pool);
+
+  /* Check all files before sending anything, so that bad URLs and
+     unreadable files get a proper error response. */
+  for (i = 0; i < items->nelts; ++i)
+    {
+      fetch_item_t *item = &APR_ARRAY_IDX(items, i, fetch_item_t);
+
+      serr = resolve_href(&item->root, &item->path, &ffb, item->href,
+                          resource->pool);
+      if (serr)
+        {
+          derr = dav_svn__convert_err(serr,
+                                      serr->apr_err == SVN_ERR_AUTHZ_UNREADABLE
+                                        ? HTTP_FORBIDDEN
+                                        : HTTP_BAD_REQUEST,
+                                      NULL, resource->pool);
+          goto cleanup;
+        }
+    }
+
+  /* Send the files in the order they were requested.  The client relies
+     on that to match the responses. */
+  iterpool = svn_pool_create(resource->pool);
+  for (i = 0; i < items->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+      serr = send_file(&ffb, &APR_ARRAY_IDX(items, i, fetch_item_t),
+                       iterpool);
+      if (serr)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (serr)
+    {
+      derr = dav_svn__convert_err(serr, HTTP_BAD_REQUEST, NULL,
+                                  resource->pool);
+      goto cleanup;
+    }
+
+  if ((serr = maybe_send_header(&ffb)))
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error beginning REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+  if ((serr = dav_svn__brigade_puts(ffb.bb, ffb.output,
+                                    "</S:fetch-files-report>" DEBUG_CR)))
+    {
+      derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                  "Error ending REPORT response.",
+                                  resource->pool);
+      goto cleanup;
+    }
+
+ cleanup:
+
+  dav_svn__operational_log(resource->info,
+                           svn_log__fetch_files(items->nelts,
+                                                resource->pool));
+
+  return dav_svn__final_flush_or_error(resource->info->r, ffb.bb, output,
+                                       derr, resource->pool);
+}
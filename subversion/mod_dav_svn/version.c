@@ -39,6 +39,7 @@
 #include "svn_dav.h"
 #include "svn_base64.h"
 #include "svn_version.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_dav_protocol.h"
@@ -153,6 +154,7 @@ get_vsn_options(apr_pool_t *p, apr_text_header *phdr)
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_INLINE_PROPS);
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_REVERSE_FILE_REVS);
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_LIST);
+  apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_FETCH_FILES);
   /* Mergeinfo is a special case: here we merely say that the server
    * knows how to handle mergeinfo -- whether the repository does too
    * is a separate matter.
@@ -198,6 +200,7 @@ get_option(const dav_resource *resource,
     { SVN_DAV_NS_DAV_SVN_SVNDIFF1,            { 1, 10, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_SVNDIFF2,            { 1, 10, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, { 1, 10, 0, ""} },
+    { SVN_DAV_NS_DAV_SVN_SVNDIFF4,            { 1, 13, 0, ""} },
   };
 
   /* ### DAV:version-history-collection-set */
@@ -357,6 +360,14 @@ get_option(const dav_resource *resource,
   /* Report commit capabilites. */
   for (i = 0; i < sizeof(capabilities)/sizeof(capabilities[0]); ++i)
     {
+      /* We can only accept svndiff4 if we have been built with zstd
+         support.  When proxying to a master, we can't tell whether the
+         latter has been, so don't advertise svndiff4 at all. */
+      if (strcmp(capabilities[i].capability_name,
+                 SVN_DAV_NS_DAV_SVN_SVNDIFF4) == 0
+          && (master_version || !svn_txdelta__svndiff4_supported()))
+        continue;
+
       /* If a master version is declared filter out unsupported
          capabilities. */
       if (master_version
@@ -1180,6 +1191,10 @@ deliver_report(request_rec *r,
         {
           return dav_svn__list_report(resource, doc, output);
         }
+      else if (strcmp(doc->root->name, "fetch-files-report") == 0)
+        {
+          return dav_svn__fetch_files_report(resource, doc, output);
+        }
       /* NOTE: if you add a report, don't forget to add it to the
        *       dav_svn__reports_list[] array.
        */
@@ -51,6 +51,7 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_fs_private.h"
+#include "private/svn_repos_private.h"
 
 #include "svn_private_config.h"
 
@@ -97,6 +98,7 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_history_index,
   subcommand_crashtest,
   subcommand_create,
   subcommand_delrevprop,
@@ -158,7 +160,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -297,6 +300,11 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"jobs",          svnadmin__jobs, 1,
+     N_("use ARG worker threads to verify the repository\n"
+        "                             metadata concurrently. Default: 1.\n"
+        "                             [used for FSFS repositories only]")},
+
     {NULL}
   };
 
@@ -306,6 +314,18 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc3_t cmd_table[] =
 {
+  {"build-history-index", subcommand_build_history_index, {0}, {N_(
+    "usage: svnadmin build-history-index REPOS_PATH\n"
+    "\n"), N_(
+    "Create or update the history index of the repository at REPOS_PATH.\n"
+    "The index speeds up 'svn log', 'svn blame' and similar operations on\n"
+    "paths with a long history.  Once created, the index is updated with\n"
+    "every commit.  Revisions added by 'svnadmin load' or 'svnsync' are\n"
+    "not indexed; run this command again afterwards.  The index can be\n"
+    "removed at any time and rebuilt later.\n"
+   )},
+   {'q'} },
+
   {"crashtest", subcommand_crashtest, {0}, {N_(
     "usage: svnadmin crashtest REPOS_PATH\n"
     "\n"), N_(
@@ -619,7 +639,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only, svnadmin__jobs} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -662,6 +682,7 @@ struct svnadmin_opt_state
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
+  int jobs;                                         /* --jobs */
 
   const char *config_dir;    /* Overriding Configuration Directory */
 };
@@ -691,6 +712,9 @@ open_repos(svn_repos_t **repos,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                            opt_state->no_flush_to_disk ? "1" : "0");
+  if (opt_state->jobs > 1)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_VERIFY_JOBS,
+                             apr_itoa(pool, opt_state->jobs));
 
   /* now, open the requested repository */
   SVN_ERR(svn_repos_open3(repos, path, fs_config, pool, pool));
@@ -810,6 +834,36 @@ crashtest_malfunction_handler(svn_boolean_t can_return,
   return SVN_NO_ERROR; /* Not reached. */
 }
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_history_index(apr_getopt_t *os, void *baton,
+                               apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_revnum_t start_rev, end_rev;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+  SVN_ERR(svn_repos__build_history_index(&start_rev, &end_rev, repos,
+                                         check_cancel, NULL, pool));
+
+  if (opt_state->quiet)
+    return SVN_NO_ERROR;
+
+  if (SVN_IS_VALID_REVNUM(start_rev))
+    SVN_ERR(svn_cmdline_printf(pool,
+                               _("* Indexed revisions %ld through %ld.\n"),
+                               start_rev, end_rev));
+  else
+    SVN_ERR(svn_cmdline_printf(pool,
+                               _("* History index is up to date.\n")));
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_crashtest(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2964,6 +3018,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3033,6 +3088,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
         SVN_ERR(svn_utf_cstring_to_utf8(&(opt_state.file), opt_arg, pool));
         dash_F_arg = TRUE;
         break;
+      case svnadmin__jobs:
+        {
+          apr_int64_t jobs;
+          SVN_ERR(svn_cstring_strtoi64(&jobs, opt_arg, 1, 256, 10));
+
+          opt_state.jobs = (int) jobs;
+        }
+        break;
       case svnadmin__version:
         opt_state.version = TRUE;
         break;
@@ -3305,7 +3368,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    /* Concurrent verification requires thread-safe caches. */
+    settings.single_threaded = opt_state.jobs < 2;
 
     svn_cache_config_set(&settings);
   }
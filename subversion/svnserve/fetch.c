@@ -0,0 +1,796 @@
+/*
+ * fetch.c :  reconstructing file contents of updates on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include <apr_strings.h>
+
+#include "svn_private_config.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_delta.h"
+#include "private/svn_fspath.h"
+
+#include "server.h"
+
+/* Files that are larger than this will be sent inline, i.e. their
+ * contents will be reconstructed by the thread driving the editor. */
+#define MAX_FETCH_SIZE 0x100000
+
+/* Maximum number of deferred files that have not been sent, yet.  Each
+ * of them corresponds to an open file baton on the client side.  Once we
+ * reached this limit, further files will be sent inline. */
+#define MAX_FETCHES_IN_FLIGHT 256
+
+/* Maximum total size of the deferred files that have not been sent, yet.
+ * This limits the amount of memory used to buffer their contents.  Files
+ * that would exceed this limit will be sent inline. */
+#define MAX_FETCH_DATA_IN_FLIGHT 0x1000000
+
+#if APR_HAS_THREADS
+
+/* A deferred file whose contents get reconstructed by a worker. */
+typedef struct fetch_t
+{
+  /* In-repository path of the file. */
+  const char *path;
+
+  /* Size of the file's fulltext. */
+  apr_size_t size;
+
+  /* Checksum to pass to close_file. */
+  const char *text_checksum;
+
+  /* File baton of the wrapped editor and the pool it lives in.
+   * This structure is allocated in FILE_POOL as well. */
+  void *wrapped_file_baton;
+  apr_pool_t *file_pool;
+
+  /* Thread-safe root pool containing CONTENTS. */
+  apr_pool_t *pool;
+
+  /* The reconstructed fulltext and the error that occurred while
+   * reading it, if any.  Set by the worker. */
+  svn_stringbuf_t *contents;
+  svn_error_t *err;
+
+  /* Set once the worker is done with this file. */
+  svn_boolean_t done;
+
+  /* Next deferred file in order of submission. */
+  struct fetch_t *next;
+} fetch_t;
+
+struct edit_baton
+{
+  const svn_delta_editor_t *wrapped_editor;
+  void *wrapped_edit_baton;
+
+  /* In-repository path of the edit's anchor. */
+  const char *fs_base;
+
+  /* Root of the revision being sent.  Only to be used by the thread
+   * driving the editor. */
+  svn_fs_root_t *root;
+
+  /* What the workers need to open their own revision root. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t revision;
+
+  /* Worker threads started so far and the limit for them. */
+  apr_array_header_t *threads;
+  int max_threads;
+
+  /* The following members are protected by MUTEX. */
+
+  /* Deferred files not sent yet, in order of submission. */
+  fetch_t *first;
+  fetch_t *last;
+
+  /* First entry in that list that has not been picked up by a worker. */
+  fetch_t *next_queued;
+
+  /* Number and total size of the entries in that list. */
+  int count;
+  apr_size_t data_size;
+
+  /* Set when the workers shall terminate. */
+  svn_boolean_t shutdown;
+
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever one of the protected members changed. */
+  apr_thread_cond_t *changed;
+
+  apr_pool_t *pool;
+};
+
+struct dir_baton
+{
+  struct edit_baton *edit_baton;
+  void *wrapped_dir_baton;
+};
+
+struct file_baton
+{
+  struct edit_baton *edit_baton;
+  void *wrapped_file_baton;
+
+  /* Only added files without history may be deferred.  For those, these
+   * are their in-repository path and the pool that the wrapped baton
+   * lives in.  NULL otherwise. */
+  const char *path;
+  apr_pool_t *file_pool;
+
+  /* Set if the contents will be sent by a worker.  SIZE is the size of
+   * the fulltext in that case. */
+  svn_boolean_t deferred;
+  apr_size_t size;
+};
+
+/* Read the contents of FETCH->PATH from ROOT into FETCH->CONTENTS.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_contents(fetch_t *fetch,
+              svn_fs_root_t *root,
+              apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream;
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, fetch->path, scratch_pool));
+  SVN_ERR(svn_stringbuf_from_stream(&fetch->contents, stream, fetch->size,
+                                    fetch->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Worker thread reconstructing the deferred files queued in the
+ * struct edit_baton given as DATA, until it gets shut down. */
+static void * APR_THREAD_FUNC
+fetch_thread(apr_thread_t *tid,
+             void *data)
+{
+  struct edit_baton *eb = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_t *fs;
+  svn_fs_root_t *root = NULL;
+  svn_error_t *open_err;
+
+  /* svn_fs_t must not be shared between threads. */
+  open_err = svn_fs_open2(&fs, eb->fs_path, eb->fs_config, pool, pool);
+  if (!open_err)
+    open_err = svn_fs_revision_root(&root, fs, eb->revision, pool);
+
+  apr_thread_mutex_lock(eb->mutex);
+  while (TRUE)
+    {
+      fetch_t *fetch;
+
+      while (!eb->shutdown && !eb->next_queued)
+        apr_thread_cond_wait(eb->changed, eb->mutex);
+
+      if (eb->shutdown)
+        break;
+
+      fetch = eb->next_queued;
+      eb->next_queued = fetch->next;
+      apr_thread_mutex_unlock(eb->mutex);
+
+      svn_pool_clear(iterpool);
+      if (open_err)
+        fetch->err = svn_error_dup(open_err);
+      else
+        fetch->err = read_contents(fetch, root, iterpool);
+
+      apr_thread_mutex_lock(eb->mutex);
+      fetch->done = TRUE;
+      apr_thread_cond_broadcast(eb->changed);
+    }
+  apr_thread_mutex_unlock(eb->mutex);
+
+  svn_error_clear(open_err);
+  svn_pool_destroy(pool);
+
+  return NULL;
+}
+
+/* Release all resources held by FETCH. */
+static void
+destroy_fetch(fetch_t *fetch)
+{
+  svn_error_clear(fetch->err);
+  svn_pool_destroy(fetch->pool);
+  svn_pool_destroy(fetch->file_pool);
+}
+
+/* Pool cleanup function terminating the workers of the struct edit_baton
+ * given as DATA and releasing all deferred files that have not been sent.
+ * Must be run as a pre-cleanup hook, i.e. before the thread objects'
+ * pools get destroyed. */
+static apr_status_t
+shutdown_workers(void *data)
+{
+  struct edit_baton *eb = data;
+  int i;
+
+  apr_thread_mutex_lock(eb->mutex);
+  eb->shutdown = TRUE;
+  apr_thread_cond_broadcast(eb->changed);
+  apr_thread_mutex_unlock(eb->mutex);
+
+  for (i = 0; i < eb->threads->nelts; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, APR_ARRAY_IDX(eb->threads, i, apr_thread_t *));
+    }
+
+  /* No other thread is accessing EB anymore. */
+  while (eb->first)
+    {
+      fetch_t *fetch = eb->first;
+      eb->first = fetch->next;
+      destroy_fetch(fetch);
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Queue FETCH in EB and make sure there is a worker to process it. */
+static svn_error_t *
+start_fetch(struct edit_baton *eb,
+            fetch_t *fetch)
+{
+  apr_thread_mutex_lock(eb->mutex);
+  if (eb->last)
+    eb->last->next = fetch;
+  else
+    eb->first = fetch;
+
+  eb->last = fetch;
+  if (!eb->next_queued)
+    eb->next_queued = fetch;
+
+  eb->count++;
+  eb->data_size += fetch->size;
+  apr_thread_cond_broadcast(eb->changed);
+  apr_thread_mutex_unlock(eb->mutex);
+
+  if (eb->threads->nelts < eb->max_threads)
+    {
+      apr_thread_t *tid;
+      apr_status_t status = apr_thread_create(&tid, NULL, fetch_thread, eb,
+                                              eb->pool);
+      if (status)
+        {
+          /* Without any worker, FETCH would never complete. */
+          if (eb->threads->nelts == 0)
+            return svn_error_wrap_apr(status, _("Can't create thread"));
+
+          /* Make do with the workers that we already have. */
+          eb->max_threads = eb->threads->nelts;
+        }
+      else
+        {
+          APR_ARRAY_PUSH(eb->threads, apr_thread_t *) = tid;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the contents of FETCH through the wrapped editor in EB and close
+ * the file.  Release FETCH afterwards.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+send_fetch(struct edit_baton *eb,
+           fetch_t *fetch,
+           apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_error_t *err = fetch->err;
+
+  fetch->err = NULL;
+  if (!err)
+    err = eb->wrapped_editor->apply_textdelta(fetch->wrapped_file_baton,
+                                              NULL, scratch_pool,
+                                              &handler, &handler_baton);
+  if (!err)
+    err = svn_txdelta_send_stream(svn_stream_from_stringbuf(fetch->contents,
+                                                            scratch_pool),
+                                  handler, handler_baton, NULL,
+                                  scratch_pool);
+  if (!err)
+    err = eb->wrapped_editor->close_file(fetch->wrapped_file_baton,
+                                         fetch->text_checksum,
+                                         scratch_pool);
+
+  destroy_fetch(fetch);
+
+  return svn_error_trace(err);
+}
+
+/* Send all deferred files in EB through the wrapped editor, in the order
+ * in which the workers finish them.  Wait for the workers as necessary.
+ *
+ * The deferred files' contents may only be sent after all directories,
+ * including the root, have been closed (see rule 5(b) of the
+ * svn_delta_editor_t documentation).  So, this must only be called from
+ * close_edit.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+send_deferred(struct edit_baton *eb,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      fetch_t *fetch, *previous = NULL;
+
+      apr_thread_mutex_lock(eb->mutex);
+      while (TRUE)
+        {
+          for (fetch = eb->first; fetch; fetch = fetch->next)
+            {
+              if (fetch->done)
+                break;
+
+              previous = fetch;
+            }
+
+          if (fetch || eb->count == 0)
+            break;
+
+          apr_thread_cond_wait(eb->changed, eb->mutex);
+          previous = NULL;
+        }
+
+      /* Take FETCH out of the list. */
+      if (fetch)
+        {
+          if (previous)
+            previous->next = fetch->next;
+          else
+            eb->first = fetch->next;
+
+          if (eb->last == fetch)
+            eb->last = previous;
+
+          eb->count--;
+          eb->data_size -= fetch->size;
+        }
+      apr_thread_mutex_unlock(eb->mutex);
+
+      if (!fetch)
+        break;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(send_fetch(eb, fetch, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if a file of SIZE bytes may still be deferred in EB without
+ * exceeding our limits on the files in flight. */
+static svn_boolean_t
+may_defer(struct edit_baton *eb,
+          apr_size_t size)
+{
+  svn_boolean_t result;
+
+  apr_thread_mutex_lock(eb->mutex);
+  result = (   eb->count < MAX_FETCHES_IN_FLIGHT
+            && eb->data_size + size <= MAX_FETCH_DATA_IN_FLIGHT);
+  apr_thread_mutex_unlock(eb->mutex);
+
+  return result;
+}
+
+static svn_error_t *
+set_target_revision(void *edit_baton,
+                    svn_revnum_t target_revision,
+                    apr_pool_t *pool)
+{
+  struct edit_baton *eb = edit_baton;
+
+  return eb->wrapped_editor->set_target_revision(eb->wrapped_edit_baton,
+                                                 target_revision,
+                                                 pool);
+}
+
+static svn_error_t *
+open_root(void *edit_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *pool,
+          void **root_baton)
+{
+  struct edit_baton *eb = edit_baton;
+  struct dir_baton *db = apr_palloc(pool, sizeof(*db));
+
+  SVN_ERR(eb->wrapped_editor->open_root(eb->wrapped_edit_baton,
+                                        base_revision,
+                                        pool,
+                                        &db->wrapped_dir_baton));
+
+  db->edit_baton = eb;
+  *root_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+delete_entry(const char *path,
+             svn_revnum_t base_revision,
+             void *parent_baton,
+             apr_pool_t *pool)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+
+  return eb->wrapped_editor->delete_entry(path,
+                                          base_revision,
+                                          pb->wrapped_dir_baton,
+                                          pool);
+}
+
+static svn_error_t *
+add_directory(const char *path,
+              void *parent_baton,
+              const char *copyfrom_path,
+              svn_revnum_t copyfrom_revision,
+              apr_pool_t *pool,
+              void **child_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+  struct dir_baton *db = apr_palloc(pool, sizeof(*db));
+
+  SVN_ERR(eb->wrapped_editor->add_directory(path,
+                                            pb->wrapped_dir_baton,
+                                            copyfrom_path,
+                                            copyfrom_revision,
+                                            pool,
+                                            &db->wrapped_dir_baton));
+
+  db->edit_baton = eb;
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_directory(const char *path,
+               void *parent_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *pool,
+               void **child_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+  struct dir_baton *db = apr_palloc(pool, sizeof(*db));
+
+  SVN_ERR(eb->wrapped_editor->open_directory(path,
+                                             pb->wrapped_dir_baton,
+                                             base_revision,
+                                             pool,
+                                             &db->wrapped_dir_baton));
+
+  db->edit_baton = eb;
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_dir_prop(void *dir_baton,
+                const char *name,
+                const svn_string_t *value,
+                apr_pool_t *pool)
+{
+  struct dir_baton *db = dir_baton;
+  struct edit_baton *eb = db->edit_baton;
+
+  return eb->wrapped_editor->change_dir_prop(db->wrapped_dir_baton,
+                                             name, value, pool);
+}
+
+static svn_error_t *
+close_directory(void *dir_baton,
+                apr_pool_t *pool)
+{
+  struct dir_baton *db = dir_baton;
+  struct edit_baton *eb = db->edit_baton;
+
+  return eb->wrapped_editor->close_directory(db->wrapped_dir_baton, pool);
+}
+
+static svn_error_t *
+absent_directory(const char *path,
+                 void *parent_baton,
+                 apr_pool_t *pool)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+
+  return eb->wrapped_editor->absent_directory(path, pb->wrapped_dir_baton,
+                                              pool);
+}
+
+static svn_error_t *
+add_file(const char *path,
+         void *parent_baton,
+         const char *copyfrom_path,
+         svn_revnum_t copyfrom_revision,
+         apr_pool_t *pool,
+         void **file_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+  struct file_baton *fb = apr_pcalloc(pool, sizeof(*fb));
+
+  /* The wrapped file baton of a deferred file must outlive POOL. */
+  if (!copyfrom_path)
+    {
+      fb->file_pool = svn_pool_create(eb->pool);
+      fb->path = svn_fspath__join(eb->fs_base, path, fb->file_pool);
+    }
+
+  SVN_ERR(eb->wrapped_editor->add_file(path,
+                                       pb->wrapped_dir_baton,
+                                       copyfrom_path,
+                                       copyfrom_revision,
+                                       fb->file_pool ? fb->file_pool : pool,
+                                       &fb->wrapped_file_baton));
+
+  fb->edit_baton = eb;
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_file(const char *path,
+          void *parent_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *pool,
+          void **file_baton)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+  struct file_baton *fb = apr_pcalloc(pool, sizeof(*fb));
+
+  SVN_ERR(eb->wrapped_editor->open_file(path,
+                                        pb->wrapped_dir_baton,
+                                        base_revision,
+                                        pool,
+                                        &fb->wrapped_file_baton));
+
+  fb->edit_baton = eb;
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+apply_textdelta(void *file_baton,
+                const char *base_checksum,
+                apr_pool_t *pool,
+                svn_txdelta_window_handler_t *handler,
+                void **handler_baton)
+{
+  struct file_baton *fb = file_baton;
+  struct edit_baton *eb = fb->edit_baton;
+
+  /* Deltas against the client's base must be sent inline but fulltexts
+     of reasonable size can be reconstructed by a worker.  Handing back
+     the no-op handler tells the report driver not to even start on it. */
+  if (fb->path && !base_checksum)
+    {
+      svn_filesize_t length;
+
+      SVN_ERR(svn_fs_file_length(&length, eb->root, fb->path, pool));
+      if (   length > 0
+          && length <= MAX_FETCH_SIZE
+          && may_defer(eb, (apr_size_t)length))
+        {
+          fb->deferred = TRUE;
+          fb->size = (apr_size_t)length;
+
+          *handler = svn_delta_noop_window_handler;
+          *handler_baton = NULL;
+
+          return SVN_NO_ERROR;
+        }
+    }
+
+  return eb->wrapped_editor->apply_textdelta(fb->wrapped_file_baton,
+                                             base_checksum,
+                                             pool,
+                                             handler,
+                                             handler_baton);
+}
+
+static svn_error_t *
+change_file_prop(void *file_baton,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *pool)
+{
+  struct file_baton *fb = file_baton;
+  struct edit_baton *eb = fb->edit_baton;
+
+  return eb->wrapped_editor->change_file_prop(fb->wrapped_file_baton,
+                                              name, value, pool);
+}
+
+static svn_error_t *
+close_file(void *file_baton,
+           const char *text_checksum,
+           apr_pool_t *pool)
+{
+  struct file_baton *fb = file_baton;
+  struct edit_baton *eb = fb->edit_baton;
+
+  if (fb->deferred)
+    {
+      fetch_t *fetch = apr_pcalloc(fb->file_pool, sizeof(*fetch));
+
+      fetch->path = fb->path;
+      fetch->size = fb->size;
+      fetch->text_checksum = apr_pstrdup(fb->file_pool, text_checksum);
+      fetch->wrapped_file_baton = fb->wrapped_file_baton;
+      fetch->file_pool = fb->file_pool;
+      fetch->pool = svn_pool_create(NULL);
+
+      return svn_error_trace(start_fetch(eb, fetch));
+    }
+
+  SVN_ERR(eb->wrapped_editor->close_file(fb->wrapped_file_baton,
+                                         text_checksum, pool));
+  if (fb->file_pool)
+    svn_pool_destroy(fb->file_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+absent_file(const char *path,
+            void *parent_baton,
+            apr_pool_t *pool)
+{
+  struct dir_baton *pb = parent_baton;
+  struct edit_baton *eb = pb->edit_baton;
+
+  return eb->wrapped_editor->absent_file(path, pb->wrapped_dir_baton,
+                                         pool);
+}
+
+static svn_error_t *
+close_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  struct edit_baton *eb = edit_baton;
+
+  /* The root directory has been closed by now, so we may finally send
+     the deferred files. */
+  SVN_ERR(send_deferred(eb, pool));
+  return eb->wrapped_editor->close_edit(eb->wrapped_edit_baton, pool);
+}
+
+static svn_error_t *
+abort_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  struct edit_baton *eb = edit_baton;
+
+  /* Files that have not been sent yet get released with EB->POOL. */
+  return eb->wrapped_editor->abort_edit(eb->wrapped_edit_baton, pool);
+}
+
+#endif
+
+svn_error_t *
+get_fetch_editor(const svn_delta_editor_t **editor,
+                 void **edit_baton,
+                 const svn_delta_editor_t *wrapped_editor,
+                 void *wrapped_edit_baton,
+                 svn_fs_t *fs,
+                 apr_hash_t *fs_config,
+                 const char *fs_base,
+                 svn_revnum_t revision,
+                 int max_threads,
+                 apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_delta_editor_t *fetch_editor;
+  struct edit_baton *eb;
+  apr_status_t status;
+
+  if (max_threads <= 0)
+    {
+      *editor = wrapped_editor;
+      *edit_baton = wrapped_edit_baton;
+      return SVN_NO_ERROR;
+    }
+
+  eb = apr_pcalloc(pool, sizeof(*eb));
+  eb->wrapped_editor = wrapped_editor;
+  eb->wrapped_edit_baton = wrapped_edit_baton;
+  eb->fs_base = apr_pstrdup(pool, fs_base);
+  eb->fs_path = apr_pstrdup(pool, svn_fs_path(fs, pool));
+  eb->fs_config = fs_config;
+  eb->revision = revision;
+  eb->threads = apr_array_make(pool, max_threads, sizeof(apr_thread_t *));
+  eb->max_threads = max_threads;
+  eb->pool = pool;
+
+  SVN_ERR(svn_fs_revision_root(&eb->root, fs, revision, pool));
+
+  status = apr_thread_mutex_create(&eb->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&eb->changed, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, eb, shutdown_workers);
+
+  fetch_editor = svn_delta_default_editor(pool);
+  fetch_editor->set_target_revision = set_target_revision;
+  fetch_editor->open_root = open_root;
+  fetch_editor->delete_entry = delete_entry;
+  fetch_editor->add_directory = add_directory;
+  fetch_editor->open_directory = open_directory;
+  fetch_editor->change_dir_prop = change_dir_prop;
+  fetch_editor->close_directory = close_directory;
+  fetch_editor->absent_directory = absent_directory;
+  fetch_editor->add_file = add_file;
+  fetch_editor->open_file = open_file;
+  fetch_editor->apply_textdelta = apply_textdelta;
+  fetch_editor->change_file_prop = change_file_prop;
+  fetch_editor->close_file = close_file;
+  fetch_editor->absent_file = absent_file;
+  fetch_editor->close_edit = close_edit;
+  fetch_editor->abort_edit = abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+#else
+  *editor = wrapped_editor;
+  *edit_baton = wrapped_edit_baton;
+#endif
+
+  return SVN_NO_ERROR;
+}
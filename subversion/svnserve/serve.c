@@ -51,6 +51,7 @@
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
@@ -63,6 +64,11 @@
 #include "server.h"
 #include "logger.h"
 
+/* Maximum size of the string items that get_file uses when sending file
+ * contents straight from the repository files.  The client has to hold
+ * each item in memory as a whole. */
+#define MAX_FILE_RANGE_ITEM 0x100000
+
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
   svn_revnum_t *new_rev;
@@ -990,6 +996,17 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
   /* Make an svn_repos report baton.  Tell it to drive the network editor
    * when the report is complete. */
   svn_ra_svn_get_editor(&editor, &edit_baton, conn, pool, NULL, NULL);
+
+  /* Plain updates may send file contents in whatever order our workers
+   * reconstruct them, if the client can handle that. */
+  if (!tgt_path && text_deltas
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_UNORDERED_CONTENTS))
+    SVN_CMD_ERR(get_fetch_editor(&editor, &edit_baton, editor, edit_baton,
+                                 b->repository->fs,
+                                 b->repository->fs_config,
+                                 b->repository->fs_path->data, rev,
+                                 b->fetch_threads, pool));
+
   SVN_CMD_ERR(svn_repos_begin_report3(&report_baton, rev,
                                       b->repository->repos,
                                       b->repository->fs_path->data, target,
@@ -1562,6 +1579,23 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_fs_process_contents_func_t, sending CONTENTS of length
+ * LEN to the svn_ra_svn_conn_t in BATON as a single string. */
+static svn_error_t *
+send_file_contents(const unsigned char *contents,
+                   apr_size_t len,
+                   void *baton,
+                   apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = baton;
+  svn_string_t str;
+
+  str.data = (const char *)contents;
+  str.len = len;
+
+  return svn_error_trace(svn_ra_svn__write_string(conn, scratch_pool, &str));
+}
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1572,7 +1606,10 @@ get_file(svn_ra_svn_conn_t *conn,
   const char *path, *full_path, *hex_digest;
   svn_revnum_t rev;
   svn_fs_root_t *root;
-  svn_stream_t *contents;
+  svn_stream_t *contents = NULL;
+  apr_file_t *contents_file = NULL;
+  apr_off_t contents_offset;
+  svn_filesize_t contents_length;
   apr_hash_t *props = NULL;
   apr_array_header_t *inherited_props;
   svn_string_t write_str;
@@ -1624,8 +1661,23 @@ get_file(svn_ra_svn_conn_t *conn,
                           wants_inherited_props ? &inherited_props : NULL,
                           &ab, root, full_path,
                           pool));
+  /* Small files are best sent straight from the fulltext cache.  Larger
+     ones may be sent straight from the repository files instead of being
+     streamed through our buffers, if the network connection allows. */
   if (want_contents)
-    SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    {
+      SVN_CMD_ERR(svn_fs_file_length(&contents_length, root, full_path,
+                                     pool));
+      if (   contents_length > svn_ra_svn_zero_copy_limit(conn)
+          && svn_ra_svn__can_write_file_range(conn))
+        SVN_CMD_ERR(svn_fs__get_contents_location(&contents_file,
+                                                  &contents_offset,
+                                                  &contents_length,
+                                                  root, full_path,
+                                                  pool, pool));
+      if (!contents_file)
+        SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    }
 
   /* Send successful command response with revision and props. */
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((?c)r(!", "success",
@@ -1655,10 +1707,34 @@ get_file(svn_ra_svn_conn_t *conn,
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
 
   /* Now send the file's contents. */
-  if (want_contents)
+  if (want_contents && contents_file)
     {
+      while (contents_length > 0)
+        {
+          apr_size_t chunk = contents_length > MAX_FILE_RANGE_ITEM
+                           ? MAX_FILE_RANGE_ITEM
+                           : (apr_size_t)contents_length;
+          SVN_ERR(svn_ra_svn__write_file_range(conn, pool, contents_file,
+                                               contents_offset, chunk));
+          contents_offset += chunk;
+          contents_length -= chunk;
+        }
+
+      SVN_ERR(svn_ra_svn__write_cstring(conn, pool, ""));
+      SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+    }
+  else if (want_contents)
+    {
+      svn_boolean_t processed = FALSE;
+
       err = SVN_NO_ERROR;
-      while (1)
+      if (   contents_length > 0
+          && contents_length <= svn_ra_svn_zero_copy_limit(conn))
+        err = svn_fs_try_process_file_contents(&processed, root, full_path,
+                                               send_file_contents, conn,
+                                               pool);
+
+      while (!processed && !err)
         {
           len = sizeof(buf);
           err = svn_stream_read_full(contents, buf, &len);
@@ -3850,6 +3926,7 @@ find_repos(const char *url,
   SVN_ERR(svn_repos_remember_client_capabilities(repository->repos,
                                                  repository->capabilities));
   repository->fs = svn_repos_fs(repository->repos);
+  repository->fs_config = fs_config;
   fs_path = full_path + strlen(repository->repos_root);
   repository->fs_path = svn_stringbuf_create(*fs_path ? fs_path : "/",
                                              result_pool);
@@ -4145,6 +4222,7 @@ construct_server_baton(server_baton_t **baton,
   b->read_only = params->read_only;
   b->pool = conn_pool;
   b->vhost = params->vhost;
+  b->fetch_threads = params->fetch_threads;
 
   b->logger = params->logger;
   b->client_info = get_client_info(conn, params, conn_pool);
@@ -4153,7 +4231,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4167,7 +4245,8 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           svn_ra_svn__svndiff4_capability()
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
@@ -4402,10 +4481,11 @@ serve_interruptable(svn_boolean_t *terminate_p,
           svn_boolean_t has_command;
 
           /* If the server is busy, execute just one command and only if
-           * there is one currently waiting in our receive buffers.
+           * it has been received completely.  Don't block while waiting
+           * for the rest of it.
            */
-          err = svn_ra_svn__has_command(&has_command, &terminate,
-                                        connection->conn, iterpool);
+          err = svn_ra_svn__has_complete_command(&has_command, &terminate,
+                                                 connection->conn, iterpool);
           if (!err && has_command)
             err = svn_ra_svn__handle_command(&terminate, cmd_hash,
                                              connection->baton,
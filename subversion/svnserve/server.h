@@ -27,6 +27,7 @@
 #define SERVER_H
 
 #include <apr_network_io.h>
+#include <apr_poll.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,7 @@ typedef struct repository_t {
   const char *repos_name;  /* URI-encoded name of repository (not for authz) */
   const char *repos_root;  /* Repository root directory */
   svn_fs_t *fs;            /* For convenience; same as svn_repos_fs(repos) */
+  apr_hash_t *fs_config;   /* FS configuration that REPOS got opened with */
   const char *base;        /* Base directory for config files */
   svn_config_t *pwdb;      /* Parsed password database */
   svn_authz_t *authzdb;    /* Parsed authz rules */
@@ -90,6 +92,8 @@ typedef struct server_baton_t {
                               May be NULL even if log_file is not. */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
   svn_boolean_t vhost;     /* Use virtual-host-based path to repo. */
+  int fetch_threads;       /* Max. worker threads per update, see
+                              serve_params_t */
   apr_pool_t *pool;
 } server_baton_t;
 
@@ -159,6 +163,11 @@ typedef struct serve_params_t {
 
   /* Use virtual-host-based path to repo. */
   svn_boolean_t vhost;
+
+  /* Maximum number of worker threads that reconstruct file contents for
+     a single update, if the client supports out-of-order file contents.
+     0 disables that feature. */
+  int fetch_threads;
 } serve_params_t;
 
 /* This structure contains all data that describes a client / server
@@ -181,6 +190,10 @@ typedef struct connection_t
   /* memory pool for objects with connection lifetime */
   apr_pool_t *pool;
 
+  /* USOCK as registered with the event loop while the connection is
+     idle.  Only used in event mode. */
+  apr_pollfd_t pollfd;
+
   /* Number of threads using the pool.
      The pool passed to apr_thread_create can only be released when both
 
@@ -221,6 +234,29 @@ serve_interruptable(svn_boolean_t *terminate_p,
                     svn_boolean_t (* is_busy)(connection_t *),
                     apr_pool_t *pool);
 
+/* Wrap WRAPPED_EDITOR / WRAPPED_EDIT_BATON, which send an update of
+   FS_BASE in FS to REVISION to the client, and return the wrapper in
+   *EDITOR / *EDIT_BATON.  The contents of added files will be
+   reconstructed by up to MAX_THREADS worker threads while the tree is
+   being sent.  They are sent after the root directory has been closed,
+   in the order in which they become available.  Workers open FS again
+   using FS_CONFIG.
+
+   If MAX_THREADS is 0 or threads are not supported, return the wrapped
+   editor itself.  POOL must live until the edit is completed or aborted.
+   Destroying it shuts down the workers. */
+svn_error_t *
+get_fetch_editor(const svn_delta_editor_t **editor,
+                 void **edit_baton,
+                 const svn_delta_editor_t *wrapped_editor,
+                 void *wrapped_edit_baton,
+                 svn_fs_t *fs,
+                 apr_hash_t *fs_config,
+                 const char *fs_base,
+                 svn_revnum_t revision,
+                 int max_threads,
+                 apr_pool_t *pool);
+
 /* Initialize the Cyrus SASL library. POOL is used for allocations. */
 svn_error_t *cyrus_init(apr_pool_t *pool);
 
@@ -56,6 +56,7 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
 #include "private/svn_subr_private.h"
 
 #if APR_HAS_THREADS
@@ -76,6 +77,8 @@
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_event,  /* Threads serve commands, idle connections
+                             wait in an event loop */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -155,6 +158,16 @@ enum run_mode {
  */
 #define ACCEPT_BACKLOG 128
 
+/* Number of idle connections that the event loop is expected to hold.
+ *
+ * This is merely a sizing hint for event mechanisms like epoll or kqueue.
+ * Should a connection not fit into the event loop anyway, it gets served
+ * by a blocking thread.  The poll() and select() based mechanisms can't
+ * be used by multiple threads at once.  With those, svnserve serves all
+ * connections with a thread each, just like with -T.
+ */
+#define EVENT_LOOP_SIZE 16384
+
 /* Default limit to the client request size in MBytes.  This effectively
  * limits the size of a paths and individual property values to about
  * this value.
@@ -164,6 +177,12 @@ enum run_mode {
  */
 #define MAX_REQUEST_SIZE 16
 
+/* Default number of worker threads that reconstruct file contents for a
+ * single update request.  Only clients that accept file contents in any
+ * order benefit from this.
+ */
+#define FETCH_THREADS 4
+
 #ifdef WIN32
 static apr_os_sock_t winservice_svnserve_accept_socket = INVALID_SOCKET;
 
@@ -222,6 +241,9 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_FILE      277
+#define SVNSERVE_OPT_EVENT_LOOP      278
+#define SVNSERVE_OPT_FETCH_THREADS   279
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -297,6 +319,16 @@ static const apr_getopt_option_t svnserve__options[] =
         "0 switches to dynamically sized caches.\n"
         "                             "
         "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-file", SVNSERVE_OPT_CACHE_FILE, 1,
+     N_("place the in-memory cache in file ARG and share\n"
+        "                             "
+        "it with other svnserve processes using that file.\n"
+        "                             "
+        "All of them must use the same --memory-cache-size.\n"
+        "                             "
+        "Default is a per-process cache.\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
         "                             "
@@ -348,6 +380,12 @@ static const apr_getopt_option_t svnserve__options[] =
                                     "[mode: daemon]")},
 #endif
 #if APR_HAS_THREADS
+    {"event-loop",       SVNSERVE_OPT_EVENT_LOOP, 0,
+     N_("use threads only for connections that sent a\n"
+        "                             "
+        "command; idle connections wait in an event loop\n"
+        "                             "
+        "[mode: daemon]")},
     {"min-threads",      SVNSERVE_OPT_MIN_THREADS, 1,
      N_("Minimum number of server threads, even if idle.\n"
         "                             "
@@ -362,6 +400,13 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Default is " APR_STRINGIFY(THREADPOOL_MAX_SIZE) "."
         ONLY_AVAILABLE_WITH_THEADS)},
+    {"fetch-threads",    SVNSERVE_OPT_FETCH_THREADS, 1,
+     N_("Maximum number of threads reconstructing file\n"
+        "                             "
+        "contents for a single update request.\n"
+        "                             "
+        "0 disables this; default is "
+        APR_STRINGIFY(FETCH_THREADS) ".")},
 #endif
     {"max-request-size", SVNSERVE_OPT_MAX_REQUEST, 1,
      N_("Maximum acceptable size of a client request in MB.\n"
@@ -614,6 +659,23 @@ static svn_root_pools__t *connection_pools;
 /* The global thread pool serving all connections. */
 static apr_thread_pool_t *threads;
 
+/* Let FUNC serve CONNECTION on one of the THREADS.  If that fails, log
+   the error and close the connection. */
+static void
+push_connection(apr_thread_start_t func,
+                connection_t *connection)
+{
+  apr_status_t status = apr_thread_pool_push(threads, func, connection, 0,
+                                             NULL);
+  if (status)
+    {
+      svn_error_t *err = svn_error_wrap_apr(status, _("Can't push task"));
+      logger__log_error(connection->params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+      close_connection(connection);
+    }
+}
+
 /* Very simple load determination callback for serve_interruptable:
    With less than half the threads in THREADS in use, we can afford to
    wait in the socket read() function.  Otherwise, poll them round-robin. */
@@ -651,11 +713,163 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   if (done)
     close_connection(connection);
   else
-    apr_thread_pool_push(threads, serve_thread, connection, 0, NULL);
+    push_connection(serve_thread, connection);
+
+  return NULL;
+}
+
+/* In event mode, all idle connections wait here for their next command. */
+static apr_pollset_t *idle_connections;
+
+/* Load determination callback for serve_interruptable in event mode:
+   Never wait for a command to come in.  That's what the event loop does. */
+static svn_boolean_t
+always_busy(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Serve all commands that have been received completely on the connection
+   given by DATA.  Then, put the connection into the event loop. */
+static void * APR_THREAD_FUNC serve_event_thread(apr_thread_t *tid,
+                                                 void *data)
+{
+  svn_boolean_t done = FALSE;
+  svn_boolean_t has_command = TRUE;
+  connection_t *connection = data;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t status;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* Commands may have been pipelined by the client.  Since they have
+     been read from the socket already, the event loop would not notice
+     them anymore. */
+  while (!err && !done && has_command)
+    {
+      svn_pool_clear(pool);
+      err = serve_interruptable(&done, connection, always_busy, pool);
+      if (!err && !done)
+        err = svn_ra_svn__has_complete_command(&has_command, &done,
+                                               connection->conn, pool);
+    }
+
+  /* Make sure the client got all our responses before going idle. */
+  if (!err && !done)
+    err = svn_ra_svn__flush(connection->conn, pool);
+
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  if (done)
+    {
+      close_connection(connection);
+      return NULL;
+    }
+
+  /* Wait for the next command.  If the event loop is full, fall back to
+     serving the connection the traditional way. */
+  connection->pollfd.p = NULL;
+  connection->pollfd.desc_type = APR_POLL_SOCKET;
+  connection->pollfd.reqevents = APR_POLLIN;
+  connection->pollfd.desc.s = connection->usock;
+  connection->pollfd.client_data = connection;
+
+  status = apr_pollset_add(idle_connections, &connection->pollfd);
+  if (status)
+    push_connection(serve_thread, connection);
+
+  return NULL;
+}
+
+/* The event loop, run by a single thread.  Wait for any of the idle
+   connections to receive data and pass them on to the worker threads.
+   DATA is the serve_params_t used to log errors. */
+static void * APR_THREAD_FUNC event_loop(apr_thread_t *tid, void *data)
+{
+  serve_params_t *params = data;
+
+  while (1)
+    {
+      apr_int32_t count, i;
+      const apr_pollfd_t *descriptors;
+      apr_status_t status;
+
+      status = apr_pollset_poll(idle_connections, -1, &count, &descriptors);
+      if (APR_STATUS_IS_EINTR(status) || APR_STATUS_IS_TIMEUP(status))
+        continue;
 
+      if (status)
+        {
+          svn_error_t *err = svn_error_wrap_apr(status,
+                                                _("Can't poll connections"));
+          logger__log_error(params->logger, err, NULL, NULL);
+          svn_error_clear(err);
+          continue;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = descriptors[i].client_data;
+
+          /* The worker will re-add the connection once it is idle again.
+             Hangups and errors will be detected by the worker as well. */
+          apr_pollset_remove(idle_connections, &connection->pollfd);
+          push_connection(serve_event_thread, connection);
+        }
+    }
+
+  /* NOTREACHED */
   return NULL;
 }
 
+/* Create the event loop for idle connections and start the thread that
+   runs it.  PARAMS are the server parameters.  Allocate everything in
+   POOL.
+
+   Set *STARTED to FALSE, if the platform's poll mechanism can't be used
+   by multiple threads at once, e.g. because it is based on poll() or
+   select().  Log a warning in that case. */
+static svn_error_t *
+start_event_loop(svn_boolean_t *started,
+                 serve_params_t *params,
+                 apr_pool_t *pool)
+{
+  apr_thread_t *tid;
+  apr_status_t status;
+
+  /* Worker threads add connections while the event loop is waiting. */
+  status = apr_pollset_create(&idle_connections, EVENT_LOOP_SIZE, pool,
+                              APR_POLLSET_THREADSAFE | APR_POLLSET_NOCOPY);
+  if (status)
+    {
+      svn_error_t *err
+        = svn_error_wrap_apr(status,
+                             _("Can't create event loop, serving each "
+                               "connection with a thread instead"));
+      logger__log_warning(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+
+      idle_connections = NULL;
+      *started = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  status = apr_thread_create(&tid, NULL, event_loop, params, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create event loop thread"));
+
+  *started = TRUE;
+  return SVN_NO_ERROR;
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -738,6 +952,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   int handling_opt_count = 0;
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
+  const char *memory_cache_file = NULL;
   const char *log_filename = NULL;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
@@ -774,6 +989,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.error_check_interval = 4096;
   params.max_request_size = MAX_REQUEST_SIZE * 0x100000;
   params.max_response_size = 0;
+#if APR_HAS_THREADS
+  params.fetch_threads = FETCH_THREADS;
+#else
+  params.fetch_threads = 0;
+#endif
 
   while (1)
     {
@@ -892,6 +1112,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           handling_opt_count++;
           break;
 
+        case SVNSERVE_OPT_EVENT_LOOP:
+          handling_mode = connection_mode_event;
+          handling_opt_count++;
+          break;
+
         case 'c':
           params.compression_level = atoi(arg);
           if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
@@ -909,6 +1134,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           }
           break;
 
+        case SVNSERVE_OPT_CACHE_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&memory_cache_file, arg, pool));
+          memory_cache_file = svn_dirent_internal_style(memory_cache_file,
+                                                        pool);
+          SVN_ERR(svn_dirent_get_absolute(&memory_cache_file,
+                                          memory_cache_file, pool));
+          break;
+
         case SVNSERVE_OPT_CACHE_TXDELTAS:
           cache_txdeltas = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -962,6 +1195,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           max_thread_count = (apr_size_t)apr_strtoi64(arg, NULL, 0);
           break;
 
+        case SVNSERVE_OPT_FETCH_THREADS:
+          params.fetch_threads = (int)apr_strtoi64(arg, NULL, 0);
+          if (params.fetch_threads < 0)
+            params.fetch_threads = 0;
+          break;
+
 #ifdef WIN32
         case SVNSERVE_OPT_SERVICE:
           if (run_mode != run_mode_service)
@@ -1029,7 +1268,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --event-loop "
+                        "or --single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
       *exit_code = EXIT_FAILURE;
@@ -1037,7 +1277,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 
   /* construct object pools */
-  is_multi_threaded = handling_mode == connection_mode_thread;
+  is_multi_threaded = handling_mode == connection_mode_thread
+                   || handling_mode == connection_mode_event;
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1280,7 +1521,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (is_multi_threaded)
       {
 #if APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -1295,12 +1536,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* Share the cache with other svnserve processes. */
+    if (memory_cache_file)
+      svn_cache_config_set_shared_file(memory_cache_file);
   }
 
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
-  if (handling_mode == connection_mode_thread)
+  if (is_multi_threaded)
     {
       /* create the thread pool with a valid range of threads */
       if (max_thread_count < 1)
@@ -1323,6 +1568,15 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
       /* don't queue requests unless we reached the worker thread limit */
       apr_thread_pool_threshold_set(threads, 0);
+
+      if (handling_mode == connection_mode_event)
+        {
+          svn_boolean_t started;
+
+          SVN_ERR(start_event_loop(&started, &params, pool));
+          if (!started)
+            handling_mode = connection_mode_thread;
+        }
     }
   else
     {
@@ -1382,6 +1636,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
           break;
 
+        case connection_mode_event:
+          /* Serve the handshake right away.  Afterwards, the connection
+             will wait in the event loop for the next command. */
+#if APR_HAS_THREADS
+          attach_connection(connection);
+
+          status = apr_thread_pool_push(threads, serve_event_thread,
+                                        connection, 0, NULL);
+          if (status)
+            {
+              return svn_error_wrap_apr(status, _("Can't push task"));
+            }
+#endif
+          break;
+
         case connection_mode_single:
           /* Serve one connection at a time. */
           /* serve_socket() logs any error it returns, so ignore it. */
@@ -133,6 +133,104 @@ def verify_xml_response(expected_xml, actual_xml):
                           % (ET.tostring(expected_elem),
                              ET.tostring(actual_elem)))
 
+def repo_uripath(sbox):
+  """Return the URI path of SBOX's repository."""
+  return '/' + svntest.wc.svn_uri_quote(sbox.repo_dir.replace(os.path.sep,
+                                                              '/'))
+
+def rvr_url(sbox, rev, path):
+  """Return the version resource URL of PATH in revision REV of SBOX's
+  repository."""
+  return '%s/!svn/rvr/%d/%s' % (repo_uripath(sbox), rev, path)
+
+def read_svndiff_int(data, pos):
+  """Decode the variable-length integer at POS in the bytearray DATA.
+  Return the integer and the position after it."""
+  value = 0
+  while True:
+    value = (value << 7) | (data[pos] & 0x7f)
+    pos += 1
+    if data[pos - 1] & 0x80 == 0:
+      return value, pos
+
+def apply_svndiff0(svndiff, source):
+  """Return the text that the svndiff0 delta SVNDIFF produces from the
+  bytes SOURCE."""
+  data = bytearray(svndiff)
+  if data[:4] != bytearray(b'SVN\0'):
+    raise svntest.Failure('Not an svndiff0 delta: %r' % svndiff[:4])
+
+  target = bytearray()
+  pos = 4
+  while pos < len(data):
+    sview_offset, pos = read_svndiff_int(data, pos)
+    sview_len, pos = read_svndiff_int(data, pos)
+    tview_len, pos = read_svndiff_int(data, pos)
+    ins_len, pos = read_svndiff_int(data, pos)
+    new_len, pos = read_svndiff_int(data, pos)
+
+    ins_end = pos + ins_len
+    new_pos = ins_end
+    tview = bytearray()
+    while pos < ins_end:
+      action = data[pos] >> 6
+      length = data[pos] & 0x3f
+      pos += 1
+      if length == 0:
+        length, pos = read_svndiff_int(data, pos)
+      if action == 0:
+        offset, pos = read_svndiff_int(data, pos)
+        start = sview_offset + offset
+        tview += bytearray(source[start:start + length])
+      elif action == 1:
+        offset, pos = read_svndiff_int(data, pos)
+        # The source range may overlap with the target range.
+        for i in range(length):
+          tview.append(tview[offset + i])
+      else:
+        tview += data[new_pos:new_pos + length]
+        new_pos += length
+
+    if len(tview) != tview_len:
+      raise svntest.Failure('Delta window has %d bytes instead of %d'
+                            % (len(tview), tview_len))
+    target += tview
+    pos = ins_end + new_len
+
+  return bytes(target)
+
+def fetch_files(sbox, files, user=b'jrandom'):
+  """Request the FILES, a list of (HREF, DELTA_BASE) tuples, from SBOX's
+  repository with a fetch-files REPORT as USER.  DELTA_BASE may be None.
+  Return the response status and, if successful, the list of received
+  (HREF, SVNDIFF) tuples."""
+
+  import xml.etree.ElementTree as ET
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(user + b':rayjandom').decode(),
+  }
+  req_body = '<S:fetch-files-report xmlns:S="svn:">\n'
+  for href, delta_base in files:
+    req_body += '<S:file><S:href>%s</S:href>' % href
+    if delta_base:
+      req_body += '<S:delta-base>%s</S:delta-base>' % delta_base
+    req_body += '</S:file>\n'
+  req_body += '</S:fetch-files-report>\n'
+
+  h = svntest.main.create_http_connection(sbox.repo_url)
+  h.request('REPORT', sbox.repo_url, req_body, headers)
+  r = h.getresponse()
+  actual_response = r.read()
+  if r.status != httplib.OK:
+    return r.status, None
+
+  received = []
+  for elem in ET.fromstring(actual_response).findall('{svn:}file'):
+    txdelta = elem.find('{svn:}txdelta').text or ''
+    received.append((elem.get('href'), base64.b64decode(txdelta)))
+  return r.status, received
+
 ######################################################################
 # Tests
 
@@ -640,6 +738,93 @@ def propfind_propname(sbox):
   actual_response = r.read()
   verify_xml_response(expected_response, actual_response)
 
+@SkipUnless(svntest.main.is_ra_type_dav)
+def fetch_files_mixed_revisions(sbox):
+  "fetch-files REPORT across several revisions"
+
+  sbox.build()
+  sbox.simple_append('iota', 'Second line of iota.\n')
+  sbox.simple_commit(message='r2')
+  sbox.simple_append('A/mu', 'Second line of mu.\n')
+  sbox.simple_commit(message='r3')
+  sbox.simple_append('iota', 'Third line of iota.\n')
+  sbox.simple_commit(message='r4')
+
+  iota_1 = b"This is the file 'iota'.\n"
+  iota_2 = iota_1 + b'Second line of iota.\n'
+  iota_4 = iota_2 + b'Third line of iota.\n'
+  mu_1 = b"This is the file 'mu'.\n"
+  mu_3 = mu_1 + b'Second line of mu.\n'
+  lambda_1 = b"This is the file 'lambda'.\n"
+
+  # (href, delta base, delta base contents, expected contents)
+  expected = [
+    (rvr_url(sbox, 4, 'iota'), rvr_url(sbox, 2, 'iota'), iota_2, iota_4),
+    (rvr_url(sbox, 1, 'iota'), None, b'', iota_1),
+    (rvr_url(sbox, 3, 'A/mu'), rvr_url(sbox, 1, 'A/mu'), mu_1, mu_3),
+    (rvr_url(sbox, 4, 'A/B/lambda'), rvr_url(sbox, 2, 'A/B/lambda'),
+     lambda_1, lambda_1),
+    (rvr_url(sbox, 2, 'iota'), rvr_url(sbox, 4, 'iota'), iota_4, iota_2),
+  ]
+
+  status, received = fetch_files(sbox, [(href, base)
+                                        for href, base, _, _ in expected])
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  if len(received) != len(expected):
+    raise svntest.Failure('Received %d files instead of %d'
+                          % (len(received), len(expected)))
+
+  # The files must arrive in request order.
+  for (href, svndiff), (exp_href, _, base, contents) in zip(received,
+                                                            expected):
+    if href != exp_href:
+      raise svntest.Failure("Received '%s' instead of '%s'"
+                            % (href, exp_href))
+    actual = apply_svndiff0(svndiff, base)
+    if actual != contents:
+      raise svntest.Failure("Wrong contents of '%s': %r" % (href, actual))
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def fetch_files_errors(sbox):
+  "fetch-files REPORT with bad or unreadable files"
+
+  sbox.build(create_wc=False)
+  svntest.main.write_authz_file(sbox, { '/'      : '* = rw',
+                                        '/A/B/E' : 'jrandom =' })
+
+  iota = rvr_url(sbox, 1, 'iota')
+  alpha = rvr_url(sbox, 1, 'A/B/E/alpha')
+
+  # An unreadable file fails the whole request, even after readable ones.
+  status, _ = fetch_files(sbox, [(iota, None), (alpha, None)])
+  if status != httplib.FORBIDDEN:
+    raise svntest.Failure('Unexpected status: %d' % status)
+
+  # Users with access get it.
+  status, received = fetch_files(sbox, [(alpha, None)], user=b'jconstant')
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  if apply_svndiff0(received[0][1], b'') != b"This is the file 'alpha'.\n":
+    raise svntest.Failure("Wrong contents of '%s'" % alpha)
+
+  # An unreadable delta base is ignored and we get fulltext instead.
+  status, received = fetch_files(sbox, [(iota, alpha)])
+  if status != httplib.OK:
+    raise svntest.Failure('Unexpected status: %d' % status)
+  if apply_svndiff0(received[0][1], b'') != b"This is the file 'iota'.\n":
+    raise svntest.Failure("Wrong contents of '%s'" % iota)
+
+  # Public URLs and URLs outside the repository are bad requests,
+  # not forbidden ones.
+  for href in [repo_uripath(sbox) + '/iota',
+               '/no-such-repos/!svn/rvr/1/iota',
+               repo_uripath(sbox) + '/!svn/me']:
+    status, _ = fetch_files(sbox, [(href, None)])
+    if status != httplib.BAD_REQUEST:
+      raise svntest.Failure("Unexpected status for '%s': %d"
+                            % (href, status))
+
 ########################################################################
 # Run the tests
 
@@ -652,6 +837,8 @@ test_list = [ None,
               propfind_404,
               propfind_allprop,
               propfind_propname,
+              fetch_files_mixed_revisions,
+              fetch_files_errors,
              ]
 serial_only = True
 
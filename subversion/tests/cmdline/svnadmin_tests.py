@@ -2805,6 +2805,40 @@ def verify_packed(sbox):
   svntest.actions.run_and_verify_svnadmin(expected_output, [],
                                           "verify", sbox.repo_dir)
 
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+def verify_concurrently(sbox):
+  "verify metadata using multiple threads"
+
+  # Configure two files per shard such that there is more than one
+  # task to distribute.
+  sbox.build()
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  sbox.simple_append('iota', "Line.\n")
+  sbox.simple_commit(message='r2')
+  sbox.simple_propset('foo', 'bar', 'iota')
+  sbox.simple_commit(message='r3')
+  sbox.simple_rm('A/C')
+  sbox.simple_commit(message='r4')
+  sbox.simple_copy('A/B/E', 'A/B/E1')
+  sbox.simple_commit(message='r5')
+
+  # Pack some of the shards but leave the others as they are.
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "pack", sbox.repo_dir)
+  sbox.simple_append('A/mu', "Line.\n")
+  sbox.simple_commit(message='r6')
+
+  # Progress and results must be reported in the same order and with
+  # the same granularity as in serial mode.
+  _, expected_output, _ = svntest.actions.run_and_verify_svnadmin(
+                                          None, [],
+                                          "verify", sbox.repo_dir)
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "verify", "--jobs", "3",
+                                          sbox.repo_dir)
+
 # Test that 'svnadmin freeze' is nestable.  (For example, this ensures it
 # won't take system-global locks, only repository-scoped ones.)
 #
@@ -4043,6 +4077,7 @@ test_list = [ None,
               recover_prunes_rep_cache_when_enabled,
               recover_prunes_rep_cache_when_disabled,
               dump_include_copied_directory,
+              verify_concurrently,
              ]
 
 if __name__ == '__main__':
@@ -715,6 +715,9 @@ exclusive-locking = true
     if options.http_proxy_password:
       http_proxy_password_str = "http-proxy-password=%s" % \
                                      (options.http_proxy_password)
+    http_http2_str = ""
+    if options.http_http2:
+      http_http2_str = "http-http2=yes"
 
     server_contents = """
 #
@@ -723,10 +726,11 @@ exclusive-locking = true
 %s
 %s
 %s
+%s
 store-plaintext-passwords=yes
 store-passwords=yes
 """ % (http_library_str, http_proxy_str, http_proxy_username_str,
-       http_proxy_password_str)
+       http_proxy_password_str, http_http2_str)
 
   file_write(cfgfile_cfg, config_contents)
   file_write(cfgfile_srv, server_contents)
@@ -1781,6 +1785,8 @@ class TestSpawningThread(threading.Thread):
       args.append('--http-proxy-username=' + options.http_proxy_username)
     if options.http_proxy_password:
       args.append('--http-proxy-password=' + options.http_proxy_password)
+    if options.http_http2:
+      args.append('--http-http2')
     if options.httpd_version:
       args.append('--httpd-version=' + options.httpd_version)
     if options.httpd_whitelist:
@@ -2207,6 +2213,8 @@ def _create_parser(usage=None):
                     help='Username for the HTTP Proxy.')
   parser.add_option('--http-proxy-password', action='store',
                     help='Password for the HTTP Proxy.')
+  parser.add_option('--http-http2', action='store_true',
+                    help='Multiplex HTTP requests over http/2.')
   parser.add_option('--httpd-version', action='store',
                     help='Assume HTTPD is this version.')
   parser.add_option('--httpd-whitelist', action='store',
@@ -6897,6 +6897,75 @@ def update_keeps_unversioned_items_in_deleted_dir(sbox):
                                         expected_status,
                                         [], True)
 
+def update_many_added_files(sbox):
+  "update adding many files in nested dirs"
+
+  # Over svn://, the contents of small added files get reconstructed on
+  # server threads and are sent after the tree.  Add more of them than
+  # the server is willing to defer and mix them with files that are sent
+  # inline: empty ones, large ones and modified ones.
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  expected_output = svntest.wc.State(wc_dir, {
+    'A/mu'     : Item(status='U '),
+    'A/fetch'  : Item(status='A '),
+    })
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.tweak('A/mu', contents='modified mu\n')
+  expected_disk.add({
+    'A/fetch'  : Item(),
+    })
+
+  sbox.simple_mkdir('A/fetch')
+  sbox.simple_append('A/mu', 'modified mu\n', truncate=True)
+  added_files = []
+  for i in range(6):
+    dir_path = 'A/fetch/D%d' % i
+    sbox.simple_mkdir(dir_path)
+    expected_output.add({ dir_path : Item(status='A ') })
+    expected_disk.add({ dir_path : Item() })
+    for j in range(60):
+      path = '%s/f%d' % (dir_path, j)
+      contents = 'This is file %d in directory %d.\n' % (j, i)
+      svntest.main.file_write(sbox.ospath(path), contents)
+      added_files.append(path)
+      expected_output.add({ path : Item(status='A ') })
+      expected_disk.add({ path : Item(contents) })
+
+  big = 'A/fetch/big'
+  big_contents = 'Line of a file larger than one megabyte.\n' * 30000
+  svntest.main.file_write(sbox.ospath(big), big_contents)
+  empty = 'A/fetch/D0/empty'
+  svntest.main.file_write(sbox.ospath(empty), '')
+  expected_output.add({ big : Item(status='A '),
+                        empty : Item(status='A ') })
+  expected_disk.add({ big : Item(big_contents),
+                      empty : Item('') })
+
+  sbox.simple_add(big, empty, *added_files)
+  sbox.simple_commit()
+
+  expected_status = svntest.actions.get_virginal_state(wc_dir, 2)
+  for path in expected_disk.desc:
+    if path not in expected_status.desc:
+      expected_status.add({ path : Item(status='  ', wc_rev=2) })
+
+  # Update from r1 to r2.
+  sbox.simple_update(revision='1')
+  svntest.actions.run_and_verify_update(wc_dir,
+                                        expected_output,
+                                        expected_disk,
+                                        expected_status)
+
+  # And a fresh checkout of r2.
+  wc2_dir = sbox.add_wc_path('checkout')
+  expected_output = expected_disk.copy(wc2_dir)
+  expected_output.tweak(status='A ', contents=None)
+  svntest.actions.run_and_verify_checkout(sbox.repo_url, wc2_dir,
+                                          expected_output,
+                                          expected_disk)
+
 #######################################################################
 # Run the tests
 
@@ -6989,6 +7058,7 @@ test_list = [ None,
               update_delete_switched,
               update_add_missing_local_add,
               update_keeps_unversioned_items_in_deleted_dir,
+              update_many_added_files,
              ]
 
 if __name__ == '__main__':
@@ -1419,6 +1419,177 @@ test_copy_pin_externals_select_subtree(const svn_test_opts_t *opts, apr_pool_t *
   return SVN_NO_ERROR;
 }
 
+/* Baton for the callbacks of test_interrupted_checkout(). */
+typedef struct interrupt_baton_t
+{
+  /* The absolute paths of the files reported as added, mapped to "". */
+  apr_hash_t *added_files;
+
+  /* Cancel once this many files have been reported. */
+  unsigned int cancel_after;
+} interrupt_baton_t;
+
+/* Implements svn_wc_notify_func2_t. */
+static void
+interrupt_notify(void *baton,
+                 const svn_wc_notify_t *notify,
+                 apr_pool_t *pool)
+{
+  interrupt_baton_t *ib = baton;
+
+  if (notify->action == svn_wc_notify_update_add
+      && notify->kind == svn_node_file)
+    {
+      apr_pool_t *result_pool = apr_hash_pool_get(ib->added_files);
+
+      svn_hash_sets(ib->added_files,
+                    apr_pstrdup(result_pool, notify->path), "");
+    }
+}
+
+/* Implements svn_cancel_func_t. */
+static svn_error_t *
+interrupt_cancel(void *baton)
+{
+  interrupt_baton_t *ib = baton;
+
+  if (apr_hash_count(ib->added_files) >= ib->cancel_after)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_client_status_func_t, collecting the statuses in the
+   hash BATON, keyed by absolute path. */
+static svn_error_t *
+interrupt_status(void *baton,
+                 const char *path,
+                 const svn_client_status_t *status,
+                 apr_pool_t *scratch_pool)
+{
+  apr_hash_t *statuses = baton;
+  apr_pool_t *result_pool = apr_hash_pool_get(statuses);
+
+  svn_hash_sets(statuses, apr_pstrdup(result_pool, status->local_abspath),
+                svn_client_status_dup(status, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Check out the Greek tree, but cancel after a few files have been added,
+   while the changes are collected in a bulk transaction.  Check that the
+   changes made so far are committed and that cleanup leaves a working copy
+   that update can complete. */
+static svn_error_t *
+test_interrupted_checkout(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_opt_revision_t rev;
+  svn_client_ctx_t *ctx;
+  svn_wc_context_t *wc_ctx;
+  interrupt_baton_t ib;
+  const char *repos_url;
+  const char *wc_path;
+  apr_array_header_t *targets;
+  apr_hash_t *statuses;
+  apr_hash_index_t *hi;
+  apr_pool_t *subpool;
+  svn_error_t *err;
+  int files;
+
+  /* Create a filesytem and repository containing the Greek tree. */
+  SVN_ERR(create_greek_repos(&repos_url, "interrupted-checkout", opts, pool));
+
+  SVN_ERR(svn_dirent_get_absolute(
+            &wc_path, svn_test_data_path("interrupted-checkout-wc", pool),
+            pool));
+  svn_test_add_dir_cleanup(wc_path);
+  SVN_ERR(svn_io_remove_dir2(wc_path, TRUE, NULL, NULL, pool));
+
+  SVN_ERR(svn_client_create_context(&ctx, pool));
+  ib.added_files = apr_hash_make(pool);
+  ib.cancel_after = 3;
+  ctx->notify_func2 = interrupt_notify;
+  ctx->notify_baton2 = &ib;
+  ctx->cancel_func = interrupt_cancel;
+  ctx->cancel_baton = &ib;
+
+  /* Destroying the pool runs the cleanup of the interrupted edit. */
+  rev.kind = svn_opt_revision_head;
+  subpool = svn_pool_create(pool);
+  err = svn_client_checkout3(NULL, repos_url, wc_path, &rev, &rev,
+                             svn_depth_infinity, FALSE, FALSE, ctx, subpool);
+  svn_pool_destroy(subpool);
+  SVN_TEST_ASSERT(err && svn_error_find_cause(err, SVN_ERR_CANCELLED));
+  svn_error_clear(err);
+  SVN_TEST_ASSERT(apr_hash_count(ib.added_files) >= ib.cancel_after);
+  SVN_TEST_ASSERT(apr_hash_count(ib.added_files) < 12);
+
+  ctx->notify_func2 = NULL;
+  ctx->cancel_func = NULL;
+
+  /* Everything reported before the interruption is visible to others. */
+  SVN_ERR(svn_wc_context_create(&wc_ctx, NULL, pool, pool));
+  for (hi = apr_hash_first(pool, ib.added_files); hi; hi = apr_hash_next(hi))
+    {
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_wc_read_kind2(&kind, wc_ctx, apr_hash_this_key(hi),
+                                FALSE, FALSE, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+  SVN_ERR(svn_wc_context_destroy(wc_ctx));
+
+  SVN_ERR(svn_client_cleanup2(wc_path, TRUE, TRUE, FALSE, TRUE, FALSE,
+                              ctx, pool));
+
+  /* Nothing on disk is unknown to the working copy and nothing it knows
+     is missing on disk. */
+  statuses = apr_hash_make(pool);
+  SVN_ERR(svn_client_status6(NULL, ctx, wc_path, &rev, svn_depth_infinity,
+                             TRUE, FALSE, TRUE, TRUE, TRUE, FALSE, NULL,
+                             interrupt_status, statuses, pool));
+  for (hi = apr_hash_first(pool, statuses); hi; hi = apr_hash_next(hi))
+    {
+      const svn_client_status_t *status = apr_hash_this_val(hi);
+
+      SVN_TEST_ASSERT(status->node_status != svn_wc_status_unversioned);
+      SVN_TEST_ASSERT(status->node_status != svn_wc_status_missing);
+      SVN_TEST_ASSERT(status->node_status != svn_wc_status_obstructed);
+    }
+  for (hi = apr_hash_first(pool, ib.added_files); hi; hi = apr_hash_next(hi))
+    {
+      const svn_client_status_t *status
+        = svn_hash_gets(statuses, apr_hash_this_key(hi));
+
+      SVN_TEST_ASSERT(status);
+      SVN_TEST_ASSERT(status->node_status == svn_wc_status_normal);
+    }
+
+  /* Update completes the checkout. */
+  targets = apr_array_make(pool, 1, sizeof(const char *));
+  APR_ARRAY_PUSH(targets, const char *) = wc_path;
+  SVN_ERR(svn_client_update4(NULL, targets, &rev, svn_depth_infinity, TRUE,
+                             FALSE, FALSE, TRUE, FALSE, ctx, pool));
+
+  statuses = apr_hash_make(pool);
+  SVN_ERR(svn_client_status6(NULL, ctx, wc_path, &rev, svn_depth_infinity,
+                             TRUE, FALSE, TRUE, TRUE, TRUE, FALSE, NULL,
+                             interrupt_status, statuses, pool));
+  files = 0;
+  for (hi = apr_hash_first(pool, statuses); hi; hi = apr_hash_next(hi))
+    {
+      const svn_client_status_t *status = apr_hash_this_val(hi);
+
+      SVN_TEST_ASSERT(status->node_status == svn_wc_status_normal);
+      if (status->kind == svn_node_file)
+        files++;
+    }
+  SVN_TEST_INT_ASSERT(files, 12);
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1447,6 +1618,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_client_copy7 with externals_to_pin"),
     SVN_TEST_OPTS_PASS(test_copy_pin_externals_select_subtree,
                        "pin externals on selected subtrees only"),
+    SVN_TEST_OPTS_PASS(test_interrupted_checkout,
+                       "clean up an interrupted checkout"),
     SVN_TEST_NULL
   };
 
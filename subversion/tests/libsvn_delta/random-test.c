@@ -36,7 +36,9 @@
 #include "svn_delta.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -280,6 +282,14 @@ copy_tempfile(apr_file_t *fp, apr_pool_t *pool)
 
 
 
+/* Return the svndiff version to use in iteration I of the random tests,
+ * cycling through all versions supported by this build. */
+static int
+pick_svndiff_version(int i)
+{
+  return i % (svn_txdelta__svndiff4_supported() ? 5 : 4);
+}
+
 /* (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_test(apr_pool_t *pool,
@@ -330,8 +340,8 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              pick_svndiff_version(i), i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -358,6 +368,7 @@ do_random_test(apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+
 /* Implements svn_test_driver_t. */
 static svn_error_t *
 random_test(apr_pool_t *pool)
@@ -426,8 +437,8 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              pick_svndiff_version(i), i % 10, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
 
@@ -569,8 +580,9 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
                    FALSE, iterpool);
-      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
-                                                   iterpool);
+      delta_stream = svn_txdelta_to_svndiff_stream(txstream,
+                                                   pick_svndiff_version(i),
+                                                   i % 10, iterpool);
 
       /* Apply it to a copy of the source file to see if we get the
          same target back. */
@@ -605,6 +617,323 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Size of the source data used by the xdelta throughput test. */
+#define THROUGHPUT_CORPUS_SIZE (4 * 1024 * 1024)
+
+/* Append LEN bytes of generated data to BUF.  If TEXT is set, make it look
+ * like program source code; generate random binary data otherwise.
+ * Use and update *SEED.
+ */
+static void
+generate_corpus(svn_stringbuf_t *buf,
+                apr_size_t len,
+                svn_boolean_t text,
+                apr_uint32_t *seed)
+{
+  static const char * const words[] = {
+    "if (", "len", ") ", "return ", "svn_error_t *", "apr_size_t ", "pool",
+    ";\n", "  ", "{\n", "}\n", "NULL", ", ", "SVN_ERR(", "data", " = "
+  };
+
+  apr_size_t end = buf->len + len;
+  if (text)
+    {
+      while (buf->len < end)
+        {
+          const char *word = words[svn_test_rand(seed) % 16];
+          apr_size_t word_len = strlen(word);
+          svn_stringbuf_appendbytes(buf, word,
+                                    MIN(word_len, end - buf->len));
+        }
+    }
+  else
+    {
+      while (buf->len < end)
+        svn_stringbuf_appendbyte(buf, (char)svn_test_rand(seed));
+    }
+}
+
+/* Return a copy of SOURCE with scattered insertions, deletions and
+ * modifications applied to it.  TEXT and SEED are the same as for
+ * generate_corpus().  Allocate the result in POOL.
+ */
+static svn_stringbuf_t *
+edit_corpus(const svn_stringbuf_t *source,
+            svn_boolean_t text,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *target
+    = svn_stringbuf_create_ensure(source->len + source->len / 8, pool);
+  apr_size_t pos = 0;
+
+  while (pos < source->len)
+    {
+      /* Copy a run of unchanged data. */
+      apr_size_t len = MIN(svn_test_rand(seed) % 8192, source->len - pos);
+      svn_stringbuf_appendbytes(target, source->data + pos, len);
+      pos += len;
+
+      /* Followed by some local change. */
+      len = svn_test_rand(seed) % 256;
+      switch (svn_test_rand(seed) % 3)
+        {
+        case 0:
+          generate_corpus(target, len, text, seed);
+          break;
+
+        case 1:
+          pos += MIN(len, source->len - pos);
+          break;
+
+        default:
+          len = MIN(len, source->len - pos);
+          generate_corpus(target, len, text, seed);
+          pos += len;
+          break;
+        }
+    }
+
+  return target;
+}
+
+/* Implements svn_txdelta_window_handler_t.
+ * Append a copy of WINDOW to the array of windows in BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window,
+               void *baton)
+{
+  apr_array_header_t *windows = baton;
+
+  if (window)
+    APR_ARRAY_PUSH(windows, svn_txdelta_window_t *)
+      = svn_txdelta_window_dup(window, windows->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Deltify generated binary and text data and report the throughput of the
+ * delta generator.  Verify that the deltas actually reproduce the target.
+ */
+static svn_error_t *
+xdelta_throughput_test(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x5eed;
+  int text;
+
+  for (text = 0; text < 2; ++text)
+    {
+      apr_pool_t *iterpool = svn_pool_create(pool);
+      svn_stringbuf_t *source
+        = svn_stringbuf_create_ensure(THROUGHPUT_CORPUS_SIZE, iterpool);
+      svn_stringbuf_t *target;
+      svn_stringbuf_t *result = svn_stringbuf_create_empty(iterpool);
+      apr_array_header_t *windows
+        = apr_array_make(iterpool, 64, sizeof(svn_txdelta_window_t *));
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      apr_time_t duration;
+      int i;
+
+      generate_corpus(source, THROUGHPUT_CORPUS_SIZE, text, &seed);
+      target = edit_corpus(source, text, &seed, iterpool);
+
+      /* Only measure the delta generation. */
+      duration = apr_time_now();
+      SVN_ERR(svn_txdelta_run(svn_stream_from_stringbuf(source, iterpool),
+                              svn_stream_from_stringbuf(target, iterpool),
+                              collect_window, windows,
+                              svn_checksum_md5, NULL, NULL, NULL,
+                              iterpool, iterpool));
+      duration = apr_time_now() - duration;
+
+      if (opts->verbose)
+        printf("%s: %d windows, %.1f MB/s\n",
+               text ? "text" : "binary", windows->nelts,
+               (double)target->len / MAX(duration, 1));
+
+      /* Apply the delta to the source and compare with the target. */
+      svn_txdelta_apply(svn_stream_from_stringbuf(source, iterpool),
+                        svn_stream_from_stringbuf(result, iterpool),
+                        NULL, NULL, iterpool, &handler, &handler_baton);
+      for (i = 0; i < windows->nelts; ++i)
+        SVN_ERR(handler(APR_ARRAY_IDX(windows, i, svn_txdelta_window_t *),
+                        handler_baton));
+      SVN_ERR(handler(NULL, handler_baton));
+
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+      svn_pool_destroy(iterpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Size of the source data used by the large window test. */
+#define LARGE_WINDOW_CORPUS_SIZE (2 * 1024 * 1024)
+
+/* Push TARGET through a delta stream against SOURCE that uses windows of
+ * WINDOW_SIZE bytes.  Return the result in svndiff VERSION format in
+ * *SVNDIFF.  Allocate everything in POOL.
+ */
+static svn_error_t *
+encode_with_window_size(svn_stringbuf_t **svndiff,
+                        svn_stringbuf_t *source,
+                        svn_stringbuf_t *target,
+                        apr_size_t window_size,
+                        int version,
+                        apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = target->len;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  stream = svn_txdelta__target_push(handler, handler_baton,
+                                    svn_stream_from_stringbuf(source, pool),
+                                    window_size, pool);
+  SVN_ERR(svn_stream_write(stream, target->data, &len));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Parse SVNDIFF and apply it to SOURCE.  Return the result in *RESULT.
+ * Allocate everything in POOL.
+ */
+static svn_error_t *
+apply_svndiff(svn_stringbuf_t **result,
+              svn_stringbuf_t *source,
+              svn_stringbuf_t *svndiff,
+              apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = svndiff->len;
+
+  *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_from_stringbuf(*result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Like apply_svndiff but read SVNDIFF window by window, the way the
+ * repository backends do.  This is the only way to decode large windows.
+ */
+static svn_error_t *
+apply_svndiff_windows(svn_stringbuf_t **result,
+                      svn_stringbuf_t *source,
+                      svn_stringbuf_t *svndiff,
+                      apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream = svn_stream_from_stringbuf(svndiff, pool);
+  char header[4];
+  apr_size_t len = sizeof(header);
+  svn_boolean_t more;
+
+  *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_from_stringbuf(*result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+
+  SVN_ERR(svn_stream_read_full(stream, header, &len));
+  SVN_TEST_ASSERT(len == sizeof(header));
+
+  SVN_ERR(svn_stream_data_available(stream, &more));
+  while (more)
+    {
+      svn_txdelta_window_t *window;
+      SVN_ERR(svn_txdelta_read_svndiff_window(&window, stream, header[3],
+                                              pool));
+      SVN_ERR(handler(window, handler_baton));
+      SVN_ERR(svn_stream_data_available(stream, &more));
+    }
+
+  return svn_error_trace(handler(NULL, handler_baton));
+}
+
+/* Insert data near the start of a binary file, i.e. shift most of its
+ * contents by more than half a standard window.  Verify that svndiff3
+ * with large windows still finds the common data while svndiff1 does not
+ * and that older svndiff versions reject large windows.  Streams as
+ * received from the network must never contain large windows.
+ */
+static svn_error_t *
+large_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x1a59e;
+  svn_stringbuf_t *source
+    = svn_stringbuf_create_ensure(LARGE_WINDOW_CORPUS_SIZE, pool);
+  svn_stringbuf_t *target;
+  svn_stringbuf_t *small_delta, *large_delta, *result;
+
+  generate_corpus(source, LARGE_WINDOW_CORPUS_SIZE, FALSE, &seed);
+  target = svn_stringbuf_create_ensure(source->len + 0x10000, pool);
+  svn_stringbuf_appendbytes(target, source->data, 1000);
+  generate_corpus(target, 0x10000, FALSE, &seed);
+  svn_stringbuf_appendbytes(target, source->data + 1000, source->len - 1000);
+
+  SVN_ERR(encode_with_window_size(&small_delta, source, target,
+                                  SVN_DELTA_WINDOW_SIZE, 1, pool));
+  SVN_ERR(encode_with_window_size(&large_delta, source, target,
+                                  1024 * 1024, 3, pool));
+  SVN_TEST_ASSERT(large_delta->len < small_delta->len / 4);
+
+  /* Both must reproduce the target. */
+  SVN_ERR(apply_svndiff(&result, source, small_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+  SVN_ERR(apply_svndiff_windows(&result, source, large_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  /* But not when parsed as a stream. */
+  SVN_TEST_ASSERT_ERROR(apply_svndiff(&result, source, large_delta, pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  /* Svndiff4 supports large windows as well. */
+  if (svn_txdelta__svndiff4_supported())
+    {
+      SVN_ERR(encode_with_window_size(&large_delta, source, target,
+                                      1024 * 1024, 4, pool));
+      SVN_TEST_ASSERT(large_delta->len < small_delta->len / 4);
+      SVN_ERR(apply_svndiff_windows(&result, source, large_delta, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+      SVN_TEST_ASSERT_ERROR(apply_svndiff(&result, source, large_delta,
+                                          pool),
+                            SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+    }
+
+  /* Svndiff1 can't describe large windows.  The encoder refuses to
+   * produce them and the decoder rejects them. */
+  SVN_TEST_ASSERT_ERROR(encode_with_window_size(&small_delta, source, target,
+                                                1024 * 1024, 1, pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+  SVN_ERR(encode_with_window_size(&large_delta, source, target,
+                                  1024 * 1024, 3, pool));
+  large_delta->data[3] = 1;
+  SVN_TEST_ASSERT_ERROR(apply_svndiff_windows(&result, source, large_delta,
+                                              pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  /* Windows up to the standard size are fine for any version. */
+  SVN_ERR(encode_with_window_size(&small_delta, source, target,
+                                  SVN_DELTA_WINDOW_SIZE, 0, pool));
+  SVN_ERR(apply_svndiff(&result, source, small_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +954,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(xdelta_throughput_test,
+                       "xdelta throughput on binary and text data"),
+    SVN_TEST_PASS2(large_window_test,
+                   "svndiff3 with large delta windows"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
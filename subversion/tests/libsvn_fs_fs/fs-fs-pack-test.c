@@ -36,6 +36,7 @@
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_cache.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -1887,6 +1888,448 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large_delta_windows"
+
+static svn_error_t *
+large_delta_windows(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents, *contents2, *read_back;
+  apr_hash_t *fs_config;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 13))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create a repo using 1MB delta windows. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_DELTA_WINDOW_SIZE, "1048576");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->delta_window_size == 1048576);
+
+  /* Construct a file spanning several windows, then insert some data
+   * near its start.  This shifts all following data across window
+   * boundaries. */
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len < 3 * 1024 * 1024; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %d\n", i));
+
+  contents2 = svn_stringbuf_dup(contents, pool);
+  svn_stringbuf_insert(contents2, 1000, contents->data + 500000, 65536);
+
+  /* Revision 1: add the file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: modify it. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents2->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Reopen with disjoint caches, so we actually read the deltas from disk,
+   * and check that the window size has been persisted. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->delta_window_size == 1048576);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &read_back, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, contents));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &read_back, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, contents2));
+
+  /* Window sizes outside the supported range must be rejected. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_DELTA_WINDOW_SIZE, "1000");
+  SVN_TEST_ASSERT_ANY_ERROR(svn_test__create_fs2(&fs, REPO_NAME "-invalid",
+                                                 opts, fs_config, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-parallel_reconstruction"
+
+static svn_error_t *
+parallel_reconstruction(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *text, *read_back;
+  apr_array_header_t *contents;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 13))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Build a delta chain for a file spanning multiple windows.  Each
+   * revision modifies a different part of it. */
+  contents = apr_array_make(pool, 8, sizeof(svn_stringbuf_t *));
+  text = svn_stringbuf_create_empty(pool);
+  for (i = 0; text->len < 3 * 1024 * 1024; ++i)
+    svn_stringbuf_appendcstr(text, apr_psprintf(pool, "line %d\n", i));
+
+  rev = 0;
+  for (i = 0; i < 8; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (i > 0)
+        {
+          text = svn_stringbuf_dup(text, pool);
+          svn_stringbuf_insert(text, i * 300000, "modified\n", 9);
+        }
+
+      APR_ARRAY_PUSH(contents, svn_stringbuf_t *) = text;
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (i == 0)
+        SVN_ERR(svn_fs_make_file(root, "foo", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "foo", text->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Reopen with disjoint caches, so we actually read the deltas from disk,
+   * and let worker threads read all delta windows. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+  ffd->parallel_read_threshold = 1;
+
+  /* Start with the longest delta chain. */
+  for (i = contents->nelts - 1; i >= 0; --i)
+    {
+      svn_pool_clear(iterpool);
+      text = APR_ARRAY_IDX(contents, i, svn_stringbuf_t *);
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "foo", &read_back,
+                                          iterpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, text));
+    }
+
+#if APR_HAS_THREADS
+  /* Every representation in the chain has been read by a worker. */
+  SVN_TEST_ASSERT(ffd->prefetched_windows >= (apr_uint64_t)contents->nelts);
+#endif
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-mmap_rev_files"
+#define SHARD_SIZE 4
+#define MAX_REV 9
+static svn_error_t *
+mmap_rev_files(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+  apr_hash_t *fs_config;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 13))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create a repo with packed shards as well as non-packed revisions. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Reopen with disjoint caches, so we actually read everything from the
+   * mapped rev / pack files. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+  ffd->enable_mmap = TRUE;
+
+  for (rev = MAX_REV; rev >= 0; --rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_verify_root(root, iterpool));
+
+      if (rev > 1)
+        {
+          SVN_ERR(svn_test__get_file_contents(root, "iota", &contents,
+                                              iterpool));
+          SVN_TEST_STRING_ASSERT(contents->data,
+                                 get_rev_contents(rev, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-truncated_index"
+/* Number of bytes of the L2P index to keep.  Shorter than its prefix. */
+#define L2P_KEEP 4
+static svn_error_t *
+truncated_index(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *rev_path;
+  svn_stringbuf_t *rev_contents;
+  svn_stringbuf_t *truncated;
+  svn_stringbuf_t *footer;
+  svn_stringbuf_t *contents;
+  apr_off_t l2p_offset, p2l_offset, footer_offset;
+  svn_checksum_t *l2p_checksum, *p2l_checksum;
+  unsigned char footer_length;
+  apr_hash_t *fs_config;
+  svn_error_t *err;
+  int use_mmap;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 13))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  if (! svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Cut the L2P index down to a few bytes and fix up the footer, so that
+   * the P2L index and the footer itself stay intact. */
+  rev_path = svn_fs_fs__path_rev_absolute(fs, rev, pool);
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents, rev_path, pool));
+
+  footer_length = (unsigned char)rev_contents->data[rev_contents->len - 1];
+  footer_offset = rev_contents->len - 1 - footer_length;
+  footer = svn_stringbuf_ncreate(rev_contents->data + footer_offset,
+                                 footer_length, pool);
+  SVN_ERR(svn_fs_fs__parse_footer(&l2p_offset, &l2p_checksum,
+                                  &p2l_offset, &p2l_checksum, footer,
+                                  rev, footer_offset, pool));
+
+  truncated = svn_stringbuf_ncreate(rev_contents->data,
+                                    (apr_size_t)l2p_offset + L2P_KEEP, pool);
+  svn_stringbuf_appendbytes(truncated, rev_contents->data + p2l_offset,
+                            (apr_size_t)(footer_offset - p2l_offset));
+  footer = svn_fs_fs__unparse_footer(l2p_offset, l2p_checksum,
+                                     l2p_offset + L2P_KEEP, p2l_checksum,
+                                     pool, pool);
+  svn_stringbuf_appendstr(truncated, footer);
+  svn_stringbuf_appendbyte(truncated, (char)footer->len);
+  SVN_ERR(svn_io_write_atomic2(rev_path, truncated->data, truncated->len,
+                               NULL, FALSE, pool));
+
+  /* Reading the revision must report the corruption, whether or not the
+   * rev file is mapped into memory.  Use fresh caches each time. */
+  for (use_mmap = 0; use_mmap < 2; ++use_mmap)
+    {
+      fs_config = apr_hash_make(pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                               svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+      ffd = fs->fsap_data;
+      ffd->enable_mmap = use_mmap;
+
+      err = svn_fs_revision_root(&root, fs, rev, pool);
+      if (!err)
+        err = svn_test__get_file_contents(root, "iota", &contents, pool);
+
+      SVN_TEST_ASSERT(svn_error_find_cause(err, SVN_ERR_FS_INDEX_CORRUPTION));
+      svn_error_clear(err);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef L2P_KEEP
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-read_ahead_statistics"
+#define FILE_COUNT 100
+#define BLOCK_SIZE 0x1000
+static svn_error_t *
+read_ahead_statistics(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents;
+  apr_uint32_t seed = 0;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int read_ahead_blocks;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 13))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Block-read and thus reading ahead require logical addressing. */
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Revision 1: many files with hardly compressible contents, so reading
+   * them in order walks across many block boundaries. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "f%03d", i);
+      contents = svn_stringbuf_create_empty(iterpool);
+      while (contents->len < 4096)
+        {
+          seed = seed * 1103515245 + 12345;
+          svn_stringbuf_appendcstr(contents,
+                                   apr_psprintf(iterpool, "%08x", seed));
+        }
+
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path, contents->data,
+                                          iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  for (read_ahead_blocks = 0; read_ahead_blocks <= 4; read_ahead_blocks += 4)
+    {
+      svn_cache__info_t *before, *after;
+      apr_uint64_t requested, hits;
+      apr_hash_t *fs_config;
+
+      svn_pool_clear(subpool);
+
+      /* Use a separate cache namespace, so all data has to be read from
+       * the rev file. */
+      fs_config = apr_hash_make(subpool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                               svn_uuid_generate(subpool));
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, subpool, subpool));
+
+      ffd = fs->fsap_data;
+      ffd->block_size = BLOCK_SIZE;
+      ffd->read_ahead_blocks = read_ahead_blocks;
+
+      /* The statistics are process-wide.  Other tests may only add to
+       * them, so only check lower bounds. */
+      before = svn_cache__membuffer_get_global_info(subpool);
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, subpool));
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_test__get_file_contents(root,
+                                              apr_psprintf(iterpool,
+                                                           "f%03d", i),
+                                              &contents, iterpool));
+        }
+
+      after = svn_cache__membuffer_get_global_info(subpool);
+      requested = after->read_ahead_blocks - before->read_ahead_blocks;
+      hits = after->read_ahead_hits - before->read_ahead_hits;
+
+      if (read_ahead_blocks == 0)
+        {
+          /* Nothing has been requested for this FS. */
+          SVN_TEST_ASSERT(ffd->read_ahead_end == 0);
+        }
+      else
+        {
+          /* Reading the file contents in order crosses a block boundary
+           * every few files.  Most of the blocks we cross into should
+           * have been requested already. */
+          SVN_TEST_ASSERT(ffd->read_ahead_end > 0);
+          SVN_TEST_ASSERT(hits >= FILE_COUNT / 5);
+          SVN_TEST_ASSERT(requested >= hits);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef FILE_COUNT
+#undef BLOCK_SIZE
+
 
 
 /* The test table.  */
@@ -1942,6 +2385,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(large_delta_windows,
+                       "large delta windows using svndiff3"),
+    SVN_TEST_OPTS_PASS(parallel_reconstruction,
+                       "read delta windows on worker threads"),
+    SVN_TEST_OPTS_PASS(mmap_rev_files,
+                       "read from memory-mapped rev and pack files"),
+    SVN_TEST_OPTS_PASS(truncated_index,
+                       "reject truncated index streams"),
+    SVN_TEST_OPTS_PASS(read_ahead_statistics,
+                       "read-ahead across block boundaries"),
     SVN_TEST_NULL
   };
 
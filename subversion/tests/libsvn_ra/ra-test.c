@@ -36,6 +36,12 @@
 #include "svn_cmdline.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "svn_sorts.h"
+#include "svn_ra_svn.h"
+
+#include "private/svn_dep_compat.h"
+#include "private/svn_fs_private.h"
+#include "private/svn_ra_svn_private.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -169,6 +175,27 @@ check_tunnel(void *tunnel_baton, const char *tunnel_name)
   return b->last_check;
 }
 
+/* Set *SVNSERVE to the absolute path of the svnserve executable in the
+   build tree.  Allocate it in POOL. */
+static svn_error_t *
+get_svnserve_path(const char **svnserve,
+                  apr_pool_t *pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_dirent_get_absolute(svnserve, "../../svnserve/svnserve", pool));
+#ifdef WIN32
+  *svnserve = apr_pstrcat(pool, *svnserve, ".exe", SVN_VA_NULL);
+#endif
+  SVN_ERR(svn_io_check_path(*svnserve, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Could not find svnserve at %s",
+                             svn_dirent_local_style(*svnserve, pool));
+
+  return SVN_NO_ERROR;
+}
+
 static void
 close_tunnel(void *tunnel_context, void *tunnel_baton);
 
@@ -181,7 +208,6 @@ open_tunnel(svn_stream_t **request, svn_stream_t **response,
             svn_cancel_func_t cancel_func, void *cancel_baton,
             apr_pool_t *pool)
 {
-  svn_node_kind_t kind;
   apr_proc_t *proc;
   apr_procattr_t *attr;
   apr_status_t status;
@@ -192,15 +218,7 @@ open_tunnel(svn_stream_t **request, svn_stream_t **response,
 
   SVN_TEST_ASSERT(b->magic == TUNNEL_MAGIC);
 
-  SVN_ERR(svn_dirent_get_absolute(&svnserve, "../../svnserve/svnserve", pool));
-#ifdef WIN32
-  svnserve = apr_pstrcat(pool, svnserve, ".exe", SVN_VA_NULL);
-#endif
-  SVN_ERR(svn_io_check_path(svnserve, &kind, pool));
-  if (kind != svn_node_file)
-    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
-                             "Could not find svnserve at %s",
-                             svn_dirent_local_style(svnserve, pool));
+  SVN_ERR(get_svnserve_path(&svnserve, pool));
 
   status = apr_procattr_create(&attr, pool);
   if (status == APR_SUCCESS)
@@ -260,6 +278,90 @@ close_tunnel(void *tunnel_context, void *tunnel_baton)
     }
 }
 
+/* Start an svnserve daemon that serves the current directory on a free
+   port of the loopback interface.  Pass EXTRA_ARG, if not NULL, as an
+   additional command line argument.  Set *URL to the svn:// URL of the
+   served directory.  The daemon is killed when POOL gets cleaned up. */
+static svn_error_t *
+start_svnserve_daemon(const char **url,
+                      const char *extra_arg,
+                      apr_pool_t *pool)
+{
+  apr_sockaddr_t *sa;
+  apr_socket_t *sock;
+  apr_proc_t *proc;
+  apr_procattr_t *attr;
+  apr_status_t status;
+  const char *svnserve;
+  const char *args[9];
+  int i = 0;
+
+  SVN_ERR(get_svnserve_path(&svnserve, pool));
+
+  /* Let the OS pick a free port for us. */
+  status = apr_sockaddr_info_get(&sa, "127.0.0.1", APR_INET, 0, 0, pool);
+  if (status == APR_SUCCESS)
+    status = apr_socket_create(&sock, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, pool);
+  if (status == APR_SUCCESS)
+    {
+      status = apr_socket_bind(sock, sa);
+      if (status == APR_SUCCESS)
+        status = apr_socket_addr_get(&sa, APR_LOCAL, sock);
+      apr_socket_close(sock);
+    }
+  if (status != APR_SUCCESS)
+    return svn_error_wrap_apr(status, "Could not find a free port");
+
+  args[i++] = "svnserve";
+  args[i++] = "-d";
+  args[i++] = "--foreground";
+  args[i++] = "-r";
+  args[i++] = ".";
+  args[i++] = "--listen-host=127.0.0.1";
+  args[i++] = apr_psprintf(pool, "--listen-port=%d", sa->port);
+  if (extra_arg)
+    args[i++] = extra_arg;
+  args[i] = NULL;
+
+  status = apr_procattr_create(&attr, pool);
+  if (status == APR_SUCCESS)
+    status = apr_procattr_cmdtype_set(attr, APR_PROGRAM);
+  proc = apr_palloc(pool, sizeof(*proc));
+  if (status == APR_SUCCESS)
+    status = apr_proc_create(proc,
+                             svn_dirent_local_style(svnserve, pool),
+                             args, NULL, attr, pool);
+  if (status != APR_SUCCESS)
+    return svn_error_wrap_apr(status, "Could not run svnserve");
+  apr_pool_note_subprocess(pool, proc, APR_KILL_ALWAYS);
+
+  *url = apr_psprintf(pool, "svn://127.0.0.1:%d", sa->port);
+  return SVN_NO_ERROR;
+}
+
+/* Open *SESSION to URL like svn_ra_open4() does, using CBTABLE.  Retry for
+   a while, giving a freshly started svnserve daemon time to listen. */
+static svn_error_t *
+open_daemon_session(svn_ra_session_t **session,
+                    const char *url,
+                    svn_ra_callbacks2_t *cbtable,
+                    apr_pool_t *pool)
+{
+  int attempt;
+
+  for (attempt = 0; ; ++attempt)
+    {
+      svn_error_t *err = svn_ra_open4(session, NULL, url, NULL, cbtable,
+                                      NULL, NULL, pool);
+      if (!err || attempt == 50)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+      apr_sleep(apr_time_from_msec(100));
+    }
+}
+
 
 
 
@@ -1785,6 +1887,291 @@ commit_locked_file(const svn_test_opts_t *opts, apr_pool_t *pool)
 }
 
 
+/* Number of log entries to parse in ra_svn_parse_items. */
+#define PARSE_BENCHMARK_ITEMS 100000
+
+static svn_error_t *
+ra_svn_parse_items(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *input = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *large = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__item_t *item;
+  svn_ra_svn__list_t *entry;
+  apr_time_t duration;
+  int i;
+
+  /* Log entries as a server would send them, interleaved with a few
+     strings that are larger than the connection's read buffer. */
+  for (i = 0; i < 100000; ++i)
+    svn_stringbuf_appendbyte(large, (char)('a' + i % 26));
+
+  for (i = 0; i < PARSE_BENCHMARK_ITEMS; ++i)
+    {
+      svn_stringbuf_appendcstr(input,
+        apr_psprintf(pool,
+                     "( ( ( 11:/trunk/%04d M ( ) ( 4:file true false ) ) ) "
+                     "%d ( 7:jrandom ) ( 27:2019-01-01T00:00:00.000000Z ) "
+                     "( 11:log message ) false false 0 ( ) false ) ",
+                     i % 10000, i + 1));
+
+      if (i % 10000 == 0)
+        svn_stringbuf_appendcstr(input,
+                                 apr_psprintf(pool, "%" APR_SIZE_T_FMT ":%s ",
+                                              large->len, large->data));
+    }
+
+  conn = svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_stringbuf(input, pool),
+                                 svn_stream_empty(pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                 0, 0, 0, 0, pool);
+
+  duration = apr_time_now();
+  for (i = 0; i < PARSE_BENCHMARK_ITEMS; ++i)
+    {
+      svn_ra_svn__item_t *elt;
+
+      svn_pool_clear(iterpool);
+
+      if (i % 10000 == 0)
+        {
+          SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+          SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+          SVN_TEST_ASSERT(item->u.string.len == large->len);
+          SVN_TEST_ASSERT(memcmp(item->u.string.data, large->data,
+                                 large->len) == 0);
+        }
+
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+      entry = &item->u.list;
+      SVN_TEST_INT_ASSERT(entry->nelts, 10);
+
+      /* Changed paths. */
+      elt = &SVN_RA_SVN__LIST_ITEM(entry, 0);
+      SVN_TEST_ASSERT(elt->kind == SVN_RA_SVN_LIST);
+      SVN_TEST_INT_ASSERT(elt->u.list.nelts, 1);
+      elt = &SVN_RA_SVN__LIST_ITEM(&elt->u.list, 0);
+      SVN_TEST_ASSERT(elt->kind == SVN_RA_SVN_LIST);
+      SVN_TEST_INT_ASSERT(elt->u.list.nelts, 4);
+      SVN_TEST_STRING_ASSERT(SVN_RA_SVN__LIST_ITEM(&elt->u.list, 0)
+                               .u.string.data,
+                             apr_psprintf(iterpool, "/trunk/%04d",
+                                          i % 10000));
+      SVN_TEST_STRING_ASSERT(SVN_RA_SVN__LIST_ITEM(&elt->u.list, 1)
+                               .u.word.data, "M");
+
+      /* Revision, author and message. */
+      elt = &SVN_RA_SVN__LIST_ITEM(entry, 1);
+      SVN_TEST_ASSERT(elt->kind == SVN_RA_SVN_NUMBER);
+      SVN_TEST_ASSERT(elt->u.number == (apr_uint64_t)i + 1);
+      elt = &SVN_RA_SVN__LIST_ITEM(entry, 2);
+      SVN_TEST_STRING_ASSERT(SVN_RA_SVN__LIST_ITEM(&elt->u.list, 0)
+                               .u.string.data, "jrandom");
+      elt = &SVN_RA_SVN__LIST_ITEM(entry, 4);
+      SVN_TEST_STRING_ASSERT(SVN_RA_SVN__LIST_ITEM(&elt->u.list, 0)
+                               .u.string.data, "log message");
+      elt = &SVN_RA_SVN__LIST_ITEM(entry, 9);
+      SVN_TEST_ASSERT(elt->kind == SVN_RA_SVN_WORD);
+      SVN_TEST_STRING_ASSERT(elt->u.word.data, "false");
+    }
+  duration = apr_time_now() - duration;
+
+  if (opts->verbose)
+    printf("parsed %d log entries, %.1f MB/s\n", PARSE_BENCHMARK_ITEMS,
+           (double)input->len / MAX(duration, 1));
+
+  /* Malformed data must still be detected. */
+  conn = svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_string(
+                                   svn_string_create("( 3:abc) ", pool),
+                                   pool),
+                                 svn_stream_empty(pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                 0, 0, 0, 0, pool);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_item(conn, pool, &item),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Number of concurrent sessions in svnserve_event_loop. */
+#define EVENT_LOOP_SESSIONS 3
+
+/* Serve several interleaved sessions from svnserve --event-loop.  Where
+   the event loop is not available, svnserve falls back to a thread per
+   connection, which must serve these sessions just the same. */
+static svn_error_t *
+svnserve_event_loop(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  const char repos_name[] = "test-repo-event-loop";
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *sessions[EVENT_LOOP_SESSIONS];
+  int i, round;
+
+  SVN_ERR(svn_test__create_repos(&repos, repos_name, opts, scratch_pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), 0, scratch_pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, scratch_pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, scratch_pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                  scratch_pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  /* Close the repository before svnserve opens it. */
+  svn_pool_clear(scratch_pool);
+
+  SVN_ERR(start_svnserve_daemon(&url, "--event-loop", pool));
+  url = apr_pstrcat(pool, url, "/", repos_name, SVN_VA_NULL);
+
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  for (i = 0; i < EVENT_LOOP_SESSIONS; ++i)
+    SVN_ERR(open_daemon_session(&sessions[i], url, cbtable, pool));
+
+  /* Keep all connections open and alternate between them, so that each
+     one goes idle and has to be picked up again by the server. */
+  for (round = 0; round < 5; ++round)
+    for (i = 0; i < EVENT_LOOP_SESSIONS; ++i)
+      {
+        svn_revnum_t rev;
+        svn_stringbuf_t *contents;
+
+        svn_pool_clear(scratch_pool);
+        contents = svn_stringbuf_create_empty(scratch_pool);
+
+        SVN_ERR(svn_ra_get_latest_revnum(sessions[i], &rev, scratch_pool));
+        SVN_TEST_ASSERT(rev == youngest_rev);
+
+        SVN_ERR(svn_ra_get_file(sessions[i], "iota", rev,
+                                svn_stream_from_stringbuf(contents,
+                                                          scratch_pool),
+                                NULL, NULL, scratch_pool));
+        SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'iota'.\n");
+      }
+
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Number of lines in the file that svnserve_get_file_plain fetches.
+   Make it span several sendfile() chunks in svnserve. */
+#define PLAIN_FILE_LINES 100000
+
+/* Fetch a large file that FSFS stores as a PLAIN representation from
+   svnserve.  It may send such files straight from the revision file. */
+static svn_error_t *
+svnserve_get_file_plain(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  const char repos_name[] = "test-repo-get-file-plain";
+  const char fsfs_conf[] = "[deltification]\n"
+                           "compression = none\n";
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t youngest_rev;
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *contents;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *session;
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* Without compression, FSFS stores new files as PLAIN reps. */
+  SVN_ERR(svn_test__create_repos(&repos, repos_name, opts, scratch_pool));
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join(svn_fs_path(
+                                                 svn_repos_fs(repos),
+                                                 scratch_pool),
+                                               "fsfs.conf", scratch_pool),
+                               fsfs_conf, sizeof(fsfs_conf) - 1,
+                               NULL, FALSE, scratch_pool));
+  SVN_ERR(svn_repos_open3(&repos, repos_name, NULL, scratch_pool,
+                          scratch_pool));
+
+  expected = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < PLAIN_FILE_LINES; ++i)
+    svn_stringbuf_appendcstr(expected,
+                             apr_psprintf(scratch_pool,
+                                          "This is line %d of 'big'.\n", i));
+
+  /* svnserve sends at most 1MB per string. */
+  SVN_TEST_ASSERT(expected->len > 2 * 0x100000);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), 0, scratch_pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, scratch_pool));
+  SVN_ERR(svn_fs_make_file(root, "big", scratch_pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", expected->data,
+                                      scratch_pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                  scratch_pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  /* Make sure that svnserve can take the sendfile() path. */
+  SVN_ERR(svn_fs_revision_root(&root, svn_repos_fs(repos), youngest_rev,
+                               scratch_pool));
+  SVN_ERR(svn_fs__get_contents_location(&file, &offset, &length, root,
+                                        "big", scratch_pool, scratch_pool));
+  SVN_TEST_ASSERT(file != NULL);
+  SVN_TEST_ASSERT(length == expected->len);
+
+  /* Close the repository before svnserve opens it. */
+  svn_pool_clear(scratch_pool);
+
+  SVN_ERR(start_svnserve_daemon(&url, NULL, pool));
+  url = apr_pstrcat(pool, url, "/", repos_name, SVN_VA_NULL);
+
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+  SVN_ERR(open_daemon_session(&session, url, cbtable, pool));
+
+  /* The client verifies the MD5 checksum that svnserve sends along. */
+  contents = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_ra_get_file(session, "big", youngest_rev,
+                          svn_stream_from_stringbuf(contents, pool),
+                          NULL, NULL, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, expected));
+
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1820,6 +2207,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "check how last change applies to empty commit"),
     SVN_TEST_OPTS_PASS(commit_locked_file,
                        "check commit editor for a locked file"),
+    SVN_TEST_OPTS_PASS(ra_svn_parse_items,
+                       "ra_svn protocol parser throughput"),
+    SVN_TEST_OPTS_SKIP(svnserve_event_loop, !APR_HAS_THREADS,
+                       "serve sessions from the svnserve event loop"),
+    SVN_TEST_OPTS_PASS(svnserve_get_file_plain,
+                       "get-file of a large PLAIN file from svnserve"),
     SVN_TEST_NULL
   };
 
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <apr_md5.h>
 #include <apr_pools.h>
 #include <apr_time.h>
 
@@ -39,6 +40,7 @@
 #include "svn_props.h"
 #include "svn_sorts.h"
 #include "svn_version.h"
+#include "private/svn_cache.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_dep_compat.h"
 
@@ -3512,6 +3514,349 @@ get_logs(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Log receiver which appends the revision number to the svn_stringbuf_t
+   given as BATON. */
+static svn_error_t *
+log_rev_receiver(void *baton,
+                 svn_log_entry_t *log_entry,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *revs = baton;
+  svn_stringbuf_appendcstr(revs, apr_psprintf(pool, "%ld ",
+                                              log_entry->revision));
+  return SVN_NO_ERROR;
+}
+
+/* Check that repeated and partial log queries return the same results
+   when the path histories come from the history cache. */
+static svn_error_t *
+get_logs_cached(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+  svn_stringbuf_t *revs = svn_stringbuf_create_empty(pool);
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_stringbuf_t *data;
+  svn_boolean_t found;
+  const char *uuid;
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-logs-cached",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revisions 2 and 3:  Tweak A/B/E/alpha. */
+  for (i = 2; i <= 3; ++i)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha",
+                                          apr_psprintf(subpool,
+                                                       "Revision %d", i),
+                                          subpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      subpool));
+    }
+
+  /* Revision 4:  Copy A to A2. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "A2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 5:  Tweak A2/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A2/B/E/alpha",
+                                      "Revision 5", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  APR_ARRAY_PUSH(paths, const char *) = "/A2/B/E/alpha";
+
+  /* Walk part of the history first, then all of it twice. */
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 2, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "5 4 ");
+
+  for (i = 0; i < 2; ++i)
+    {
+      svn_stringbuf_setempty(revs);
+      SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, FALSE,
+                                  FALSE, FALSE, NULL, NULL, NULL,
+                                  log_rev_receiver, revs, subpool));
+      SVN_TEST_STRING_ASSERT(revs->data, "5 4 3 2 1 ");
+    }
+
+  /* A range that ends within the cached history. */
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 3, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "5 4 3 ");
+
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, 1, youngest_rev, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "1 2 3 4 5 ");
+
+  /* Strict node history must not use the entries cached above. */
+  for (i = 0; i < 2; ++i)
+    {
+      svn_stringbuf_setempty(revs);
+      SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, TRUE,
+                                  FALSE, FALSE, NULL, NULL, NULL,
+                                  log_rev_receiver, revs, subpool));
+      SVN_TEST_STRING_ASSERT(revs->data, "5 4 ");
+    }
+
+  /* Revision 6:  Tweak A/mu, which does not affect the history above. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "Revision 6",
+                                      subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Check that the cached history is still being used by replacing it
+     with a doctored one.  The cache entry is keyed by the revision of the
+     last change to the node, with the prefix and format used by log.c. */
+  membuffer = svn_cache__get_global_membuffer_cache();
+  if (membuffer)
+    {
+      SVN_ERR(svn_fs_get_uuid(fs, &uuid, subpool));
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                &cache, membuffer, NULL, NULL, APR_HASH_KEY_STRING,
+                apr_pstrcat(subpool, "svn:repos:history:", uuid, ":",
+                            svn_fs_path(fs, subpool), ":", SVN_VA_NULL),
+                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+                subpool, subpool));
+
+      SVN_ERR(svn_cache__get((void **)&data, &found, cache,
+                             "5:0:/A2/B/E/alpha", subpool));
+      SVN_TEST_ASSERT(found);
+      SVN_TEST_STRING_ASSERT(data->data,
+                             "complete\n"
+                             "5 /A2/B/E/alpha\n"
+                             "4 /A2/B/E/alpha\n"
+                             "3 /A/B/E/alpha\n"
+                             "2 /A/B/E/alpha\n"
+                             "1 /A/B/E/alpha\n");
+
+      data = svn_stringbuf_create("complete\n"
+                                  "5 /A2/B/E/alpha\n"
+                                  "2 /A/B/E/alpha\n", subpool);
+      SVN_ERR(svn_cache__set(cache, "5:0:/A2/B/E/alpha", data, subpool));
+
+      svn_stringbuf_setempty(revs);
+      SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, FALSE,
+                                  FALSE, FALSE, NULL, NULL, NULL,
+                                  log_rev_receiver, revs, subpool));
+      SVN_TEST_STRING_ASSERT(revs->data, "5 2 ");
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+/* File revision handler which appends "REV:PATH " to the svn_stringbuf_t
+   given as BATON. */
+static svn_error_t *
+file_rev_path_handler(void *baton, const char *path, svn_revnum_t rev,
+                      apr_hash_t *rev_props, svn_boolean_t result_of_merge,
+                      svn_txdelta_window_handler_t *delta_handler,
+                      void **delta_baton, apr_array_header_t *prop_diffs,
+                      apr_pool_t *pool)
+{
+  svn_stringbuf_t *revs = baton;
+  svn_stringbuf_appendcstr(revs, apr_psprintf(pool, "%ld:%s ", rev, path));
+  return SVN_NO_ERROR;
+}
+
+/* Check that log and file-revs results do not change when the path
+   histories come from the history index, and that commits keep the
+   index up to date without catching up on revisions added otherwise. */
+static svn_error_t *
+get_logs_history_index(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_revnum_t start_rev, end_rev;
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+  svn_stringbuf_t *revs = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *file_revs = svn_stringbuf_create_empty(pool);
+  apr_pool_t *subpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-history-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revisions 2 and 3:  Tweak A/B/E/alpha. */
+  for (i = 2; i <= 3; ++i)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha",
+                                          apr_psprintf(subpool,
+                                                       "Revision %d", i),
+                                          subpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      subpool));
+    }
+
+  /* Revision 4:  Copy A to A2. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "A2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* Revision 5:  Tweak A2/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A2/B/E/alpha",
+                                      "Revision 5", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Remember the file revisions as reported without an index. */
+  SVN_ERR(svn_repos_get_file_revs2(repos, "/A2/B/E/alpha", 0, youngest_rev,
+                                   FALSE, NULL, NULL,
+                                   file_rev_path_handler, file_revs,
+                                   subpool));
+  SVN_TEST_STRING_ASSERT(file_revs->data,
+                         "1:/A/B/E/alpha 2:/A/B/E/alpha 3:/A/B/E/alpha "
+                         "4:/A2/B/E/alpha 5:/A2/B/E/alpha ");
+
+  /* Index all existing revisions. */
+  SVN_ERR(svn_repos__build_history_index(&start_rev, &end_rev, repos,
+                                         NULL, NULL, subpool));
+  SVN_TEST_INT_ASSERT(start_rev, 1);
+  SVN_TEST_INT_ASSERT(end_rev, youngest_rev);
+
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_file_revs2(repos, "/A2/B/E/alpha", 0, youngest_rev,
+                                   FALSE, NULL, NULL,
+                                   file_rev_path_handler, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, file_revs->data);
+
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_file_revs2(repos, "/A2/B/E/alpha", youngest_rev, 0,
+                                   FALSE, NULL, NULL,
+                                   file_rev_path_handler, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data,
+                         "5:/A2/B/E/alpha 4:/A2/B/E/alpha 3:/A/B/E/alpha "
+                         "2:/A/B/E/alpha 1:/A/B/E/alpha ");
+
+  /* Walk the histories through the index. */
+  APR_ARRAY_PUSH(paths, const char *) = "/A2/B/E/alpha";
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "5 4 3 2 1 ");
+
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, TRUE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "5 4 ");
+
+  /* Directories change whenever one of their children does. */
+  APR_ARRAY_IDX(paths, 0, const char *) = "/A2";
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "5 4 3 2 1 ");
+
+  APR_ARRAY_IDX(paths, 0, const char *) = "/A";
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 1, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "3 2 1 ");
+
+  /* Revision 6:  Tweak A2/B/E/alpha again.  The commit updates the
+     index, so there is nothing left to build afterwards. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A2/B/E/alpha",
+                                      "Revision 6", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  SVN_ERR(svn_repos__build_history_index(&start_rev, &end_rev, repos,
+                                         NULL, NULL, subpool));
+  SVN_TEST_ASSERT(!SVN_IS_VALID_REVNUM(start_rev));
+
+  APR_ARRAY_IDX(paths, 0, const char *) = "/A2/B/E/alpha";
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, youngest_rev, 2, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "6 5 4 3 2 ");
+
+  /* Revisions 7 to 16:  Commit like 'svnadmin load' does, bypassing the
+     index.  Revision 17:  A regular commit must not catch up on those. */
+  for (i = 7; i <= 17; ++i)
+    {
+      svn_pool_clear(subpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A2/B/E/alpha",
+                                          apr_psprintf(subpool,
+                                                       "Revision %d", i),
+                                          subpool));
+      if (i < 17)
+        SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, subpool));
+      else
+        SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                        subpool));
+    }
+
+  SVN_ERR(svn_repos__build_history_index(&start_rev, &end_rev, repos,
+                                         NULL, NULL, subpool));
+  SVN_TEST_INT_ASSERT(start_rev, 7);
+  SVN_TEST_INT_ASSERT(end_rev, 17);
+
+  svn_stringbuf_setempty(revs);
+  SVN_ERR(svn_repos_get_logs4(repos, paths, 8, 5, 0, FALSE,
+                              FALSE, FALSE, NULL, NULL, NULL,
+                              log_rev_receiver, revs, subpool));
+  SVN_TEST_STRING_ASSERT(revs->data, "8 7 6 5 ");
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
 
 /* Tests for svn_repos_get_file_revsN() */
 
@@ -4466,6 +4811,269 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_delta_editor_t.open_root.  Pass EDIT_BATON, the
+   svn_stringbuf_t * that receives the text deltas, down the tree. */
+static svn_error_t *
+delta_recorder_open_root(void *edit_baton,
+                         svn_revnum_t base_revision,
+                         apr_pool_t *dir_pool,
+                         void **root_baton)
+{
+  *root_baton = edit_baton;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.open_file. */
+static svn_error_t *
+delta_recorder_open_file(const char *path,
+                         void *parent_baton,
+                         svn_revnum_t base_revision,
+                         apr_pool_t *file_pool,
+                         void **file_baton)
+{
+  *file_baton = parent_baton;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.apply_textdelta.  Append the delta to
+   FILE_BATON as uncompressed svndiff0. */
+static svn_error_t *
+delta_recorder_apply_textdelta(void *file_baton,
+                               const char *base_checksum,
+                               apr_pool_t *pool,
+                               svn_txdelta_window_handler_t *handler,
+                               void **handler_baton)
+{
+  svn_stringbuf_t *svndiff = file_baton;
+
+  svn_txdelta_to_svndiff3(handler, handler_baton,
+                          svn_stream_from_stringbuf(svndiff, pool),
+                          0, SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+  return SVN_NO_ERROR;
+}
+
+/* Update the whole of REPOS from revision 2 to 3 and return the text
+   deltas sent by the reporter in *SVNDIFF, as svndiff0.  Allocate the
+   result in POOL. */
+static svn_error_t *
+record_update_deltas(svn_stringbuf_t **svndiff,
+                     svn_repos_t *repos,
+                     apr_pool_t *pool)
+{
+  svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+  void *report_baton;
+
+  editor->open_root = delta_recorder_open_root;
+  editor->open_file = delta_recorder_open_file;
+  editor->apply_textdelta = delta_recorder_apply_textdelta;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_repos_begin_report3(&report_baton, 3, repos, "/", "", NULL,
+                                  TRUE, svn_depth_infinity, FALSE, FALSE,
+                                  editor, *svndiff, NULL, NULL, 0, pool));
+  SVN_ERR(svn_repos_set_path3(report_baton, "", 2, svn_depth_infinity,
+                              FALSE, NULL, pool));
+  return svn_error_trace(svn_repos_finish_report(report_baton, pool));
+}
+
+/* Create a greek tree repository at NAME, in which revision 2 changes
+   iota to BASE and revision 3 to CONTENTS.  Set *CACHE to the reporter's
+   delta cache for it and *KEY to the key of the iota delta from r2 to r3.
+   The prefix and the key format must match reporter.c.  Allocate
+   everything in POOL. */
+static svn_error_t *
+create_delta_cache_repos(svn_repos_t **repos,
+                         svn_cache__t **cache,
+                         const char **key,
+                         const char *name,
+                         const char *base,
+                         const char *contents,
+                         const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *s_root, *t_root;
+  svn_revnum_t youngest_rev;
+  svn_checksum_t *s_md5, *s_sha1, *t_md5, *t_sha1;
+  const char *uuid;
+
+  SVN_ERR(svn_test__create_repos(repos, name, opts, pool));
+  fs = svn_repos_fs(*repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", base, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_get_uuid(fs, &uuid, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            cache, svn_cache__get_global_membuffer_cache(), NULL, NULL,
+            APR_HASH_KEY_STRING,
+            apr_pstrcat(pool, "svn:repos:delta:", uuid, "/",
+                        svn_fs_path(fs, pool), ":", SVN_VA_NULL),
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&s_root, fs, 2, pool));
+  SVN_ERR(svn_fs_revision_root(&t_root, fs, 3, pool));
+  SVN_ERR(svn_fs_file_checksum(&s_md5, svn_checksum_md5, s_root, "iota",
+                               FALSE, pool));
+  SVN_ERR(svn_fs_file_checksum(&s_sha1, svn_checksum_sha1, s_root, "iota",
+                               FALSE, pool));
+  SVN_ERR(svn_fs_file_checksum(&t_md5, svn_checksum_md5, t_root, "iota",
+                               FALSE, pool));
+  SVN_ERR(svn_fs_file_checksum(&t_sha1, svn_checksum_sha1, t_root, "iota",
+                               FALSE, pool));
+  SVN_TEST_ASSERT(s_md5 && t_md5);
+
+  *key = apr_pstrcat(pool,
+                     svn_checksum_to_cstring(s_md5, pool), "/",
+                     s_sha1 ? svn_checksum_to_cstring(s_sha1, pool) : "",
+                     ":",
+                     svn_checksum_to_cstring(t_md5, pool), "/",
+                     t_sha1 ? svn_checksum_to_cstring(t_sha1, pool) : "",
+                     SVN_VA_NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a delta cache entry for the target TEXT that claims to have the
+   MD5 DIGEST.  The delta simply inserts all of TEXT. */
+static svn_error_t *
+make_delta_cache_entry(svn_stringbuf_t **entry,
+                       const unsigned char *digest,
+                       const char *text,
+                       apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  *entry = svn_stringbuf_ncreate((const char *)digest, APR_MD5_DIGESTSIZE,
+                                 pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*entry, pool),
+                          0, SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+  return svn_error_trace(svn_txdelta_send_string(svn_string_create(text,
+                                                                   pool),
+                                                 handler, handler_baton,
+                                                 pool));
+}
+
+/* Check that the reporter serves text deltas from its cache, rejects
+   corrupted cache entries and keeps the entries of different repositories
+   apart, even if their contents are the same. */
+static svn_error_t *
+report_delta_cache(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *base = svn_stringbuf_create_empty(pool);
+  const char *contents;
+  svn_repos_t *repos, *repos2;
+  svn_cache__t *cache, *cache2;
+  const char *key, *key2;
+  svn_stringbuf_t *expected, *svndiff, *entry, *doctored;
+  svn_checksum_t *t_md5;
+  svn_fs_root_t *t_root;
+  svn_boolean_t found;
+  int i;
+
+  if (! svn_cache__get_global_membuffer_cache())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "no membuffer cache available");
+
+  /* Make the text long enough for the delta to copy from its source. */
+  for (i = 0; i < 20; ++i)
+    svn_stringbuf_appendcstr(base, apr_psprintf(pool, "Line %d of iota.\n",
+                                                i));
+  contents = apr_pstrcat(pool, base->data, "Changed in r3.\n", SVN_VA_NULL);
+
+  SVN_ERR(create_delta_cache_repos(&repos, &cache, &key,
+                                   "test-repo-report-delta-cache",
+                                   base->data, contents, opts, pool));
+  SVN_ERR(svn_fs_revision_root(&t_root, svn_repos_fs(repos), 3, pool));
+  SVN_ERR(svn_fs_file_checksum(&t_md5, svn_checksum_md5, t_root, "iota",
+                               FALSE, pool));
+
+  /* The first update computes the delta and caches it: the target digest
+     followed by exactly the svndiff that got sent. */
+  SVN_ERR(record_update_deltas(&expected, repos, pool));
+  SVN_TEST_ASSERT(expected->len > 0);
+
+  SVN_ERR(svn_cache__get((void **)&entry, &found, cache, key, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(entry->len == APR_MD5_DIGESTSIZE + expected->len);
+  SVN_TEST_ASSERT(!memcmp(entry->data, t_md5->digest, APR_MD5_DIGESTSIZE));
+  SVN_TEST_ASSERT(!memcmp(entry->data + APR_MD5_DIGESTSIZE, expected->data,
+                          expected->len));
+
+  /* The same update again produces the same output. */
+  SVN_ERR(record_update_deltas(&svndiff, repos, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(svndiff, expected));
+
+  /* Show that it comes from the cache by replacing the entry with a
+     different but valid delta. */
+  SVN_ERR(make_delta_cache_entry(&doctored, t_md5->digest, contents, pool));
+  SVN_TEST_ASSERT(!svn_stringbuf_compare(doctored, entry));
+  SVN_ERR(svn_cache__set(cache, key, doctored, pool));
+  SVN_ERR(record_update_deltas(&svndiff, repos, pool));
+  SVN_TEST_ASSERT(svndiff->len == doctored->len - APR_MD5_DIGESTSIZE);
+  SVN_TEST_ASSERT(!memcmp(svndiff->data, doctored->data + APR_MD5_DIGESTSIZE,
+                          svndiff->len));
+
+  /* An entry with the wrong target digest gets recomputed. */
+  doctored = svn_stringbuf_dup(entry, pool);
+  doctored->data[0] ^= 0xff;
+  SVN_ERR(svn_cache__set(cache, key, doctored, pool));
+  SVN_ERR(record_update_deltas(&svndiff, repos, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(svndiff, expected));
+
+  SVN_ERR(svn_cache__get((void **)&doctored, &found, cache, key, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(svn_stringbuf_compare(doctored, entry));
+
+  /* So does an entry that produces a target of the wrong length. */
+  SVN_ERR(make_delta_cache_entry(&doctored, t_md5->digest, base->data,
+                                 pool));
+  SVN_ERR(svn_cache__set(cache, key, doctored, pool));
+  SVN_ERR(record_update_deltas(&svndiff, repos, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(svndiff, expected));
+
+  SVN_ERR(svn_cache__get((void **)&doctored, &found, cache, key, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(svn_stringbuf_compare(doctored, entry));
+
+  /* A second repository with the same contents has its own entries, even
+     though the keys are the same.  Doctor the first repository's entry
+     and check that the second one doesn't see it. */
+  SVN_ERR(create_delta_cache_repos(&repos2, &cache2, &key2,
+                                   "test-repo-report-delta-cache2",
+                                   base->data, contents, opts, pool));
+  SVN_TEST_STRING_ASSERT(key2, key);
+
+  SVN_ERR(make_delta_cache_entry(&doctored, t_md5->digest, contents, pool));
+  SVN_ERR(svn_cache__set(cache, key, doctored, pool));
+  SVN_ERR(svn_cache__get((void **)&entry, &found, cache2, key2, pool));
+  SVN_TEST_ASSERT(!found);
+
+  SVN_ERR(record_update_deltas(&svndiff, repos2, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(svndiff, expected));
+  SVN_ERR(svn_cache__get((void **)&entry, &found, cache2, key2, pool));
+  SVN_TEST_ASSERT(found);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4505,6 +5113,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test if revprops are validated by repos"),
     SVN_TEST_OPTS_PASS(get_logs,
                        "test svn_repos_get_logs ranges and limits"),
+    SVN_TEST_OPTS_PASS(get_logs_cached,
+                       "test svn_repos_get_logs with cached histories"),
+    SVN_TEST_OPTS_PASS(get_logs_history_index,
+                       "test svn_repos_get_logs with the history index"),
     SVN_TEST_OPTS_PASS(test_get_file_revs,
                        "test svn_repos_get_file_revsN"),
     SVN_TEST_OPTS_PASS(issue_4060,
@@ -4537,6 +5149,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(report_delta_cache,
+                       "test the reporter's text delta cache"),
     SVN_TEST_NULL
   };
 
@@ -26,7 +26,9 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
 
 #include "private/svn_cache.h"
@@ -590,6 +592,454 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_membuffer_shared_cache(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer1;
+  svn_membuffer_t *membuffer2;
+  svn_cache__t *cache1;
+  svn_cache__t *cache2;
+  const char *sandbox;
+  const char *path;
+  svn_revnum_t twenty = 20;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  svn_error_t *err;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "cache-test-shared", pool));
+  path = svn_dirent_join(sandbox, "membuffer", pool);
+
+  /* Map the same file twice as if we were two different processes. */
+  err = svn_cache__membuffer_cache_create_shared(&membuffer1, path,
+                                                 1024 * 1024, 256 * 1024, 0,
+                                                 TRUE, TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "memory-mapped files not supported");
+    }
+
+  SVN_ERR(err);
+  SVN_ERR(svn_cache__membuffer_cache_create_shared(&membuffer2, path,
+                                                   1024 * 1024, 256 * 1024,
+                                                   0, TRUE, TRUE, pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache1, membuffer1,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache2, membuffer2,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE,
+                                            pool, pool));
+
+  /* What one writes, the other can read. */
+  SVN_ERR(svn_cache__set(cache1, "twenty", &twenty, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache2, "twenty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 20);
+
+  /* Clearing affects both as well. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer2));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache1, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* Caches of different sizes can't share the file. */
+  SVN_TEST_ASSERT_ERROR(
+    svn_cache__membuffer_cache_create_shared(&membuffer2, path,
+                                             2 * 1024 * 1024, 256 * 1024,
+                                             0, TRUE, TRUE, pool),
+    SVN_ERR_BAD_CONFIG_VALUE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t */
+static svn_error_t *
+get_revnum_partial(void **out,
+                   const void *data,
+                   apr_size_t data_len,
+                   void *baton,
+                   apr_pool_t *result_pool)
+{
+  *out = apr_pmemdup(result_pool, data, data_len);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_tiered_cache(apr_pool_t *pool)
+{
+  svn_cache__t *primary1;
+  svn_cache__t *primary2;
+  svn_cache__t *secondary;
+  svn_cache__t *cache;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t valueA = 12345;
+  svn_revnum_t valueB = 67890;
+
+  SVN_ERR(svn_cache__create_inprocess(&primary1, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 1, 1, TRUE,
+                                      "primary1", pool));
+  SVN_ERR(svn_cache__create_inprocess(&primary2, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 1, 1, TRUE,
+                                      "primary2", pool));
+  SVN_ERR(svn_cache__create_inprocess(&secondary, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 4, 4, TRUE,
+                                      "secondary", pool));
+
+  /* Writes go to both tiers. */
+  SVN_ERR(svn_cache__create_tiered(&cache, primary1, secondary, pool));
+  SVN_ERR(svn_cache__set(cache, "key A", &valueA, pool));
+  SVN_ERR(svn_cache__has_key(&found, primary1, "key A", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_ERR(svn_cache__has_key(&found, secondary, "key A", pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Simulate a restart, i.e. replace the primary tier with an empty one.
+   * The data can still be found and gets copied to the new primary. */
+  SVN_ERR(svn_cache__create_tiered(&cache, primary2, secondary, pool));
+  SVN_ERR(svn_cache__has_key(&found, primary2, "key A", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key A", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*value == valueA);
+  SVN_ERR(svn_cache__has_key(&found, primary2, "key A", pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Same for partial getters. */
+  SVN_ERR(svn_cache__set(secondary, "key B", &valueB, pool));
+  SVN_ERR(svn_cache__get_partial((void **) &value, &found, cache, "key B",
+                                 get_revnum_partial, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*value == valueB);
+  SVN_ERR(svn_cache__has_key(&found, primary2, "key B", pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Misses in both tiers. */
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key C", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__has_key(&found, cache, "key C", pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+/* Number of bytes that serialize_string_with_trailer() appends. */
+#define TRAILER_SIZE 4
+
+/* Implements svn_cache__serialize_func_t for C strings. */
+static svn_error_t *
+serialize_string(void **data,
+                 apr_size_t *data_len,
+                 void *in,
+                 apr_pool_t *pool)
+{
+  *data_len = strlen(in) + 1;
+  *data = apr_pmemdup(pool, in, *data_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for C strings. */
+static svn_error_t *
+deserialize_string(void **out,
+                   void *data,
+                   apr_size_t data_len,
+                   apr_pool_t *pool)
+{
+  *out = data;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__serialize_func_t for C strings.  Like a cache
+ * tier that checksums its contents, append some extra bytes. */
+static svn_error_t *
+serialize_string_with_trailer(void **data,
+                              apr_size_t *data_len,
+                              void *in,
+                              apr_pool_t *pool)
+{
+  apr_size_t len = strlen(in) + 1;
+  char *buffer = apr_palloc(pool, len + TRAILER_SIZE);
+
+  memcpy(buffer, in, len);
+  memset(buffer + len, 'X', TRAILER_SIZE);
+
+  *data = buffer;
+  *data_len = len + TRAILER_SIZE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for the output of
+ * serialize_string_with_trailer(). */
+static svn_error_t *
+deserialize_string_with_trailer(void **out,
+                                void *data,
+                                apr_size_t data_len,
+                                apr_pool_t *pool)
+{
+  SVN_TEST_ASSERT(data_len > TRAILER_SIZE);
+  *out = apr_pstrmemdup(pool, data, data_len - TRAILER_SIZE - 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t.  Return a copy of the
+ * serialized string and count the calls in the int that BATON points to.
+ */
+static svn_error_t *
+get_string_partial(void **out,
+                   const void *data,
+                   apr_size_t data_len,
+                   void *baton,
+                   apr_pool_t *result_pool)
+{
+  int *calls = baton;
+
+  ++*calls;
+  *out = apr_pstrmemdup(result_pool, data, data_len - 1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_tiered_cache_partial(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *primary;
+  svn_cache__t *secondary;
+  svn_cache__t *cache;
+  svn_boolean_t found;
+  char *value;
+  char *large;
+  apr_size_t large_size = 64 * 1024;
+  int calls = 0;
+
+  /* A primary tier that refuses LARGE and a secondary one whose
+   * serialized form differs from the primary's. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&primary, membuffer,
+                                            serialize_string,
+                                            deserialize_string,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_inprocess(&secondary,
+                                      serialize_string_with_trailer,
+                                      deserialize_string_with_trailer,
+                                      APR_HASH_KEY_STRING, 4, 4, TRUE,
+                                      "secondary", pool));
+  SVN_ERR(svn_cache__create_tiered(&cache, primary, secondary, pool));
+
+  large = apr_palloc(pool, large_size + 1);
+  memset(large, 'L', large_size);
+  large[large_size] = '\0';
+  SVN_TEST_ASSERT(!svn_cache__is_cachable(primary, large_size + 1));
+
+  /* Partial reads of items found in the secondary tier only are served
+   * from the primary tier's form after promotion. */
+  SVN_ERR(svn_cache__set(secondary, "small", "small value", pool));
+  SVN_ERR(svn_cache__get_partial((void **) &value, &found, cache, "small",
+                                 get_string_partial, &calls, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(value, "small value");
+  SVN_TEST_INT_ASSERT(calls, 1);
+
+  /* If the primary tier refuses the item, the partial getter must not
+   * see the secondary tier's form.  That is a miss. */
+  SVN_ERR(svn_cache__set(secondary, "large", large, pool));
+  SVN_ERR(svn_cache__get_partial((void **) &value, &found, cache, "large",
+                                 get_string_partial, &calls, pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_TEST_INT_ASSERT(calls, 1);
+
+  /* Full reads still find it. */
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "large", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(strcmp(value, large) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Number of different items in the concurrent read test. */
+#define CONCURRENT_ITEM_COUNT 1000
+
+/* Number of cache lookups per thread in the concurrent read test. */
+#define CONCURRENT_READ_COUNT 200000
+
+/* Every that many lookups, a thread will also update the item. */
+#define CONCURRENT_WRITE_INTERVAL 64
+
+/* Per-thread data for the concurrent read test. */
+typedef struct reader_baton_t
+{
+  /* Front-end to the shared membuffer.  Only used by this thread. */
+  svn_cache__t *cache;
+
+  /* Start of the key range to read. */
+  int first_key;
+
+  /* Any error that occurred. */
+  svn_error_t *err;
+} reader_baton_t;
+
+/* Read items from BATON->CACHE in a loop, occasionally write them back
+ * and verify that we always see the value written. */
+static svn_error_t *
+read_items(reader_baton_t *baton,
+           apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < CONCURRENT_READ_COUNT; ++i)
+    {
+      svn_revnum_t key = (baton->first_key + i) % CONCURRENT_ITEM_COUNT;
+      svn_revnum_t value = 2 * key;
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_cache__get((void **) &answer, &found, baton->cache, &key,
+                             iterpool));
+
+      /* Concurrent writers may cause items to be missing temporarily.
+       * But we must never see inconsistent data. */
+      if (found && *answer != value)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "expected %ld but found '%ld'",
+                                 value, *answer);
+
+      if (i % CONCURRENT_WRITE_INTERVAL == 0)
+        SVN_ERR(svn_cache__set(baton->cache, &key, &value, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC reader_thread(apr_thread_t *tid, void *data)
+{
+  reader_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  baton->err = read_items(baton, pool);
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_concurrent_reads(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* Read the same set of items with an increasing number of threads.
+   * Besides checking that we never get inconsistent data, this serves
+   * as a benchmark for read scalability.  Use --verbose to see the
+   * throughput per thread count. */
+  enum { MAX_THREAD_COUNT = 16 };
+  svn_membuffer_t *membuffer;
+  apr_thread_t *threads[MAX_THREAD_COUNT];
+  reader_baton_t batons[MAX_THREAD_COUNT];
+  svn_revnum_t key;
+  int thread_count;
+  int i;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 4 * 1024 * 1024,
+                                            1024 * 1024, 0, TRUE, TRUE,
+                                            pool));
+
+  for (i = 0; i < MAX_THREAD_COUNT; ++i)
+    {
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                &batons[i].cache, membuffer, serialize_revnum,
+                deserialize_revnum, sizeof(key), "cache:",
+                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+                pool, pool));
+      batons[i].first_key = i * CONCURRENT_ITEM_COUNT / MAX_THREAD_COUNT;
+    }
+
+  /* Populate the cache. */
+  for (key = 0; key < CONCURRENT_ITEM_COUNT; ++key)
+    {
+      svn_revnum_t value = 2 * key;
+      SVN_ERR(svn_cache__set(batons[0].cache, &key, &value, pool));
+    }
+
+  for (thread_count = 1; thread_count <= MAX_THREAD_COUNT; thread_count *= 2)
+    {
+      apr_time_t start = apr_time_now();
+      apr_time_t duration;
+      svn_error_t *err = SVN_NO_ERROR;
+      int started;
+
+      for (started = 0; started < thread_count; ++started)
+        {
+          apr_status_t status;
+
+          batons[started].err = SVN_NO_ERROR;
+          status = apr_thread_create(&threads[started], NULL, reader_thread,
+                                     &batons[started], pool);
+          if (status)
+            {
+              err = svn_error_wrap_apr(status, "Can't create thread");
+              break;
+            }
+        }
+
+      /* Wait for all threads we started, even after errors. */
+      for (i = 0; i < started; ++i)
+        {
+          apr_status_t retval;
+          apr_thread_join(&retval, threads[i]);
+          err = svn_error_compose_create(err, batons[i].err);
+        }
+
+      SVN_ERR(err);
+
+      duration = apr_time_now() - start;
+      if (opts->verbose)
+        printf("%2d threads: %8.0f lookups per millisecond\n",
+               thread_count,
+               (double)thread_count * CONCURRENT_READ_COUNT * 1000
+                 / (duration ? duration : 1));
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "threads not supported");
+#endif
+}
+
 
 /* The test table.  */
 
@@ -616,6 +1066,15 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_shared_cache,
+                   "test membuffer cache shared through a file"),
+    SVN_TEST_PASS2(test_tiered_cache,
+                   "test a two-level svn_cache"),
+    SVN_TEST_PASS2(test_tiered_cache_partial,
+                   "test partial reads from a two-level svn_cache"),
+    SVN_TEST_OPTS_SKIP(test_membuffer_concurrent_reads,
+                       ! APR_HAS_THREADS,
+                       "test concurrent reads from a membuffer cache"),
     SVN_TEST_NULL
   };
 
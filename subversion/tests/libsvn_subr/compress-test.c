@@ -21,7 +21,10 @@
  * ====================================================================
  */
 
+#include <apr_time.h>
+
 #include "svn_pools.h"
+#include "svn_sorts.h"
 #include "private/svn_subr_private.h"
 #include "../svn_test.h"
 
@@ -76,6 +79,166 @@ test_compress_lz4_empty(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_compress_zstd(apr_pool_t *pool)
+{
+  const char input[] =
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb"
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb"
+    "aaaabbbbccccaaaaccccbbbbaaaabbbb";
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+  int level;
+
+  if (!svn_zstd__compiled_version())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support has not been compiled in");
+
+  for (level = 0; level <= 19; ++level)
+    {
+      SVN_ERR(svn__compress_zstd(input, sizeof(input), compressed, level));
+      SVN_ERR(svn__decompress_zstd(compressed->data, compressed->len,
+                                   decompressed, 100));
+      SVN_TEST_STRING_ASSERT(decompressed->data, input);
+    }
+
+  /* The output size limit must be enforced. */
+  SVN_TEST_ASSERT_ERROR(svn__decompress_zstd(compressed->data,
+                                             compressed->len,
+                                             decompressed, 10),
+                        SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_zstd_empty(apr_pool_t *pool)
+{
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+
+  if (!svn_zstd__compiled_version())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd support has not been compiled in");
+
+  SVN_ERR(svn__compress_zstd("", 0, compressed, 0));
+  SVN_ERR(svn__decompress_zstd(compressed->data, compressed->len,
+                               decompressed, 100));
+  SVN_TEST_STRING_ASSERT(decompressed->data, "");
+
+  return SVN_NO_ERROR;
+}
+
+/* Size of the data blocks used by the compression throughput test.
+ * This matches the standard delta window size. */
+#define BENCHMARK_BLOCK_SIZE 102400
+
+/* Number of blocks to compress per method in the throughput test. */
+#define BENCHMARK_BLOCK_COUNT 64
+
+/* The compression methods compared in the throughput test. */
+typedef enum benchmark_method_t
+{
+  benchmark_zlib,
+  benchmark_lz4,
+  benchmark_zstd
+} benchmark_method_t;
+
+/* Compress DATA of LEN bytes into OUT using METHOD. */
+static svn_error_t *
+benchmark_compress(benchmark_method_t method,
+                   const char *data,
+                   apr_size_t len,
+                   svn_stringbuf_t *out)
+{
+  switch (method)
+    {
+      case benchmark_zlib:
+        return svn__compress_zlib(data, len, out,
+                                  SVN__COMPRESSION_ZLIB_DEFAULT);
+      case benchmark_lz4:
+        return svn__compress_lz4(data, len, out);
+      default:
+        return svn__compress_zstd(data, len, out, 0);
+    }
+}
+
+/* Decompress DATA of LEN bytes into OUT using METHOD. */
+static svn_error_t *
+benchmark_decompress(benchmark_method_t method,
+                     const char *data,
+                     apr_size_t len,
+                     svn_stringbuf_t *out)
+{
+  switch (method)
+    {
+      case benchmark_zlib:
+        return svn__decompress_zlib(data, len, out, BENCHMARK_BLOCK_SIZE);
+      case benchmark_lz4:
+        return svn__decompress_lz4(data, len, out, BENCHMARK_BLOCK_SIZE);
+      default:
+        return svn__decompress_zstd(data, len, out, BENCHMARK_BLOCK_SIZE);
+    }
+}
+
+/* Compress and decompress text-like data with zlib, LZ4 and zstd.
+ * Verify the round-trip and, in verbose mode, report compression ratio
+ * and throughput of each method.
+ */
+static svn_error_t *
+test_compression_throughput(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  static const char * const names[] = { "zlib", "lz4", "zstd" };
+  static const char * const words[] = {
+    "if (", "len", ") ", "return ", "svn_error_t *", "apr_size_t ", "pool",
+    ";\n", "  ", "{\n", "}\n", "NULL", ", ", "SVN_ERR(", "data", " = "
+  };
+  apr_uint32_t seed = 0xc0ffee;
+  svn_stringbuf_t *block
+    = svn_stringbuf_create_ensure(BENCHMARK_BLOCK_SIZE, pool);
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(pool);
+  int method;
+
+  while (block->len < BENCHMARK_BLOCK_SIZE)
+    svn_stringbuf_appendcstr(block, words[svn_test_rand(&seed) % 16]);
+  svn_stringbuf_chop(block, block->len - BENCHMARK_BLOCK_SIZE);
+
+  for (method = benchmark_zlib; method <= benchmark_zstd; ++method)
+    {
+      apr_time_t compress_time, decompress_time;
+      int i;
+
+      if (method == benchmark_zstd && !svn_zstd__compiled_version())
+        continue;
+
+      compress_time = apr_time_now();
+      for (i = 0; i < BENCHMARK_BLOCK_COUNT; ++i)
+        SVN_ERR(benchmark_compress(method, block->data, block->len,
+                                   compressed));
+      compress_time = apr_time_now() - compress_time;
+
+      decompress_time = apr_time_now();
+      for (i = 0; i < BENCHMARK_BLOCK_COUNT; ++i)
+        SVN_ERR(benchmark_decompress(method, compressed->data,
+                                     compressed->len, decompressed));
+      decompress_time = apr_time_now() - decompress_time;
+
+      SVN_TEST_ASSERT(svn_stringbuf_compare(block, decompressed));
+
+      if (opts->verbose)
+        printf("%s: ratio %.2f, compress %.1f MB/s, decompress %.1f MB/s\n",
+               names[method], (double)block->len / compressed->len,
+               (double)block->len * BENCHMARK_BLOCK_COUNT
+                 / MAX(compress_time, 1),
+               (double)block->len * BENCHMARK_BLOCK_COUNT
+                 / MAX(decompress_time, 1));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -87,6 +250,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                  "test svn__compress_lz4()"),
   SVN_TEST_PASS2(test_compress_lz4_empty,
                  "test svn__compress_lz4() with empty input"),
+  SVN_TEST_PASS2(test_compress_zstd,
+                 "test svn__compress_zstd()"),
+  SVN_TEST_PASS2(test_compress_zstd_empty,
+                 "test svn__compress_zstd() with empty input"),
+  SVN_TEST_OPTS_PASS(test_compression_throughput,
+                     "compare zlib, lz4 and zstd throughput"),
   SVN_TEST_NULL
 };
 
@@ -1525,6 +1525,106 @@ test_externals_store(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_bulk_transaction(apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_wc__db_t *db2;
+  const char *local_abspath;
+  const char *n_abspath;
+  const char *p_abspath;
+  svn_skel_t *work_item;
+  apr_uint64_t id;
+  svn_node_kind_t kind;
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_bulk_transaction", pool));
+  n_abspath = svn_dirent_join(local_abspath, "N", pool);
+  p_abspath = svn_dirent_join(local_abspath, "P", pool);
+
+  /* Another process looking at the working copy. */
+  SVN_ERR(svn_wc__db_open(&db2, NULL, FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_wc__db_bulk_begin(db, local_abspath, pool));
+
+  SVN_ERR(svn_wc__db_base_add_directory(
+            db, n_abspath, local_abspath,
+            "N", ROOT_ONE, UUID_ONE, 3,
+            apr_hash_make(pool),
+            1, TIME_1a, AUTHOR_1,
+            NULL, svn_depth_infinity,
+            NULL, FALSE, NULL, NULL, NULL, NULL,
+            pool));
+  work_item = svn_skel__make_empty_list(pool);
+  svn_skel__prepend_int(0, work_item, pool);
+  SVN_ERR(svn_wc__db_wq_add(db, local_abspath, work_item, pool));
+
+  /* Nothing is committed before flushing. */
+  SVN_ERR(svn_wc__db_read_kind(&kind, db2, n_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  SVN_ERR(svn_wc__db_bulk_flush(db, local_abspath, pool));
+
+  SVN_ERR(svn_wc__db_base_add_directory(
+            db, p_abspath, local_abspath,
+            "P", ROOT_ONE, UUID_ONE, 3,
+            apr_hash_make(pool),
+            1, TIME_1a, AUTHOR_1,
+            NULL, svn_depth_infinity,
+            NULL, FALSE, NULL, NULL, NULL, NULL,
+            pool));
+
+  /* Both nodes are there for the bulk transaction itself... */
+  SVN_ERR(svn_wc__db_read_kind(&kind, db, n_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+  SVN_ERR(svn_wc__db_read_kind(&kind, db, p_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+
+  /* ...but only the flushed one for everybody else. */
+  SVN_ERR(svn_wc__db_read_kind(&kind, db2, n_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+  SVN_ERR(svn_wc__db_read_kind(&kind, db2, p_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* Interrupt the bulk transaction, like a crashing client would. */
+  SVN_ERR(svn_wc__db_close(db));
+
+  /* The flushed changes survive, including the work item that belongs to
+     them.  The rest is gone. */
+  SVN_ERR(svn_wc__db_read_kind(&kind, db2, n_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+  SVN_ERR(svn_wc__db_read_kind(&kind, db2, p_abspath, TRUE, FALSE, FALSE,
+                               pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db2, local_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item != NULL);
+  SVN_TEST_INT_ASSERT(detect_work_item(work_item), 0);
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db2, local_abspath, id,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  /* And the working copy is not locked anymore. */
+  SVN_ERR(svn_wc__db_bulk_begin(db2, local_abspath, pool));
+  SVN_ERR(svn_wc__db_base_add_directory(
+            db2, p_abspath, local_abspath,
+            "P", ROOT_ONE, UUID_ONE, 3,
+            apr_hash_make(pool),
+            1, TIME_1a, AUTHOR_1,
+            NULL, svn_depth_infinity,
+            NULL, FALSE, NULL, NULL, NULL, NULL,
+            pool));
+  SVN_ERR(svn_wc__db_bulk_end(db2, local_abspath, pool));
+
+  return svn_error_trace(svn_wc__db_close(db2));
+}
+
 static int max_threads = 2;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -1550,6 +1650,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "work queue processing"),
     SVN_TEST_PASS2(test_externals_store,
                    "externals store"),
+    SVN_TEST_PASS2(test_bulk_transaction,
+                   "interrupted bulk transaction"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,379 @@
+/*
+ * monitor-test.c :  test the working copy monitor cache
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+#include <apr_general.h>
+#include <apr_strings.h>
+
+#include "svn_types.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_wc.h"
+
+#include "utils.h"
+
+#include "private/svn_sqlite.h"
+
+#include "../../libsvn_wc/wc.h"
+#include "../../libsvn_wc/adm_files.h"
+#include "../../libsvn_wc/monitor.h"
+
+#include "../svn_test.h"
+
+#include "wc-test-queries.h"
+
+WC_TEST_QUERIES_SQL_DECLARE_STATEMENTS(monitor_statements);
+
+/* The journal header as written by the monitor, without the session. */
+#define JOURNAL_HEADER "svn-wc-monitor-journal 1 "
+
+/* Replace the monitor journal in the working copy of B with a new one
+   for SESSION. */
+static svn_error_t *
+start_journal(svn_test__sandbox_t *b,
+              const char *session)
+{
+  const char *journal_path = svn_wc__adm_child(b->wc_abspath,
+                                               SVN_WC__ADM_MONITOR_JOURNAL,
+                                               b->pool);
+
+  return svn_error_trace(svn_io_file_create(journal_path,
+                                            apr_pstrcat(b->pool,
+                                                        JOURNAL_HEADER,
+                                                        session, "\n",
+                                                        SVN_VA_NULL),
+                                            b->pool));
+}
+
+/* Append RECORDS to the monitor journal in the working copy of B. */
+static svn_error_t *
+append_journal(svn_test__sandbox_t *b,
+               const char *records)
+{
+  const char *journal_path = svn_wc__adm_child(b->wc_abspath,
+                                               SVN_WC__ADM_MONITOR_JOURNAL,
+                                               b->pool);
+  apr_file_t *file;
+
+  SVN_ERR(svn_io_file_open(&file, journal_path, APR_WRITE | APR_APPEND,
+                           APR_OS_DEFAULT, b->pool));
+  SVN_ERR(svn_io_file_write_full(file, records, strlen(records), NULL,
+                                 b->pool));
+
+  return svn_error_trace(svn_io_file_close(file, b->pool));
+}
+
+/* Open the monitor cache of B and record the entries of the directories
+   given as NULL-terminated list of relpaths, as read from disk. */
+static svn_error_t *
+record_dirs(svn_test__sandbox_t *b,
+            ...)
+{
+  svn_wc__monitor_t *monitor;
+  const char *relpath;
+  va_list ap;
+
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b->wc_abspath,
+                                        b->pool, b->pool));
+  va_start(ap, b);
+  while ((relpath = va_arg(ap, const char *)))
+    {
+      const char *local_abspath = sbox_wc_path(b, relpath);
+      apr_hash_t *dirents;
+
+      SVN_ERR(svn_io_get_dirents3(&dirents, local_abspath, FALSE,
+                                  b->pool, b->pool));
+      SVN_ERR(svn_wc__monitor_set_dirents(monitor, local_abspath, dirents,
+                                          b->pool));
+    }
+  va_end(ap);
+
+  return svn_error_trace(svn_wc__monitor_close(monitor, b->pool));
+}
+
+/* Check that MONITOR has entries for RELPATH in the working copy of B if
+   and only if EXPECTED is set.  If it has, check that they name the same
+   nodes as the entries on disk.  Sizes and timestamps are not compared,
+   as SQLite touches the administrative directory. */
+static svn_error_t *
+check_cached(svn_wc__monitor_t *monitor,
+             svn_test__sandbox_t *b,
+             const char *relpath,
+             svn_boolean_t expected)
+{
+  const char *local_abspath = sbox_wc_path(b, relpath);
+  apr_hash_t *cached;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_wc__monitor_get_dirents(&cached, monitor, local_abspath,
+                                      b->pool, b->pool));
+  if (!expected)
+    {
+      if (cached)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Unexpected cache entries for '%s'",
+                                 relpath);
+      return SVN_NO_ERROR;
+    }
+
+  if (!cached)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Missing cache entries for '%s'", relpath);
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, local_abspath, FALSE,
+                              b->pool, b->pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(cached), apr_hash_count(dirents));
+  for (hi = apr_hash_first(b->pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const svn_io_dirent2_t *cached_dirent
+        = svn_hash_gets(cached, apr_hash_this_key(hi));
+
+      SVN_TEST_ASSERT(cached_dirent);
+      SVN_TEST_INT_ASSERT(cached_dirent->kind, dirent->kind);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that journal records invalidate exactly the directories that may
+   have changed and that incomplete or foreign records are handled. */
+static svn_error_t *
+test_journal_invalidation(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_wc__monitor_t *monitor;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "monitor_journal_invalidation",
+                                   opts, pool));
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+  SVN_ERR(sbox_wc_mkdir(&b, "A/B"));
+  SVN_ERR(sbox_wc_mkdir(&b, "A/B/C"));
+  SVN_ERR(sbox_wc_mkdir(&b, "A/D"));
+  SVN_ERR(sbox_wc_mkdir(&b, "A/my dir"));
+  SVN_ERR(sbox_file_write(&b, "A/D/file", "contents\n"));
+
+  SVN_ERR(start_journal(&b, "session-1"));
+  SVN_ERR(record_dirs(&b, "", "A", "A/B", "A/B/C", "A/D", "A/my dir",
+                      SVN_VA_NULL));
+
+  /* Nothing changed. */
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", TRUE));
+  SVN_ERR(check_cached(monitor, &b, "A/B/C", TRUE));
+  SVN_ERR(check_cached(monitor, &b, "A/D", TRUE));
+  SVN_ERR(check_cached(monitor, &b, "A/my dir", TRUE));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* A change drops the parent, the node itself and everything below it.
+     Paths are URI-encoded and incomplete records are not applied yet. */
+  SVN_ERR(append_journal(&b, "C A/B\nC A/my%20dir\nK monitor-cookie.tmp\n"
+                             "C A/D"));
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", TRUE));
+  SVN_ERR(check_cached(monitor, &b, "A", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A/B", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A/B/C", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A/my dir", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A/D", TRUE));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* Complete the last record. */
+  SVN_ERR(append_journal(&b, "/file\n"));
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", TRUE));
+  SVN_ERR(check_cached(monitor, &b, "A/D", FALSE));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* Lost events invalidate everything. */
+  SVN_ERR(record_dirs(&b, "A", "A/D", SVN_VA_NULL));
+  SVN_ERR(append_journal(&b, "O\n"));
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A", FALSE));
+  SVN_ERR(check_cached(monitor, &b, "A/D", FALSE));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* So does a new monitor session. */
+  SVN_ERR(record_dirs(&b, "", SVN_VA_NULL));
+  SVN_ERR(start_journal(&b, "session-2"));
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", FALSE));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* Invalid journals are reported by the test API only. */
+  SVN_ERR(svn_io_file_create(svn_wc__adm_child(b.wc_abspath,
+                                               SVN_WC__ADM_MONITOR_JOURNAL,
+                                               pool),
+                             "no journal\n", pool));
+  SVN_TEST_ASSERT_ERROR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath,
+                                                      pool, pool),
+                        SVN_ERR_WC_CORRUPT);
+  SVN_ERR(svn_wc__monitor_open(&monitor, b.wc_abspath, pool, pool));
+  SVN_TEST_ASSERT(monitor == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that failures to access the cache are not reported as errors. */
+static svn_error_t *
+test_cache_errors(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_wc__monitor_t *monitor;
+  svn_sqlite__db_t *sdb;
+  apr_hash_t *dirents;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "monitor_cache_errors", opts, pool));
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+  SVN_ERR(start_journal(&b, "session-1"));
+  SVN_ERR(record_dirs(&b, "", SVN_VA_NULL));
+
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(check_cached(monitor, &b, "", TRUE));
+
+  /* Break the cache behind the monitor's back. */
+  SVN_ERR(svn_sqlite__open(&sdb,
+                           svn_wc__adm_child(b.wc_abspath,
+                                             SVN_WC__ADM_MONITOR_CACHE,
+                                             pool),
+                           svn_sqlite__mode_readwrite, monitor_statements,
+                           0, NULL, 0, pool, pool));
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_MONITOR_DROP_DIRENTS));
+  SVN_ERR(svn_sqlite__close(sdb));
+
+  /* Reading falls back to the disk, writing is skipped. */
+  SVN_ERR(check_cached(monitor, &b, "", FALSE));
+  SVN_ERR(svn_io_get_dirents3(&dirents, sbox_wc_path(&b, "A"), FALSE,
+                              pool, pool));
+  SVN_ERR(svn_wc__monitor_set_dirents(monitor, sbox_wc_path(&b, "A"),
+                                      dirents, pool));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  /* Same for pending entries that can't be written on close. */
+  SVN_ERR(svn_io_remove_file2(svn_wc__adm_child(b.wc_abspath,
+                                                SVN_WC__ADM_MONITOR_CACHE,
+                                                pool),
+                              FALSE, pool));
+  SVN_ERR(svn_wc__monitor_open_unsynced(&monitor, b.wc_abspath, pool, pool));
+  SVN_ERR(svn_wc__monitor_set_dirents(monitor, sbox_wc_path(&b, "A"),
+                                      dirents, pool));
+  SVN_ERR(svn_sqlite__open(&sdb,
+                           svn_wc__adm_child(b.wc_abspath,
+                                             SVN_WC__ADM_MONITOR_CACHE,
+                                             pool),
+                           svn_sqlite__mode_readwrite, monitor_statements,
+                           0, NULL, 0, pool, pool));
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_MONITOR_DROP_DIRENTS));
+  SVN_ERR(svn_sqlite__close(sdb));
+  SVN_ERR(svn_wc__monitor_close(monitor, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for status_receiver. */
+typedef struct status_baton_t
+{
+  /* Relpaths of the unversioned nodes reported, mapped to "". */
+  apr_hash_t *unversioned;
+  const char *wc_abspath;
+} status_baton_t;
+
+/* Implements svn_wc_status_func4_t. */
+static svn_error_t *
+status_receiver(void *baton,
+                const char *local_abspath,
+                const svn_wc_status3_t *status,
+                apr_pool_t *scratch_pool)
+{
+  status_baton_t *sb = baton;
+
+  if (status->node_status == svn_wc_status_unversioned)
+    {
+      apr_pool_t *pool = apr_hash_pool_get(sb->unversioned);
+
+      svn_hash_sets(sb->unversioned,
+                    apr_pstrdup(pool,
+                                svn_dirent_skip_ancestor(sb->wc_abspath,
+                                                         local_abspath)),
+                    "");
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that status walks read everything from disk if the journal has
+   been left behind by a monitor that is gone, even if the cache claims
+   that nothing changed. */
+static svn_error_t *
+test_fallback_full_walk(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  status_baton_t sb;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "monitor_fallback_full_walk",
+                                   opts, pool));
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+  SVN_ERR(start_journal(&b, "session-1"));
+  SVN_ERR(record_dirs(&b, "", "A", SVN_VA_NULL));
+
+  /* Nobody records these changes. */
+  SVN_ERR(sbox_file_write(&b, "new", "new\n"));
+  SVN_ERR(sbox_file_write(&b, "A/new", "new\n"));
+
+  sb.unversioned = apr_hash_make(pool);
+  sb.wc_abspath = b.wc_abspath;
+  SVN_ERR(svn_wc_walk_status(b.wc_ctx, b.wc_abspath, svn_depth_infinity,
+                             FALSE, FALSE, FALSE, NULL,
+                             status_receiver, &sb, NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(sb.unversioned), 2);
+  SVN_TEST_ASSERT(svn_hash_gets(sb.unversioned, "new"));
+  SVN_TEST_ASSERT(svn_hash_gets(sb.unversioned, "A/new"));
+
+  return SVN_NO_ERROR;
+}
+
+/* ---------------------------------------------------------------------- */
+/* The list of test functions */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_OPTS_PASS(test_journal_invalidation,
+                       "monitor journal invalidates changed dirs"),
+    SVN_TEST_OPTS_PASS(test_cache_errors,
+                       "monitor cache errors are not reported"),
+    SVN_TEST_OPTS_PASS(test_fallback_full_walk,
+                       "status walk without monitor reads everything"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -23,6 +23,7 @@
 
 #include <apr_pools.h>
 #include <apr_general.h>
+#include <apr_strings.h>
 
 #include "svn_types.h"
 
@@ -34,6 +35,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
@@ -306,6 +308,222 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 #endif
 }
 
+/* Exercise the pristine text API with a DB that stores pristine texts
+ * compressed, using a text that spans several compressed blocks. */
+static svn_error_t *
+pristine_compressed(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_wc__db_t *sandbox_db;
+  svn_wc__db_t *db;
+  svn_config_t *config;
+  const char *wc_abspath;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_string_t *data_string;
+  svn_checksum_t *data_sha1, *data_md5;
+  int i;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath, &sandbox_db,
+                              "pristine_compressed", opts, pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "line %d\n", i));
+  data_string = svn_string_create_from_buf(data, pool);
+
+  /* Install the text. */
+  {
+    svn_wc__db_install_data_t *install_data;
+    svn_stream_t *pristine_stream;
+    apr_size_t sz = data_string->len;
+
+    SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                                &install_data,
+                                                &data_sha1, &data_md5,
+                                                db, wc_abspath,
+                                                pool, pool));
+    SVN_ERR(svn_stream_write(pristine_stream, data_string->data, &sz));
+    SVN_ERR(svn_stream_close(pristine_stream));
+    SVN_ERR(svn_wc__db_pristine_install(install_data,
+                                        data_sha1, data_md5, pool));
+  }
+
+  /* The stored file is smaller than the text. */
+  {
+    const char *stored_abspath;
+    svn_boolean_t compressed;
+    apr_finfo_t finfo;
+
+    SVN_ERR(svn_wc__db_pristine_get_stored_path(&stored_abspath,
+                                                &compressed,
+                                                db, wc_abspath, data_sha1,
+                                                pool, pool));
+    SVN_TEST_ASSERT(compressed);
+    SVN_ERR(svn_io_stat(&finfo, stored_abspath, APR_FINFO_SIZE, pool));
+    SVN_TEST_ASSERT(finfo.size < (apr_off_t)data_string->len);
+  }
+
+  /* Read the text back, through the DB that doesn't compress as well. */
+  {
+    svn_stream_t *data_read_back;
+    svn_filesize_t size;
+    svn_boolean_t same;
+
+    SVN_ERR(svn_wc__db_pristine_read(&data_read_back, &size,
+                                     sandbox_db, wc_abspath,
+                                     data_sha1, pool, pool));
+    SVN_TEST_ASSERT(size == (svn_filesize_t)data_string->len);
+    SVN_ERR(svn_stream_contents_same2(&same, data_read_back,
+                                      svn_stream_from_string(data_string,
+                                                             pool),
+                                      pool));
+    SVN_TEST_ASSERT(same);
+  }
+
+  /* The path to the text is that of a verbatim copy. */
+  {
+    const char *pristine_abspath;
+    svn_stringbuf_t *contents;
+
+    SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, db, wc_abspath,
+                                         data_sha1, pool, pool));
+    SVN_ERR(svn_stringbuf_from_file2(&contents, pristine_abspath, pool));
+    SVN_TEST_STRING_ASSERT(contents->data, data_string->data);
+  }
+
+  /* Remove it again. */
+  {
+    svn_boolean_t present;
+
+    SVN_ERR(svn_wc__db_pristine_check(&present, db, wc_abspath, data_sha1,
+                                      pool));
+    SVN_TEST_ASSERT(present);
+    SVN_ERR(svn_wc__db_pristine_remove(db, wc_abspath, data_sha1, pool));
+    SVN_ERR(svn_wc__db_pristine_check(&present, db, wc_abspath, data_sha1,
+                                      pool));
+    SVN_TEST_ASSERT(! present);
+  }
+
+  return svn_error_trace(svn_wc__db_close(db));
+}
+
+
+/* Check that a conflicting update works on compressed pristine texts:
+ * the work queue must still find the merge sources after the decompressed
+ * copies of the pristine texts are gone. */
+static svn_error_t *
+pristine_compressed_conflict(const svn_test_opts_t *opts,
+                             apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_checksum_t *sha1;
+  const char *stored_abspath;
+  svn_boolean_t compressed;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "pristine_compressed_conflict",
+                                   opts, pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc_context_destroy(b.wc_ctx));
+  SVN_ERR(svn_wc_context_create(&b.wc_ctx, config, pool, pool));
+
+  SVN_ERR(sbox_file_write(&b, "f", "base\n"));
+  SVN_ERR(sbox_wc_add(&b, "f"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+  SVN_ERR(sbox_file_write(&b, "f", "theirs\n"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, "base\n", 5, pool));
+  SVN_ERR(svn_wc__db_pristine_get_stored_path(&stored_abspath, &compressed,
+                                              b.wc_ctx->db, b.wc_abspath,
+                                              sha1, pool, pool));
+  SVN_TEST_ASSERT(compressed);
+
+  SVN_ERR(sbox_wc_update(&b, "", 1));
+  SVN_ERR(sbox_file_write(&b, "f", "mine\n"));
+  SVN_ERR(sbox_wc_update(&b, "", 2));
+
+  /* The conflict files hold the texts that were merged. */
+  SVN_ERR(svn_stringbuf_from_file2(&contents, sbox_wc_path(&b, "f.r1"),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "base\n");
+  SVN_ERR(svn_stringbuf_from_file2(&contents, sbox_wc_path(&b, "f.r2"),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "theirs\n");
+  SVN_ERR(svn_stringbuf_from_file2(&contents, sbox_wc_path(&b, "f.mine"),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "mine\n");
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Check that a working copy only gets the format that allows compressed
+   pristine texts once the first compressed text is stored in it. */
+static svn_error_t *
+pristine_compressed_format(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_stringbuf_t *contents;
+  svn_stream_t *stream;
+  svn_checksum_t *sha1;
+  int format;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "pristine_compressed_format",
+                                   opts, pool));
+
+  SVN_ERR(sbox_file_write(&b, "f", "verbatim\n"));
+  SVN_ERR(sbox_wc_add(&b, "f"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+
+  SVN_ERR(svn_wc__db_temp_get_format(&format, b.wc_ctx->db, b.wc_abspath,
+                                     pool));
+  SVN_TEST_INT_ASSERT(format, SVN_WC__VERSION);
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc_context_destroy(b.wc_ctx));
+  SVN_ERR(svn_wc_context_create(&b.wc_ctx, config, pool, pool));
+
+  SVN_ERR(sbox_file_write(&b, "g", "compressed\n"));
+  SVN_ERR(sbox_wc_add(&b, "g"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+
+  /* Reopen without compression; the working copy keeps the new format
+     and both texts stay readable. */
+  SVN_ERR(svn_wc_context_destroy(b.wc_ctx));
+  SVN_ERR(svn_wc_context_create(&b.wc_ctx, NULL, pool, pool));
+
+  SVN_ERR(svn_wc__db_temp_get_format(&format, b.wc_ctx->db, b.wc_abspath,
+                                     pool));
+  SVN_TEST_INT_ASSERT(format, SVN_WC__HAS_COMPRESSED_PRISTINES);
+
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, "verbatim\n", 9, pool));
+  SVN_ERR(svn_wc__db_pristine_read(&stream, NULL, b.wc_ctx->db,
+                                   b.wc_abspath, sha1, pool, pool));
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "verbatim\n");
+
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, "compressed\n", 11, pool));
+  SVN_ERR(svn_wc__db_pristine_read(&stream, NULL, b.wc_ctx->db,
+                                   b.wc_abspath, sha1, pool, pool));
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "compressed\n");
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = -1;
 
@@ -318,6 +536,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(pristine_compressed,
+                       "pristine_compressed"),
+    SVN_TEST_OPTS_PASS(pristine_compressed_conflict,
+                       "pristine_compressed_conflict"),
+    SVN_TEST_OPTS_PASS(pristine_compressed_format,
+                       "pristine_compressed_format"),
     SVN_TEST_NULL
   };
 
@@ -76,3 +76,6 @@ WHERE wc_id = 1 and local_relpath = ?1
 -- STMT_SELECT_ALL_ACTUAL
 SELECT local_relpath FROM actual_node WHERE wc_id = 1
 
+
+-- STMT_MONITOR_DROP_DIRENTS
+DROP TABLE dirents
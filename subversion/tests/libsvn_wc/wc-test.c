@@ -30,6 +30,7 @@
 #include "svn_types.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_path.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
 #include "svn_wc.h"
@@ -43,6 +44,7 @@
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -493,6 +495,261 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Baton for status_read_ahead_func(). */
+struct status_read_ahead_baton_t
+{
+  /* Maps the relpaths of all reported nodes to their svn_wc_status3_t *. */
+  apr_hash_t *statuses;
+
+  /* The node reported last. */
+  const char *last_abspath;
+
+  /* Set if a node has not been reported in depth-first order. */
+  svn_boolean_t out_of_order;
+
+  const char *wc_abspath;
+  apr_pool_t *pool;
+};
+
+/* Implements svn_wc_status_func4_t, recording the status in BATON. */
+static svn_error_t *
+status_read_ahead_func(void *baton,
+                       const char *local_abspath,
+                       const svn_wc_status3_t *status,
+                       apr_pool_t *scratch_pool)
+{
+  struct status_read_ahead_baton_t *sb = baton;
+  const char *relpath = svn_dirent_skip_ancestor(sb->wc_abspath,
+                                                 local_abspath);
+
+  if (sb->last_abspath
+      && svn_path_compare_paths(sb->last_abspath, local_abspath) >= 0)
+    sb->out_of_order = TRUE;
+
+  sb->last_abspath = apr_pstrdup(sb->pool, local_abspath);
+  svn_hash_sets(sb->statuses, apr_pstrdup(sb->pool, relpath),
+                svn_wc_dup_status3(status, sb->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the node status of RELPATH in SB or svn_wc_status_none if it
+   has not been reported. */
+static enum svn_wc_status_kind
+read_ahead_status(struct status_read_ahead_baton_t *sb,
+                  const char *relpath)
+{
+  svn_wc_status3_t *status = svn_hash_gets(sb->statuses, relpath);
+
+  return status ? status->node_status : svn_wc_status_none;
+}
+
+/* More than the status walk reads ahead of any directory. */
+#define READ_AHEAD_DIRS 40
+
+static svn_error_t *
+test_status_read_ahead(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+  int ignore_text_mods;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "status_read_ahead", opts, pool));
+
+  /* Enough subdirectories for the walk to read ahead of them in batches,
+     each having subdirectories of its own. */
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+  for (i = 0; i < READ_AHEAD_DIRS; i++)
+    {
+      const char *dir;
+
+      svn_pool_clear(iterpool);
+      dir = apr_psprintf(iterpool, "A/D%02d", i);
+      SVN_ERR(sbox_wc_mkdir(&b, dir));
+      SVN_ERR(sbox_wc_mkdir(&b, svn_relpath_join(dir, "sub", iterpool)));
+      SVN_ERR(sbox_file_write(&b, svn_relpath_join(dir, "sub/f", iterpool),
+                              "f\n"));
+      SVN_ERR(sbox_wc_add(&b, svn_relpath_join(dir, "sub/f", iterpool)));
+    }
+  SVN_ERR(sbox_wc_commit(&b, ""));
+  SVN_ERR(sbox_wc_update(&b, "", 1));
+
+  /* Changes in directories that get read ahead. */
+  SVN_ERR(sbox_file_write(&b, "A/D03/sub/f", "modified\n"));
+  SVN_ERR(sbox_file_write(&b, "A/D17/sub/new", "new\n"));
+  SVN_ERR(svn_io_remove_dir2(sbox_wc_path(&b, "A/D33/sub"), FALSE,
+                             NULL, NULL, pool));
+  SVN_ERR(svn_io_remove_dir2(sbox_wc_path(&b, "A/D34/sub"), FALSE,
+                             NULL, NULL, pool));
+  SVN_ERR(sbox_file_write(&b, "A/D34/sub", "obstruction\n"));
+
+  for (ignore_text_mods = 0; ignore_text_mods < 2; ignore_text_mods++)
+    {
+      struct status_read_ahead_baton_t sb = { 0 };
+
+      svn_pool_clear(iterpool);
+      sb.statuses = apr_hash_make(iterpool);
+      sb.wc_abspath = b.wc_abspath;
+      sb.pool = iterpool;
+
+      SVN_ERR(svn_wc_walk_status(b.wc_ctx, b.wc_abspath, svn_depth_infinity,
+                                 TRUE /* get_all */, FALSE /* no_ignore */,
+                                 ignore_text_mods, NULL,
+                                 status_read_ahead_func, &sb,
+                                 NULL, NULL, iterpool));
+
+      /* Every node exactly once and in the usual order. */
+      SVN_TEST_ASSERT(!sb.out_of_order);
+      SVN_TEST_ASSERT(apr_hash_count(sb.statuses)
+                      == 2 + 3 * READ_AHEAD_DIRS + 1);
+
+      for (i = 0; i < READ_AHEAD_DIRS; i++)
+        {
+          const char *dir = apr_psprintf(iterpool, "A/D%02d", i);
+
+          SVN_TEST_ASSERT(read_ahead_status(&sb, dir)
+                          == svn_wc_status_normal);
+          SVN_TEST_ASSERT(read_ahead_status(&sb,
+                                            svn_relpath_join(dir, "sub/f",
+                                                             iterpool))
+                          != svn_wc_status_none);
+        }
+
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D03/sub/f")
+                      == (ignore_text_mods ? svn_wc_status_normal
+                                           : svn_wc_status_modified));
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D05/sub/f")
+                      == svn_wc_status_normal);
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D17/sub/new")
+                      == svn_wc_status_unversioned);
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D33/sub")
+                      == svn_wc_status_missing);
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D33/sub/f")
+                      == svn_wc_status_missing);
+      SVN_TEST_ASSERT(read_ahead_status(&sb, "A/D34/sub")
+                      == svn_wc_status_obstructed);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t, cancelling once it has been called more
+   often than the int * BATON says. */
+static svn_error_t *
+countdown_cancel_func(void *baton)
+{
+  int *remaining = baton;
+
+  if ((*remaining)-- <= 0)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* More files than the work queue installs at once. */
+#define WQ_INSTALL_FILES 150
+
+static svn_error_t *
+test_wq_run_interrupted(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_wc__db_t *db;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint64_t id;
+  svn_skel_t *work_item;
+  int remaining;
+  int missing = 0;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "wq_run_interrupted", opts, pool));
+  db = b.wc_ctx->db;
+
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+  for (i = 0; i < WQ_INSTALL_FILES; i++)
+    {
+      const char *relpath;
+
+      svn_pool_clear(iterpool);
+      relpath = apr_psprintf(iterpool, "A/f%03d", i);
+      SVN_ERR(sbox_file_write(&b, relpath,
+                              apr_psprintf(iterpool, "file %d\n", i)));
+      SVN_ERR(sbox_wc_add(&b, relpath));
+    }
+  SVN_ERR(sbox_wc_commit(&b, ""));
+
+  /* Remove all files and queue installing them again. */
+  for (i = 0; i < WQ_INSTALL_FILES; i++)
+    {
+      const char *local_abspath;
+
+      svn_pool_clear(iterpool);
+      local_abspath = svn_dirent_join(b.wc_abspath,
+                                      apr_psprintf(iterpool, "A/f%03d", i),
+                                      iterpool);
+      SVN_ERR(svn_io_remove_file2(local_abspath, FALSE, iterpool));
+      SVN_ERR(svn_wc__wq_build_file_install(&work_item, db, local_abspath,
+                                            NULL, FALSE, TRUE,
+                                            iterpool, iterpool));
+      SVN_ERR(svn_wc__db_wq_add(db, b.wc_abspath, work_item, iterpool));
+    }
+
+  /* Cancel while the first batch is being installed or right after. */
+  remaining = 1;
+  SVN_TEST_ASSERT_ERROR(svn_wc__wq_run(db, b.wc_abspath,
+                                       countdown_cancel_func, &remaining,
+                                       pool),
+                        SVN_ERR_CANCELLED);
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, b.wc_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item != NULL);
+
+  for (i = 0; i < WQ_INSTALL_FILES; i++)
+    {
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_check_path(svn_dirent_join(b.wc_abspath,
+                                                apr_psprintf(iterpool,
+                                                             "A/f%03d", i),
+                                                iterpool),
+                                &kind, iterpool));
+      if (kind == svn_node_none)
+        missing++;
+    }
+  SVN_TEST_ASSERT(missing > 0);
+
+  /* Running the queue again completes it. */
+  SVN_ERR(svn_wc__wq_run(db, b.wc_abspath, NULL, NULL, pool));
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, b.wc_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  for (i = 0; i < WQ_INSTALL_FILES; i++)
+    {
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&contents,
+                                       svn_dirent_join(b.wc_abspath,
+                                                       apr_psprintf(iterpool,
+                                                                    "A/f%03d",
+                                                                    i),
+                                                       iterpool),
+                                       iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             apr_psprintf(iterpool, "file %d\n", i));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +772,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_status_read_ahead,
+                       "test reading directories ahead of status"),
+    SVN_TEST_OPTS_PASS(test_wq_run_interrupted,
+                       "rerun an interrupted work queue"),
     SVN_TEST_NULL
   };
 
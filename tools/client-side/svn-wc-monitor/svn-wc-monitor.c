@@ -0,0 +1,137 @@
+/*
+ * svn-wc-monitor.c:  Keep track of changes in a working copy, so that
+ *                    status walks only need to read what changed.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_pools.h"
+#include "svn_utf.h"
+#include "svn_wc.h"
+
+#include "private/svn_cmdline_private.h"
+#include "private/svn_wc_private.h"
+
+/* Used to terminate lines in large multi-line string literals. */
+#define NL APR_EOL_STR
+
+static const char *usage_summary =
+  "Watch the working copy at WC-PATH (default: the current directory) for"  NL
+  "changes until interrupted."                                              NL
+  ""                                                                        NL
+  "While this runs, 'svn status', 'svn commit' and other operations that"   NL
+  "look for local modifications only read those directories of the"         NL
+  "working copy that changed on disk since the previous such operation."    NL
+  "On large working copies, that is much faster than reading all of them."  NL
+  ""                                                                        NL
+  "This requires Linux' inotify.  Each directory of the working copy needs" NL
+  "an inotify watch, so fs.inotify.max_user_watches may have to be raised." NL;
+
+/* Print a usage message for this program (PROGNAME), possibly with an
+   error message ERR_MSG, if not NULL.  */
+static void
+usage_maybe_with_err(const char *progname, const char *err_msg)
+{
+  FILE *out;
+
+  out = err_msg ? stderr : stdout;
+  fprintf(out, "Usage: %s [WC-PATH]\n\n%s", progname, usage_summary);
+  if (err_msg)
+    fprintf(out, "\nERROR: %s\n", err_msg);
+}
+
+/* Watch the working copy at PATH until we get cancelled. */
+static svn_error_t *
+monitor(const char *path,
+        apr_pool_t *pool)
+{
+  svn_wc_context_t *wc_ctx;
+  const char *local_abspath;
+  svn_error_t *err;
+
+  SVN_ERR(svn_dirent_get_absolute(&local_abspath, path, pool));
+  SVN_ERR(svn_wc_context_create(&wc_ctx, NULL, pool, pool));
+
+  err = svn_wc__monitor_run(wc_ctx, local_abspath,
+                            svn_cmdline__setup_cancellation_handler(), NULL,
+                            pool);
+
+  /* Being interrupted is how we are supposed to end. */
+  if (err && err->apr_err == SVN_ERR_CANCELLED)
+    {
+      svn_error_clear(err);
+      err = SVN_NO_ERROR;
+    }
+
+  return svn_error_compose_create(err, svn_wc_context_destroy(wc_ctx));
+}
+
+int
+main(int argc, const char **argv)
+{
+  apr_pool_t *pool;
+  svn_error_t *err = SVN_NO_ERROR;
+  const char *path = "";
+
+  /* Initialize the app.  Send all error messages to 'stderr'.  */
+  if (svn_cmdline_init(argv[0], stderr) == EXIT_FAILURE)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  if (argc > 2
+      || (argc == 2 && (strcmp(argv[1], "-h") == 0
+                        || strcmp(argv[1], "--help") == 0)))
+    {
+      usage_maybe_with_err(argv[0], argc > 2 ? "Too many arguments." : NULL);
+      svn_pool_destroy(pool);
+      return argc > 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+  /* Convert argv[1] into a UTF8, internal-format, canonicalized path. */
+  if (argc == 2)
+    {
+      if ((err = svn_utf_cstring_to_utf8(&path, argv[1], pool)))
+        goto cleanup;
+      path = svn_dirent_internal_style(path, pool);
+      path = svn_dirent_canonicalize(path, pool);
+    }
+
+  err = monitor(path, pool);
+
+ cleanup:
+  svn_pool_destroy(pool);
+
+  if (err)
+    {
+      svn_handle_error2(err, stderr, FALSE, "svn-wc-monitor: ");
+      svn_error_clear(err);
+      return EXIT_FAILURE;
+    }
+
+  svn_cmdline__cancellation_exit();
+
+  return EXIT_SUCCESS;
+}